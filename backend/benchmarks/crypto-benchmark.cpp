@@ -0,0 +1,138 @@
+// Measures throughput of field encryption: legacy Base64 filter pipelines against binary envelope
+// with direct AEAD calls. Key derivation is measured separately, because PBKDF2 dominates every
+// Crypto::encrypt()/decrypt() call and would hide cost of encoding. Cost of single operation is then
+// compared between fresh cipher context per operation and cached context that only resynchronizes IV.
+//
+// Usage: crypto-benchmark [fieldSize] [iterations]
+
+#include <crypto.hpp>
+#include <cryptopp/aes.h>
+#include <cryptopp/gcm.h>
+#include <cryptopp/base64.h>
+#include <cryptopp/filters.h>
+#include <cryptopp/osrng.h>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <string>
+
+namespace {
+    /// @brief Runs operation given number of times
+    /// @return throughput in MB/s of plaintext
+    double measure(std::size_t fieldSize, std::size_t iterations, const std::function<void()>& operation) {
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < iterations; ++i) {
+            operation();
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return static_cast<double>(fieldSize * iterations) / elapsed.count() / 1e6;
+    }
+
+    void report(const char* name, double throughput) {
+        std::cout << name << ": " << throughput << " MB/s\n";
+    }
+
+    void reportLatency(const char* name, std::size_t fieldSize, double throughput) {
+        std::cout << name << ": " << static_cast<double>(fieldSize) / throughput * 1e3 << " ns/op\n";
+    }
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        std::size_t fieldSize = argc > 1 ? std::stoul(argv[1]) : 64;
+        std::size_t iterations = argc > 2 ? std::stoul(argv[2]) : 200000;
+
+        CryptoPP::AutoSeededRandomPool rng;
+        CryptoPP::SecByteBlock key(Crypto::AES_KEY_SIZE);
+        CryptoPP::SecByteBlock salt(Crypto::SALT_SIZE);
+        CryptoPP::SecByteBlock iv(Crypto::IV_SIZE);
+        rng.GenerateBlock(key, key.size());
+        rng.GenerateBlock(salt, salt.size());
+        rng.GenerateBlock(iv, iv.size());
+        std::string plaintext(fieldSize, 'x');
+
+        // Before: AEAD filter, concatenation and Base64 filter, decrypt with substr copy
+        std::string legacy;
+        report("legacy encrypt", measure(fieldSize, iterations, [&] {
+            std::string ciphertext;
+            CryptoPP::GCM<CryptoPP::AES>::Encryption enc;
+            enc.SetKeyWithIV(key, key.size(), iv, iv.size());
+            CryptoPP::StringSource ss(plaintext, true,
+                new CryptoPP::AuthenticatedEncryptionFilter(enc, new CryptoPP::StringSink(ciphertext), false, Crypto::TAG_SIZE));
+            std::string combined;
+            combined.append(reinterpret_cast<const char*>(salt.data()), salt.size());
+            combined.append(reinterpret_cast<const char*>(iv.data()), iv.size());
+            combined.append(ciphertext);
+            legacy.clear();
+            CryptoPP::StringSource ss2(combined, true, new CryptoPP::Base64Encoder(new CryptoPP::StringSink(legacy), false));
+        }));
+        report("legacy decrypt", measure(fieldSize, iterations, [&] {
+            std::string decoded;
+            CryptoPP::StringSource ss(legacy, true, new CryptoPP::Base64Decoder(new CryptoPP::StringSink(decoded)));
+            std::string encryptedData = decoded.substr(Crypto::SALT_SIZE + Crypto::IV_SIZE);
+            std::string recovered;
+            CryptoPP::GCM<CryptoPP::AES>::Decryption dec;
+            dec.SetKeyWithIV(key, key.size(), iv, iv.size());
+            CryptoPP::StringSource ss2(encryptedData, true,
+                new CryptoPP::AuthenticatedDecryptionFilter(dec, new CryptoPP::StringSink(recovered),
+                    CryptoPP::AuthenticatedDecryptionFilter::DEFAULT_FLAGS, Crypto::TAG_SIZE));
+        }));
+
+        // After: envelope written in place by EncryptAndAuthenticate, opened by DecryptAndVerify
+        std::string envelope;
+        report("envelope encrypt", measure(fieldSize, iterations, [&] {
+            envelope.assign(Crypto::ENVELOPE_OVERHEAD + plaintext.size(), '\0');
+            auto* data = reinterpret_cast<CryptoPP::byte*>(envelope.data());
+            data[0] = Crypto::ENVELOPE_VERSION;
+            std::copy(salt.begin(), salt.end(), data + 1);
+            std::copy(iv.begin(), iv.end(), data + 1 + Crypto::SALT_SIZE);
+            auto* ciphertext = data + 1 + Crypto::SALT_SIZE + Crypto::IV_SIZE;
+            CryptoPP::GCM<CryptoPP::AES>::Encryption enc;
+            enc.SetKeyWithIV(key, key.size(), iv, iv.size());
+            enc.EncryptAndAuthenticate(ciphertext, ciphertext + plaintext.size(), Crypto::TAG_SIZE, iv, static_cast<int>(iv.size()),
+                nullptr, 0, reinterpret_cast<const CryptoPP::byte*>(plaintext.data()), plaintext.size());
+        }));
+        report("envelope decrypt", measure(fieldSize, iterations, [&] {
+            const auto* data = reinterpret_cast<const CryptoPP::byte*>(envelope.data());
+            const auto* ciphertext = data + 1 + Crypto::SALT_SIZE + Crypto::IV_SIZE;
+            std::string recovered(plaintext.size(), '\0');
+            CryptoPP::GCM<CryptoPP::AES>::Decryption dec;
+            dec.SetKeyWithIV(key, key.size(), iv, iv.size());
+            if (!dec.DecryptAndVerify(reinterpret_cast<CryptoPP::byte*>(recovered.data()), ciphertext + plaintext.size(), Crypto::TAG_SIZE,
+                    iv, static_cast<int>(iv.size()), nullptr, 0, ciphertext, plaintext.size())) {
+                throw std::runtime_error("Envelope verification failed");
+            }
+        }));
+        std::cout << "stored size: legacy " << legacy.size() << " B, envelope " << envelope.size() << " B\n";
+        std::cout << "acceleration: " << Crypto::accelerationInfo() << "\n";
+
+        // Per operation cost: key schedule and GHASH table setup on every call against IV resynchronization only
+        std::string output(Crypto::ENVELOPE_OVERHEAD + plaintext.size(), '\0');
+        auto* ciphertext = reinterpret_cast<CryptoPP::byte*>(output.data());
+        auto* tag = ciphertext + plaintext.size();
+        const auto* input = reinterpret_cast<const CryptoPP::byte*>(plaintext.data());
+        reportLatency("fresh context encrypt", fieldSize, measure(fieldSize, iterations, [&] {
+            CryptoPP::GCM<CryptoPP::AES>::Encryption enc;
+            enc.SetKeyWithIV(key, key.size(), iv, iv.size());
+            enc.EncryptAndAuthenticate(ciphertext, tag, Crypto::TAG_SIZE, iv, static_cast<int>(iv.size()), nullptr, 0, input, plaintext.size());
+        }));
+        CryptoPP::GCM<CryptoPP::AES>::Encryption cached;
+        cached.SetKeyWithIV(key, key.size(), iv, iv.size());
+        reportLatency("cached context encrypt", fieldSize, measure(fieldSize, iterations, [&] {
+            rng.GenerateBlock(iv, iv.size());
+            cached.EncryptAndAuthenticate(ciphertext, tag, Crypto::TAG_SIZE, iv, static_cast<int>(iv.size()), nullptr, 0, input, plaintext.size());
+        }));
+
+        // Full round trip through Crypto, session key is derived on first call and then reused
+        Crypto crypto("benchmark-password");
+        std::string stored = crypto.encrypt(plaintext);
+        reportLatency("Crypto::encrypt", fieldSize, measure(fieldSize, iterations, [&] { stored = crypto.encrypt(plaintext); }));
+        reportLatency("Crypto::decrypt", fieldSize, measure(fieldSize, iterations, [&] { crypto.decrypt(stored); }));
+        return 0;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Benchmark failed: " << e.what() << "\n";
+        return 1;
+    }
+}
@@ -7,11 +7,26 @@
 #include <passwords.hpp>
 #include <database-manager.hpp>
 #include <auth.hpp>
+#include <change-events.hpp>
+#include <breach-corpus.hpp>
+#include <wordlist.hpp>
+#include <crypto.hpp>
+#include <admission-control.hpp>
+#include <kdf-executor.hpp>
+#include <vault-cache.hpp>
+#include <write-queue.hpp>
+#include <key-rotation.hpp>
+#include <encryption-pool.hpp>
+#include <tombstone-compactor.hpp>
+#include <search-backfill.hpp>
+#include <backup-manager.hpp>
+#include <request-trace.hpp>
 
 int main() {
     // Initialize logger
     Logger::init("./Password-Fucker.log", "Password-Fucker");
     Logger::info("Starting backend");
+    Logger::info("AES-GCM acceleration: {}", Crypto::accelerationInfo());
 
     // Register signal handlers
     try {
@@ -41,9 +56,146 @@ int main() {
         return 1;
     }
 
+    // Spread password tables of users over shard files, users table stays in main database
+    try {
+        DatabaseManager::ShardSettings shards;
+        if (configuration.shardMode == "user") {
+            shards.mode = DatabaseManager::ShardMode::User;
+        }
+        else if (configuration.shardMode == "hash") {
+            shards.mode = DatabaseManager::ShardMode::Hash;
+        }
+        else if (configuration.shardMode != "none") {
+            throw std::invalid_argument("Unknown shard mode: " + configuration.shardMode);
+        }
+        shards.count = configuration.shardCount;
+        shards.directory = configuration.shardDirectory;
+        shards.maxOpen = configuration.maxOpenShards;
+        DatabaseManager::getInstance().configureShards(shards);
+
+        auto moved = pass::SQLitePasswordRepository::getInstance().migrateToShards();
+        if (moved > 0) {
+            Logger::info("Moved passwords of {} users from main database into shards", moved);
+        }
+    }
+    catch (const std::exception& e) {
+        Logger::critical("Could not configure database shards becouse of: {}", e.what());
+        return 1;
+    }
+
+    // Map breach corpus, server works without it
+    if (!configuration.breachCorpusPath.empty()) {
+        try {
+            pass::BreachChecker::getInstance().load(configuration.breachCorpusPath);
+            Logger::info("Loaded breach corpus: {}", configuration.breachCorpusPath.string());
+        }
+        catch (const std::runtime_error& e) {
+            Logger::warn("Could not load breach corpus becouse of: {}", e.what());
+        }
+    }
+
+    // Map passphrase wordlist, server works without it
+    if (!configuration.wordlistPath.empty()) {
+        try {
+            pass::Wordlist::getInstance().load(configuration.wordlistPath);
+            Logger::info("Loaded wordlist with {} words: {}", pass::Wordlist::getInstance().size(), configuration.wordlistPath.string());
+        }
+        catch (const std::runtime_error& e) {
+            Logger::warn("Could not load wordlist becouse of: {}", e.what());
+        }
+    }
+
+    // Calibrate KDF of new users on this host, existing users are upgraded at their next login
+    if (configuration.kdfTargetMilliseconds > 0) {
+        try {
+            auto kdf = KdfParameters::calibrate(KdfParameters::algorithmFromName(configuration.kdfAlgorithm),
+                std::chrono::milliseconds(configuration.kdfTargetMilliseconds), configuration.argon2MemoryKiB, configuration.argon2Lanes);
+            Crypto::setTargetKdf(kdf);
+            Logger::info("Calibrated KDF for {} ms: {}", configuration.kdfTargetMilliseconds, kdf.toString());
+        }
+        catch (const std::exception& e) {
+            Logger::warn("Could not calibrate KDF becouse of: {} Using {}", e.what(), Crypto::targetKdf().toString());
+        }
+    }
+
+    // Limit key derivations of logins and registrations, so they cannot starve other endpoints
+    try {
+        auth::AdmissionControl::Settings admission;
+        admission.maxConcurrent = configuration.kdfConcurrency;
+        admission.queueTimeout = std::chrono::milliseconds(configuration.kdfQueueTimeoutMilliseconds);
+        admission.burst = configuration.loginBurst;
+        admission.refillPerSecond = configuration.loginRatePerMinute / 60.0;
+        auth::AdmissionControl::getInstance().configure(admission);
+    }
+    catch (const std::invalid_argument& e) {
+        Logger::warn("Could not configure admission control becouse of: {} Using default limits.", e.what());
+    }
+
+    // Keep decrypted vaults of active users in locked memory, disabled by default
+    pass::VaultCache::Settings vaultCache;
+    vaultCache.budgetBytes = static_cast<std::size_t>(configuration.vaultCacheKiB) * 1024;
+    vaultCache.idleTimeout = std::chrono::seconds(configuration.vaultCacheIdleSeconds);
+    pass::VaultCache::getInstance().configure(vaultCache);
+    pass::VaultCache::getInstance().start();
+
+    // Choose storage format of new passwords, both formats stay readable
+    pass::PasswordCrypto::setRecordEncryption(configuration.recordEncryption);
+
     // Provide secret key
     auth::AuthenticationManager::setPrivateKey("0123456789ABCDEF0123456789ABCDEF");
 
+    // Start pushing vault changes to event streams
+    events::ChangeNotifier::getInstance().start();
+
+    // Commit single password writes of concurrent requests together
+    pass::WriteQueue::Settings writeQueue;
+    writeQueue.maxBatch = configuration.groupCommitMaxBatch;
+    writeQueue.maxDelay = std::chrono::microseconds(configuration.groupCommitDelayMicroseconds);
+    pass::WriteQueue::getInstance().start(writeQueue);
+
+    // Re-encrypt vaults after password change in background at limited rate
+    try {
+        pass::KeyRotation::Settings rotation;
+        rotation.chunkSize = configuration.rotationChunkSize;
+        rotation.entriesPerSecond = configuration.rotationEntriesPerSecond;
+        pass::KeyRotation::getInstance().configure(rotation);
+    }
+    catch (const std::invalid_argument& e) {
+        Logger::warn("Could not configure key rotation becouse of: {} Using default limits.", e.what());
+    }
+    pass::KeyRotation::getInstance().start();
+
+    // Copy databases online in small steps, scheduled or on demand
+    try {
+        BackupManager::Settings backup;
+        backup.directory = configuration.backupDirectory;
+        backup.interval = std::chrono::minutes(configuration.backupIntervalMinutes);
+        backup.retention = configuration.backupRetention;
+        backup.stepPages = static_cast<int>(configuration.backupStepPages);
+        backup.stepPause = std::chrono::milliseconds(configuration.backupStepPauseMilliseconds);
+        backup.endpointsEnabled = configuration.backupEndpointsEnabled;
+        BackupManager::getInstance().configure(backup);
+    }
+    catch (const std::invalid_argument& e) {
+        Logger::warn("Could not configure backups becouse of: {} Using default settings.", e.what());
+    }
+    BackupManager::getInstance().start();
+
+    // Purge tombstones older than any delta sync worth serving
+    pass::TombstoneCompactor::Settings compactor;
+    compactor.retention = std::chrono::hours(24) * configuration.tombstoneRetentionDays;
+    pass::TombstoneCompactor::getInstance().start(compactor);
+
+    // Index entries stored before search index once per user after login
+    pass::SearchBackfill::getInstance().start();
+
+    // Log requests slower than threshold with time spent in each stage
+    timing::Clock::calibrate();
+    timing::RequestTrace::setSlowThreshold(std::chrono::milliseconds(configuration.slowRequestMilliseconds));
+
+    // Key derivations of logins and registrations run outside of HTTP threads
+    auth::KdfExecutor::getInstance().start(configuration.kdfThreads);
+
     // Initialize backend server
     Poco::Net::HTTPServer s(new MyRequestHandlerFactory, configuration.backendServerPort);
     s.start();
@@ -51,6 +203,15 @@ int main() {
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
     s.stop();
+    auth::KdfExecutor::getInstance().stop();
+    BackupManager::getInstance().stop();
+    pass::TombstoneCompactor::getInstance().stop();
+    pass::SearchBackfill::getInstance().stop();
+    pass::KeyRotation::getInstance().stop();
+    pass::EncryptionPool::getInstance().stop();
+    pass::WriteQueue::getInstance().stop();
+    events::ChangeNotifier::getInstance().stop();
+    pass::VaultCache::getInstance().stop();
 
     // Exit program
     Logger::info("Backend stopped");
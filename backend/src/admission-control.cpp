@@ -0,0 +1,68 @@
+#include <admission-control.hpp>
+#include <request-trace.hpp>
+#include <algorithm>
+#include <cmath>
+#include <format>
+
+namespace auth {
+    AdmissionControl::AdmissionControl() : slots(std::make_unique<std::counting_semaphore<>>(settings.maxConcurrent)) {}
+
+    AdmissionControl& AdmissionControl::getInstance() {
+        static AdmissionControl instance;
+        return instance;
+    }
+
+    void AdmissionControl::configure(const Settings& settings) {
+        if (settings.maxConcurrent == 0 || settings.burst == 0 || settings.refillPerSecond <= 0.0) {
+            throw std::invalid_argument("Admission control limits must be positive");
+        }
+
+        std::lock_guard<std::mutex> lock(bucketsMutex);
+        this->settings = settings;
+        slots = std::make_unique<std::counting_semaphore<>>(settings.maxConcurrent);
+        buckets.clear();
+        recent.clear();
+    }
+
+    AdmissionControl::Permit AdmissionControl::admit(const std::string& client) {
+        timing::ScopedStage stage("admission");
+        takeToken(client);
+
+        // Waiting longer than queue timeout would only move the stall to the client
+        if (!slots->try_acquire_for(settings.queueTimeout)) {
+            auto retryAfter = std::chrono::ceil<std::chrono::seconds>(settings.queueTimeout);
+            throw TooManyRequests("Too many logins in progress", std::max(retryAfter, std::chrono::seconds(1)));
+        }
+        return Permit(slots.get());
+    }
+
+    void AdmissionControl::takeToken(const std::string& client) {
+        auto now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(bucketsMutex);
+
+        auto it = buckets.find(client);
+        if (it == buckets.end()) {
+            // Least recently used client had longest time to refill, dropping its bucket forgets least
+            if (buckets.size() >= MAX_CLIENTS) {
+                buckets.erase(recent.back());
+                recent.pop_back();
+            }
+            recent.push_front(client);
+            it = buckets.emplace(client, Bucket{static_cast<double>(settings.burst), now, recent.begin()}).first;
+        }
+        else {
+            recent.splice(recent.begin(), recent, it->second.recent);
+        }
+        auto& bucket = it->second;
+        std::chrono::duration<double> elapsed = now - bucket.updated;
+        bucket.tokens = std::min<double>(settings.burst, bucket.tokens + elapsed.count() * settings.refillPerSecond);
+        bucket.updated = now;
+
+        if (bucket.tokens < 1.0) {
+            auto wait = std::ceil((1.0 - bucket.tokens) / settings.refillPerSecond);
+            throw TooManyRequests(std::format("Too many login attempts from {}", client),
+                std::chrono::seconds(static_cast<std::int64_t>(wait)));
+        }
+        bucket.tokens -= 1.0;
+    }
+}
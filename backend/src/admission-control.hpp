@@ -0,0 +1,118 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <semaphore>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace auth {
+    /// @brief Exception thrown when request is rejected by admission control, mapped to 429 response
+    class TooManyRequests : public std::runtime_error {
+    public:
+        /// @brief Constructor
+        /// @param message reason of rejection
+        /// @param retryAfter time after which client should retry
+        TooManyRequests(const std::string& message, std::chrono::seconds retryAfter)
+            : std::runtime_error(message), retryAfterSeconds(retryAfter) {}
+
+        /// @brief Gets time after which client should retry, value of Retry-After header
+        /// @return time to wait
+        std::chrono::seconds retryAfter() const { return retryAfterSeconds; }
+
+    private:
+        std::chrono::seconds retryAfterSeconds;     // Time after which client should retry
+    };
+
+    /// @brief Admission control of expensive key derivations (login and registration) implementing Singleton pattern
+    /// @note Requests pass per-client token bucket first and then bounded semaphore of concurrent derivations.
+    /// Rejection is fast, so bursts of logins cannot occupy every HTTP worker thread.
+    class AdmissionControl {
+    public:
+        /// @brief Limits of admission control
+        class Settings {
+        public:
+            std::uint32_t maxConcurrent = 2;                        // Derivations running at once
+            std::chrono::milliseconds queueTimeout{500};            // Longest wait for free derivation slot
+            std::uint32_t burst = 5;                                // Capacity of client token bucket
+            double refillPerSecond = 0.2;                           // Tokens added to client bucket per second
+        };
+
+        /// @brief Permit of running one derivation, releases slot on destruction
+        class Permit {
+        public:
+            /// @brief Constructor
+            /// @param semaphore semaphore whose slot is held
+            explicit Permit(std::counting_semaphore<>* semaphore) : semaphore(semaphore) {}
+
+            /// @brief Destructor, releases slot
+            ~Permit() { if (semaphore) semaphore->release(); }
+
+            /// @brief Move constructor
+            Permit(Permit&& other) noexcept : semaphore(std::exchange(other.semaphore, nullptr)) {}
+
+            /// @brief Delete copy, assignment and move assignment
+            Permit(const Permit&) = delete;
+            Permit& operator=(const Permit&) = delete;
+            Permit& operator=(Permit&&) = delete;
+
+        private:
+            std::counting_semaphore<>* semaphore;   // Semaphore whose slot is held
+        };
+
+        /// @brief Get singleton instance of admission control
+        /// @return Reference to admission control instance
+        static AdmissionControl& getInstance();
+
+        /// @brief Delete copy, assignment, move, move assignment constructor
+        AdmissionControl(const AdmissionControl&) = delete;
+        AdmissionControl& operator=(const AdmissionControl&) = delete;
+        AdmissionControl(AdmissionControl&&) = delete;
+        AdmissionControl& operator=(AdmissionControl&&) = delete;
+
+        /// @brief Sets limits, must be called before server starts
+        /// @param settings limits
+        /// @throw std::invalid_argument on zero concurrency, burst or refill rate
+        void configure(const Settings& settings);
+
+        /// @brief Admits expensive request of client
+        /// @param client identifier of client, e.g. remote address
+        /// @return permit to hold while derivation runs
+        /// @throw TooManyRequests when client bucket is empty or no derivation slot frees up within queue timeout
+        Permit admit(const std::string& client);
+
+        static constexpr std::size_t MAX_CLIENTS = 65536;   // Buckets kept, least recently used one is dropped above this
+
+    private:
+        /// @brief Token bucket of one client
+        class Bucket {
+        public:
+            double tokens;                                  // Available tokens
+            std::chrono::steady_clock::time_point updated;  // Time of last refill
+            std::list<std::string>::iterator recent;        // Position in list of recently used clients
+        };
+
+        /// @brief Private constructor for Singleton pattern
+        AdmissionControl();
+
+        /// @brief Private destructor
+        ~AdmissionControl() = default;
+
+        /// @brief Takes token from client bucket
+        /// @param client identifier of client
+        /// @throw TooManyRequests when bucket is empty
+        void takeToken(const std::string& client);
+
+        Settings settings;                                          // Limits
+        std::unique_ptr<std::counting_semaphore<>> slots;           // Free derivation slots
+        std::unordered_map<std::string, Bucket> buckets;            // Token buckets by client
+        std::list<std::string> recent;                              // Clients with bucket, most recently used first
+        std::mutex bucketsMutex;                                    // Mutex guarding buckets
+    };
+}
@@ -2,6 +2,15 @@
 #include <Poco/JWT/Token.h>
 #include <Poco/JWT/Signer.h>
 #include <crypto.hpp>
+#include <log.hpp>
+#include <request-trace.hpp>
+#include <secure-arena.hpp>
+#include <format>
+#include <cryptopp/osrng.h>
+#include <cryptopp/hex.h>
+#include <cryptopp/filters.h>
+#include <cryptopp/hmac.h>
+#include <cryptopp/sha.h>
 
 namespace auth {
     nlohmann::json User::toJson() const {
@@ -46,6 +55,26 @@ namespace auth {
                 surname TEXT NOT NULL
             )
         )");
+
+        // Users created before KDF parameters were stored used legacy PBKDF2
+        SQLite::Statement column(*db, "SELECT COUNT(*) FROM pragma_table_info('users') WHERE name = 'kdf'");
+        if (column.executeStep() && column.getColumn(0).getInt() == 0) {
+            db->exec("ALTER TABLE users ADD COLUMN kdf TEXT NOT NULL DEFAULT '" + KdfParameters().toString() + "'");
+        }
+
+        // Unfinished re-encryption after change of master password, survives restart
+        SQLite::Statement rotation(*db, "SELECT COUNT(*) FROM pragma_table_info('users') WHERE name = 'rotation'");
+        if (rotation.executeStep() && rotation.getColumn(0).getInt() == 0) {
+            db->exec("ALTER TABLE users ADD COLUMN rotation BLOB");
+            db->exec("ALTER TABLE users ADD COLUMN rotationCursor INTEGER NOT NULL DEFAULT 0");
+        }
+
+        // Keyed hash of login, lets login find its user without decrypting all of them
+        SQLite::Statement loginKey(*db, "SELECT COUNT(*) FROM pragma_table_info('users') WHERE name = 'loginKey'");
+        if (loginKey.executeStep() && loginKey.getColumn(0).getInt() == 0) {
+            db->exec("ALTER TABLE users ADD COLUMN loginKey TEXT");
+        }
+        db->exec("CREATE INDEX IF NOT EXISTS idx_users_login_key ON users(loginKey)");
     }
 
     SQLiteUserRepository& SQLiteUserRepository::getInstance() {
@@ -53,22 +82,62 @@ namespace auth {
         return instance;
     }
 
-    std::list<User> SQLiteUserRepository::getAll() {
+    namespace {
+        /// @brief Reads all rows of query into batch
+        /// @param query query selecting whole users
+        /// @param users batch to append to
+        void readUsers(SQLite::Statement& query, UserBatch& users) {
+            auto text = [&query, &users](const char* column) {
+                auto value = query.getColumn(column);
+                auto data = static_cast<const char*>(value.getBlob());
+                return users.store(std::string_view(data, static_cast<std::size_t>(value.getBytes())));
+            };
+            while (query.executeStep()) {
+                UserRow u;
+                u.id = query.getColumn("id").getUInt();
+                u.login = text("login");
+                u.password = text("password");
+                u.name = text("name");
+                u.surname = text("surname");
+                u.kdf = text("kdf");
+                u.loginKey = text("loginKey");
+                users.add() = u;
+            }
+        }
+    }
+
+    UserBatch SQLiteUserRepository::getAll() {
         std::lock_guard<std::mutex> lock(DatabaseManager::getInstance().getMutex());
-        std::list<User> passwords;
+        UserBatch users;
         
         SQLite::Statement query(*db, "SELECT * FROM users");
-        while (query.executeStep()) {
-            User u;
-            u.id = query.getColumn("id").getUInt();
-            u.login = query.getColumn("login").getString();
-            u.password = query.getColumn("password").getString();
-            u.name = query.getColumn("name").getString();
-            u.surname = query.getColumn("surname").getString();
-            passwords.push_back(u);
-        }
+        readUsers(query, users);
         
-        return passwords;
+        return users;
+    }
+
+    UserBatch SQLiteUserRepository::getByLoginKey(const std::string& loginKey) {
+        std::lock_guard<std::mutex> lock(DatabaseManager::getInstance().getMutex());
+        UserBatch users;
+
+        SQLite::Statement query(*db, "SELECT * FROM users WHERE loginKey = ?");
+        query.bind(1, loginKey);
+        readUsers(query, users);
+        if (users.empty()) {
+            SQLite::Statement legacy(*db, "SELECT * FROM users WHERE loginKey IS NULL");
+            readUsers(legacy, users);
+        }
+
+        return users;
+    }
+
+    void SQLiteUserRepository::setLoginKey(const std::uint32_t id, const std::string& loginKey) {
+        std::lock_guard<std::mutex> lock(DatabaseManager::getInstance().getMutex());
+
+        SQLite::Statement query(*db, "UPDATE users SET loginKey = ? WHERE id = ?");
+        query.bind(1, loginKey);
+        query.bind(2, static_cast<int64_t>(id));
+        query.exec();
     }
 
     std::optional<User> SQLiteUserRepository::getById(const std::uint32_t& id) {
@@ -84,6 +153,7 @@ namespace auth {
             u.password = query.getColumn("password").getString();
             u.name = query.getColumn("name").getString();
             u.surname = query.getColumn("surname").getString();
+            u.kdf = KdfParameters::fromString(query.getColumn("kdf").getString());
             
             return u;
         }
@@ -95,12 +165,19 @@ namespace auth {
         std::lock_guard<std::mutex> lock(DatabaseManager::getInstance().getMutex());
         
         SQLite::Statement query(*db, 
-            "INSERT INTO users (login, password, name, surname) VALUES (?, ?, ?, ?)");
+            "INSERT INTO users (login, password, name, surname, kdf, loginKey) VALUES (?, ?, ?, ?, ?, ?)");
         
-        query.bind(1, user.login);
-        query.bind(2, user.password);
-        query.bind(3, user.name);
-        query.bind(4, user.surname);
+        query.bind(1, user.login.data(), static_cast<int>(user.login.size()));
+        query.bind(2, user.password.data(), static_cast<int>(user.password.size()));
+        query.bind(3, user.name.data(), static_cast<int>(user.name.size()));
+        query.bind(4, user.surname.data(), static_cast<int>(user.surname.size()));
+        query.bind(5, user.kdf.toString());
+        if (user.loginKey.empty()) {
+            query.bind(6);
+        }
+        else {
+            query.bind(6, user.loginKey);
+        }
         
         query.exec();
         user.id = static_cast<std::uint32_t>(db->getLastInsertRowid());
@@ -110,12 +187,14 @@ namespace auth {
         std::lock_guard<std::mutex> lock(DatabaseManager::getInstance().getMutex());
         
         SQLite::Statement query(*db,
-            "UPDATE users SET login = ?, password = ?, name = ?, surname = ? WHERE id = ?");
+            "UPDATE users SET login = ?, password = ?, name = ?, surname = ?, kdf = ? WHERE id = ?");
         
-        query.bind(1, user.login);
-        query.bind(2, user.password);
-        query.bind(3, user.name);
-        query.bind(4, user.surname);
+        query.bind(1, user.login.data(), static_cast<int>(user.login.size()));
+        query.bind(2, user.password.data(), static_cast<int>(user.password.size()));
+        query.bind(3, user.name.data(), static_cast<int>(user.name.size()));
+        query.bind(4, user.surname.data(), static_cast<int>(user.surname.size()));
+        query.bind(5, user.kdf.toString());
+        query.bind(6, static_cast<int64_t>(user.id));
         query.exec();
     }
 
@@ -127,10 +206,80 @@ namespace auth {
         query.exec();
     }
 
+    bool SQLiteUserRepository::startKeyRotation(const User& user, const std::string& previous, const std::string& expectedPassword) {
+        std::lock_guard<std::mutex> lock(DatabaseManager::getInstance().getMutex());
+        
+        // Compare and swap, change verified against credentials replaced meanwhile must not win
+        SQLite::Statement query(*db,
+            "UPDATE users SET login = ?, password = ?, name = ?, surname = ?, kdf = ?, rotation = ?, rotationCursor = 0 "
+            "WHERE id = ? AND rotation IS NULL AND password = ?");
+        
+        query.bind(1, user.login.data(), static_cast<int>(user.login.size()));
+        query.bind(2, user.password.data(), static_cast<int>(user.password.size()));
+        query.bind(3, user.name.data(), static_cast<int>(user.name.size()));
+        query.bind(4, user.surname.data(), static_cast<int>(user.surname.size()));
+        query.bind(5, user.kdf.toString());
+        query.bind(6, previous.data(), static_cast<int>(previous.size()));
+        query.bind(7, static_cast<int64_t>(user.id));
+        query.bind(8, expectedPassword.data(), static_cast<int>(expectedPassword.size()));
+        return query.exec() > 0;
+    }
+
+    bool SQLiteUserRepository::upgradeCredentials(const User& user, const std::string& expectedPassword) {
+        std::lock_guard<std::mutex> lock(DatabaseManager::getInstance().getMutex());
+        
+        // Compare and swap, upgrade must not overwrite credentials swapped by password change
+        SQLite::Statement query(*db,
+            "UPDATE users SET login = ?, password = ?, name = ?, surname = ?, kdf = ? "
+            "WHERE id = ? AND password = ? AND rotation IS NULL");
+        
+        query.bind(1, user.login.data(), static_cast<int>(user.login.size()));
+        query.bind(2, user.password.data(), static_cast<int>(user.password.size()));
+        query.bind(3, user.name.data(), static_cast<int>(user.name.size()));
+        query.bind(4, user.surname.data(), static_cast<int>(user.surname.size()));
+        query.bind(5, user.kdf.toString());
+        query.bind(6, static_cast<int64_t>(user.id));
+        query.bind(7, expectedPassword.data(), static_cast<int>(expectedPassword.size()));
+        return query.exec() > 0;
+    }
+
+    std::optional<KeyRotationState> SQLiteUserRepository::getKeyRotation(const std::uint32_t id) {
+        std::lock_guard<std::mutex> lock(DatabaseManager::getInstance().getMutex());
+        
+        SQLite::Statement query(*db, "SELECT rotation, rotationCursor FROM users WHERE id = ? AND rotation IS NOT NULL");
+        query.bind(1, static_cast<int64_t>(id));
+        
+        if (query.executeStep()) {
+            KeyRotationState state;
+            state.previous = query.getColumn(0).getString();
+            state.cursor = query.getColumn(1).getUInt();
+            return state;
+        }
+        
+        return std::nullopt;
+    }
+
+    void SQLiteUserRepository::setKeyRotationCursor(const std::uint32_t id, const std::uint32_t cursor) {
+        std::lock_guard<std::mutex> lock(DatabaseManager::getInstance().getMutex());
+        
+        SQLite::Statement query(*db, "UPDATE users SET rotationCursor = ? WHERE id = ?");
+        query.bind(1, static_cast<int64_t>(cursor));
+        query.bind(2, static_cast<int64_t>(id));
+        query.exec();
+    }
+
+    void SQLiteUserRepository::finishKeyRotation(const std::uint32_t id) {
+        std::lock_guard<std::mutex> lock(DatabaseManager::getInstance().getMutex());
+        
+        SQLite::Statement query(*db, "UPDATE users SET rotation = NULL, rotationCursor = 0 WHERE id = ?");
+        query.bind(1, static_cast<int64_t>(id));
+        query.exec();
+    }
+
     // AuthenticationManager implementation
     AuthenticationManager::AuthenticationManager() : repo(SQLiteUserRepository::getInstance()) {}
 
-    std::list<User> AuthenticationManager::getAllUsers() {
+    UserBatch AuthenticationManager::getAllUsers() {
         return repo.getAll();
     }
 
@@ -156,10 +305,24 @@ namespace auth {
         secretKey = key;
     }
 
+    std::string AuthenticationManager::loginKey(const std::string& login) {
+        // Domain prefix keeps hash apart from JWT signatures made with the same secret
+        const std::string message = "login-key:" + login;
+        CryptoPP::HMAC<CryptoPP::SHA256> hmac(reinterpret_cast<const CryptoPP::byte*>(secretKey.data()), secretKey.size());
+        CryptoPP::byte digest[CryptoPP::SHA256::DIGESTSIZE];
+        hmac.CalculateDigest(digest, reinterpret_cast<const CryptoPP::byte*>(message.data()), message.size());
+
+        std::string key;
+        CryptoPP::StringSource ss(digest, sizeof(digest), true, new CryptoPP::HexEncoder(new CryptoPP::StringSink(key), false));
+        return key;
+    }
+
     std::optional<User> AuthenticationManager::checkCredentials(const std::string& login, const std::string& password) {
-        AuthenticationManager menager;
-        auto users = menager.getAllUsers();
+        const auto key = loginKey(login);
+        auto& repo = SQLiteUserRepository::getInstance();
+        auto users = repo.getByLoginKey(key);
         for (const auto& user : users) {
+            // Envelopes carry their KDF parameters, stored ones are needed only to detect outdated users
             Crypto crypto(password);
             auto descryptedLogin = crypto.decrypt(user.login);
             auto descryptedPassword = crypto.decrypt(user.password);
@@ -170,12 +333,61 @@ namespace auth {
                 decryptedUser.name = crypto.decrypt(user.name);
                 decryptedUser.surname = crypto.decrypt(user.surname);
                 decryptedUser.id = user.id;
+                decryptedUser.kdf = KdfParameters::fromString(user.kdf);
+                decryptedUser.loginKey = key;
+
+                // User found by scan of users without login key is indexed from now on
+                if (user.loginKey.empty()) {
+                    repo.setLoginKey(user.id, key);
+                }
+
+                // Login must not fail because of upgrade, user stays on old KDF until next login
+                if (decryptedUser.kdf != Crypto::targetKdf()) {
+                    const std::string expectedPassword(user.password);
+                    bool upgraded = true;
+                    try {
+                        upgraded = upgradeKdf(decryptedUser, expectedPassword);
+                    }
+                    catch (const std::exception& e) {
+                        Logger::warn("Could not upgrade KDF of user {}: {}", user.id, e.what());
+                    }
+
+                    // Upgrade is skipped while re-encryption runs, but changed password must not be registered
+                    if (!upgraded) {
+                        auto stored = repo.getById(user.id);
+                        if (!stored || stored->password != expectedPassword) {
+                            Logger::warn("Password of user {} changed while login was verified", user.id);
+                            util::wipe(decryptedUser.password);
+                            return std::nullopt;
+                        }
+                    }
+                }
                 return decryptedUser;
             }
         }
         return std::nullopt;
     }
 
+    bool AuthenticationManager::upgradeKdf(User& user, const std::string& expectedPassword) {
+        auto kdf = Crypto::targetKdf();
+        Crypto crypto(user.password, kdf);
+
+        User encryptedUser;
+        encryptedUser.id = user.id;
+        encryptedUser.login = crypto.encrypt(user.login);
+        encryptedUser.password = crypto.encrypt(user.password);
+        encryptedUser.name = crypto.encrypt(user.name);
+        encryptedUser.surname = crypto.encrypt(user.surname);
+        encryptedUser.kdf = kdf;
+
+        if (!SQLiteUserRepository::getInstance().upgradeCredentials(encryptedUser, expectedPassword)) {
+            return false;
+        }
+        Logger::info("Upgraded KDF of user {} from {} to {}", user.id, user.kdf.toString(), kdf.toString());
+        user.kdf = kdf;
+        return true;
+    }
+
     std::string AuthenticationManager::generateJWTToken(const User& user) {
         Poco::JWT::Token token;
         token.setType("JWT");
@@ -191,6 +403,7 @@ namespace auth {
     }
 
     std::uint32_t AuthenticationManager::validateJWTToken(const std::string& token) {
+        timing::ScopedStage stage("auth");
         Poco::JWT::Signer signer(secretKey);
         Poco::JWT::Token jwt;
         
@@ -199,4 +412,40 @@ namespace auth {
         }
         throw std::runtime_error("Token is not valid.");
     }
-}
\ No newline at end of file
+
+    StreamTickets& StreamTickets::getInstance() {
+        static StreamTickets instance;
+        return instance;
+    }
+
+    std::string StreamTickets::issue(const std::uint32_t userId) {
+        CryptoPP::AutoSeededRandomPool rng;
+        CryptoPP::byte random[TICKET_BYTES];
+        rng.GenerateBlock(random, sizeof(random));
+        std::string ticket;
+        CryptoPP::StringSource ss(random, sizeof(random), true, new CryptoPP::HexEncoder(new CryptoPP::StringSink(ticket), false));
+
+        auto now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(mtx);
+        std::erase_if(tickets, [now](const auto& entry) { return entry.second.expires <= now; });
+        if (tickets.size() >= MAX_TICKETS) {
+            throw std::runtime_error("Too many stream tickets outstanding");
+        }
+        tickets[ticket] = Ticket{ userId, now + TTL };
+        return ticket;
+    }
+
+    std::uint32_t StreamTickets::redeem(const std::string& ticket) {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = tickets.find(ticket);
+        if (it == tickets.end()) {
+            throw std::runtime_error("Stream ticket is not valid");
+        }
+        auto issued = it->second;
+        tickets.erase(it);
+        if (issued.expires <= std::chrono::steady_clock::now()) {
+            throw std::runtime_error("Stream ticket expired");
+        }
+        return issued.userId;
+    }
+}
@@ -8,7 +8,12 @@
 #include <SQLiteCpp/SQLiteCpp.h>
 #include <memory>
 #include <mutex>
+#include <chrono>
+#include <unordered_map>
 #include <database-manager.hpp>
+#include <row-batch.hpp>
+#include <kdf.hpp>
+#include <string_view>
 
 namespace auth {
     /// @brief Class with User object
@@ -19,6 +24,8 @@ namespace auth {
         std::string password;       // password of user     
         std::string name;           // name of user 
         std::string surname;        // surname of user     
+        KdfParameters kdf;          // KDF protecting credentials of user
+        std::string loginKey;       // indexed login key, see AuthenticationManager::loginKey(), empty if unknown
 
         /// @brief Function to convert user object to Json
         /// @return json object
@@ -30,6 +37,28 @@ namespace auth {
         static User fromJson(const nlohmann::json& user);
     };
 
+    /// @brief Class with user row as stored in database, text fields are views into UserBatch
+    class UserRow {
+    public:
+        std::uint32_t id = 0;           // id of user
+        std::string_view login;         // encrypted login of user
+        std::string_view password;      // encrypted password of user
+        std::string_view name;          // encrypted name of user
+        std::string_view surname;       // encrypted surname of user
+        std::string_view kdf;           // KDF parameters of user in text form
+        std::string_view loginKey;      // indexed login key, empty if not stored yet
+    };
+
+    /// @brief Flat batch of user rows
+    using UserBatch = util::RowBatch<UserRow>;
+
+    /// @brief Class with unfinished re-encryption of vault after change of master password
+    class KeyRotationState {
+    public:
+        std::string previous;       // previous password encrypted with current one
+        std::uint32_t cursor = 0;   // id of last re-encrypted password
+    };
+
     /// @brief Interface for User repository
     class IUserRepository {
     public:
@@ -37,8 +66,13 @@ namespace auth {
         virtual ~IUserRepository() = default;
 
         /// @brief Virtual getter for users
-        /// @return list of users
-        virtual std::list<User> getAll() = 0;
+        /// @return batch of users
+        virtual UserBatch getAll() = 0;
+
+        /// @brief Virtual getter for users with given login key
+        /// @param loginKey login key, see AuthenticationManager::loginKey()
+        /// @return batch of users with this key, or users without key when none has it
+        virtual UserBatch getByLoginKey(const std::string& loginKey) = 0;
         
         /// @brief Virtual function to read user with given id
         /// @param id id of user to read
@@ -85,8 +119,20 @@ namespace auth {
         static SQLiteUserRepository& getInstance();
 
         /// @brief Get all users from repository
-        /// @return List of all users
-        std::list<User> getAll() override;
+        /// @return Batch of all users
+        UserBatch getAll() override;
+
+        /// @brief Get users with given login key, indexed lookup
+        /// @note Users created before login keys were stored have none, they are returned when no user has
+        /// the key and get it on their next login, see setLoginKey()
+        /// @param loginKey login key, see AuthenticationManager::loginKey()
+        /// @return batch of users with this key, or users without key when none has it
+        UserBatch getByLoginKey(const std::string& loginKey) override;
+
+        /// @brief Store login key of user
+        /// @param id ID of user
+        /// @param loginKey login key, see AuthenticationManager::loginKey()
+        void setLoginKey(const std::uint32_t id, const std::string& loginKey);
 
         /// @brief Get user by its id
         /// @param id ID of user to retrieve
@@ -105,6 +151,33 @@ namespace auth {
         /// @param id ID of user to remove
         void remove(const std::uint32_t id) override;
 
+        /// @brief Replace credentials of user and record key rotation in single statement
+        /// @param user User with credentials encrypted with new password
+        /// @param previous Previous password encrypted with new one
+        /// @param expectedPassword Stored encrypted password the caller verified, credentials are replaced only if it is unchanged
+        /// @return false when user was not found, credentials changed meanwhile or rotation is already recorded
+        bool startKeyRotation(const User& user, const std::string& previous, const std::string& expectedPassword);
+
+        /// @brief Replace credentials of user re-encrypted with another KDF
+        /// @param user User with credentials encrypted with the same password and new KDF
+        /// @param expectedPassword Stored encrypted password the caller verified, credentials are replaced only if it is unchanged
+        /// @return false when user was not found, credentials changed meanwhile or key rotation runs
+        bool upgradeCredentials(const User& user, const std::string& expectedPassword);
+
+        /// @brief Get unfinished key rotation of user
+        /// @param id ID of user
+        /// @return Optional containing state if rotation is not finished
+        std::optional<KeyRotationState> getKeyRotation(const std::uint32_t id);
+
+        /// @brief Store progress of key rotation
+        /// @param id ID of user
+        /// @param cursor ID of last re-encrypted password
+        void setKeyRotationCursor(const std::uint32_t id, const std::uint32_t cursor);
+
+        /// @brief Forget finished key rotation together with previous password
+        /// @param id ID of user
+        void finishKeyRotation(const std::uint32_t id);
+
         /// @brief Execute custom database operation with automatic locking
         /// @tparam Func Type of lambda function
         /// @param operation Lambda function with database operation
@@ -129,8 +202,8 @@ namespace auth {
         static std::string secretKey;
 
         /// @brief Get all users
-        /// @return List of all users
-        std::list<User> getAllUsers();
+        /// @return Batch of all users
+        UserBatch getAllUsers();
 
         /// @brief Get user by id
         /// @param id ID of user to retrieve
@@ -162,12 +235,27 @@ namespace auth {
         /// @param key key for JWT signer
         static void setPrivateKey(const std::string& key);
 
+        /// @brief Computes key under which user is looked up at login
+        /// @note Logins are stored encrypted with password of user, so keyed hash with server secret lets
+        /// login find its row without trying key derivation of every user
+        /// @param login plaintext login
+        /// @return HMAC-SHA256 of login in hex format
+        static std::string loginKey(const std::string& login);
+
         /// @brief Function to check credentials for loging in
+        /// @note Only users with matching login key are decrypted, so login runs one key derivation.
+        /// Credentials of user with KDF other than Crypto::targetKdf() are re-encrypted with target KDF
         /// @param login user login 
         /// @param password user password
-        /// @return User object when credentials correct, nullopt otherwise
+        /// @return User object when credentials correct, nullopt otherwise or when password was changed while being verified
         static std::optional<User> checkCredentials(const std::string& login, const std::string& password);
 
+        /// @brief Function to re-encrypt credentials of user with Crypto::targetKdf()
+        /// @param user decrypted user, its KDF is updated on success
+        /// @param expectedPassword stored encrypted password the user was verified against
+        /// @return false when credentials changed since they were verified, nothing is written then
+        static bool upgradeKdf(User& user, const std::string& expectedPassword);
+
         /// @brief Function to generate JWT token
         /// @param user user for who generate token
         /// @return string with JWT
@@ -178,4 +266,50 @@ namespace auth {
         /// @return id of user carried in token
         static std::uint32_t validateJWTToken(const std::string& token);
     };
+
+    /// @brief Short-lived single-use tickets opening event streams, implementing Singleton pattern
+    /// @note Browser EventSource cannot set Authorization header, so credential of stream has to travel in URL.
+    /// Ticket issued to authenticated request replaces session JWT there, so URLs in proxy logs or history are useless.
+    class StreamTickets {
+    public:
+        /// @brief Get singleton instance of tickets
+        /// @return Reference to tickets instance
+        static StreamTickets& getInstance();
+
+        /// @brief Delete copy, assignment, move, move assignment constructor
+        StreamTickets(const StreamTickets&) = delete;
+        StreamTickets& operator=(const StreamTickets&) = delete;
+        StreamTickets(StreamTickets&&) = delete;
+        StreamTickets& operator=(StreamTickets&&) = delete;
+
+        /// @brief Issues ticket for user
+        /// @param userId ID of authenticated user
+        /// @return random ticket valid for TTL
+        /// @throw std::runtime_error when too many tickets are outstanding
+        std::string issue(const std::uint32_t userId);
+
+        /// @brief Redeems ticket, it cannot be used again
+        /// @param ticket ticket from issue()
+        /// @return ID of user ticket was issued to
+        /// @throw std::runtime_error when ticket is unknown, used or expired
+        std::uint32_t redeem(const std::string& ticket);
+
+        static constexpr std::chrono::seconds TTL{30};              // Time to open stream with ticket
+        static constexpr std::size_t MAX_TICKETS = 10000;           // Outstanding tickets at most
+        static constexpr std::size_t TICKET_BYTES = 32;             // Random bytes of ticket
+
+    private:
+        /// @brief Private constructor for Singleton pattern
+        StreamTickets() = default;
+
+        /// @brief Outstanding ticket
+        class Ticket {
+        public:
+            std::uint32_t userId;                                   // ID of user ticket was issued to
+            std::chrono::steady_clock::time_point expires;          // End of validity
+        };
+
+        std::unordered_map<std::string, Ticket> tickets;            // Outstanding tickets
+        std::mutex mtx;                                             // Mutex guarding tickets
+    };
 }
\ No newline at end of file
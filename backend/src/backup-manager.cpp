@@ -0,0 +1,285 @@
+#include <backup-manager.hpp>
+#include <key-rotation.hpp>
+#include <log.hpp>
+#include <utilities.hpp>
+#include <SQLiteCpp/Backup.h>
+#include <algorithm>
+#include <format>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+nlohmann::json BackupManager::Status::toJson() const {
+    return {
+        { "running", running },
+        { "file", file },
+        { "remainingPages", remainingPages },
+        { "totalPages", totalPages },
+        { "lastSnapshot", std::filesystem::path(lastSnapshot).filename().string() },
+        { "lastFinishedAt", lastFinishedAt },
+        { "lastError", lastError }
+    };
+}
+
+BackupManager& BackupManager::getInstance() {
+    static BackupManager manager;
+    return manager;
+}
+
+BackupManager::~BackupManager() {
+    stop();
+}
+
+void BackupManager::configure(const Settings& settings) {
+    if (settings.stepPages <= 0 || settings.retention == 0) {
+        throw std::invalid_argument("Backup step and retention must be positive");
+    }
+    std::lock_guard<std::mutex> lock(mtx);
+    this->settings = settings;
+}
+
+void BackupManager::start() {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!worker.joinable()) {
+        worker = std::jthread([this](std::stop_token stopToken) { run(stopToken); });
+    }
+}
+
+void BackupManager::stop() {
+    if (worker.joinable()) {
+        worker.request_stop();
+        cv.notify_all();
+        worker.join();
+    }
+}
+
+bool BackupManager::request() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (requested || state.running) {
+            return false;
+        }
+        requested = true;
+    }
+    cv.notify_all();
+    return true;
+}
+
+BackupManager::Status BackupManager::status() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return state;
+}
+
+bool BackupManager::endpointsEnabled() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return settings.endpointsEnabled;
+}
+
+void BackupManager::run(std::stop_token stopToken) {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            if (settings.interval.count() > 0) {
+                cv.wait_for(lock, stopToken, settings.interval, [this]() { return requested; });
+            }
+            else {
+                cv.wait(lock, stopToken, [this]() { return requested; });
+            }
+            if (stopToken.stop_requested()) {
+                return;
+            }
+            requested = false;
+            state.running = true;
+            state.lastError.clear();
+        }
+
+        std::filesystem::path snapshot;
+        std::string error;
+        try {
+            snapshot = backup(stopToken);
+        }
+        catch (const std::exception& e) {
+            error = e.what();
+            Logger::error("Backup failed: {}", e.what());
+        }
+
+        std::lock_guard<std::mutex> lock(mtx);
+        state.running = false;
+        state.file.clear();
+        state.remainingPages = 0;
+        state.totalPages = 0;
+        state.lastError = error;
+        state.lastFinishedAt = util::time::toString(std::chrono::system_clock::now());
+        if (!snapshot.empty()) {
+            state.lastSnapshot = snapshot.string();
+        }
+    }
+}
+
+std::filesystem::path BackupManager::backup(std::stop_token stopToken) {
+    auto& manager = DatabaseManager::getInstance();
+    auto directory = snapshotsDirectory();
+    auto name = snapshotName(directory);
+    auto partial = directory / (name + PARTIAL_SUFFIX);
+    std::filesystem::create_directories(partial);
+
+    // Re-encryption rewrites credentials in main database and entries in shards, which are copied at different times,
+    // so it is paused before shards are enumerated
+    pass::KeyRotation::Pause rotationPause;
+
+    // Main database holds users, in None mode also all per-user tables. Registration is not paused, shard created
+    // after enumeration is not copied, so user registered meanwhile may be restored with empty vault.
+    using Pin = std::function<std::shared_ptr<DatabaseManager::Shard>()>;
+    std::vector<std::pair<Pin, std::filesystem::path>> sources;
+    auto mainPath = std::filesystem::path(manager.getDatabase()->getFilename());
+    if (manager.getShardSettings().mode == DatabaseManager::ShardMode::None) {
+        sources.emplace_back([&manager]() { return manager.pinShard(0); }, partial / mainPath.filename());
+    }
+    else {
+        sources.emplace_back([&manager]() {
+            return std::make_shared<DatabaseManager::Shard>(manager.getDatabase(), manager.getMutex());
+        }, partial / mainPath.filename());
+        for (auto key : manager.storedShards()) {
+            sources.emplace_back([&manager, key]() { return manager.pinShard(key); }, partial / "shards" / manager.getShardPath(key).filename());
+        }
+    }
+
+    // Shard is pinned only while it is copied, so backup does not hold all shards open past limit of LRU
+    for (auto& [pin, target] : sources) {
+        std::filesystem::create_directories(target.parent_path());
+        auto source = pin();
+        if (!copy(source, target, stopToken)) {
+            Logger::warn("Backup {} abandoned on stop", name);
+            std::error_code ignored;
+            std::filesystem::remove_all(partial, ignored);
+            return {};
+        }
+
+        // Shard is released as soon as it is copied, so it can be closed by LRU again
+        source.reset();
+        verify(target);
+    }
+
+    // Snapshot is published only when all files passed integrity check
+    auto snapshot = directory / name;
+    if (std::filesystem::exists(snapshot)) {
+        throw std::runtime_error(std::format("Snapshot {} already exists", snapshot.string()));
+    }
+    std::filesystem::rename(partial, snapshot);
+    Logger::info("Backup {} written with {} database files", snapshot.string(), sources.size());
+    applyRetention(directory);
+    return snapshot;
+}
+
+bool BackupManager::copy(const std::shared_ptr<DatabaseManager::Shard>& source, const std::filesystem::path& target, std::stop_token stopToken) {
+    Settings limits;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        limits = settings;
+        state.file = target.filename().string();
+    }
+
+    SQLite::Database destination(target.string(), SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+    std::unique_ptr<SQLite::Backup> backup;
+    {
+        DatabaseManager::Lease lease(source);
+        backup = std::make_unique<SQLite::Backup>(destination, lease.database());
+    }
+
+    // Backup touches source connection until it is finished, so it is released under lock of source too
+    auto finish = [&source, &backup]() {
+        DatabaseManager::Lease lease(source);
+        backup.reset();
+    };
+
+    try {
+        while (true) {
+            int remaining = 0;
+            {
+                DatabaseManager::Lease lease(source);
+                backup->executeStep(limits.stepPages);
+                remaining = backup->getRemainingPageCount();
+                std::lock_guard<std::mutex> lock(mtx);
+                state.remainingPages = remaining;
+                state.totalPages = backup->getTotalPageCount();
+            }
+            if (remaining == 0) {
+                break;
+            }
+
+            // Pause between steps is what leaves database to requests
+            std::unique_lock<std::mutex> lock(mtx);
+            cv.wait_for(lock, stopToken, limits.stepPause, []() { return false; });
+            if (stopToken.stop_requested()) {
+                lock.unlock();
+                finish();
+                return false;
+            }
+        }
+    }
+    catch (...) {
+        finish();
+        throw;
+    }
+    finish();
+    return true;
+}
+
+void BackupManager::verify(const std::filesystem::path& path) {
+    SQLite::Database database(path.string(), SQLite::OPEN_READONLY);
+    SQLite::Statement query(database, "PRAGMA integrity_check");
+    std::string result = query.executeStep() ? query.getColumn(0).getString() : "no result";
+    if (result != "ok") {
+        throw std::runtime_error(std::format("Integrity check of {} failed: {}", path.string(), result));
+    }
+}
+
+void BackupManager::applyRetention(const std::filesystem::path& directory) {
+    std::size_t retention = 0;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        retention = settings.retention;
+    }
+
+    // Names are timestamps, so lexical order is order of creation
+    std::vector<std::filesystem::path> snapshots;
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        if (!entry.is_directory()) {
+            continue;
+        }
+        if (entry.path().filename().string().ends_with(PARTIAL_SUFFIX)) {
+            // Left by crash or failed check, only one backup runs at a time
+            std::filesystem::remove_all(entry.path());
+            continue;
+        }
+        snapshots.push_back(entry.path());
+    }
+    std::sort(snapshots.begin(), snapshots.end(), std::greater<>());
+    for (std::size_t i = retention; i < snapshots.size(); ++i) {
+        Logger::info("Deleting backup {} above retention", snapshots[i].string());
+        std::filesystem::remove_all(snapshots[i]);
+    }
+}
+
+std::string BackupManager::snapshotName(const std::filesystem::path& directory) {
+    // Millisecond already taken by another snapshot is skipped forward, so names stay unique and ordered
+    auto time = std::chrono::time_point_cast<std::chrono::milliseconds>(std::chrono::system_clock::now());
+    while (true) {
+        auto milliseconds = time.time_since_epoch().count() % 1000;
+        auto name = std::format("{}.{:03}Z", util::time::toString(time, "%Y%m%dT%H%M%S", util::time::Zone::UTC), milliseconds);
+        if (!std::filesystem::exists(directory / name) && !std::filesystem::exists(directory / (name + PARTIAL_SUFFIX))) {
+            return name;
+        }
+        time += std::chrono::milliseconds(1);
+    }
+}
+
+std::filesystem::path BackupManager::snapshotsDirectory() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!settings.directory.empty()) {
+            return settings.directory;
+        }
+    }
+    return std::filesystem::path(DatabaseManager::getInstance().getDatabase()->getFilename()).parent_path() / "backups";
+}
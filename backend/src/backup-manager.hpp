@@ -0,0 +1,135 @@
+#pragma once
+
+#include <fix.hpp>
+#include <database-manager.hpp>
+#include <nlohmann/json.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/// @brief Online backups of main database and shards implementing Singleton pattern
+/// @note Databases are copied with SQLite incremental backup API through their own connections, few pages per step.
+/// Database is locked only for single step and backup thread pauses between steps, so requests keep running.
+/// Copying through the same connection which serves writes keeps backup consistent without restarts.
+/// Snapshot is written into timestamped directory, checked with integrity_check and only then published.
+/// @note Every file is consistent on its own, but files are copied one after another, so snapshot is not a single
+/// point in time across main database and shards. Key rotation and password changes are paused while backup runs,
+/// since restored credentials and entries sealed with another password would leave vault unreadable.
+class BackupManager {
+public:
+    /// @brief Settings of backups
+    class Settings {
+    public:
+        std::filesystem::path directory;                // Directory of snapshots, empty for "backups" next to main database
+        std::chrono::minutes interval{0};               // Interval of scheduled backups, 0 for backups on demand only
+        std::size_t retention = 7;                      // Verified snapshots kept, older ones are deleted
+        int stepPages = 64;                             // Pages copied under single lock of database
+        std::chrono::milliseconds stepPause{5};         // Pause between steps leaving database to requests
+        bool endpointsEnabled = false;                  // Whether HTTP endpoints serve backups, any user would reach them otherwise
+    };
+
+    /// @brief State of backups
+    class Status {
+    public:
+        bool running = false;                           // Whether snapshot is being written
+        std::string file;                               // Database file being copied
+        int remainingPages = 0;                         // Pages of current file left to copy
+        int totalPages = 0;                             // Pages of current file
+        std::string lastSnapshot;                       // Directory of last verified snapshot, only its name is reported
+        std::string lastFinishedAt;                     // Time of last finished backup, empty if none
+        std::string lastError;                          // Error of last backup, empty if it succeeded
+
+        /// @brief Function to convert Status object to Json
+        /// @return json object
+        nlohmann::json toJson() const;
+    };
+
+    /// @brief Get singleton instance of backup manager
+    /// @return Reference to backup manager instance
+    static BackupManager& getInstance();
+
+    /// @brief Delete copy, assignment, move, move assignment constructor
+    BackupManager(const BackupManager&) = delete;
+    BackupManager& operator=(const BackupManager&) = delete;
+    BackupManager(BackupManager&&) = delete;
+    BackupManager& operator=(BackupManager&&) = delete;
+
+    /// @brief Sets settings of backups, must be called before start
+    /// @param settings settings of backups
+    /// @throw std::invalid_argument on non positive step or zero retention
+    void configure(const Settings& settings);
+
+    /// @brief Starts backup thread
+    void start();
+
+    /// @brief Stops backup thread, snapshot being written is abandoned
+    void stop();
+
+    /// @brief Requests backup on demand
+    /// @return false when backup is already requested or running
+    bool request();
+
+    /// @brief Gets state of backups
+    /// @return current state
+    Status status();
+
+    /// @brief Checks whether HTTP endpoints of backups are enabled
+    /// @return value of Settings::endpointsEnabled
+    bool endpointsEnabled();
+
+private:
+    /// @brief Private constructor for Singleton pattern
+    BackupManager() = default;
+
+    /// @brief Private destructor
+    ~BackupManager();
+
+    /// @brief Backup thread loop
+    /// @param stopToken token signalling stop request
+    void run(std::stop_token stopToken);
+
+    /// @brief Writes, verifies and publishes single snapshot, then applies retention
+    /// @param stopToken token signalling stop request
+    /// @return directory of snapshot, empty when stopped
+    std::filesystem::path backup(std::stop_token stopToken);
+
+    /// @brief Copies database step by step, database is locked only for single step
+    /// @param source shard of database, pinned so it stays open between steps
+    /// @param target path of copy
+    /// @param stopToken token signalling stop request
+    /// @return false when stopped before copy was finished
+    bool copy(const std::shared_ptr<DatabaseManager::Shard>& source, const std::filesystem::path& target, std::stop_token stopToken);
+
+    /// @brief Checks integrity of copied database
+    /// @param path path of copy
+    /// @throw std::runtime_error when check fails
+    static void verify(const std::filesystem::path& path);
+
+    /// @brief Deletes snapshots above retention and snapshots left unfinished
+    /// @param directory directory of snapshots
+    void applyRetention(const std::filesystem::path& directory);
+
+    /// @brief Gets directory of snapshots
+    /// @return configured directory or "backups" next to main database
+    std::filesystem::path snapshotsDirectory();
+
+    /// @brief Picks name of new snapshot, UTC timestamp with milliseconds not used by any snapshot yet
+    /// @note Names have fixed width, so lexical order used by retention is order of creation
+    /// @param directory directory of snapshots
+    /// @return name of snapshot without suffix
+    static std::string snapshotName(const std::filesystem::path& directory);
+
+    static constexpr const char* PARTIAL_SUFFIX = ".partial";   // Suffix of snapshot which is not verified yet
+
+    Settings settings;                              // Settings of backups
+    Status state;                                   // State of backups
+    bool requested = false;                         // Whether backup on demand is requested
+    std::mutex mtx;                                 // Mutex guarding settings, state and request
+    std::condition_variable_any cv;                 // Signals request, stop or pause
+    std::jthread worker;                            // Backup thread
+};
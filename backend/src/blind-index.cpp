@@ -0,0 +1,185 @@
+#include <blind-index.hpp>
+#include <cryptopp/hmac.h>
+#include <cryptopp/sha.h>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <format>
+
+namespace pass {
+    BlindIndex::BlindIndex(const CryptoPP::SecByteBlock& key) : key(key) {}
+
+    std::vector<std::int64_t> BlindIndex::entryTokens(std::string_view name, std::string_view url, std::string_view login) const {
+        std::vector<std::int64_t> result{ INDEXED_MARKER };
+        wordTokens({ name, url, login }, result);
+
+        auto keys = urlKeys(url);
+        if (!keys.origin.empty()) {
+            auto [origin, site] = urlTokens(keys);
+            result.push_back(origin);
+            result.push_back(site);
+        }
+
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+        return result;
+    }
+
+    void BlindIndex::wordTokens(std::initializer_list<std::string_view> fields, std::vector<std::int64_t>& result) const {
+        for (const auto& field : fields) {
+            for (const auto& word : words(field)) {
+                // Short queries match anywhere in word, not only at its start
+                for (std::size_t i = 0; i < word.size(); ++i) {
+                    result.push_back(token('g', std::string_view(word).substr(i, 1)));
+                    if (i + 2 <= word.size()) {
+                        result.push_back(token('g', std::string_view(word).substr(i, 2)));
+                    }
+                }
+                for (std::size_t i = 0; i + NGRAM_SIZE <= word.size(); ++i) {
+                    result.push_back(token('t', std::string_view(word).substr(i, NGRAM_SIZE)));
+                }
+            }
+        }
+    }
+
+    std::vector<std::int64_t> BlindIndex::queryTokens(std::string_view query) const {
+        std::vector<std::int64_t> result;
+        for (const auto& word : words(query)) {
+            if (word.size() < NGRAM_SIZE) {
+                result.push_back(token('g', word));
+                continue;
+            }
+            for (std::size_t i = 0; i + NGRAM_SIZE <= word.size(); ++i) {
+                result.push_back(token('t', std::string_view(word).substr(i, NGRAM_SIZE)));
+            }
+        }
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+        if (result.size() > MAX_QUERY_TOKENS) {
+            result.resize(MAX_QUERY_TOKENS);
+        }
+        return result;
+    }
+
+    std::pair<std::int64_t, std::int64_t> BlindIndex::urlTokens(const UrlKeys& keys) const {
+        return { token('o', keys.origin), token('s', keys.site) };
+    }
+
+    BlindIndex::UrlKeys BlindIndex::urlKeys(std::string_view url) {
+        std::string text;
+        for (char c : url) {
+            if (!std::isspace(static_cast<unsigned char>(c))) {
+                text += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            }
+        }
+
+        // Url without scheme (e.g. "example.com/login") is treated as https
+        std::string scheme = "https";
+        auto schemeEnd = text.find("://");
+        if (schemeEnd != std::string::npos) {
+            scheme = text.substr(0, schemeEnd);
+            text.erase(0, schemeEnd + 3);
+        }
+
+        std::string authority = text.substr(0, text.find_first_of("/?#"));
+        auto userInfoEnd = authority.rfind('@');
+        if (userInfoEnd != std::string::npos) {
+            authority.erase(0, userInfoEnd + 1);
+        }
+
+        std::string host = authority;
+        std::string port;
+        auto portBegin = authority.rfind(':');
+        if (portBegin != std::string::npos && authority.find(']', portBegin) == std::string::npos) {
+            host = authority.substr(0, portBegin);
+            port = authority.substr(portBegin + 1);
+        }
+        while (!host.empty() && host.back() == '.') {
+            host.pop_back();
+        }
+        if (host.empty()) {
+            return {};
+        }
+        if ((scheme == "https" && port == "443") || (scheme == "http" && port == "80")) {
+            port.clear();
+        }
+
+        UrlKeys keys;
+        keys.origin = scheme + "://" + host + (port.empty() ? "" : ":" + port);
+        keys.site = host;
+
+        // IP addresses have no registrable domain
+        bool ip = host.front() == '[' || std::all_of(host.begin(), host.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)) || c == '.'; });
+        if (ip) {
+            return keys;
+        }
+
+        // Registrable domain is last two labels, or three for common second level suffixes of country domains (co.uk, com.pl, ...)
+        std::vector<std::string_view> labels;
+        std::string_view rest = host;
+        for (auto dot = rest.rfind('.'); dot != std::string_view::npos && labels.size() < 3; dot = rest.rfind('.')) {
+            labels.push_back(rest.substr(dot + 1));
+            rest = rest.substr(0, dot);
+        }
+        labels.push_back(rest);
+
+        static constexpr std::string_view SECOND_LEVEL[] = { "co", "com", "net", "org", "gov", "edu", "ac", "or", "ne", "go" };
+        std::size_t count = 2;
+        if (labels.size() >= 3 && labels[0].size() == 2 && std::find(std::begin(SECOND_LEVEL), std::end(SECOND_LEVEL), labels[1]) != std::end(SECOND_LEVEL)) {
+            count = 3;
+        }
+        if (labels.size() > count) {
+            keys.site.clear();
+            for (std::size_t i = count; i-- > 0;) {
+                keys.site += labels[i];
+                keys.site += i == 0 ? "" : ".";
+            }
+        }
+        return keys;
+    }
+
+    bool BlindIndex::matches(std::string_view field, std::string_view query) {
+        auto it = std::search(field.begin(), field.end(), query.begin(), query.end(), [](char a, char b) {
+            return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+        });
+        return it != field.end() || query.empty();
+    }
+
+    std::string BlindIndex::searchContext(const std::uint32_t userId) {
+        return std::format("PasswordFucker/search-index/{}", userId);
+    }
+
+    std::int64_t BlindIndex::token(char kind, std::string_view value) const {
+        CryptoPP::HMAC<CryptoPP::SHA256> hmac(key.data(), key.size());
+        const auto kindByte = static_cast<CryptoPP::byte>(kind);
+        hmac.Update(&kindByte, 1);
+        hmac.Update(reinterpret_cast<const CryptoPP::byte*>(value.data()), value.size());
+
+        CryptoPP::byte digest[CryptoPP::SHA256::DIGESTSIZE];
+        hmac.Final(digest);
+
+        std::int64_t result;
+        std::memcpy(&result, digest, sizeof(result));
+        return result >= 0 && result < MARKER_RANGE ? result + MARKER_RANGE : result;
+    }
+
+    std::vector<std::string> BlindIndex::words(std::string_view text) {
+        // Non-ASCII bytes are kept as part of words, so UTF-8 text is indexed byte-wise
+        std::vector<std::string> result;
+        std::string current;
+        for (char c : text) {
+            auto uc = static_cast<unsigned char>(c);
+            if (uc >= 0x80 || std::isalnum(uc)) {
+                current += static_cast<char>(std::tolower(uc));
+            }
+            else if (!current.empty()) {
+                result.push_back(std::move(current));
+                current.clear();
+            }
+        }
+        if (!current.empty()) {
+            result.push_back(std::move(current));
+        }
+        return result;
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <initializer_list>
+#include <utility>
+#include <cryptopp/secblock.h>
+
+/// @brief Namespace of password related stuff
+namespace pass {
+    /// @brief Class producing keyed tokens which let server search encrypted fields without decrypting them
+    /// @note Every word is indexed by all its 1 and 2 character substrings and all its trigrams, each token is
+    /// HMAC-SHA256 under per-user key truncated to 64 bits. Matching by tokens may give false positives,
+    /// so matched entries have to be verified after decryption.
+    class BlindIndex {
+    public:
+        /// @brief Constructor
+        /// @param key per-user key of index
+        explicit BlindIndex(const CryptoPP::SecByteBlock& key);
+
+        /// @brief Url split into keys used for autofill lookup
+        class UrlKeys {
+        public:
+            std::string origin;     // Normalized origin, e.g. "https://login.example.co.uk:8443"
+            std::string site;       // Registrable domain (eTLD+1), e.g. "example.co.uk"
+        };
+
+        /// @brief Computes tokens of password entry for storing in index
+        /// @param name plaintext name
+        /// @param url plaintext url
+        /// @param login plaintext login
+        /// @return sorted unique tokens of words of all fields and url keys
+        std::vector<std::int64_t> entryTokens(std::string_view name, std::string_view url, std::string_view login) const;
+
+        /// @brief Computes tokens which entry has to contain to match query
+        /// @param query plaintext query
+        /// @return sorted unique tokens, at most MAX_QUERY_TOKENS
+        std::vector<std::int64_t> queryTokens(std::string_view query) const;
+
+        /// @brief Computes tokens of url keys used for autofill lookup
+        /// @param keys keys of url
+        /// @return pair of origin and site tokens
+        std::pair<std::int64_t, std::int64_t> urlTokens(const UrlKeys& keys) const;
+
+        /// @brief Normalizes url into origin and registrable domain
+        /// @param url url with or without scheme
+        /// @return keys, empty when url has no host
+        static UrlKeys urlKeys(std::string_view url);
+
+        /// @brief Checks if plaintext field contains query, used to remove false positives
+        /// @param field plaintext field
+        /// @param query plaintext query
+        /// @return true if query is substring of field ignoring case
+        static bool matches(std::string_view field, std::string_view query);
+
+        /// @brief Context of key derivation for search index of user
+        /// @param userId ID of user
+        /// @return context for Crypto::contextKey
+        static std::string searchContext(const std::uint32_t userId);
+
+        /// @brief Token stored for every indexed entry, marks entry as indexed with current token format
+        /// @note Bump when tokens of entries change, entries with older marker are indexed again
+        static constexpr std::int64_t INDEXED_MARKER = 2;
+
+        static constexpr std::size_t NGRAM_SIZE = 3;            // Size of n-grams of longer words
+        static constexpr std::size_t MAX_QUERY_TOKENS = 32;     // Limit of tokens used in one query
+
+    private:
+        CryptoPP::SecByteBlock key;     // Per-user key of index
+
+        /// @brief Computes tokens of words of given fields
+        /// @param fields plaintext fields
+        /// @param result output tokens
+        void wordTokens(std::initializer_list<std::string_view> fields, std::vector<std::int64_t>& result) const;
+
+        /// @brief Computes single token
+        /// @param kind kind of token ('g' for 1-2 character substring, 't' for trigram, 'o' for origin, 's' for site)
+        /// @param value normalized text
+        /// @return 64-bit token, never equal to marker
+        std::int64_t token(char kind, std::string_view value) const;
+
+        static constexpr std::int64_t MARKER_RANGE = 256;     // Tokens below this value are reserved for markers
+
+        /// @brief Splits text into lowercase words
+        /// @param text plaintext
+        /// @return words
+        static std::vector<std::string> words(std::string_view text);
+    };
+}
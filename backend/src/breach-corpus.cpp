@@ -0,0 +1,206 @@
+#include <breach-corpus.hpp>
+#include <cryptopp/sha.h>
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+
+namespace pass {
+    BreachCorpus::Hash BreachCorpus::hash(std::string_view password) {
+        Hash result;
+        CryptoPP::SHA1 sha;
+        sha.Update(reinterpret_cast<const CryptoPP::byte*>(password.data()), password.size());
+        sha.Final(result.data());
+        return result;
+    }
+
+    bool BreachCorpus::parseHex(std::string_view text, Hash& hash) {
+        auto digit = [](char c) -> int {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            return -1;
+        };
+        if (text.size() < HASH_SIZE * 2) {
+            return false;
+        }
+        for (std::size_t i = 0; i < HASH_SIZE; ++i) {
+            int high = digit(text[2 * i]);
+            int low = digit(text[2 * i + 1]);
+            if (high < 0 || low < 0) {
+                return false;
+            }
+            hash[i] = static_cast<std::uint8_t>(high << 4 | low);
+        }
+        return true;
+    }
+
+    std::uint64_t BreachCorpus::blockOf(const Hash& hash, std::uint64_t blocks) {
+        std::uint64_t value;
+        std::memcpy(&value, hash.data() + 8, sizeof(value));
+        return value % blocks;
+    }
+
+    std::uint64_t BreachCorpus::bitsOf(const Hash& hash) {
+        std::uint64_t value;
+        std::memcpy(&value, hash.data(), sizeof(value));
+        return value;
+    }
+
+    BreachCorpusWriter::BreachCorpusWriter(std::ostream& out, std::uint64_t expectedCount, std::size_t bitsPerKey)
+        : out(out) {
+        blocks = std::max<std::uint64_t>(1, (expectedCount * bitsPerKey + BreachCorpus::BLOCK_SIZE * 8 - 1) / (BreachCorpus::BLOCK_SIZE * 8));
+        bloom.assign(blocks * BreachCorpus::BLOCK_WORDS, 0);
+
+        // Header is rewritten by finish()
+        char header[BreachCorpus::HEADER_SIZE] = {};
+        out.write(header, sizeof(header));
+    }
+
+    void BreachCorpusWriter::add(const BreachCorpus::Hash& hash) {
+        if (count > 0) {
+            if (hash == last) {
+                return;
+            }
+            if (hash < last) {
+                throw std::invalid_argument(std::format("Hashes are not sorted at entry {}", count));
+            }
+        }
+
+        auto* block = bloom.data() + BreachCorpus::blockOf(hash, blocks) * BreachCorpus::BLOCK_WORDS;
+        auto bits = BreachCorpus::bitsOf(hash);
+        for (std::size_t i = 0; i < BreachCorpus::BLOCK_WORDS; ++i) {
+            block[i] |= std::uint64_t(1) << ((bits >> (6 * i)) & 63);
+        }
+
+        out.write(reinterpret_cast<const char*>(hash.data()), hash.size());
+        last = hash;
+        ++count;
+    }
+
+    std::uint64_t BreachCorpusWriter::finish() {
+        // Bloom filter starts at cache line boundary
+        std::uint64_t end = BreachCorpus::HEADER_SIZE + count * BreachCorpus::HASH_SIZE;
+        std::uint64_t bloomOffset = (end + BreachCorpus::BLOCK_SIZE - 1) / BreachCorpus::BLOCK_SIZE * BreachCorpus::BLOCK_SIZE;
+        char padding[BreachCorpus::BLOCK_SIZE] = {};
+        out.write(padding, static_cast<std::streamsize>(bloomOffset - end));
+        out.write(reinterpret_cast<const char*>(bloom.data()), static_cast<std::streamsize>(bloom.size() * sizeof(std::uint64_t)));
+
+        BreachCorpus::Header header{};
+        std::memcpy(header.magic, BreachCorpus::MAGIC, sizeof(header.magic));
+        header.version = BreachCorpus::VERSION;
+        header.hashSize = BreachCorpus::HASH_SIZE;
+        header.count = count;
+        header.bloomBlocks = blocks;
+        header.bloomOffset = bloomOffset;
+        out.seekp(0);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.flush();
+
+        if (!out) {
+            throw std::runtime_error("Failed to write breach corpus");
+        }
+        return count;
+    }
+
+    BreachChecker& BreachChecker::getInstance() {
+        static BreachChecker checker;
+        return checker;
+    }
+
+    void BreachChecker::load(const std::filesystem::path& path) {
+        util::MappedFile mapped(path);
+        auto bytes = mapped.bytes();
+
+        BreachCorpus::Header header;
+        if (bytes.size() < sizeof(header)) {
+            throw std::runtime_error(std::format("Breach corpus is too small: {}", path.string()));
+        }
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        if (std::memcmp(header.magic, BreachCorpus::MAGIC, sizeof(header.magic)) != 0
+            || header.version != BreachCorpus::VERSION || header.hashSize != BreachCorpus::HASH_SIZE) {
+            throw std::runtime_error(std::format("Unsupported breach corpus format: {}", path.string()));
+        }
+        if (std::any_of(std::begin(header.reserved), std::end(header.reserved), [](std::uint64_t word) { return word != 0; })) {
+            throw std::runtime_error(std::format("Unsupported breach corpus format: {}", path.string()));
+        }
+
+        // Sizes are compared by division, so forged counts cannot overflow into passing checks
+        const std::uint64_t size = bytes.size();
+        if (header.count > (size - BreachCorpus::HEADER_SIZE) / BreachCorpus::HASH_SIZE) {
+            throw std::runtime_error(std::format("Breach corpus is truncated: {}", path.string()));
+        }
+        std::uint64_t end = BreachCorpus::HEADER_SIZE + header.count * BreachCorpus::HASH_SIZE;
+        std::uint64_t expectedOffset = (end + BreachCorpus::BLOCK_SIZE - 1) / BreachCorpus::BLOCK_SIZE * BreachCorpus::BLOCK_SIZE;
+        if (header.bloomOffset != expectedOffset || header.bloomBlocks == 0 || header.bloomOffset > size
+            || header.bloomBlocks > (size - header.bloomOffset) / BreachCorpus::BLOCK_SIZE) {
+            throw std::runtime_error(std::format("Breach corpus is truncated: {}", path.string()));
+        }
+
+        auto* base = reinterpret_cast<const std::uint8_t*>(bytes.data());
+        hashes = base + BreachCorpus::HEADER_SIZE;
+        bloom = reinterpret_cast<const std::uint64_t*>(base + header.bloomOffset);
+        count = header.count;
+        blocks = header.bloomBlocks;
+        file = std::move(mapped);
+    }
+
+    bool BreachChecker::isBreached(std::string_view password) const {
+        return count > 0 && contains(BreachCorpus::hash(password));
+    }
+
+    bool BreachChecker::contains(const BreachCorpus::Hash& hash) const {
+        if (count == 0) {
+            return false;
+        }
+
+        // Most checked passwords are not breached and end here after reading single cache line
+        const auto* block = bloom + BreachCorpus::blockOf(hash, blocks) * BreachCorpus::BLOCK_WORDS;
+        auto bits = BreachCorpus::bitsOf(hash);
+        for (std::size_t i = 0; i < BreachCorpus::BLOCK_WORDS; ++i) {
+            if ((block[i] >> ((bits >> (6 * i)) & 63) & 1) == 0) {
+                return false;
+            }
+        }
+
+        // Hashes are uniformly distributed, so interpolation finds them in few probes
+        auto key = prefixOf(hash.data());
+        std::uint64_t low = 0;
+        std::uint64_t high = count;
+        for (int probes = 0; low < high; ++probes) {
+            std::uint64_t middle;
+            if (probes < MAX_INTERPOLATION_PROBES) {
+                auto lowKey = prefixOf(hashes + low * BreachCorpus::HASH_SIZE);
+                auto highKey = prefixOf(hashes + (high - 1) * BreachCorpus::HASH_SIZE);
+                if (key < lowKey || key > highKey) {
+                    return false;
+                }
+                middle = highKey == lowKey ? low
+                    : low + static_cast<std::uint64_t>(static_cast<long double>(key - lowKey) / static_cast<long double>(highKey - lowKey) * static_cast<long double>(high - 1 - low));
+            }
+            else {
+                middle = low + (high - low) / 2;
+            }
+
+            int order = std::memcmp(hashes + middle * BreachCorpus::HASH_SIZE, hash.data(), BreachCorpus::HASH_SIZE);
+            if (order == 0) {
+                return true;
+            }
+            if (order < 0) {
+                low = middle + 1;
+            }
+            else {
+                high = middle;
+            }
+        }
+        return false;
+    }
+
+    std::uint64_t BreachChecker::prefixOf(const std::uint8_t* hash) {
+        std::uint64_t value = 0;
+        for (std::size_t i = 0; i < sizeof(value); ++i) {
+            value = value << 8 | hash[i];
+        }
+        return value;
+    }
+}
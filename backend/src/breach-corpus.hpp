@@ -0,0 +1,139 @@
+#pragma once
+
+#include <mapped-file.hpp>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+/// @brief Namespace of password related stuff
+namespace pass {
+    /// @brief Binary format of breach corpus, sorted SHA-1 hashes of breached passwords
+    /// @note Layout (native little endian): 64 byte header, count sorted 20 byte hashes, padding to 64 bytes,
+    /// blocked Bloom filter of bloomBlocks 64 byte blocks. Every key sets one bit in each of 8 words of its block,
+    /// so negative lookup touches single cache line.
+    class BreachCorpus {
+    public:
+        static constexpr std::size_t HASH_SIZE = 20;                    // Size of SHA-1 hash
+        using Hash = std::array<std::uint8_t, HASH_SIZE>;
+
+        /// @brief Header of corpus file
+        struct Header {
+            char magic[8];                  // MAGIC
+            std::uint32_t version;          // VERSION
+            std::uint32_t hashSize;         // HASH_SIZE
+            std::uint64_t count;            // Number of hashes
+            std::uint64_t bloomBlocks;      // Number of Bloom filter blocks
+            std::uint64_t bloomOffset;      // Offset of Bloom filter from start of file
+            std::uint64_t reserved[3];      // Zeroed
+        };
+
+        static constexpr char MAGIC[8] = { 'P', 'F', 'B', 'R', 'E', 'A', 'C', 'H' };
+        static constexpr std::uint32_t VERSION = 1;
+        static constexpr std::size_t HEADER_SIZE = 64;
+        static constexpr std::size_t BLOCK_WORDS = 8;                   // 64-bit words in Bloom filter block
+        static constexpr std::size_t BLOCK_SIZE = BLOCK_WORDS * sizeof(std::uint64_t);
+
+        /// @brief Computes hash of password as used by corpus
+        /// @param password plaintext password
+        /// @return SHA-1 of password
+        static Hash hash(std::string_view password);
+
+        /// @brief Parses hexadecimal hash, e.g. line of HIBP dump ("HASH:COUNT")
+        /// @param text text starting with 40 hexadecimal digits
+        /// @param hash output hash
+        /// @return false if text does not start with hash
+        static bool parseHex(std::string_view text, Hash& hash);
+
+        /// @brief Gets index of Bloom filter block of hash
+        /// @param hash hash of password
+        /// @param blocks number of blocks
+        /// @return index of block
+        static std::uint64_t blockOf(const Hash& hash, std::uint64_t blocks);
+
+        /// @brief Gets bit positions of hash, 6 bits for each word of block
+        /// @param hash hash of password
+        /// @return positions packed into 48 lowest bits
+        static std::uint64_t bitsOf(const Hash& hash);
+    };
+
+    static_assert(sizeof(BreachCorpus::Header) == BreachCorpus::HEADER_SIZE);
+
+    /// @brief Class writing breach corpus from hashes given in ascending order
+    class BreachCorpusWriter {
+    public:
+        /// @brief Constructor
+        /// @param out seekable binary stream
+        /// @param expectedCount expected number of hashes, used to size Bloom filter
+        /// @param bitsPerKey bits of Bloom filter per hash
+        BreachCorpusWriter(std::ostream& out, std::uint64_t expectedCount, std::size_t bitsPerKey = DEFAULT_BITS_PER_KEY);
+
+        /// @brief Adds hash, duplicates are skipped
+        /// @param hash hash not lower than previous one
+        /// @throws std::invalid_argument if hashes are not sorted
+        void add(const BreachCorpus::Hash& hash);
+
+        /// @brief Writes Bloom filter and header
+        /// @return number of written hashes
+        /// @throws std::runtime_error on write error
+        std::uint64_t finish();
+
+        static constexpr std::size_t DEFAULT_BITS_PER_KEY = 16;
+
+    private:
+        std::ostream& out;                  // Output stream
+        std::vector<std::uint64_t> bloom;   // Bloom filter built in memory
+        std::uint64_t blocks;               // Number of Bloom filter blocks
+        std::uint64_t count = 0;            // Number of written hashes
+        BreachCorpus::Hash last{};          // Last written hash
+    };
+
+    /// @brief Offline check of passwords against breach corpus implementing Singleton pattern
+    class BreachChecker {
+    public:
+        /// @brief Get singleton instance of checker
+        /// @return Reference to checker instance
+        static BreachChecker& getInstance();
+
+        /// @brief Delete copy, assignment, move, move assignment constructor
+        BreachChecker(const BreachChecker&) = delete;
+        BreachChecker& operator=(const BreachChecker&) = delete;
+        BreachChecker(BreachChecker&&) = delete;
+        BreachChecker& operator=(BreachChecker&&) = delete;
+
+        /// @brief Maps corpus file, must be called before server starts
+        /// @param path path to corpus file
+        /// @throws std::runtime_error if file is missing or malformed
+        void load(const std::filesystem::path& path);
+
+        /// @brief Checks if password appears in corpus
+        /// @param password plaintext password
+        /// @return true if password is breached, false if not or no corpus is loaded
+        bool isBreached(std::string_view password) const;
+
+        /// @brief Checks if hash appears in corpus
+        /// @param hash SHA-1 of password
+        /// @return true if hash is in corpus
+        bool contains(const BreachCorpus::Hash& hash) const;
+
+        static constexpr int MAX_INTERPOLATION_PROBES = 8;  // Probes before falling back to binary search
+
+    private:
+        /// @brief Private constructor for Singleton pattern
+        BreachChecker() = default;
+
+        util::MappedFile file;                  // Mapped corpus
+        const std::uint8_t* hashes = nullptr;   // Sorted hashes
+        const std::uint64_t* bloom = nullptr;   // Bloom filter
+        std::uint64_t count = 0;                // Number of hashes
+        std::uint64_t blocks = 0;               // Number of Bloom filter blocks
+
+        /// @brief Reads first 8 bytes of hash as big endian number, used for interpolation
+        /// @param hash pointer to hash
+        /// @return prefix of hash
+        static std::uint64_t prefixOf(const std::uint8_t* hash);
+    };
+}
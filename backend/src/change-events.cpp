@@ -0,0 +1,147 @@
+#include <change-events.hpp>
+#include <log.hpp>
+#include <Poco/Exception.h>
+#include <Poco/Timespan.h>
+#include <format>
+
+namespace events {
+    ChangeNotifier& ChangeNotifier::getInstance() {
+        static ChangeNotifier notifier;
+        return notifier;
+    }
+
+    ChangeNotifier::~ChangeNotifier() {
+        stop();
+    }
+
+    void ChangeNotifier::start() {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!writer.joinable()) {
+            writer = std::jthread([this](std::stop_token stopToken) { run(stopToken); });
+        }
+    }
+
+    void ChangeNotifier::stop() {
+        if (writer.joinable()) {
+            writer.request_stop();
+            cv.notify_all();
+            writer.join();
+        }
+    }
+
+    void ChangeNotifier::subscribe(const std::uint32_t userId, Poco::Net::StreamSocket socket) {
+        socket.setBlocking(false);
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            incoming.push_back(Connection{ userId, std::move(socket), {} });
+        }
+        cv.notify_one();
+    }
+
+    void ChangeNotifier::publish(const std::uint32_t userId, const std::int64_t version) {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            queue.emplace_back(userId, version);
+        }
+        cv.notify_one();
+    }
+
+    void ChangeNotifier::run(std::stop_token stopToken) {
+        auto nextHeartbeat = std::chrono::steady_clock::now() + HEARTBEAT_INTERVAL;
+        std::vector<Connection> newConnections;
+        std::vector<std::pair<std::uint32_t, std::int64_t>> events;
+
+        while (!stopToken.stop_requested()) {
+            // Sleep until something happens, retry pending writes sooner
+            bool hasPending = false;
+            for (const auto& connection : connections) {
+                hasPending = hasPending || !connection.pending.empty();
+            }
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                auto deadline = hasPending ? std::chrono::steady_clock::now() + FLUSH_INTERVAL : nextHeartbeat;
+                cv.wait_until(lock, stopToken, deadline, [this]() { return !incoming.empty() || !queue.empty(); });
+                newConnections.swap(incoming);
+                events.swap(queue);
+            }
+
+            for (auto& connection : newConnections) {
+                connections.push_back(std::move(connection));
+            }
+            newConnections.clear();
+
+            for (const auto& [userId, version] : events) {
+                std::string event = std::format("event: changed\ndata: {{\"version\":{}}}\n\n", version);
+                for (auto& connection : connections) {
+                    if (connection.userId == userId) {
+                        connection.pending += event;
+                    }
+                }
+            }
+            events.clear();
+
+            bool heartbeat = std::chrono::steady_clock::now() >= nextHeartbeat;
+            if (heartbeat) {
+                nextHeartbeat = std::chrono::steady_clock::now() + HEARTBEAT_INTERVAL;
+            }
+
+            for (auto it = connections.begin(); it != connections.end();) {
+                if (heartbeat) {
+                    it->pending += ": ping\n\n";
+                }
+                if ((heartbeat && isClosed(*it)) || !flush(*it)) {
+                    Logger::trace("Closing event stream of user {}", it->userId);
+                    try {
+                        it->socket.close();
+                    }
+                    catch (const Poco::Exception&) {
+                    }
+                    it = connections.erase(it);
+                }
+                else {
+                    ++it;
+                }
+            }
+        }
+
+        for (auto& connection : connections) {
+            try {
+                connection.socket.close();
+            }
+            catch (const Poco::Exception&) {
+            }
+        }
+        connections.clear();
+    }
+
+    bool ChangeNotifier::flush(Connection& connection) {
+        try {
+            while (!connection.pending.empty()) {
+                int sent = connection.socket.sendBytes(connection.pending.data(), static_cast<int>(connection.pending.size()));
+                if (sent <= 0) {
+                    break;  // Socket buffer is full
+                }
+                connection.pending.erase(0, static_cast<std::size_t>(sent));
+            }
+        }
+        catch (const Poco::Exception& e) {
+            Logger::trace("Event stream write failed: {}", e.displayText());
+            return false;
+        }
+        return connection.pending.size() <= MAX_PENDING_BYTES;
+    }
+
+    bool ChangeNotifier::isClosed(Connection& connection) {
+        try {
+            // Client never sends anything after request, readable socket means EOF or error
+            if (connection.socket.poll(Poco::Timespan(0, 0), Poco::Net::Socket::SELECT_READ | Poco::Net::Socket::SELECT_ERROR)) {
+                char buffer[256];
+                return connection.socket.receiveBytes(buffer, sizeof(buffer)) <= 0;
+            }
+            return false;
+        }
+        catch (const Poco::Exception&) {
+            return true;
+        }
+    }
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <fix.hpp>
+#include <Poco/Net/StreamSocket.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/// @brief Namespace for server-push change notifications
+namespace events {
+    /// @brief In-process publisher of vault changes to Server-Sent Events streams implementing Singleton pattern
+    /// @note Subscribed sockets are detached from HTTP server, so open streams do not occupy its worker threads.
+    /// All of them are served by single writer thread using non-blocking writes.
+    class ChangeNotifier {
+    public:
+        /// @brief Get singleton instance of notifier
+        /// @return Reference to notifier instance
+        static ChangeNotifier& getInstance();
+
+        /// @brief Delete copy, assignment, move, move assignment constructor
+        ChangeNotifier(const ChangeNotifier&) = delete;
+        ChangeNotifier& operator=(const ChangeNotifier&) = delete;
+        ChangeNotifier(ChangeNotifier&&) = delete;
+        ChangeNotifier& operator=(ChangeNotifier&&) = delete;
+
+        /// @brief Starts writer thread
+        void start();
+
+        /// @brief Stops writer thread and closes all streams
+        void stop();
+
+        /// @brief Hands over socket with already sent SSE response header
+        /// @param userId ID of user whose changes are streamed
+        /// @param socket socket detached from HTTP server
+        void subscribe(const std::uint32_t userId, Poco::Net::StreamSocket socket);
+
+        /// @brief Publishes change of user vault to all streams of that user
+        /// @param userId ID of user whose vault changed
+        /// @param version new version of vault
+        void publish(const std::uint32_t userId, const std::int64_t version);
+
+        /// @brief Header of SSE response written before socket is subscribed
+        static constexpr const char* RESPONSE_HEADER =
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Type: text/event-stream\r\n"
+            "Cache-Control: no-cache\r\n"
+            "Connection: keep-alive\r\n"
+            "Access-Control-Allow-Origin: *\r\n"
+            "\r\n"
+            "retry: 3000\n\n";
+
+        static constexpr auto HEARTBEAT_INTERVAL = std::chrono::seconds(15);    // Interval of keep-alive comments
+        static constexpr auto FLUSH_INTERVAL = std::chrono::milliseconds(50);   // Retry interval of pending writes
+        static constexpr std::size_t MAX_PENDING_BYTES = 64 * 1024;             // Slow clients above this are dropped
+
+    private:
+        /// @brief Open event stream
+        class Connection {
+        public:
+            std::uint32_t userId;               // ID of user whose changes are streamed
+            Poco::Net::StreamSocket socket;     // Detached non-blocking socket
+            std::string pending;                // Data waiting for socket to become writable
+        };
+
+        /// @brief Private constructor for Singleton pattern
+        ChangeNotifier() = default;
+
+        /// @brief Private destructor
+        ~ChangeNotifier();
+
+        /// @brief Writer thread loop
+        /// @param stopToken token signalling stop request
+        void run(std::stop_token stopToken);
+
+        /// @brief Writes as much pending data as socket accepts
+        /// @param connection connection to flush
+        /// @return false when connection is closed or too slow and should be dropped
+        static bool flush(Connection& connection);
+
+        /// @brief Checks if client closed connection
+        /// @param connection connection to check
+        /// @return true when connection is closed
+        static bool isClosed(Connection& connection);
+
+        std::mutex mtx;                                             // Mutex guarding queues below
+        std::condition_variable_any cv;                             // Wakes writer thread
+        std::vector<Connection> incoming;                           // Sockets waiting for writer thread
+        std::vector<std::pair<std::uint32_t, std::int64_t>> queue;  // Published events waiting for writer thread
+        std::list<Connection> connections;                          // Open streams, owned by writer thread
+        std::jthread writer;                                        // Writer thread
+    };
+}
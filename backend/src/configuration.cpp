@@ -8,12 +8,72 @@ namespace config {
     void Configuration::setDefault() {
         backendServerPort = 1234;
         databasePath = "./definitely-not-password.db";
+        breachCorpusPath = "";
+        wordlistPath = "";
+        recordEncryption = false;
+        kdfAlgorithm = "pbkdf2-sha256";
+        kdfTargetMilliseconds = 0;
+        argon2MemoryKiB = 65536;
+        argon2Lanes = 2;
+        kdfConcurrency = 2;
+        kdfQueueTimeoutMilliseconds = 500;
+        loginBurst = 5;
+        loginRatePerMinute = 12;
+        kdfThreads = 0;
+        shardMode = "none";
+        shardCount = 16;
+        shardDirectory = "";
+        maxOpenShards = 64;
+        vaultCacheKiB = 0;
+        vaultCacheIdleSeconds = 900;
+        groupCommitMaxBatch = 64;
+        groupCommitDelayMicroseconds = 200;
+        rotationChunkSize = 100;
+        rotationEntriesPerSecond = 500;
+        backupDirectory = "";
+        backupIntervalMinutes = 0;
+        backupRetention = 7;
+        backupStepPages = 64;
+        backupStepPauseMilliseconds = 5;
+        backupEndpointsEnabled = false;
+        tombstoneRetentionDays = 90;
+        slowRequestMilliseconds = 1000;
     }
 
     nlohmann::json Configuration::toJson() const {
         return nlohmann::json{
             {"backendServerPort", backendServerPort},
-            {"databasePath", databasePath.string()}
+            {"databasePath", databasePath.string()},
+            {"breachCorpusPath", breachCorpusPath.string()},
+            {"wordlistPath", wordlistPath.string()},
+            {"recordEncryption", recordEncryption},
+            {"kdfAlgorithm", kdfAlgorithm},
+            {"kdfTargetMilliseconds", kdfTargetMilliseconds},
+            {"argon2MemoryKiB", argon2MemoryKiB},
+            {"argon2Lanes", argon2Lanes},
+            {"kdfConcurrency", kdfConcurrency},
+            {"kdfQueueTimeoutMilliseconds", kdfQueueTimeoutMilliseconds},
+            {"loginBurst", loginBurst},
+            {"loginRatePerMinute", loginRatePerMinute},
+            {"kdfThreads", kdfThreads},
+            {"shardMode", shardMode},
+            {"shardCount", shardCount},
+            {"shardDirectory", shardDirectory.string()},
+            {"maxOpenShards", maxOpenShards},
+            {"vaultCacheKiB", vaultCacheKiB},
+            {"vaultCacheIdleSeconds", vaultCacheIdleSeconds},
+            {"groupCommitMaxBatch", groupCommitMaxBatch},
+            {"groupCommitDelayMicroseconds", groupCommitDelayMicroseconds},
+            {"rotationChunkSize", rotationChunkSize},
+            {"rotationEntriesPerSecond", rotationEntriesPerSecond},
+            {"backupDirectory", backupDirectory.string()},
+            {"backupIntervalMinutes", backupIntervalMinutes},
+            {"backupRetention", backupRetention},
+            {"backupStepPages", backupStepPages},
+            {"backupStepPauseMilliseconds", backupStepPauseMilliseconds},
+            {"backupEndpointsEnabled", backupEndpointsEnabled},
+            {"tombstoneRetentionDays", tombstoneRetentionDays},
+            {"slowRequestMilliseconds", slowRequestMilliseconds}
         };
     }
 
@@ -22,6 +82,36 @@ namespace config {
         try {
             config.backendServerPort = configuration.at("backendServerPort").get<std::uint16_t>();
             config.databasePath = configuration.at("databasePath").get<std::string>();
+            config.breachCorpusPath = configuration.value("breachCorpusPath", "");
+            config.wordlistPath = configuration.value("wordlistPath", "");
+            config.recordEncryption = configuration.value("recordEncryption", false);
+            config.kdfAlgorithm = configuration.value("kdfAlgorithm", "pbkdf2-sha256");
+            config.kdfTargetMilliseconds = configuration.value("kdfTargetMilliseconds", 0u);
+            config.argon2MemoryKiB = configuration.value("argon2MemoryKiB", 65536u);
+            config.argon2Lanes = configuration.value("argon2Lanes", 2u);
+            config.kdfConcurrency = configuration.value("kdfConcurrency", 2u);
+            config.kdfQueueTimeoutMilliseconds = configuration.value("kdfQueueTimeoutMilliseconds", 500u);
+            config.loginBurst = configuration.value("loginBurst", 5u);
+            config.loginRatePerMinute = configuration.value("loginRatePerMinute", 12u);
+            config.kdfThreads = configuration.value("kdfThreads", 0u);
+            config.shardMode = configuration.value("shardMode", "none");
+            config.shardCount = configuration.value("shardCount", 16u);
+            config.shardDirectory = configuration.value("shardDirectory", "");
+            config.maxOpenShards = configuration.value("maxOpenShards", 64u);
+            config.vaultCacheKiB = configuration.value("vaultCacheKiB", 0u);
+            config.vaultCacheIdleSeconds = configuration.value("vaultCacheIdleSeconds", 900u);
+            config.groupCommitMaxBatch = configuration.value("groupCommitMaxBatch", 64u);
+            config.groupCommitDelayMicroseconds = configuration.value("groupCommitDelayMicroseconds", 200u);
+            config.rotationChunkSize = configuration.value("rotationChunkSize", 100u);
+            config.rotationEntriesPerSecond = configuration.value("rotationEntriesPerSecond", 500u);
+            config.backupDirectory = configuration.value("backupDirectory", "");
+            config.backupIntervalMinutes = configuration.value("backupIntervalMinutes", 0u);
+            config.backupRetention = configuration.value("backupRetention", 7u);
+            config.backupStepPages = configuration.value("backupStepPages", 64u);
+            config.backupStepPauseMilliseconds = configuration.value("backupStepPauseMilliseconds", 5u);
+            config.backupEndpointsEnabled = configuration.value("backupEndpointsEnabled", false);
+            config.tombstoneRetentionDays = configuration.value("tombstoneRetentionDays", 90u);
+            config.slowRequestMilliseconds = configuration.value("slowRequestMilliseconds", 1000u);
         }
         catch (const nlohmann::json::exception& e) {
             throw std::runtime_error(std::format("Failed to parse configuration: {}", e.what()));
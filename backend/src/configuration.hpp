@@ -13,6 +13,36 @@ namespace config {
     public:
         std::uint16_t backendServerPort;           // Port with SSH avaliable
         std::filesystem::path databasePath;   // Path to database
+        std::filesystem::path breachCorpusPath;   // Path to breach corpus built by breach-corpus-builder, empty disables check
+        std::filesystem::path wordlistPath;       // Path to wordlist of passphrase generator, empty disables passphrase mode
+        bool recordEncryption;                    // Seal secret fields of new passwords into one record instead of encrypting each field
+        std::string kdfAlgorithm;                 // KDF of new and upgraded users: "pbkdf2-sha256" or "argon2id"
+        std::uint32_t kdfTargetMilliseconds;      // Login latency of KDF calibrated at startup, 0 keeps legacy PBKDF2
+        std::uint32_t argon2MemoryKiB;            // Argon2id memory cost
+        std::uint32_t argon2Lanes;                // Argon2id parallelism
+        std::uint32_t kdfConcurrency;             // Logins and registrations deriving keys at once
+        std::uint32_t kdfQueueTimeoutMilliseconds; // Longest wait for free derivation slot before 429
+        std::uint32_t loginBurst;                 // Logins and registrations of one client allowed at once
+        std::uint32_t loginRatePerMinute;         // Logins and registrations of one client refilled per minute
+        std::uint32_t kdfThreads;                 // Threads of KDF executor, 0 for one per physical core
+        std::string shardMode;                    // Placement of password tables: "none", "user" (file per user) or "hash"
+        std::uint32_t shardCount;                 // Number of shard files in "hash" mode, must not change once data is stored
+        std::filesystem::path shardDirectory;     // Directory of shard files, empty for "shards" next to database
+        std::uint32_t maxOpenShards;              // Shard files kept open at once
+        std::uint32_t vaultCacheKiB;              // Memory of decrypted vaults cached in locked pages, 0 disables cache
+        std::uint32_t vaultCacheIdleSeconds;      // Cached vault not read for this long is wiped
+        std::uint32_t groupCommitMaxBatch;        // Single password writes committed together at most, 0 disables group commit
+        std::uint32_t groupCommitDelayMicroseconds; // Time first write of batch waits for others
+        std::uint32_t rotationChunkSize;          // Entries re-encrypted in single transaction after password change
+        std::uint32_t rotationEntriesPerSecond;   // Rate of re-encryption after password change, 0 for unlimited
+        std::filesystem::path backupDirectory;    // Directory of backups, empty for "backups" next to database
+        std::uint32_t backupIntervalMinutes;      // Interval of scheduled backups, 0 for backups on demand only
+        std::uint32_t backupRetention;            // Verified backups kept, older ones are deleted
+        std::uint32_t backupStepPages;            // Pages copied under single lock of database
+        std::uint32_t backupStepPauseMilliseconds; // Pause between backup steps leaving database to requests
+        bool backupEndpointsEnabled;              // Serve backup endpoints to authenticated users, meant for single-operator setups
+        std::uint32_t tombstoneRetentionDays;     // Tombstones of removed passwords kept for delta sync, 0 keeps them forever
+        std::uint32_t slowRequestMilliseconds;    // Requests taking longer are logged with time of their stages, 0 disables log
         
         /// @brief Function which sets configuration to default values
         void setDefault();
@@ -1,23 +1,49 @@
 #include "crypto.hpp"
+#include <secure-arena.hpp>
 
 #include <cryptopp/aes.h>
 #include <cryptopp/gcm.h>
 #include <cryptopp/hex.h>
 #include <cryptopp/base64.h>
-#include <cryptopp/pwdbased.h>
 #include <cryptopp/sha.h>
+#include <cryptopp/hmac.h>
 #include <cryptopp/filters.h>
+#include <cryptopp/cpu.h>
 
 #include <stdexcept>
 #include <algorithm>
 #include <cctype>
 #include <format>
+#include <atomic>
+#include <vector>
 
 // Constructor
-Crypto::Crypto(const std::string& password) : userPassword(password) {
+Crypto::Crypto(const std::string& password, const KdfParameters& kdf) : userPassword(password), kdf(kdf) {
     if (password.empty()) {
         throw std::invalid_argument("Password cannot be empty");
     }
+    kdf.validate();
+}
+
+std::atomic<KdfParameters> Crypto::target{KdfParameters()};
+
+const KdfParameters& Crypto::kdfParameters() const {
+    return kdf;
+}
+
+void Crypto::setTargetKdf(const KdfParameters& kdf) {
+    kdf.validate();
+    target.store(kdf);
+}
+
+KdfParameters Crypto::targetKdf() {
+    return target.load();
+}
+
+// Random pool is not thread-safe, so every thread gets its own
+CryptoPP::AutoSeededRandomPool& Crypto::rng() {
+    thread_local CryptoPP::AutoSeededRandomPool pool;
+    return pool;
 }
 
 // Key derivation from password
@@ -25,62 +51,218 @@ void Crypto::deriveKeyFromPassword(const std::string& password,
                                   const CryptoPP::SecByteBlock& salt,
                                   CryptoPP::SecByteBlock& derivedKey) {
     derivedKey.resize(AES_KEY_SIZE);
-    
-    CryptoPP::PKCS5_PBKDF2_HMAC<CryptoPP::SHA256> pbkdf2;
-    pbkdf2.DeriveKey(
-        derivedKey.data(), derivedKey.size(),
-        0x00, // purpose (not used)
-        reinterpret_cast<const CryptoPP::byte*>(password.data()), password.length(),
-        salt.data(), salt.size(),
-        PBKDF2_ITERATIONS,
-        0.0 // timeInSeconds (not used)
+    KdfParameters().derive(password, salt.data(), salt.size(), derivedKey.data(), derivedKey.size());
+}
+
+CryptoPP::SecByteBlock Crypto::deriveKey(const CryptoPP::SecByteBlock& salt) {
+    CryptoPP::SecByteBlock key;
+    deriveKeyFromPassword(userPassword, salt, key);
+    return key;
+}
+
+const CryptoPP::SecByteBlock& Crypto::contextKey(const std::string& context) {
+    std::lock_guard<std::mutex> lock(contextKeysMutex);
+    auto it = contextKeys.find(context);
+    if (it == contextKeys.end()) {
+        CryptoPP::SecByteBlock salt(reinterpret_cast<const CryptoPP::byte*>(context.data()), context.size());
+        it = contextKeys.emplace(context, deriveKey(salt)).first;
+    }
+    return it->second;
+}
+
+void Crypto::setPreviousPassword(const std::string& password) {
+    if (password.empty()) {
+        throw std::invalid_argument("Password cannot be empty");
+    }
+    std::lock_guard<std::mutex> lock(dataKeysMutex);
+    previousPassword = password;
+}
+
+void Crypto::clearPreviousPassword() {
+    std::lock_guard<std::mutex> lock(dataKeysMutex);
+    SecureZeroMemory(previousPassword.data(), previousPassword.size());
+    previousPassword.clear();
+
+    // Keys of previous password are marked by first byte of cache key
+    std::erase_if(dataKeys, [](const auto& entry) { return entry.first.front() != '\0'; });
+}
+
+std::shared_ptr<const Crypto::DataKey> Crypto::dataKey(const KdfParameters& parameters, const CryptoPP::byte* salt, bool previous) {
+    static std::atomic<std::uint64_t> nextId = 1;
+    std::string cacheKey(1 + KdfParameters::ENCODED_SIZE + SALT_SIZE, '\0');
+    cacheKey[0] = previous ? '\1' : '\0';
+    parameters.encode(reinterpret_cast<CryptoPP::byte*>(cacheKey.data()) + 1);
+    std::copy(salt, salt + SALT_SIZE, reinterpret_cast<CryptoPP::byte*>(cacheKey.data()) + 1 + KdfParameters::ENCODED_SIZE);
+
+    std::promise<std::shared_ptr<const DataKey>> derivation;
+    std::shared_future<std::shared_ptr<const DataKey>> result;
+    std::string password;
+    {
+        std::lock_guard<std::mutex> lock(dataKeysMutex);
+        if (previous && previousPassword.empty()) {
+            return nullptr;
+        }
+        auto it = dataKeys.find(cacheKey);
+        if (it != dataKeys.end()) {
+            it->second.lastUse = ++dataKeysClock;
+            result = it->second.key;
+        }
+        else {
+            if (dataKeys.size() >= MAX_DATA_KEYS) {
+                // Holders of evicted key keep using it, it is only derived again on next miss
+                auto oldest = std::min_element(dataKeys.begin(), dataKeys.end(), [](const auto& a, const auto& b) {
+                    return a.second.lastUse < b.second.lastUse;
+                });
+                dataKeys.erase(oldest);
+            }
+            result = derivation.get_future().share();
+            dataKeys.emplace(cacheKey, CachedDataKey{ result, ++dataKeysClock });
+            password = previous ? previousPassword : userPassword;
+        }
+    }
+    if (password.empty()) {
+        return result.get();
+    }
+
+    // Only the thread which inserted placeholder derives, others wait for its future
+    try {
+        auto key = std::make_shared<DataKey>();
+        key->id = nextId++;
+        key->key.resize(AES_KEY_SIZE);
+        parameters.derive(password, salt, SALT_SIZE, key->key.data(), key->key.size());
+        SecureZeroMemory(password.data(), password.size());
+        derivation.set_value(std::move(key));
+    }
+    catch (...) {
+        SecureZeroMemory(password.data(), password.size());
+        derivation.set_exception(std::current_exception());
+
+        // Failed derivation is not cached, next lookup tries again
+        std::lock_guard<std::mutex> lock(dataKeysMutex);
+        auto it = dataKeys.find(cacheKey);
+        if (it != dataKeys.end() && it->second.key.valid() && it->second.key.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            dataKeys.erase(it);
+        }
+    }
+    return result.get();
+}
+
+std::shared_ptr<const Crypto::DataKey> Crypto::sessionKey(CryptoPP::byte* salt) {
+    {
+        std::lock_guard<std::mutex> lock(dataKeysMutex);
+        if (sessionSalt.empty()) {
+            sessionSalt.resize(SALT_SIZE);
+            rng().GenerateBlock(reinterpret_cast<CryptoPP::byte*>(sessionSalt.data()), SALT_SIZE);
+        }
+        std::copy(sessionSalt.begin(), sessionSalt.end(), reinterpret_cast<char*>(salt));
+    }
+    return dataKey(kdf, salt);
+}
+
+template <typename Cipher>
+Cipher& Crypto::cipherContext(const std::shared_ptr<const DataKey>& key) {
+    struct Context {
+        std::weak_ptr<const DataKey> key;   // Owner of key schedule, expires with session
+        std::uint64_t keyId;                // Id of key
+        std::uint64_t lastUse;              // Value of clock at last use
+        Cipher cipher;                      // Cipher with key schedule and GHASH tables
+    };
+    thread_local std::vector<std::unique_ptr<Context>> contexts;
+    thread_local std::uint64_t clock = 0;
+    ++clock;
+
+    // Contexts of closed sessions are dropped, cipher destructor wipes key schedule
+    std::erase_if(contexts, [](const auto& context) { return context->key.expired(); });
+    for (auto& context : contexts) {
+        if (context->keyId == key->id) {
+            context->lastUse = clock;
+            return context->cipher;
+        }
+    }
+
+    if (contexts.size() >= MAX_CIPHER_CONTEXTS) {
+        contexts.erase(std::min_element(contexts.begin(), contexts.end(), [](const auto& a, const auto& b) {
+            return a->lastUse < b->lastUse;
+        }));
+    }
+    auto& context = contexts.emplace_back(std::make_unique<Context>());
+    context->key = key;
+    context->keyId = key->id;
+    context->lastUse = clock;
+
+    // Placeholder IV, every operation resynchronizes with its own
+    const CryptoPP::byte iv[IV_SIZE] = {};
+    context->cipher.SetKeyWithIV(key->key, key->key.size(), iv, IV_SIZE);
+    return context->cipher;
+}
+
+std::string Crypto::accelerationInfo() {
+    bool aes = false;
+    bool clmul = false;
+#if CRYPTOPP_BOOL_X86 || CRYPTOPP_BOOL_X32 || CRYPTOPP_BOOL_X64
+    aes = CryptoPP::HasAESNI();
+    clmul = CryptoPP::HasCLMUL();
+#endif
+    if (aes && clmul) {
+        return "AES-NI + PCLMUL";
+    }
+    if (aes) {
+        return "AES-NI (software GHASH)";
+    }
+    if (clmul) {
+        return "PCLMUL (software AES)";
+    }
+    return "none (software AES and GHASH)";
+}
+
+std::string Crypto::fingerprint(const std::string& context, const std::string& data) {
+    const auto& key = contextKey(context);
+    CryptoPP::HMAC<CryptoPP::SHA256> hmac(key.data(), key.size());
+    hmac.Update(reinterpret_cast<const CryptoPP::byte*>(data.data()), data.size());
+
+    CryptoPP::byte digest[CryptoPP::SHA256::DIGESTSIZE];
+    hmac.Final(digest);
+
+    std::string encoded;
+    CryptoPP::StringSource ss(digest, sizeof(digest), true,
+        new CryptoPP::Base64Encoder(
+            new CryptoPP::StringSink(encoded),
+            false // no line breaks
+        )
     );
+    return encoded;
 }
 
 // Encryption
-std::string Crypto::encrypt(const std::string& plaintext) {
+std::string Crypto::encrypt(std::string_view plaintext) {
     try {
-        // Generate random salt
-        CryptoPP::SecByteBlock salt(SALT_SIZE);
-        rng.GenerateBlock(salt, salt.size());
-        
-        // Derive key from password and salt
-        CryptoPP::SecByteBlock key;
-        deriveKeyFromPassword(userPassword, salt, key);
-        
-        // Generate random IV
-        CryptoPP::SecByteBlock iv(IV_SIZE);
-        rng.GenerateBlock(iv, iv.size());
+        // Envelope is written in place: version + KDF parameters (if not legacy) + salt + IV + ciphertext + tag
+        const bool legacyKdf = kdf == KdfParameters();
+        std::string envelope((legacyKdf ? ENVELOPE_OVERHEAD : ENVELOPE_KDF_OVERHEAD) + plaintext.size(), '\0');
+        auto* data = reinterpret_cast<CryptoPP::byte*>(envelope.data());
+        auto* salt = data + 1;
+        if (legacyKdf) {
+            data[0] = ENVELOPE_VERSION;
+        }
+        else {
+            data[0] = ENVELOPE_KDF_VERSION;
+            kdf.encode(salt);
+            salt += KdfParameters::ENCODED_SIZE;
+        }
+        auto* iv = salt + SALT_SIZE;
+        auto* ciphertext = iv + IV_SIZE;
+        auto* tag = ciphertext + plaintext.size();
+
+        // Session key with random IV, cipher context of thread already has its key schedule
+        auto key = sessionKey(salt);
+        rng().GenerateBlock(iv, IV_SIZE);
         
         // AES-GCM encryption
-        std::string ciphertext;
-        CryptoPP::GCM<CryptoPP::AES>::Encryption enc;
-        enc.SetKeyWithIV(key, key.size(), iv, iv.size());
+        auto& enc = cipherContext<CryptoPP::GCM<CryptoPP::AES>::Encryption>(key);
+        enc.EncryptAndAuthenticate(ciphertext, tag, TAG_SIZE, iv, IV_SIZE, nullptr, 0,
+            reinterpret_cast<const CryptoPP::byte*>(plaintext.data()), plaintext.size());
         
-        CryptoPP::StringSource ss(plaintext, true,
-            new CryptoPP::AuthenticatedEncryptionFilter(enc,
-                new CryptoPP::StringSink(ciphertext),
-                false, TAG_SIZE
-            )
-        );
-        
-        // Combine salt + IV + ciphertext + tag
-        std::string combined;
-        combined.reserve(SALT_SIZE + IV_SIZE + ciphertext.length());
-        combined.append(reinterpret_cast<const char*>(salt.data()), salt.size());
-        combined.append(reinterpret_cast<const char*>(iv.data()), iv.size());
-        combined.append(ciphertext);
-        
-        // Encode to Base64
-        std::string encoded;
-        CryptoPP::StringSource ss2(combined, true,
-            new CryptoPP::Base64Encoder(
-                new CryptoPP::StringSink(encoded),
-                false // no line breaks
-            )
-        );
-        
-        return encoded;
+        return envelope;
         
     } 
     catch (const CryptoPP::Exception& e) {
@@ -89,79 +271,121 @@ std::string Crypto::encrypt(const std::string& plaintext) {
 }
 
 // Decryption
-std::string Crypto::decrypt(const std::string& ciphertext) {
+std::string Crypto::decrypt(std::string_view ciphertext) {
+    std::string recovered;
+    decryptInto(ciphertext, [&recovered](std::size_t size) {
+        recovered.resize(size);
+        return reinterpret_cast<CryptoPP::byte*>(recovered.data());
+    });
+    return recovered;
+}
+
+std::string_view Crypto::decrypt(std::string_view ciphertext, std::pmr::memory_resource& resource) {
+    char* data = nullptr;
+    std::size_t length = 0;
+    decryptInto(ciphertext, [&](std::size_t size) {
+        length = size;
+        data = size == 0 ? nullptr : static_cast<char*>(resource.allocate(size, 1));
+        return reinterpret_cast<CryptoPP::byte*>(data);
+    });
+    return std::string_view(data, length);
+}
+
+bool Crypto::needsPreviousPassword(std::string_view ciphertext) {
+    bool previousUsed = false;
+    util::SecureString plaintext(util::SecureArena::resource());
+    decryptInto(ciphertext, [&plaintext](std::size_t size) {
+        plaintext.resize(size);
+        return reinterpret_cast<CryptoPP::byte*>(plaintext.data());
+    }, &previousUsed);
+    SecureZeroMemory(plaintext.data(), plaintext.size());
+    return previousUsed;
+}
+
+void Crypto::decryptInto(std::string_view ciphertext, const std::function<CryptoPP::byte*(std::size_t)>& output, bool* previousUsed) {
     try {
-        // Decode from Base64
-        std::string decoded;
-        CryptoPP::StringSource ss(ciphertext, true,
-            new CryptoPP::Base64Decoder(
-                new CryptoPP::StringSink(decoded)
-            )
-        );
+        const auto* data = reinterpret_cast<const CryptoPP::byte*>(ciphertext.data());
+        std::size_t size = ciphertext.size();
+
+        // Version byte is not Base64 character, so anything else is legacy Base64 text (salt + IV + ciphertext + tag)
+        util::SecureString decoded(util::SecureArena::resource());
+        KdfParameters parameters;
+        if (size > 0 && data[0] == ENVELOPE_VERSION) {
+            ++data;
+            --size;
+        }
+        else if (size > KdfParameters::ENCODED_SIZE && data[0] == ENVELOPE_KDF_VERSION) {
+            try {
+                parameters = KdfParameters::decode(data + 1);
+            }
+            catch (const std::invalid_argument& e) {
+                throw std::runtime_error("Invalid encrypted data - " + std::string(e.what()));
+            }
+            data += 1 + KdfParameters::ENCODED_SIZE;
+            size -= 1 + KdfParameters::ENCODED_SIZE;
+        }
+        else {
+            decoded.reserve(size * 3 / 4);
+            CryptoPP::StringSource ss(data, size, true,
+                new CryptoPP::Base64Decoder(
+                    new CryptoPP::StringSinkTemplate<util::SecureString>(decoded)
+                )
+            );
+            data = reinterpret_cast<const CryptoPP::byte*>(decoded.data());
+            size = decoded.size();
+        }
         
         // Check minimum length
-        if (decoded.length() < SALT_SIZE + IV_SIZE + TAG_SIZE) {
+        if (size < SALT_SIZE + IV_SIZE + TAG_SIZE) {
             throw std::runtime_error("Invalid encrypted data - too short");
         }
         
-        // Extract salt
-        CryptoPP::SecByteBlock salt(
-            reinterpret_cast<const CryptoPP::byte*>(decoded.data()), 
-            SALT_SIZE
-        );
-        
-        // Extract IV
-        CryptoPP::SecByteBlock iv(
-            reinterpret_cast<const CryptoPP::byte*>(decoded.data() + SALT_SIZE), 
-            IV_SIZE
-        );
-        
-        // Extract ciphertext + tag
-        std::string encryptedData = decoded.substr(SALT_SIZE + IV_SIZE);
-        
-        // Derive key from password and extracted salt
-        CryptoPP::SecByteBlock key;
-        deriveKeyFromPassword(userPassword, salt, key);
+        const auto* salt = data;
+        const auto* iv = salt + SALT_SIZE;
+        const auto* encryptedData = iv + IV_SIZE;
+        const std::size_t plaintextSize = size - SALT_SIZE - IV_SIZE - TAG_SIZE;
+        const auto* tag = encryptedData + plaintextSize;
         
-        // AES-GCM decryption
-        std::string recovered;
-        CryptoPP::GCM<CryptoPP::AES>::Decryption dec;
-        dec.SetKeyWithIV(key, key.size(), iv, iv.size());
-        
-        CryptoPP::StringSource ss2(encryptedData, true,
-            new CryptoPP::AuthenticatedDecryptionFilter(dec,
-                new CryptoPP::StringSink(recovered),
-                CryptoPP::AuthenticatedDecryptionFilter::DEFAULT_FLAGS,
-                TAG_SIZE
-            )
-        );
-        
-        return recovered;
+        // Key of salt is derived once per session
+        auto key = dataKey(parameters, salt);
         
+        // AES-GCM decryption straight into buffer of final size, so no partial copies of plaintext are left on heap
+        CryptoPP::byte* plaintext = output(plaintextSize);
+        auto& dec = cipherContext<CryptoPP::GCM<CryptoPP::AES>::Decryption>(key);
+        if (!dec.DecryptAndVerify(plaintext, tag, TAG_SIZE, iv, IV_SIZE, nullptr, 0, encryptedData, plaintextSize)) {
+            // During key rotation data not re-encrypted yet is still sealed with previous password
+            auto previous = dataKey(parameters, salt, true);
+            if (!previous || !cipherContext<CryptoPP::GCM<CryptoPP::AES>::Decryption>(previous).DecryptAndVerify(
+                    plaintext, tag, TAG_SIZE, iv, IV_SIZE, nullptr, 0, encryptedData, plaintextSize)) {
+                SecureZeroMemory(plaintext, plaintextSize);
+                throw std::runtime_error("Decryption error (probably wrong password): authentication tag mismatch");
+            }
+            if (previousUsed) {
+                *previousUsed = true;
+            }
+        }
     } 
     catch (const CryptoPP::Exception& e) {
         throw std::runtime_error("Decryption error (probably wrong password): " + std::string(e.what()));
     }
 }
 
-std::map<std::uint32_t, std::unique_ptr<Crypto>> CryptoManager::usersCrypto;
+std::map<std::uint32_t, std::shared_ptr<Crypto>> CryptoManager::usersCrypto;
 std::mutex CryptoManager::mtx;
 
-void CryptoManager::registerCrypto(const std::string& password, const std::uint32_t id) {
-    // Check if Crypto with this key allready exists, if so - erase it
-    auto it = usersCrypto.find(id);
-    if (it != usersCrypto.end()) {
-        usersCrypto.erase(it);
-    }
+void CryptoManager::registerCrypto(const std::string& password, const std::uint32_t id, const KdfParameters& kdf) {
+    auto crypto = std::make_shared<Crypto>(password, kdf);
+    std::lock_guard<std::mutex> lock(mtx);
 
-    // Register new instance
-    usersCrypto[id] = std::make_unique<Crypto>(password);
+    // Previous instance is only released here, workers still holding it finish with it
+    usersCrypto[id] = std::move(crypto);
 }
 
-Crypto* CryptoManager::get(const std::uint32_t id) {
+std::shared_ptr<Crypto> CryptoManager::get(const std::uint32_t id) {
+    std::lock_guard<std::mutex> lock(mtx);
     auto it = usersCrypto.find(id);
     if (it == usersCrypto.end()) {
         throw std::runtime_error(std::format("Crypto with id: {} was not found", id));
     }
-    return it->second.get();
+    return it->second;
 }
\ No newline at end of file
@@ -3,46 +3,172 @@
 #include <map>
 #include <memory>
 #include <mutex>
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory_resource>
+#include <string_view>
 #include <cryptopp/secblock.h>
 #include <cryptopp/osrng.h>
+#include <kdf.hpp>
 
 /// @brief Class for handling encryption/decryption of data based on user password
-/// @note Uses AES-256-GCM with PBKDF2 for safe key derive from password. Each encryption uses unique salt and IV.
+/// @note Uses AES-256-GCM with key derived from password by KDF of user (PBKDF2 or Argon2id). Every object (session) encrypts with
+/// one random salt, so key is derived once, and every encryption uses unique IV. Keys derived for salts of
+/// decrypted data are cached, and every thread keeps cipher contexts with ready key schedule per key,
+/// so single operation only resynchronizes IV.
+/// @note Ciphertext is binary envelope: version byte, KDF parameters (only when other than legacy PBKDF2), salt, IV,
+/// ciphertext and tag. Legacy Base64 text (salt, IV, ciphertext and tag without version byte) is still accepted by decrypt().
+/// @note encrypt() and decrypt() are safe to call concurrently from multiple threads.
 class Crypto {
 public:
     /// @brief Constructor with user password
     /// @param password User password (cannot be empty)
-    /// @throws std::invalid_argument if password is empty
-    explicit Crypto(const std::string& password);
+    /// @param kdf Parameters of key derivation used for encryption, decryption follows parameters of envelope
+    /// @throws std::invalid_argument if password is empty or parameters are invalid
+    explicit Crypto(const std::string& password, const KdfParameters& kdf = KdfParameters());
     
     /// @brief Destructor
     ~Crypto() = default;
     
     /// @brief Encrypts plaintext
     /// @param plaintext Text to encrypt
-    /// @return Encrypted text in Base64 format (contains salt, IV, ciphertext and tag)
+    /// @return Binary envelope of ENVELOPE_OVERHEAD (ENVELOPE_KDF_OVERHEAD for non legacy KDF) + plaintext size bytes, to be stored as BLOB
     /// @throws std::runtime_error in case of encryption error
-    std::string encrypt(const std::string& plaintext);
+    std::string encrypt(std::string_view plaintext);
     
     /// @brief Decrypts encrypted text
-    /// @param ciphertext Encrypted text in Base64 format
+    /// @param ciphertext Binary envelope or legacy Base64 text
     /// @return Decrypted plaintext
     /// @throws std::runtime_error in case of decryption error or wrong password
-    std::string decrypt(const std::string& ciphertext);
+    std::string decrypt(std::string_view ciphertext);
+
+    /// @brief Decrypts encrypted text into memory of given resource
+    /// @param ciphertext Binary envelope or legacy Base64 text
+    /// @param resource Memory resource receiving plaintext, e.g. buffer of row batch
+    /// @return View of decrypted plaintext, valid as long as memory of resource
+    /// @throws std::runtime_error in case of decryption error or wrong password
+    std::string_view decrypt(std::string_view ciphertext, std::pmr::memory_resource& resource);
+
+    /// @brief Checks whether encrypted text is still sealed with previous password, see setPreviousPassword()
+    /// @param ciphertext Binary envelope or legacy Base64 text
+    /// @return true when only previous password opens it
+    /// @throws std::runtime_error in case of decryption error or wrong password
+    bool needsPreviousPassword(std::string_view ciphertext);
+
+    /// @brief Derives AES key from user password and given salt
+    /// @note Always uses legacy PBKDF2, so keys of vault archives stay stable when KDF of user is upgraded
+    /// @param salt salt for key derivation
+    /// @return derived key of AES_KEY_SIZE bytes
+    CryptoPP::SecByteBlock deriveKey(const CryptoPP::SecByteBlock& salt);
+
+    /// @brief Gets deterministic key for given context, e.g. key of blind index
+    /// @param context context used as salt, should contain user id and purpose
+    /// @return key of AES_KEY_SIZE bytes, derived once and cached for lifetime of object
+    /// @note Always uses legacy PBKDF2, so stored blind index tokens stay valid when KDF of user is upgraded
+    const CryptoPP::SecByteBlock& contextKey(const std::string& context);
+
+    /// @brief Sets password of data not re-encrypted yet after change of master password
+    /// @note Envelopes failing authentication with own password are tried again with previous one, so vault stays readable during key rotation
+    /// @param password previous user password (cannot be empty)
+    /// @throws std::invalid_argument if password is empty
+    void setPreviousPassword(const std::string& password);
+
+    /// @brief Forgets previous password and keys derived from it, called when key rotation is finished
+    void clearPreviousPassword();
+
+    /// @brief Gets parameters of key derivation used for encryption
+    /// @return KDF parameters
+    const KdfParameters& kdfParameters() const;
+
+    /// @brief Sets KDF parameters of new and upgraded users, e.g. result of KdfParameters::calibrate()
+    /// @param kdf validated parameters
+    static void setTargetKdf(const KdfParameters& kdf);
+
+    /// @brief Gets KDF parameters of new and upgraded users
+    /// @return KDF parameters, legacy PBKDF2 until set
+    static KdfParameters targetKdf();
+
+    /// @brief Describes hardware acceleration used by AES-GCM on this CPU
+    /// @return e.g. "AES-NI + PCLMUL" or "none (software AES and GHASH)"
+    static std::string accelerationInfo();
+
+    /// @brief Computes deterministic keyed fingerprint (HMAC-SHA256) of data
+    /// @param context context of key, see contextKey()
+    /// @param data data to fingerprint
+    /// @return fingerprint in Base64 format
+    std::string fingerprint(const std::string& context, const std::string& data);
 
-private:
-    std::string userPassword;
-    CryptoPP::AutoSeededRandomPool rng;
-    
     // Cryptographic constants
     static const size_t AES_KEY_SIZE = 32;        // AES-256 (32 bytes)
     static const size_t IV_SIZE = 12;             // 96 bits for GCM
     static const size_t TAG_SIZE = 16;            // 128 bits for GCM
     static const size_t SALT_SIZE = 16;           // 128 bits salt
-    static const unsigned int PBKDF2_ITERATIONS = 100000; // 100k iterations
+    static const CryptoPP::byte ENVELOPE_VERSION = 0x01;                        // First byte of binary envelope
+    static const CryptoPP::byte ENVELOPE_KDF_VERSION = 0x02;                    // First byte of envelope carrying KDF parameters
+    static const size_t ENVELOPE_OVERHEAD = 1 + SALT_SIZE + IV_SIZE + TAG_SIZE; // Size of envelope without ciphertext
+    static const size_t ENVELOPE_KDF_OVERHEAD = ENVELOPE_OVERHEAD + KdfParameters::ENCODED_SIZE;
+    static const size_t MAX_CIPHER_CONTEXTS = 32;                               // Cipher contexts kept by every thread
+    static const size_t MAX_DATA_KEYS = 64;                                     // Data keys cached by every session
+
+private:
+    /// @brief AES key derived for one salt, shared by cipher contexts of all threads
+    struct DataKey {
+        std::uint64_t id;               // Unique id of key, identifies cipher contexts
+        CryptoPP::SecByteBlock key;     // Derived key
+    };
+
+    /// @brief Cached data key, placeholder until derivation finishes
+    struct CachedDataKey {
+        std::shared_future<std::shared_ptr<const DataKey>> key;   // Key, ready when derivation finished
+        std::uint64_t lastUse;                                      // Value of dataKeysClock at last use
+    };
+
+    std::string userPassword;
+    std::string previousPassword;                               // Password of data not re-encrypted yet, empty if none
+    KdfParameters kdf;                                          // KDF of encryption
+    static std::atomic<KdfParameters> target;                   // KDF of new and upgraded users
+    std::map<std::string, CryptoPP::SecByteBlock> contextKeys;  // Cache of context keys
+    std::mutex contextKeysMutex;                                // Mutex guarding context keys
+    std::map<std::string, CachedDataKey> dataKeys;              // Cache of data keys by KDF parameters and salt
+    std::uint64_t dataKeysClock = 0;                            // Counter of data key lookups, orders eviction
+    std::string sessionSalt;                                    // Salt of all encryptions of this object
+    std::mutex dataKeysMutex;                                   // Mutex guarding data keys, session salt and previous password
+
+    /// @brief Gets data key for given KDF parameters and salt, derives it on first use
+    /// @note Derivation runs outside of mutex, so other salts are not blocked by it, and threads asking
+    /// for the same salt wait for the first one. Cache keeps MAX_DATA_KEYS least recently used keys,
+    /// legacy envelopes with salt per field would grow it without bound otherwise.
+    /// @param parameters KDF parameters
+    /// @param salt salt of SALT_SIZE bytes
+    /// @param previous true to derive key from previous password
+    /// @return shared data key, nullptr when previous key is requested and there is no previous password
+    std::shared_ptr<const DataKey> dataKey(const KdfParameters& parameters, const CryptoPP::byte* salt, bool previous = false);
+
+    /// @brief Gets data key used for encryption, generates session salt on first use
+    /// @param salt output salt of SALT_SIZE bytes
+    /// @return shared data key
+    std::shared_ptr<const DataKey> sessionKey(CryptoPP::byte* salt);
+
+    /// @brief Gets cipher contexts of calling thread with key schedule of given key
+    /// @param key data key
+    /// @return reference valid until next call on the same thread
+    template <typename Cipher>
+    static Cipher& cipherContext(const std::shared_ptr<const DataKey>& key);
+    
+    /// @brief Gets random generator of calling thread
+    /// @return reference to thread local random pool
+    static CryptoPP::AutoSeededRandomPool& rng();
+
+    /// @brief Decrypts encrypted text into buffer provided by caller
+    /// @param ciphertext Binary envelope or legacy Base64 text
+    /// @param output Callback returning buffer for plaintext of given size, buffer is zeroed if authentication fails
+    /// @param previousUsed Optional output, set to true when only previous password opened the envelope
+    void decryptInto(std::string_view ciphertext, const std::function<CryptoPP::byte*(std::size_t)>& output, bool* previousUsed = nullptr);
     
-    /// @brief Derives encryption key from password using PBKDF2
+    /// @brief Derives encryption key from password using legacy PBKDF2
     /// @param password User password
     /// @param salt Salt for key derivation
     /// @param derivedKey Output buffer for derived key
@@ -62,17 +188,19 @@ private:
 /// @brief Class for making access to crypto classes easier along entire software
 class CryptoManager {
 private:
-    static std::map<std::uint32_t, std::unique_ptr<Crypto>> usersCrypto;    // map ID -> crypto
+    static std::map<std::uint32_t, std::shared_ptr<Crypto>> usersCrypto;    // map ID -> crypto
     static std::mutex mtx;                                                  // mutex for safety
 
 public:
     /// @brief Function to register new Crypto object
     /// @param password user password
     /// @param id id of user
-    static void registerCrypto(const std::string& password, const std::uint32_t id);
+    /// @param kdf KDF parameters of user
+    static void registerCrypto(const std::string& password, const std::uint32_t id, const KdfParameters& kdf);
 
     /// @brief Function to get Crypto object associated with user of given ID
+    /// @note Returned object stays valid when user logs in again or changes password, holder keeps it alive
     /// @param id ID of user
-    /// @return pointer to crypto object
-    static Crypto* get(const std::uint32_t id);
+    /// @return shared crypto object
+    static std::shared_ptr<Crypto> get(const std::uint32_t id);
 };
\ No newline at end of file
@@ -1,4 +1,10 @@
 #include <database-manager.hpp>
+#include <request-trace.hpp>
+#include <algorithm>
+#include <charconv>
+#include <format>
+#include <stdexcept>
+#include <string_view>
 
 DatabaseManager& DatabaseManager::getInstance() {
     static DatabaseManager manager;
@@ -48,3 +54,178 @@ std::mutex& DatabaseManager::getMutex() {
     return mtx; 
 }
 
+void DatabaseManager::configureShards(const ShardSettings& settings) {
+    if (settings.count == 0 || settings.maxOpen == 0) {
+        throw std::invalid_argument("Shard count and number of open shards must be positive");
+    }
+
+    std::scoped_lock lock(shardsMutex);
+    if (!shards.empty()) {
+        throw std::logic_error("Shards are already open");
+    }
+    shardSettings = settings;
+}
+
+DatabaseManager::ShardSettings DatabaseManager::getShardSettings() {
+    std::scoped_lock lock(shardsMutex);
+    return shardSettings;
+}
+
+void DatabaseManager::setShardInitializer(std::function<void(SQLite::Database&)> initializer) {
+    std::scoped_lock lock(shardsMutex);
+    shardInitializer = std::move(initializer);
+    if (shardSettings.mode == ShardMode::None) {
+        std::scoped_lock databaseLock(getMutex());
+        shardInitializer(*getDatabase());
+    }
+}
+
+DatabaseManager::Lease DatabaseManager::shard(const std::uint32_t userId) {
+    return Lease(pinShard(shardOf(userId)));
+}
+
+std::shared_ptr<DatabaseManager::Shard> DatabaseManager::pinShard(const std::uint32_t key) {
+    if (!isInitialized) {
+        throw std::runtime_error("Database not initialized");
+    }
+
+    std::shared_ptr<Shard> leased;
+    {
+        std::scoped_lock lock(shardsMutex);
+        if (shardSettings.mode == ShardMode::None) {
+            if (!mainShard) {
+                mainShard = std::make_shared<Shard>(getDatabase(), getMutex());
+            }
+            leased = mainShard;
+        }
+        else {
+            auto found = shardIndex.find(key);
+            if (found != shardIndex.end()) {
+                shards.splice(shards.begin(), shards, found->second);
+                leased = found->second->second;
+            }
+            else {
+                auto path = shardPath(key);
+                try {
+                    std::filesystem::create_directories(path.parent_path());
+                    auto database = std::make_shared<SQLite::Database>(path.string(), SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+                    if (shardInitializer) {
+                        shardInitializer(*database);
+                    }
+                    leased = std::make_shared<Shard>(std::move(database));
+                }
+                catch (const SQLite::Exception& e) {
+                    throw std::runtime_error(std::format("Failed to open shard {}: {}", path.string(), e.what()));
+                }
+                catch (const std::filesystem::filesystem_error& e) {
+                    throw std::runtime_error(std::format("Failed to create shard directory: {}", e.what()));
+                }
+                shards.emplace_front(key, leased);
+                shardIndex[key] = shards.begin();
+
+                // Only idle shards are closed, shard in use stays open over limit until its lease ends
+                for (auto it = std::prev(shards.end()); shards.size() > shardSettings.maxOpen && it != shards.begin();) {
+                    auto current = it--;
+                    if (current->second.use_count() == 1) {
+                        shardIndex.erase(current->first);
+                        shards.erase(current);
+                    }
+                }
+            }
+        }
+    }
+    return leased;
+}
+
+std::vector<std::uint32_t> DatabaseManager::storedShards() {
+    std::vector<std::uint32_t> keys;
+    std::scoped_lock lock(shardsMutex);
+    if (shardSettings.mode == ShardMode::None) {
+        return keys;
+    }
+
+    // Files are matched by name pattern of current mode
+    const std::string prefix = shardSettings.mode == ShardMode::User ? "user-" : "shard-";
+    const std::string suffix = ".db";
+    auto directory = shardPath(0).parent_path();
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+        auto name = entry.path().filename().string();
+        if (!entry.is_regular_file() || name.size() <= prefix.size() + suffix.size() ||
+            !name.starts_with(prefix) || !name.ends_with(suffix)) {
+            continue;
+        }
+        std::uint32_t key = 0;
+        auto digits = std::string_view(name).substr(prefix.size(), name.size() - prefix.size() - suffix.size());
+        auto [end, result] = std::from_chars(digits.data(), digits.data() + digits.size(), key);
+        if (result == std::errc() && end == digits.data() + digits.size()) {
+            keys.push_back(key);
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+    return keys;
+}
+
+std::filesystem::path DatabaseManager::getShardPath(const std::uint32_t key) {
+    std::scoped_lock lock(shardsMutex);
+    if (shardSettings.mode == ShardMode::None) {
+        return getDatabase()->getFilename();
+    }
+    return shardPath(key);
+}
+
+std::size_t DatabaseManager::openShards() {
+    std::scoped_lock lock(shardsMutex);
+    return shards.size();
+}
+
+std::uint32_t DatabaseManager::shardOf(const std::uint32_t userId) {
+    std::scoped_lock lock(shardsMutex);
+    return shardSettings.mode == ShardMode::None ? 0 : shardKey(userId);
+}
+
+std::uint32_t DatabaseManager::shardKey(const std::uint32_t userId) const {
+    if (shardSettings.mode == ShardMode::User) {
+        return userId;
+    }
+
+    // Fibonacci hashing spreads consecutive user ids across shards
+    return static_cast<std::uint32_t>(((userId * 0x9E3779B97F4A7C15ull) >> 32) % shardSettings.count);
+}
+
+std::filesystem::path DatabaseManager::shardPath(const std::uint32_t key) const {
+    auto directory = shardSettings.directory;
+    if (directory.empty()) {
+        directory = std::filesystem::path(db->getFilename()).parent_path() / "shards";
+    }
+    if (shardSettings.mode == ShardMode::User) {
+        return directory / std::format("user-{}.db", key);
+    }
+    return directory / std::format("shard-{}.db", key);
+}
+
+DatabaseManager::Lease::Lease(std::shared_ptr<Shard> shard) : shard(std::move(shard)), lock(this->shard->mtx, std::defer_lock) {
+    timing::ScopedStage stage("db.lock");
+    lock.lock();
+}
+
+DatabaseManager::Lease::~Lease() {
+    // Statement left on a row would keep read transaction of shard open
+    for (auto statement : shard->active) {
+        statement->tryReset();
+    }
+    shard->active.clear();
+}
+
+SQLite::Statement& DatabaseManager::Lease::statement(const std::string& sql) {
+    auto& cached = shard->statements[sql];
+    if (!cached) {
+        cached = std::make_unique<SQLite::Statement>(*shard->db, sql);
+    }
+    else {
+        cached->reset();
+        cached->clearBindings();
+    }
+    shard->active.push_back(cached.get());
+    return *cached;
+}
@@ -1,12 +1,89 @@
 #pragma once
 
 #include <SQLiteCpp/SQLiteCpp.h>
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
+#include <functional>
+#include <list>
 #include <memory>
 #include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 class DatabaseManager {
 public:
+    /// @brief Placement of per-user tables (passwords, tokens, vault versions)
+    enum class ShardMode {
+        None,   // Everything in main database
+        User,   // One database file per user
+        Hash    // Users hashed across fixed number of database files
+    };
+
+    /// @brief Settings of sharding
+    class ShardSettings {
+    public:
+        ShardMode mode = ShardMode::None;       // Placement of per-user tables
+        std::uint32_t count = 16;               // Number of shard files in Hash mode, must not change once data is stored
+        std::filesystem::path directory;        // Directory of shard files, empty for "shards" next to main database
+        std::size_t maxOpen = 64;               // Shard handles kept open, least recently used idle ones are closed above it
+    };
+
+    class Lease;
+
+    /// @brief Open database of one shard with its own lock and prepared statements
+    class Shard {
+    public:
+        /// @brief Constructor of shard guarded by its own mutex
+        /// @param db open database
+        explicit Shard(std::shared_ptr<SQLite::Database> db) : db(std::move(db)), mtx(ownMutex) {}
+
+        /// @brief Constructor of shard sharing mutex with other users of database
+        /// @param db open database
+        /// @param mtx mutex guarding database
+        Shard(std::shared_ptr<SQLite::Database> db, std::mutex& mtx) : db(std::move(db)), mtx(mtx) {}
+
+    private:
+        friend class Lease;
+
+        std::shared_ptr<SQLite::Database> db;                                           // Database of shard
+        std::mutex ownMutex;                                                            // Mutex of shard not sharing database
+        std::mutex& mtx;                                                                // Mutex guarding database and statements
+        std::unordered_map<std::string, std::unique_ptr<SQLite::Statement>> statements; // Prepared statements by SQL text
+        std::vector<SQLite::Statement*> active;                                         // Statements handed out under current lease
+    };
+
+    /// @brief Locked access to shard, keeps shard open while held
+    class Lease {
+    public:
+        /// @brief Constructor, locks shard
+        /// @param shard shard to lock
+        explicit Lease(std::shared_ptr<Shard> shard);
+
+        /// @brief Destructor, resets handed out statements and unlocks shard
+        ~Lease();
+
+        /// @brief Delete copy, assignment, move, move assignment constructor
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        Lease(Lease&&) = delete;
+        Lease& operator=(Lease&&) = delete;
+
+        /// @brief Gets database of shard
+        /// @return database, valid while lease is held
+        SQLite::Database& database() { return *shard->db; }
+
+        /// @brief Gets prepared statement from cache of shard, reset and with cleared bindings
+        /// @param sql fixed SQL text, statements built from variable text should not be cached
+        /// @return statement, valid while lease is held
+        SQLite::Statement& statement(const std::string& sql);
+
+    private:
+        std::shared_ptr<Shard> shard;           // Leased shard
+        std::unique_lock<std::mutex> lock;      // Lock of shard
+    };
+
     static DatabaseManager& getInstance();
 
     // Deleted copy constructor and assignment operator
@@ -17,10 +94,69 @@ public:
     std::shared_ptr<SQLite::Database> getDatabase();
     std::mutex& getMutex();
 
+    /// @brief Sets placement of per-user tables, must be called before first shard is leased
+    /// @param settings settings of sharding
+    /// @throw std::invalid_argument on zero shard count or zero open handles
+    void configureShards(const ShardSettings& settings);
+
+    /// @brief Gets settings of sharding
+    /// @return current settings
+    ShardSettings getShardSettings();
+
+    /// @brief Sets schema initializer run on every shard when it is opened
+    /// @param initializer function creating per-user tables
+    /// @note In None mode it is run on main database immediately
+    void setShardInitializer(std::function<void(SQLite::Database&)> initializer);
+
+    /// @brief Leases shard holding tables of user, opening it when needed
+    /// @param userId ID of user
+    /// @return locked shard
+    Lease shard(const std::uint32_t userId);
+
+    /// @brief Gets shard with given key without locking it, opening it when needed
+    /// @param key key of shard, e.g. from shardOf() or storedShards()
+    /// @return shard kept open while pointer is held, lock it with Lease for every access; main database in None mode
+    std::shared_ptr<Shard> pinShard(const std::uint32_t key);
+
+    /// @brief Gets keys of shard files stored on disk, including shards not open now
+    /// @return keys in ascending order, empty in None mode
+    std::vector<std::uint32_t> storedShards();
+
+    /// @brief Gets path of database file of shard
+    /// @param key key of shard
+    /// @return path of database file, main database in None mode
+    std::filesystem::path getShardPath(const std::uint32_t key);
+
+    /// @brief Gets key of shard holding tables of user without opening it
+    /// @param userId ID of user
+    /// @return key equal for users sharing shard, 0 in None mode
+    std::uint32_t shardOf(const std::uint32_t userId);
+
+    /// @brief Gets number of open shard handles
+    /// @return number of handles, main database not included
+    std::size_t openShards();
+
 private:
     DatabaseManager() = default;  // Private constructor
 
+    /// @brief Gets key of shard holding tables of user
+    /// @param userId ID of user
+    /// @return user id in User mode, shard index in Hash mode
+    std::uint32_t shardKey(const std::uint32_t userId) const;
+
+    /// @brief Gets path of shard file
+    /// @param key key of shard
+    /// @return path of database file
+    std::filesystem::path shardPath(const std::uint32_t key) const;
+
     std::shared_ptr<SQLite::Database> db;
     std::mutex mtx;
     bool isInitialized = false;
-};
\ No newline at end of file
+
+    ShardSettings shardSettings;                                                // Settings of sharding
+    std::function<void(SQLite::Database&)> shardInitializer;                    // Schema initializer of shards
+    std::shared_ptr<Shard> mainShard;                                           // Main database as shard in None mode
+    std::list<std::pair<std::uint32_t, std::shared_ptr<Shard>>> shards;         // Open shards, most recently used first
+    std::unordered_map<std::uint32_t, decltype(shards)::iterator> shardIndex;   // Open shards by key
+    std::mutex shardsMutex;                                                     // Mutex guarding sharding state
+};
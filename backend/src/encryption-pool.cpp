@@ -0,0 +1,148 @@
+#include <encryption-pool.hpp>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+namespace pass {
+    class EncryptionPool::Batch {
+    public:
+        /// @brief Constructor
+        /// @param count number of indices
+        /// @param body function called for every index, must outlive close()
+        Batch(std::size_t count, const std::function<void(std::size_t)>& body) : count(count), body(body) {}
+
+        /// @brief Joins pool thread to batch
+        /// @return false when batch is already closed by calling thread
+        bool enter() {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (closed) {
+                return false;
+            }
+            ++running;
+            return true;
+        }
+
+        /// @brief Runs body for next free indices until range is exhausted
+        void work() {
+            try {
+                for (std::size_t i = next++; i < count; i = next++) {
+                    body(i);
+                }
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(mtx);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                next = count;
+            }
+        }
+
+        /// @brief Leaves batch after work()
+        void leave() {
+            std::lock_guard<std::mutex> lock(mtx);
+            --running;
+            done.notify_all();
+        }
+
+        /// @brief Closes batch for pool threads which did not join yet and waits for those which did
+        /// @return first exception thrown by body, nullptr if none
+        std::exception_ptr close() {
+            std::unique_lock<std::mutex> lock(mtx);
+            closed = true;
+            done.wait(lock, [this]() { return running == 0; });
+            return error;
+        }
+
+    private:
+        const std::size_t count;                                // Number of indices
+        const std::function<void(std::size_t)>& body;           // Function called for every index
+        std::atomic<std::size_t> next = 0;                      // Next free index
+        std::mutex mtx;                                         // Mutex guarding state below
+        std::condition_variable done;                           // Signals pool thread leaving batch
+        std::size_t running = 0;                                // Pool threads working on batch
+        bool closed = false;                                    // Whether pool threads may still join
+        std::exception_ptr error;                               // First exception of body
+    };
+
+    EncryptionPool& EncryptionPool::getInstance() {
+        static EncryptionPool pool;
+        return pool;
+    }
+
+    EncryptionPool::~EncryptionPool() {
+        stop();
+    }
+
+    void EncryptionPool::forEach(std::size_t count, const std::function<void(std::size_t)>& body) {
+        if (count == 0) {
+            return;
+        }
+
+        auto batch = std::make_shared<Batch>(count, body);
+        {
+            // Every queued copy of batch is picked up by one pool thread
+            std::lock_guard<std::mutex> lock(mtx);
+            ensureStarted();
+            std::size_t helpers = std::min(workers.size(), count - 1);
+            batches.insert(batches.end(), helpers, batch);
+        }
+        cv.notify_all();
+
+        batch->work();
+        auto error = batch->close();
+        {
+            // Copies not picked up yet would only find closed batch
+            std::lock_guard<std::mutex> lock(mtx);
+            std::erase(batches, batch);
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    void EncryptionPool::stop() {
+        std::vector<std::jthread> stopping;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping.swap(workers);
+        }
+        for (auto& worker : stopping) {
+            worker.request_stop();
+        }
+        cv.notify_all();
+        stopping.clear();
+    }
+
+    void EncryptionPool::ensureStarted() {
+        if (!workers.empty()) {
+            return;
+        }
+
+        // Calling thread is the last worker of its batch
+        std::size_t threads = std::max(2u, std::thread::hardware_concurrency()) - 1;
+        for (std::size_t i = 0; i < threads; ++i) {
+            workers.emplace_back([this](std::stop_token stopToken) { run(stopToken); });
+        }
+    }
+
+    void EncryptionPool::run(std::stop_token stopToken) {
+        while (true) {
+            std::shared_ptr<Batch> batch;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv.wait(lock, stopToken, [this]() { return !batches.empty(); });
+                if (stopToken.stop_requested()) {
+                    return;
+                }
+                batch = std::move(batches.front());
+                batches.pop_front();
+            }
+
+            if (batch->enter()) {
+                batch->work();
+                batch->leave();
+            }
+        }
+    }
+}
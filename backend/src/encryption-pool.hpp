@@ -0,0 +1,61 @@
+#pragma once
+
+#include <fix.hpp>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pass {
+    /// @brief Pool of threads encrypting batches of passwords, implementing Singleton pattern
+    /// @note Threads are started on first use and reused by every batch (import, batch mutations, key rotation),
+    /// so encryption of a chunk does not pay for creating threads. Calling thread always works on its own batch,
+    /// so batch finishes even when all pool threads are busy with other batches.
+    class EncryptionPool {
+    public:
+        /// @brief Get singleton instance of pool
+        /// @return Reference to pool instance
+        static EncryptionPool& getInstance();
+
+        /// @brief Delete copy, assignment, move, move assignment constructor
+        EncryptionPool(const EncryptionPool&) = delete;
+        EncryptionPool& operator=(const EncryptionPool&) = delete;
+        EncryptionPool(EncryptionPool&&) = delete;
+        EncryptionPool& operator=(EncryptionPool&&) = delete;
+
+        /// @brief Runs body for every index of range on calling thread and free pool threads
+        /// @param count number of indices
+        /// @param body function called once for every index in [0, count)
+        /// @throw first exception thrown by body, remaining indices are skipped
+        void forEach(std::size_t count, const std::function<void(std::size_t)>& body);
+
+        /// @brief Stops pool threads, next batch starts them again
+        void stop();
+
+    private:
+        /// @brief Range shared by calling thread and pool threads
+        class Batch;
+
+        /// @brief Private constructor for Singleton pattern
+        EncryptionPool() = default;
+
+        /// @brief Private destructor
+        ~EncryptionPool();
+
+        /// @brief Starts pool threads unless they are running, must be called with mutex locked
+        void ensureStarted();
+
+        /// @brief Worker thread loop
+        /// @param stopToken token signalling stop request
+        void run(std::stop_token stopToken);
+
+        std::vector<std::jthread> workers;              // Pool threads
+        std::deque<std::shared_ptr<Batch>> batches;     // Batches waiting for help of pool threads
+        std::mutex mtx;                                 // Mutex guarding workers and batches
+        std::condition_variable_any cv;                 // Signals queued batch or stop
+    };
+}
@@ -5,12 +5,84 @@
 #include <tuple>
 #include <string>
 #include <vector>
+#include <format>
 #include <configuration.hpp>
 #include <passwords.hpp>
 #include <auth.hpp>
 #include <crypto.hpp>
+#include <password-import.hpp>
+#include <vault-archive.hpp>
+#include <utilities.hpp>
+#include <change-events.hpp>
+#include <breach-corpus.hpp>
+#include <secure-arena.hpp>
+#include <admission-control.hpp>
+#include <kdf-executor.hpp>
+#include <vault-cache.hpp>
+#include <key-rotation.hpp>
+#include <search-backfill.hpp>
+#include <backup-manager.hpp>
+#include <request-trace.hpp>
+#include <Poco/URI.h>
+#include <Poco/Net/HTTPServerRequestImpl.h>
+#include <Poco/Net/NameValueCollection.h>
+#include <Poco/Timespan.h>
+#include <sstream>
+#include <charconv>
 
 namespace Endpoints {
+    namespace {
+        /// @brief Writes complete response straight to socket detached from HTTP server
+        void sendDetached(Poco::Net::StreamSocket& socket, const Poco::Net::NameValueCollection& headers, const AsyncResponse& result) {
+            Poco::Net::HTTPResponse response(result.status);
+            for (const auto& [name, value] : headers) {
+                response.set(name, value);
+            }
+            std::string body = result.body.dump();
+            response.setContentType("application/json");
+            response.setContentLength(static_cast<std::streamsize>(body.size()));
+            response.setKeepAlive(false);
+
+            std::ostringstream out;
+            response.write(out);
+            out << body;
+            std::string data = out.str();
+
+            std::size_t offset = 0;
+            while (offset < data.size()) {
+                int sent = socket.sendBytes(data.data() + offset, static_cast<int>(data.size() - offset));
+                if (sent <= 0) {
+                    throw std::runtime_error("Connection closed before response was sent");
+                }
+                offset += static_cast<std::size_t>(sent);
+            }
+            socket.shutdownSend();
+        }
+
+        /// @brief Answers request to backup endpoint which is not enabled in configuration
+        void sendBackupEndpointsDisabled(Poco::Net::HTTPServerResponse& response) {
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_NOT_FOUND);
+            response.setContentType("application/json");
+            nlohmann::json errorJson = {{"status", "error"}, {"message", "Backup endpoints are disabled"}};
+            std::ostream& out = response.send();
+            out << errorJson.dump();
+        }
+
+        /// @brief Parses whole query parameter as integer
+        /// @param name name of parameter, used in error message
+        /// @param value text of parameter
+        /// @return parsed value
+        /// @throw std::invalid_argument when value is not an integer of type T or has trailing characters
+        template<typename T>
+        T parseQueryNumber(std::string_view name, std::string_view value) {
+            T result{};
+            auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), result);
+            if (error != std::errc() || end != value.data() + value.size()) {
+                throw std::invalid_argument(std::format("Invalid value of parameter {}: {}", name, value));
+            }
+            return result;
+        }
+    }
 
     std::string extractJwt(Poco::Net::HTTPServerRequest& request) {
         // Read auth header
@@ -34,7 +106,94 @@ namespace Endpoints {
         
         return token;
     }
+
+    nlohmann::json parseBody(Poco::Net::HTTPServerRequest& request) {
+        timing::ScopedStage stage("parse");
+        return nlohmann::json::parse(request.stream());
+    }
     
+    void sendSecretJson(Poco::Net::HTTPServerResponse& response, nlohmann::json& body) {
+        // Serialized string is returned by value, so it keeps allocator of locked arena
+        auto serialized = [&body]() {
+            timing::ScopedStage stage("serialize");
+            auto dumped = util::dumpSecure(body);
+            util::wipe(body);
+            return dumped;
+        }();
+        sendSecretJson(response, serialized);
+    }
+
+    void sendSecretJson(Poco::Net::HTTPServerResponse& response, const util::SecureString& body) {
+        // Known length lets Poco send body in one write and keep connection alive
+        response.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+        response.setContentType("application/json");
+        timing::ScopedStage stage("send");
+        response.sendBuffer(body.data(), body.size());
+    }
+
+    void completeAsync(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response, std::move_only_function<AsyncResponse()> job) {
+        // Headers set so far (CORS) are carried over to response written by executor
+        Poco::Net::NameValueCollection headers;
+        for (const auto& [name, value] : response) {
+            headers.set(name, value);
+        }
+
+        // Take socket over from HTTP server, response is written by hand
+        auto& requestImpl = dynamic_cast<Poco::Net::HTTPServerRequestImpl&>(request);
+        Poco::Net::StreamSocket socket = requestImpl.detachSocket();
+        socket.setBlocking(true);
+        socket.setSendTimeout(Poco::Timespan(ASYNC_SEND_TIMEOUT_SECONDS, 0));
+
+        // Trace of request moves to executor together with the job, time spent in queue is its own stage
+        auto trace = timing::RequestTrace::current();
+        auto posted = timing::Clock::now();
+        auto task = [socket, headers = std::move(headers), job = std::move(job), trace, posted]() mutable {
+            timing::RequestTrace::Scope scope(trace);
+            if (trace) {
+                trace->add("kdf.queue", timing::Clock::now() - posted);
+            }
+
+            AsyncResponse result;
+            try {
+                result = job();
+            }
+            catch (const std::invalid_argument& e) {
+                result = { Poco::Net::HTTPResponse::HTTP_BAD_REQUEST, {
+                    {"status", "error"},
+                    {"message", "Invalid request format"},
+                    {"details", e.what()}
+                } };
+                Logger::error("Bad request format: {}", e.what());
+            }
+            catch (const std::exception& e) {
+                result = { Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR, {
+                    {"status", "error"},
+                    {"message", "Internal server error"},
+                    {"details", e.what()}
+                } };
+                Logger::error("Error completing request: {}", e.what());
+            }
+
+            if (trace) {
+                trace->setStatus(result.status);
+            }
+            try {
+                timing::ScopedStage stage("send");
+                sendDetached(socket, headers, result);
+            }
+            catch (const std::exception& e) {
+                Logger::warn("Could not send response: {}", e.what());
+            }
+        };
+
+        // Without executor (e.g. during shutdown) request is completed on this thread
+        if (auth::KdfExecutor::getInstance().size() == 0) {
+            task();
+            return;
+        }
+        auth::KdfExecutor::getInstance().post(std::move(task));
+    }
+
     void getConfiguration(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept {
         try {
             Logger::trace("Reading configuration.");
@@ -70,7 +229,7 @@ namespace Endpoints {
             Logger::trace("Updating configuration.");
 
             // Parse JSON from request body
-            nlohmann::json requestBody = nlohmann::json::parse(request.stream());
+            nlohmann::json requestBody = parseBody(request);
 
             // Parse Configuration
             auto configuartion = config::Configuration::fromJson(requestBody);
@@ -107,7 +266,7 @@ namespace Endpoints {
             Logger::trace("Generating password.");
             
             // Parse password options
-            nlohmann::json requestBody = nlohmann::json::parse(request.stream());
+            nlohmann::json requestBody = parseBody(request);
             auto passwordOptions = pass::Password::Options::fromJson(requestBody);
 
             // Generate password
@@ -117,6 +276,7 @@ namespace Endpoints {
             // Prepare response
             nlohmann::json resoult;
             resoult["password"] = password;
+            resoult["entropy"] = pass::PasswordGenerator::entropy(passwordOptions);
 
             // Response
             response.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
@@ -124,6 +284,14 @@ namespace Endpoints {
             std::ostream& out = response.send();
             out << resoult.dump();
         }
+        catch (const std::invalid_argument& e) {
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_BAD_REQUEST);
+            response.setContentType("application/json");
+            std::ostream& out = response.send();
+            nlohmann::json errorJson = {{"status", "error"}, {"message", e.what()}};
+            out << errorJson.dump();
+            Logger::error("Bad password generation options: {}", e.what());
+        }
         catch (const std::exception& e) {
             response.setStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
             response.setContentType("application/json");
@@ -146,26 +314,17 @@ namespace Endpoints {
     void getPasswords(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept {
         try {
             Logger::trace("Reading passwords.");
+            util::SecureArena::Scope secrets;
 
             // Validate request
             auto userId = auth::AuthenticationManager::validateJWTToken(extractJwt(request));
             
-            // Read passwords
+            // Read passwords, repeated reads are served from vault cache
             pass::PasswordManager manager;
-            auto passwords = manager.getAllPasswords();
-            nlohmann::json resoult = nlohmann::json::array();
-            for (const auto& password : passwords) {
-                if (password.userId == userId) {
-                    auto decryptedPassword = pass::PasswordCrypto::decrypt(password, userId);
-                    resoult.push_back(decryptedPassword.toJson());
-                }
-            }
+            auto resoult = manager.listPasswords(userId);
 
             // Response
-            response.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
-            response.setContentType("application/json");
-            std::ostream& out = response.send();
-            out << resoult.dump();
+            sendSecretJson(response, resoult);
         }
         catch (const std::exception& e) {
             response.setStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
@@ -186,36 +345,67 @@ namespace Endpoints {
         }
     }
 
-    void addPassword(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept {
+    void getPasswordChanges(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept {
         try {
-            Logger::trace("Adding password.");
+            Logger::trace("Reading password changes.");
+            util::SecureArena::Scope secrets;
 
             // Validate request
             auto userId = auth::AuthenticationManager::validateJWTToken(extractJwt(request));
 
-            // Parse JSON from request body
-            nlohmann::json requestBody = nlohmann::json::parse(request.stream());
+            // Read version known by client
+            std::int64_t since = 0;
+            for (const auto& [key, value] : Poco::URI(request.getURI()).getQueryParameters()) {
+                if (key == "since") {
+                    since = parseQueryNumber<std::int64_t>(key, value);
+                }
+            }
+            if (since < 0) {
+                throw std::invalid_argument("Version cannot be negative");
+            }
 
-            // Parse and update password
+            // Read and decrypt only changed passwords
             pass::PasswordManager manager;
-            auto password = pass::Password::fromJson(requestBody);
-            auto encryptedPassword = pass::PasswordCrypto::encrypt(password, userId);
-            manager.addPassword(encryptedPassword);
-            
+            auto changes = manager.getChanges(userId, since);
+            pass::PasswordBatch decrypted(util::SecureArena::resource());
+            decrypted.reserve(changes.changed.size());
+            for (const auto& password : changes.changed) {
+                pass::PasswordCrypto::decrypt(password, userId, decrypted);
+            }
+            util::SecureString resoult(util::SecureArena::resource());
+            {
+                // Decrypted entries are written straight into locked arena, only metadata goes through json
+                timing::ScopedStage stage("serialize");
+                nlohmann::json metadata = {
+                    {"version", changes.version},
+                    {"reset", changes.reset},
+                    {"removed", changes.removed}
+                };
+                resoult = util::dumpSecure(metadata);
+                resoult.pop_back();
+                resoult += ",\"changed\":";
+                pass::PasswordRow::appendJson(decrypted, resoult);
+                resoult += '}';
+            }
+
             // Response
-            response.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+            sendSecretJson(response, resoult);
+        }
+        catch (const std::invalid_argument& e) {
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_BAD_REQUEST);
             response.setContentType("application/json");
-            nlohmann::json j = {{"message", "Configuration updated"}};
             std::ostream& out = response.send();
-            out << j.dump();
+            nlohmann::json errorJson = {{"status", "error"}, {"message", "Invalid version"}};
+            out << errorJson.dump();
+            Logger::error("Bad password changes request: {}", e.what());
         }
         catch (const std::exception& e) {
             response.setStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
             response.setContentType("application/json");
             std::ostream& out = response.send();
-            nlohmann::json errorJson = {{"status", "error"}, {"message", e.what()}};
+            nlohmann::json errorJson = { {"status", "error"}, {"message", "Internal server error"} };
             out << errorJson.dump();
-            Logger::error("Error adding password: {}", e.what());
+            Logger::error("Error reading password changes: {}", e.what());
         }
         catch (...) {
             // Catch any other unexpected exceptions
@@ -224,40 +414,55 @@ namespace Endpoints {
             std::ostream& out = response.send();
             nlohmann::json errorJson = {{"status", "error"}, {"message", "An unexpected error occurred"}};
             out << errorJson.dump();
-            Logger::error("Unexpected error occurred while adding password");
+            Logger::error("Unexpected error occurred while reading password changes");
         }
     }
 
-    void updatePassword(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept {
+    void searchPasswords(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept {
         try {
-            Logger::trace("Updating password.");
+            Logger::trace("Searching passwords.");
+            util::SecureArena::Scope secrets;
 
             // Validate request
             auto userId = auth::AuthenticationManager::validateJWTToken(extractJwt(request));
 
-            // Parse JSON from request body
-            nlohmann::json requestBody = nlohmann::json::parse(request.stream());
+            // Read query
+            std::string query;
+            for (const auto& [key, value] : Poco::URI(request.getURI()).getQueryParameters()) {
+                if (key == "q") {
+                    query = value;
+                }
+            }
+            if (query.empty()) {
+                throw std::invalid_argument("Query cannot be empty");
+            }
 
-            // Parse and update password
+            // Only entries matched by index are decrypted
             pass::PasswordManager manager;
-            auto password = pass::Password::fromJson(requestBody);
-            auto decryptedPassword = pass::PasswordCrypto::decrypt(password, userId);
-            manager.updatePassword(decryptedPassword);
-            
+            nlohmann::json resoult = nlohmann::json::array();
+            util::WipeGuard wipeResoult(resoult);
+            for (const auto& password : manager.searchPasswords(userId, query)) {
+                resoult.push_back(password.toJson());
+            }
+
             // Response
-            response.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+            sendSecretJson(response, resoult);
+        }
+        catch (const std::invalid_argument& e) {
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_BAD_REQUEST);
             response.setContentType("application/json");
-            nlohmann::json j = {{"message", "Configuration updated"}};
             std::ostream& out = response.send();
-            out << j.dump();
+            nlohmann::json errorJson = {{"status", "error"}, {"message", e.what()}};
+            out << errorJson.dump();
+            Logger::error("Bad password search request: {}", e.what());
         }
         catch (const std::exception& e) {
             response.setStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
             response.setContentType("application/json");
             std::ostream& out = response.send();
-            nlohmann::json errorJson = {{"status", "error"}, {"message", e.what()}};
+            nlohmann::json errorJson = { {"status", "error"}, {"message", "Internal server error"} };
             out << errorJson.dump();
-            Logger::error("Error updating password: {}", e.what());
+            Logger::error("Error searching passwords: {}", e.what());
         }
         catch (...) {
             // Catch any other unexpected exceptions
@@ -266,39 +471,57 @@ namespace Endpoints {
             std::ostream& out = response.send();
             nlohmann::json errorJson = {{"status", "error"}, {"message", "An unexpected error occurred"}};
             out << errorJson.dump();
-            Logger::error("Unexpected error occurred while updating password");
+            Logger::error("Unexpected error occurred while searching passwords");
         }
     }
 
-    void removePassword(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept {
+    void matchPasswords(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept {
         try {
-            Logger::trace("Removing password.");
+            Logger::trace("Matching passwords to url.");
+            util::SecureArena::Scope secrets;
 
             // Validate request
             auto userId = auth::AuthenticationManager::validateJWTToken(extractJwt(request));
 
-            // Parse JSON from request body
-            nlohmann::json requestBody = nlohmann::json::parse(request.stream());
+            // Read url
+            std::string url;
+            for (const auto& [key, value] : Poco::URI(request.getURI()).getQueryParameters()) {
+                if (key == "url") {
+                    url = value;
+                }
+            }
+            if (url.empty()) {
+                throw std::invalid_argument("Url cannot be empty");
+            }
 
-            // Parse and update password
+            // Only entries of same site are decrypted
             pass::PasswordManager manager;
-            auto password = pass::Password::fromJson(requestBody);
-            manager.removePassword(password.id);
-            
+            nlohmann::json resoult = nlohmann::json::array();
+            util::WipeGuard wipeResoult(resoult);
+            for (const auto& [password, exact] : manager.matchPasswords(userId, url)) {
+                auto j = password.toJson();
+                j["exactOrigin"] = exact;
+                resoult.push_back(std::move(j));
+            }
+
             // Response
-            response.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+            sendSecretJson(response, resoult);
+        }
+        catch (const std::invalid_argument& e) {
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_BAD_REQUEST);
             response.setContentType("application/json");
-            nlohmann::json j = {{"message", "Configuration updated"}};
             std::ostream& out = response.send();
-            out << j.dump();
+            nlohmann::json errorJson = {{"status", "error"}, {"message", e.what()}};
+            out << errorJson.dump();
+            Logger::error("Bad password match request: {}", e.what());
         }
         catch (const std::exception& e) {
             response.setStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
             response.setContentType("application/json");
             std::ostream& out = response.send();
-            nlohmann::json errorJson = {{"status", "error"}, {"message", e.what()}};
+            nlohmann::json errorJson = { {"status", "error"}, {"message", "Internal server error"} };
             out << errorJson.dump();
-            Logger::error("Error removing password: {}", e.what());
+            Logger::error("Error matching passwords: {}", e.what());
         }
         catch (...) {
             // Catch any other unexpected exceptions
@@ -307,129 +530,119 @@ namespace Endpoints {
             std::ostream& out = response.send();
             nlohmann::json errorJson = {{"status", "error"}, {"message", "An unexpected error occurred"}};
             out << errorJson.dump();
-            Logger::error("Unexpected error occurred while removing password");
+            Logger::error("Unexpected error occurred while matching passwords");
         }
     }
 
-    void login(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept {
+    void getReusedPasswords(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept {
         try {
-            Logger::trace("Login authenication.");
+            Logger::trace("Reporting reused passwords.");
 
-            // Parse JSON from request body
-            nlohmann::json requestBody = nlohmann::json::parse(request.stream());
+            // Validate request
+            auto userId = auth::AuthenticationManager::validateJWTToken(extractJwt(request));
 
-            // read login and password
-            std::string login = requestBody.at("login").get<std::string>();
-            std::string password = requestBody.at("password").get<std::string>();
+            // Groups are computed from fingerprints, no password is decrypted
+            pass::PasswordManager manager;
+            nlohmann::json resoult = {{"groups", manager.getReusedPasswords(userId)}};
 
-            auto user = auth::AuthenticationManager::checkCredentials(login, password);
+            // Response
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+            response.setContentType("application/json");
+            std::ostream& out = response.send();
+            out << resoult.dump();
+        }
+        catch (const std::exception& e) {
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
+            response.setContentType("application/json");
+            std::ostream& out = response.send();
+            nlohmann::json errorJson = { {"status", "error"}, {"message", "Internal server error"} };
+            out << errorJson.dump();
+            Logger::error("Error reporting reused passwords: {}", e.what());
+        }
+        catch (...) {
+            // Catch any other unexpected exceptions
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
+            response.setContentType("application/json");
+            std::ostream& out = response.send();
+            nlohmann::json errorJson = {{"status", "error"}, {"message", "An unexpected error occurred"}};
+            out << errorJson.dump();
+            Logger::error("Unexpected error occurred while reporting reused passwords");
+        }
+    }
 
-            if (user.has_value()) {
-                std::string token = auth::AuthenticationManager::generateJWTToken(user.value());
-                
-                // Successful response
-                response.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
-                response.setContentType("application/json");
-                nlohmann::json successJson = {
-                    {"status", "success"},
-                    {"message", "Login successful"},
-                    {"token", token},
-                    {"user", {
-                        {"login", login}
-                    }}
-                };
-                
-                std::ostream& out = response.send();
-                out << successJson.dump();
-                
-                // register Crypto instance under this user ID
-                CryptoManager::registerCrypto(user.value().password, user.value().id);
+    void getWeakPasswords(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept {
+        try {
+            Logger::trace("Reporting weak passwords.");
 
-                Logger::info("User {} successfully authenticated", login);
-            } 
-            else {
-                // Failed authentication
-                response.setStatus(Poco::Net::HTTPResponse::HTTP_UNAUTHORIZED); // 401
-                response.setContentType("application/json");
-                nlohmann::json errorJson = {
-                    {"status", "error"},
-                    {"message", "Invalid credentials"}
-                };
-                
-                std::ostream& out = response.send();
-                out << errorJson.dump();
-                Logger::warn("Failed login attempt for user: {}", login);
+            // Validate request
+            auto userId = auth::AuthenticationManager::validateJWTToken(extractJwt(request));
+
+            // Read highest reported score
+            int maxScore = 2;
+            for (const auto& [key, value] : Poco::URI(request.getURI()).getQueryParameters()) {
+                if (key == "maxScore") {
+                    maxScore = parseQueryNumber<int>(key, value);
+                }
+            }
+            if (maxScore < 0 || maxScore > 4) {
+                throw std::invalid_argument("Score has to be between 0 and 4");
+            }
+
+            // Report uses scores stored on write, no password is decrypted
+            pass::PasswordManager manager;
+            nlohmann::json entries = nlohmann::json::array();
+            for (const auto& [id, strength] : manager.getWeakPasswords(userId, maxScore)) {
+                entries.push_back({{"id", id}, {"strength", strength}});
             }
+            nlohmann::json resoult = {{"entries", entries}};
+
+            // Response
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+            response.setContentType("application/json");
+            std::ostream& out = response.send();
+            out << resoult.dump();
         }
         catch (const std::invalid_argument& e) {
-            // Błąd w formacie żądania
-            response.setStatus(Poco::Net::HTTPResponse::HTTP_BAD_REQUEST); // 400
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_BAD_REQUEST);
             response.setContentType("application/json");
-            nlohmann::json errorJson = {
-                {"status", "error"},
-                {"message", "Invalid request format"},
-                {"details", e.what()}
-            };
-            
             std::ostream& out = response.send();
+            nlohmann::json errorJson = {{"status", "error"}, {"message", "Invalid score"}};
             out << errorJson.dump();
-            Logger::error("Bad request format: {}", e.what());
+            Logger::error("Bad weak passwords request: {}", e.what());
         }
         catch (const std::exception& e) {
-            // Ogólny błąd serwera
-            response.setStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR); // 500
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
             response.setContentType("application/json");
-            nlohmann::json errorJson = {
-                {"status", "error"},
-                {"message", "Internal server error"},
-                {"details", e.what()}
-            };
-            
             std::ostream& out = response.send();
+            nlohmann::json errorJson = { {"status", "error"}, {"message", "Internal server error"} };
             out << errorJson.dump();
-            Logger::error("Error during authentication: {}", e.what());
+            Logger::error("Error reporting weak passwords: {}", e.what());
         }
         catch (...) {
-            // Nieoczekiwany błąd
+            // Catch any other unexpected exceptions
             response.setStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
             response.setContentType("application/json");
-            nlohmann::json errorJson = {
-                {"status", "error"},
-                {"message", "An unexpected error occurred"}
-            };
-            
             std::ostream& out = response.send();
+            nlohmann::json errorJson = {{"status", "error"}, {"message", "An unexpected error occurred"}};
             out << errorJson.dump();
-            Logger::error("Unexpected error during authentication");
+            Logger::error("Unexpected error occurred while reporting weak passwords");
         }
     }
 
-    void registerUser(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept {
+    void issueEventTicket(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept {
         try {
-            Logger::trace("Registering new user.");
-
-            // Parse JSON from request body
-            nlohmann::json requestBody = nlohmann::json::parse(request.stream());
+            Logger::trace("Issuing event stream ticket.");
 
-            // Parse and update password
-            auth::AuthenticationManager manager;
-            auto user = auth::User::fromJson(requestBody);
-
-            // Encrypt User
-            auth::User encryptedUser;
-            Crypto crypto(user.password);
-            encryptedUser.login = crypto.encrypt(user.login);
-            encryptedUser.password = crypto.encrypt(user.password);
-            encryptedUser.name = crypto.encrypt(user.name);
-            encryptedUser.surname = crypto.encrypt(user.surname);
-            encryptedUser.id = user.id;
+            // Validate request
+            auto userId = auth::AuthenticationManager::validateJWTToken(extractJwt(request));
 
-            manager.addUser(encryptedUser);
-            
             // Response
             response.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
             response.setContentType("application/json");
-            nlohmann::json j = {{"message", "User registered"}};
+            nlohmann::json j = {
+                {"ticket", auth::StreamTickets::getInstance().issue(userId)},
+                {"expiresIn", auth::StreamTickets::TTL.count()}
+            };
             std::ostream& out = response.send();
             out << j.dump();
         }
@@ -439,7 +652,7 @@ namespace Endpoints {
             std::ostream& out = response.send();
             nlohmann::json errorJson = {{"status", "error"}, {"message", e.what()}};
             out << errorJson.dump();
-            Logger::error("Error registering user: {}", e.what());
+            Logger::error("Error issuing event stream ticket: {}", e.what());
         }
         catch (...) {
             // Catch any other unexpected exceptions
@@ -448,7 +661,848 @@ namespace Endpoints {
             std::ostream& out = response.send();
             nlohmann::json errorJson = {{"status", "error"}, {"message", "An unexpected error occurred"}};
             out << errorJson.dump();
-            Logger::error("Unexpected error occurred while registering user");
+            Logger::error("Unexpected error occurred while issuing event stream ticket");
+        }
+    }
+
+    void streamPasswordEvents(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept {
+        bool detached = false;
+        try {
+            Logger::trace("Opening password event stream.");
+
+            // Browser EventSource cannot set headers, so it comes with single-use ticket instead of session token
+            std::string ticket;
+            for (const auto& [key, value] : Poco::URI(request.getURI()).getQueryParameters()) {
+                if (key == "ticket") {
+                    ticket = value;
+                }
+            }
+            auto userId = ticket.empty()
+                ? auth::AuthenticationManager::validateJWTToken(extractJwt(request))
+                : auth::StreamTickets::getInstance().redeem(ticket);
+
+            // Take socket over from HTTP server, response is written by hand
+            auto& requestImpl = dynamic_cast<Poco::Net::HTTPServerRequestImpl&>(request);
+            Poco::Net::StreamSocket socket = requestImpl.detachSocket();
+            detached = true;
+            std::string_view header = events::ChangeNotifier::RESPONSE_HEADER;
+            socket.sendBytes(header.data(), static_cast<int>(header.size()));
+            events::ChangeNotifier::getInstance().subscribe(userId, std::move(socket));
+        }
+        catch (const std::exception& e) {
+            // Detached socket is no longer owned by response
+            if (!detached) {
+                response.setStatus(Poco::Net::HTTPResponse::HTTP_UNAUTHORIZED);
+                response.setContentType("application/json");
+                std::ostream& out = response.send();
+                nlohmann::json errorJson = { {"status", "error"}, {"message", "Could not open event stream"} };
+                out << errorJson.dump();
+            }
+            Logger::error("Error opening password event stream: {}", e.what());
+        }
+        catch (...) {
+            // Catch any other unexpected exceptions
+            if (!detached) {
+                response.setStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
+                response.setContentType("application/json");
+                std::ostream& out = response.send();
+                nlohmann::json errorJson = {{"status", "error"}, {"message", "An unexpected error occurred"}};
+                out << errorJson.dump();
+            }
+            Logger::error("Unexpected error occurred while opening password event stream");
+        }
+    }
+
+    void addPassword(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept {
+        try {
+            Logger::trace("Adding password.");
+
+            // Validate request
+            auto userId = auth::AuthenticationManager::validateJWTToken(extractJwt(request));
+
+            // Parse JSON from request body
+            nlohmann::json requestBody = parseBody(request);
+            util::WipeGuard wipeBody(requestBody);
+
+            // Parse and update password
+            pass::PasswordManager manager;
+            auto password = pass::Password::fromJson(requestBody);
+            if (pass::BreachChecker::getInstance().isBreached(password.password)) {
+                throw std::invalid_argument("Password appears in known data breach");
+            }
+            auto encryptedPassword = pass::PasswordCrypto::encrypt(password, userId);
+            manager.addPassword(encryptedPassword);
+            
+            // Response
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+            response.setContentType("application/json");
+            nlohmann::json j = {{"message", "Configuration updated"}};
+            std::ostream& out = response.send();
+            out << j.dump();
+        }
+        catch (const std::invalid_argument& e) {
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_BAD_REQUEST);
+            response.setContentType("application/json");
+            std::ostream& out = response.send();
+            nlohmann::json errorJson = {{"status", "error"}, {"message", e.what()}};
+            out << errorJson.dump();
+            Logger::error("Password rejected while adding: {}", e.what());
+        }
+        catch (const std::exception& e) {
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
+            response.setContentType("application/json");
+            std::ostream& out = response.send();
+            nlohmann::json errorJson = {{"status", "error"}, {"message", e.what()}};
+            out << errorJson.dump();
+            Logger::error("Error adding password: {}", e.what());
+        }
+        catch (...) {
+            // Catch any other unexpected exceptions
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
+            response.setContentType("application/json");
+            std::ostream& out = response.send();
+            nlohmann::json errorJson = {{"status", "error"}, {"message", "An unexpected error occurred"}};
+            out << errorJson.dump();
+            Logger::error("Unexpected error occurred while adding password");
+        }
+    }
+
+    void importPasswords(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept {
+        try {
+            Logger::trace("Importing passwords.");
+
+            // Validate request
+            auto userId = auth::AuthenticationManager::validateJWTToken(extractJwt(request));
+
+            // Format is taken from query, CSV is also recognized by content type
+            std::string formatName = "json";
+            if (request.getContentType().starts_with("text/csv")) {
+                formatName = "csv";
+            }
+            else if (request.getContentType().starts_with("application/octet-stream")) {
+                formatName = "archive";
+            }
+            for (const auto& [key, value] : Poco::URI(request.getURI()).getQueryParameters()) {
+                if (key == "format") {
+                    formatName = value;
+                }
+            }
+            auto format = pass::PasswordImporter::formatFromString(formatName);
+
+            // Import passwords straight from request stream
+            pass::PasswordImporter importer(userId);
+            auto result = importer.import(request.stream(), format);
+            
+            // Response
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+            response.setContentType("application/json");
+            nlohmann::json j = result.toJson();
+            j["message"] = "Passwords imported";
+            std::ostream& out = response.send();
+            out << j.dump();
+        }
+        catch (const std::invalid_argument& e) {
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_BAD_REQUEST);
+            response.setContentType("application/json");
+            std::ostream& out = response.send();
+            nlohmann::json errorJson = {{"status", "error"}, {"message", e.what()}};
+            out << errorJson.dump();
+            Logger::error("Bad import request: {}", e.what());
+        }
+        catch (const std::exception& e) {
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
+            response.setContentType("application/json");
+            std::ostream& out = response.send();
+            nlohmann::json errorJson = {{"status", "error"}, {"message", e.what()}};
+            out << errorJson.dump();
+            Logger::error("Error importing passwords: {}", e.what());
+        }
+        catch (...) {
+            // Catch any other unexpected exceptions
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
+            response.setContentType("application/json");
+            std::ostream& out = response.send();
+            nlohmann::json errorJson = {{"status", "error"}, {"message", "An unexpected error occurred"}};
+            out << errorJson.dump();
+            Logger::error("Unexpected error occurred while importing passwords");
+        }
+    }
+
+    void exportPasswords(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept {
+        bool streaming = false;
+        try {
+            Logger::trace("Exporting passwords.");
+
+            // Validate request
+            auto userId = auth::AuthenticationManager::validateJWTToken(extractJwt(request));
+            auto crypto = CryptoManager::get(userId);
+
+            // Response is streamed, archive size is not known upfront
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+            response.setContentType("application/octet-stream");
+            response.setChunkedTransferEncoding(true);
+            response.set("Content-Disposition", std::format("attachment; filename=\"vault-{}.pfv\"", 
+                util::time::toString(std::chrono::system_clock::now(), "%Y%m%d-%H%M%S")));
+            std::ostream& out = response.send();
+            streaming = true;
+
+            // Archive holds JSON array of decrypted passwords
+            pass::VaultArchiveWriter writer(out, *crypto);
+            pass::PasswordManager manager;
+            std::size_t exported = 0;
+            writer.write("[");
+            manager.forEachPasswordOfUser(userId, [&](const pass::Password& password) {
+                auto decryptedPassword = pass::PasswordCrypto::decrypt(password, userId);
+                auto json = decryptedPassword.toJson();
+                std::string entry = json.dump();
+                util::WipeGuard wipeEntry(json, entry);
+                writer.write(exported++ == 0 ? "" : ",");
+                writer.write(entry);
+            });
+            writer.write("]");
+            writer.finish();
+
+            Logger::info("Exported {} passwords of user {}", exported, userId);
+        }
+        catch (const std::exception& e) {
+            // Once streaming started the archive is left without last chunk, which readers reject as truncated
+            if (!streaming) {
+                response.setStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
+                response.setContentType("application/json");
+                std::ostream& out = response.send();
+                nlohmann::json errorJson = {{"status", "error"}, {"message", e.what()}};
+                out << errorJson.dump();
+            }
+            Logger::error("Error exporting passwords: {}", e.what());
+        }
+        catch (...) {
+            // Catch any other unexpected exceptions
+            if (!streaming) {
+                response.setStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
+                response.setContentType("application/json");
+                std::ostream& out = response.send();
+                nlohmann::json errorJson = {{"status", "error"}, {"message", "An unexpected error occurred"}};
+                out << errorJson.dump();
+            }
+            Logger::error("Unexpected error occurred while exporting passwords");
+        }
+    }
+
+    void batchPasswords(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept {
+        try {
+            Logger::trace("Applying batch of password operations.");
+
+            // Validate request
+            auto userId = auth::AuthenticationManager::validateJWTToken(extractJwt(request));
+
+            // Parse JSON from request body, either {"operations": [...]} or bare array
+            nlohmann::json requestBody = parseBody(request);
+            util::WipeGuard wipeBody(requestBody);
+            const auto& operations = requestBody.is_array() ? requestBody : requestBody.at("operations");
+            if (!operations.is_array()) {
+                throw std::invalid_argument("Operations must be an array");
+            }
+
+            // Parse all operations before anything is written
+            std::vector<pass::PasswordMutation> mutations;
+            mutations.reserve(operations.size());
+            for (const auto& operation : operations) {
+                mutations.push_back(pass::PasswordMutation::fromJson(operation));
+            }
+
+            // Batch is rejected as a whole, same as single add or update with breached password
+            for (std::size_t i = 0; i < mutations.size(); ++i) {
+                if (mutations[i].type != pass::PasswordMutation::Type::Remove && pass::BreachChecker::getInstance().isBreached(mutations[i].password.password)) {
+                    throw std::invalid_argument(std::format("Password of operation {} appears in known data breach", i));
+                }
+            }
+
+            // Encrypt added and updated passwords in parallel
+            std::vector<pass::Password> secrets;
+            for (auto& mutation : mutations) {
+                if (mutation.type != pass::PasswordMutation::Type::Remove) {
+                    secrets.push_back(std::move(mutation.password));
+                }
+            }
+            pass::PasswordCrypto::encryptBatch(secrets, userId);
+            auto secret = secrets.begin();
+            for (auto& mutation : mutations) {
+                if (mutation.type != pass::PasswordMutation::Type::Remove) {
+                    mutation.password = std::move(*secret++);
+                }
+            }
+
+            // Apply all operations in single transaction
+            pass::PasswordManager manager;
+            auto results = manager.applyMutations(mutations, userId);
+
+            // Response
+            nlohmann::json resultsJson = nlohmann::json::array();
+            for (std::size_t i = 0; i < results.size(); ++i) {
+                auto resultJson = results[i].toJson();
+                resultJson["index"] = i;
+                resultsJson.push_back(std::move(resultJson));
+            }
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+            response.setContentType("application/json");
+            nlohmann::json j = {{"status", "success"}, {"results", resultsJson}};
+            std::ostream& out = response.send();
+            out << j.dump();
+        }
+        catch (const std::invalid_argument& e) {
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_BAD_REQUEST);
+            response.setContentType("application/json");
+            std::ostream& out = response.send();
+            nlohmann::json errorJson = {{"status", "error"}, {"message", e.what()}};
+            out << errorJson.dump();
+            Logger::error("Bad batch request: {}", e.what());
+        }
+        catch (const std::exception& e) {
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
+            response.setContentType("application/json");
+            std::ostream& out = response.send();
+            nlohmann::json errorJson = {{"status", "error"}, {"message", e.what()}};
+            out << errorJson.dump();
+            Logger::error("Error applying batch of password operations: {}", e.what());
+        }
+        catch (...) {
+            // Catch any other unexpected exceptions
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
+            response.setContentType("application/json");
+            std::ostream& out = response.send();
+            nlohmann::json errorJson = {{"status", "error"}, {"message", "An unexpected error occurred"}};
+            out << errorJson.dump();
+            Logger::error("Unexpected error occurred while applying batch of password operations");
+        }
+    }
+
+    void updatePassword(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept {
+        try {
+            Logger::trace("Updating password.");
+
+            // Validate request
+            auto userId = auth::AuthenticationManager::validateJWTToken(extractJwt(request));
+
+            // Parse JSON from request body
+            nlohmann::json requestBody = parseBody(request);
+            util::WipeGuard wipeBody(requestBody);
+
+            // Parse and update password
+            pass::PasswordManager manager;
+            auto password = pass::Password::fromJson(requestBody);
+            password.userId = userId;
+            if (pass::BreachChecker::getInstance().isBreached(password.password)) {
+                throw std::invalid_argument("Password appears in known data breach");
+            }
+            auto encryptedPassword = pass::PasswordCrypto::encrypt(password, userId);
+            manager.updatePassword(encryptedPassword);
+            
+            // Response
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+            response.setContentType("application/json");
+            nlohmann::json j = {{"message", "Configuration updated"}};
+            std::ostream& out = response.send();
+            out << j.dump();
+        }
+        catch (const std::invalid_argument& e) {
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_BAD_REQUEST);
+            response.setContentType("application/json");
+            std::ostream& out = response.send();
+            nlohmann::json errorJson = {{"status", "error"}, {"message", e.what()}};
+            out << errorJson.dump();
+            Logger::error("Password rejected while updating: {}", e.what());
+        }
+        catch (const std::exception& e) {
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
+            response.setContentType("application/json");
+            std::ostream& out = response.send();
+            nlohmann::json errorJson = {{"status", "error"}, {"message", e.what()}};
+            out << errorJson.dump();
+            Logger::error("Error updating password: {}", e.what());
+        }
+        catch (...) {
+            // Catch any other unexpected exceptions
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
+            response.setContentType("application/json");
+            std::ostream& out = response.send();
+            nlohmann::json errorJson = {{"status", "error"}, {"message", "An unexpected error occurred"}};
+            out << errorJson.dump();
+            Logger::error("Unexpected error occurred while updating password");
+        }
+    }
+
+    void removePassword(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept {
+        try {
+            Logger::trace("Removing password.");
+
+            // Validate request
+            auto userId = auth::AuthenticationManager::validateJWTToken(extractJwt(request));
+
+            // Parse JSON from request body
+            nlohmann::json requestBody = parseBody(request);
+
+            // Parse and update password
+            pass::PasswordManager manager;
+            auto password = pass::Password::fromJson(requestBody);
+            manager.removePassword(userId, password.id);
+            
+            // Response
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+            response.setContentType("application/json");
+            nlohmann::json j = {{"message", "Configuration updated"}};
+            std::ostream& out = response.send();
+            out << j.dump();
+        }
+        catch (const std::exception& e) {
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
+            response.setContentType("application/json");
+            std::ostream& out = response.send();
+            nlohmann::json errorJson = {{"status", "error"}, {"message", e.what()}};
+            out << errorJson.dump();
+            Logger::error("Error removing password: {}", e.what());
+        }
+        catch (...) {
+            // Catch any other unexpected exceptions
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
+            response.setContentType("application/json");
+            std::ostream& out = response.send();
+            nlohmann::json errorJson = {{"status", "error"}, {"message", "An unexpected error occurred"}};
+            out << errorJson.dump();
+            Logger::error("Unexpected error occurred while removing password");
+        }
+    }
+
+    void login(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept {
+        try {
+            Logger::trace("Login authenication.");
+
+            // Expensive key derivation runs only with permit of admission control
+            auto permit = auth::AdmissionControl::getInstance().admit(request.clientAddress().host().toString());
+
+            // Parse JSON from request body
+            nlohmann::json requestBody = parseBody(request);
+            util::WipeGuard wipeBody(requestBody);
+
+            // read login and password
+            std::string login = requestBody.at("login").get<std::string>();
+            std::string password = requestBody.at("password").get<std::string>();
+            util::WipeGuard wipeCredentials(login, password);
+
+            // Key derivation runs on KDF executor holding the permit, HTTP thread is released right away
+            completeAsync(request, response, [permit = std::move(permit), login = std::move(login), password = std::move(password)]() mutable -> AsyncResponse {
+                util::WipeGuard wipeCredentials(login, password);
+                auto user = auth::AuthenticationManager::checkCredentials(login, password);
+                if (!user.has_value()) {
+                    // Failed authentication
+                    Logger::warn("Failed login attempt for user: {}", login);
+                    return { Poco::Net::HTTPResponse::HTTP_UNAUTHORIZED, {
+                        {"status", "error"},
+                        {"message", "Invalid credentials"}
+                    } };
+                }
+                util::WipeGuard wipeUser(user->password);
+
+                std::string token = auth::AuthenticationManager::generateJWTToken(user.value());
+
+                // register Crypto instance under this user ID
+                CryptoManager::registerCrypto(user.value().password, user.value().id, user.value().kdf);
+
+                // Re-encryption interrupted by restart continues, login must not fail because of it
+                try {
+                    pass::KeyRotation::getInstance().resume(user.value().id);
+                }
+                catch (const std::exception& e) {
+                    Logger::warn("Could not resume re-encryption of vault of user {}: {}", user.value().id, e.what());
+                }
+
+                // Entries older than search index are indexed in background, lookups do not scan for them
+                pass::SearchBackfill::getInstance().schedule(user.value().id);
+
+                Logger::info("User {} successfully authenticated", login);
+                return { Poco::Net::HTTPResponse::HTTP_OK, {
+                    {"status", "success"},
+                    {"message", "Login successful"},
+                    {"token", token},
+                    {"user", {
+                        {"login", login}
+                    }}
+                } };
+            });
+        }
+        catch (const auth::TooManyRequests& e) {
+            // Rejected by admission control, client should back off
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_TOO_MANY_REQUESTS); // 429
+            response.set("Retry-After", std::to_string(e.retryAfter().count()));
+            response.setContentType("application/json");
+            nlohmann::json errorJson = {
+                {"status", "error"},
+                {"message", "Too many requests"},
+                {"details", e.what()}
+            };
+            
+            std::ostream& out = response.send();
+            out << errorJson.dump();
+            Logger::warn("Login rejected: {}", e.what());
+        }
+        catch (const std::invalid_argument& e) {
+            // Błąd w formacie żądania
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_BAD_REQUEST); // 400
+            response.setContentType("application/json");
+            nlohmann::json errorJson = {
+                {"status", "error"},
+                {"message", "Invalid request format"},
+                {"details", e.what()}
+            };
+            
+            std::ostream& out = response.send();
+            out << errorJson.dump();
+            Logger::error("Bad request format: {}", e.what());
+        }
+        catch (const std::exception& e) {
+            // Ogólny błąd serwera
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR); // 500
+            response.setContentType("application/json");
+            nlohmann::json errorJson = {
+                {"status", "error"},
+                {"message", "Internal server error"},
+                {"details", e.what()}
+            };
+            
+            std::ostream& out = response.send();
+            out << errorJson.dump();
+            Logger::error("Error during authentication: {}", e.what());
+        }
+        catch (...) {
+            // Nieoczekiwany błąd
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
+            response.setContentType("application/json");
+            nlohmann::json errorJson = {
+                {"status", "error"},
+                {"message", "An unexpected error occurred"}
+            };
+            
+            std::ostream& out = response.send();
+            out << errorJson.dump();
+            Logger::error("Unexpected error during authentication");
+        }
+    }
+
+    void registerUser(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept {
+        try {
+            Logger::trace("Registering new user.");
+
+            // Expensive key derivation runs only with permit of admission control
+            auto permit = auth::AdmissionControl::getInstance().admit(request.clientAddress().host().toString());
+
+            // Parse JSON from request body
+            nlohmann::json requestBody = parseBody(request);
+            util::WipeGuard wipeBody(requestBody);
+
+            // Parse and update password
+            auto user = auth::User::fromJson(requestBody);
+            util::WipeGuard wipeUser(user.password);
+
+            // Key derivation runs on KDF executor holding the permit, HTTP thread is released right away
+            completeAsync(request, response, [permit = std::move(permit), user = std::move(user)]() mutable -> AsyncResponse {
+                util::WipeGuard wipeUser(user.password);
+                // Encrypt User
+                auth::User encryptedUser;
+                encryptedUser.kdf = Crypto::targetKdf();
+                Crypto crypto(user.password, encryptedUser.kdf);
+                encryptedUser.login = crypto.encrypt(user.login);
+                encryptedUser.password = crypto.encrypt(user.password);
+                encryptedUser.name = crypto.encrypt(user.name);
+                encryptedUser.surname = crypto.encrypt(user.surname);
+                encryptedUser.id = user.id;
+                encryptedUser.loginKey = auth::AuthenticationManager::loginKey(user.login);
+
+                auth::AuthenticationManager manager;
+                manager.addUser(encryptedUser);
+
+                // Response
+                return { Poco::Net::HTTPResponse::HTTP_OK, {{"message", "User registered"}} };
+            });
+        }
+        catch (const auth::TooManyRequests& e) {
+            // Rejected by admission control, client should back off
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_TOO_MANY_REQUESTS); // 429
+            response.set("Retry-After", std::to_string(e.retryAfter().count()));
+            response.setContentType("application/json");
+            nlohmann::json errorJson = {
+                {"status", "error"},
+                {"message", "Too many requests"},
+                {"details", e.what()}
+            };
+            
+            std::ostream& out = response.send();
+            out << errorJson.dump();
+            Logger::warn("Registration rejected: {}", e.what());
+        }
+        catch (const std::exception& e) {
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
+            response.setContentType("application/json");
+            std::ostream& out = response.send();
+            nlohmann::json errorJson = {{"status", "error"}, {"message", e.what()}};
+            out << errorJson.dump();
+            Logger::error("Error registering user: {}", e.what());
+        }
+        catch (...) {
+            // Catch any other unexpected exceptions
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
+            response.setContentType("application/json");
+            std::ostream& out = response.send();
+            nlohmann::json errorJson = {{"status", "error"}, {"message", "An unexpected error occurred"}};
+            out << errorJson.dump();
+            Logger::error("Unexpected error occurred while registering user");
+        }
+    }
+
+    void logout(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept {
+        try {
+            Logger::trace("Logging out.");
+
+            // Validate request
+            auto userId = auth::AuthenticationManager::validateJWTToken(extractJwt(request));
+
+            // Decrypted vault must not outlive session
+            pass::VaultCache::getInstance().evict(userId);
+
+            // Response
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+            response.setContentType("application/json");
+            nlohmann::json j = {{"status", "success"}, {"message", "Logged out"}};
+            std::ostream& out = response.send();
+            out << j.dump();
+        }
+        catch (const std::exception& e) {
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_UNAUTHORIZED);
+            response.setContentType("application/json");
+            std::ostream& out = response.send();
+            nlohmann::json errorJson = {{"status", "error"}, {"message", e.what()}};
+            out << errorJson.dump();
+            Logger::error("Error logging out: {}", e.what());
+        }
+        catch (...) {
+            // Catch any other unexpected exceptions
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
+            response.setContentType("application/json");
+            std::ostream& out = response.send();
+            nlohmann::json errorJson = {{"status", "error"}, {"message", "An unexpected error occurred"}};
+            out << errorJson.dump();
+            Logger::error("Unexpected error occurred while logging out");
+        }
+    }
+
+    void changePassword(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept {
+        try {
+            Logger::trace("Changing master password.");
+
+            // Validate request
+            auto userId = auth::AuthenticationManager::validateJWTToken(extractJwt(request));
+
+            // Expensive key derivation runs only with permit of admission control
+            auto permit = auth::AdmissionControl::getInstance().admit(request.clientAddress().host().toString());
+
+            // Parse JSON from request body, without new password only key is rotated
+            nlohmann::json requestBody = parseBody(request);
+            util::WipeGuard wipeBody(requestBody);
+            std::string currentPassword = requestBody.at("currentPassword").get<std::string>();
+            std::string newPassword = requestBody.value("newPassword", currentPassword);
+            util::WipeGuard wipePasswords(currentPassword, newPassword);
+            if (newPassword.empty()) {
+                throw std::invalid_argument("New password cannot be empty");
+            }
+
+            // Key derivation runs on KDF executor holding the permit, entries are re-encrypted in background
+            completeAsync(request, response, [permit = std::move(permit), userId, currentPassword = std::move(currentPassword), newPassword = std::move(newPassword)]() mutable -> AsyncResponse {
+                util::WipeGuard wipePasswords(currentPassword, newPassword);
+                auto& rotation = pass::KeyRotation::getInstance();
+                try {
+                    if (!rotation.changePassword(userId, currentPassword, newPassword)) {
+                        Logger::warn("Failed password change attempt for user {}", userId);
+                        return { Poco::Net::HTTPResponse::HTTP_UNAUTHORIZED, {
+                            {"status", "error"},
+                            {"message", "Invalid credentials"}
+                        } };
+                    }
+                }
+                catch (const pass::KeyRotationConflict& e) {
+                    // Concurrent change or running backup, client may retry with whichever password is current
+                    Logger::warn("Password change of user {} conflicted: {}", userId, e.what());
+                    return { Poco::Net::HTTPResponse::HTTP_CONFLICT, {
+                        {"status", "error"},
+                        {"message", "Password change conflicts with another operation"},
+                        {"details", e.what()}
+                    } };
+                }
+
+                return { Poco::Net::HTTPResponse::HTTP_ACCEPTED, {
+                    {"status", "success"},
+                    {"message", "Password changed, vault is being re-encrypted"},
+                    {"rotation", rotation.progress(userId).toJson()}
+                } };
+            });
+        }
+        catch (const auth::TooManyRequests& e) {
+            // Rejected by admission control, client should back off
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_TOO_MANY_REQUESTS); // 429
+            response.set("Retry-After", std::to_string(e.retryAfter().count()));
+            response.setContentType("application/json");
+            nlohmann::json errorJson = {
+                {"status", "error"},
+                {"message", "Too many requests"},
+                {"details", e.what()}
+            };
+
+            std::ostream& out = response.send();
+            out << errorJson.dump();
+            Logger::warn("Password change rejected: {}", e.what());
+        }
+        catch (const std::invalid_argument& e) {
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_BAD_REQUEST);
+            response.setContentType("application/json");
+            std::ostream& out = response.send();
+            nlohmann::json errorJson = {{"status", "error"}, {"message", "Invalid request format"}, {"details", e.what()}};
+            out << errorJson.dump();
+            Logger::error("Bad request format: {}", e.what());
+        }
+        catch (const std::exception& e) {
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
+            response.setContentType("application/json");
+            std::ostream& out = response.send();
+            nlohmann::json errorJson = {{"status", "error"}, {"message", e.what()}};
+            out << errorJson.dump();
+            Logger::error("Error changing password: {}", e.what());
+        }
+        catch (...) {
+            // Catch any other unexpected exceptions
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
+            response.setContentType("application/json");
+            std::ostream& out = response.send();
+            nlohmann::json errorJson = {{"status", "error"}, {"message", "An unexpected error occurred"}};
+            out << errorJson.dump();
+            Logger::error("Unexpected error occurred while changing password");
+        }
+    }
+
+    void getKeyRotation(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept {
+        try {
+            Logger::trace("Reading progress of key rotation.");
+
+            // Validate request
+            auto userId = auth::AuthenticationManager::validateJWTToken(extractJwt(request));
+
+            // Response
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+            response.setContentType("application/json");
+            nlohmann::json j = pass::KeyRotation::getInstance().progress(userId).toJson();
+            std::ostream& out = response.send();
+            out << j.dump();
+        }
+        catch (const std::exception& e) {
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
+            response.setContentType("application/json");
+            std::ostream& out = response.send();
+            nlohmann::json errorJson = {{"status", "error"}, {"message", e.what()}};
+            out << errorJson.dump();
+            Logger::error("Error reading progress of key rotation: {}", e.what());
+        }
+        catch (...) {
+            // Catch any other unexpected exceptions
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
+            response.setContentType("application/json");
+            std::ostream& out = response.send();
+            nlohmann::json errorJson = {{"status", "error"}, {"message", "An unexpected error occurred"}};
+            out << errorJson.dump();
+            Logger::error("Unexpected error occurred while reading progress of key rotation");
+        }
+    }
+
+    void createBackup(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept {
+        try {
+            Logger::trace("Requesting backup.");
+
+            // Validate request
+            auto userId = auth::AuthenticationManager::validateJWTToken(extractJwt(request));
+
+            // Every user is authenticated the same way, so only configuration can tell operator apart
+            auto& backups = BackupManager::getInstance();
+            if (!backups.endpointsEnabled()) {
+                sendBackupEndpointsDisabled(response);
+                return;
+            }
+
+            // Backup is written by backup thread, only one at a time
+            bool accepted = backups.request();
+            if (accepted) {
+                Logger::info("Backup requested by user {}", userId);
+            }
+
+            // Response
+            response.setStatus(accepted ? Poco::Net::HTTPResponse::HTTP_ACCEPTED : Poco::Net::HTTPResponse::HTTP_CONFLICT);
+            response.setContentType("application/json");
+            nlohmann::json j = {
+                {"status", accepted ? "success" : "error"},
+                {"message", accepted ? "Backup started" : "Backup is already running"},
+                {"backup", backups.status().toJson()}
+            };
+            std::ostream& out = response.send();
+            out << j.dump();
+        }
+        catch (const std::exception& e) {
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
+            response.setContentType("application/json");
+            std::ostream& out = response.send();
+            nlohmann::json errorJson = {{"status", "error"}, {"message", e.what()}};
+            out << errorJson.dump();
+            Logger::error("Error requesting backup: {}", e.what());
+        }
+        catch (...) {
+            // Catch any other unexpected exceptions
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
+            response.setContentType("application/json");
+            std::ostream& out = response.send();
+            nlohmann::json errorJson = {{"status", "error"}, {"message", "An unexpected error occurred"}};
+            out << errorJson.dump();
+            Logger::error("Unexpected error occurred while requesting backup");
+        }
+    }
+
+    void getBackupStatus(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept {
+        try {
+            Logger::trace("Reading state of backups.");
+
+            // Validate request
+            auth::AuthenticationManager::validateJWTToken(extractJwt(request));
+            auto& backups = BackupManager::getInstance();
+            if (!backups.endpointsEnabled()) {
+                sendBackupEndpointsDisabled(response);
+                return;
+            }
+
+            // Response
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+            response.setContentType("application/json");
+            nlohmann::json j = backups.status().toJson();
+            std::ostream& out = response.send();
+            out << j.dump();
+        }
+        catch (const std::exception& e) {
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
+            response.setContentType("application/json");
+            std::ostream& out = response.send();
+            nlohmann::json errorJson = {{"status", "error"}, {"message", e.what()}};
+            out << errorJson.dump();
+            Logger::error("Error reading state of backups: {}", e.what());
+        }
+        catch (...) {
+            // Catch any other unexpected exceptions
+            response.setStatus(Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
+            response.setContentType("application/json");
+            std::ostream& out = response.send();
+            nlohmann::json errorJson = {{"status", "error"}, {"message", "An unexpected error occurred"}};
+            out << errorJson.dump();
+            Logger::error("Unexpected error occurred while reading state of backups");
         }
     }
 }
\ No newline at end of file
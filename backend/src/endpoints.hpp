@@ -3,6 +3,9 @@
 #include <fix.hpp>
 #include <Poco/Net/HTTPServerRequest.h>
 #include <Poco/Net/HTTPServerResponse.h>
+#include <nlohmann/json.hpp>
+#include <secure-arena.hpp>
+#include <functional>
 
 /// @brief Namespace for endpoints handling
 namespace Endpoints {
@@ -12,6 +15,41 @@ namespace Endpoints {
     /// @throw std::runtime_error on faliure
     std::string extractJwt(Poco::Net::HTTPServerRequest& request);
 
+    /// @brief Helper function to parse JSON body of request, timed as "parse" stage of request
+    /// @param request HTTP request
+    /// @return parsed body
+    /// @throw nlohmann::json::parse_error on invalid JSON
+    nlohmann::json parseBody(Poco::Net::HTTPServerRequest& request);
+
+    /// @brief Helper function to send json containing decrypted secrets with status 200
+    /// @note Body is serialized into locked arena of current SecureArena::Scope and json is wiped afterwards
+    /// @param response HTTP response
+    /// @param body json to send, wiped on return
+    void sendSecretJson(Poco::Net::HTTPServerResponse& response, nlohmann::json& body);
+
+    /// @brief Helper function to send already serialized json containing decrypted secrets with status 200
+    /// @param response HTTP response
+    /// @param body serialized json, e.g. allocated from SecureArena::resource()
+    void sendSecretJson(Poco::Net::HTTPServerResponse& response, const util::SecureString& body);
+
+    /// @brief Status and body of response completed outside of HTTP thread
+    class AsyncResponse {
+    public:
+        Poco::Net::HTTPResponse::HTTPStatus status;     // Status of response
+        nlohmann::json body;                            // Body of response
+    };
+
+    constexpr int ASYNC_SEND_TIMEOUT_SECONDS = 5;   // Send timeout of responses written by completeAsync()
+
+    /// @brief Helper function to complete request on auth::KdfExecutor, so HTTP thread is released right away
+    /// @note Socket is detached from HTTP server and response, with headers already set on it, is written by executor
+    /// thread. std::invalid_argument thrown by job is answered with 400, other exceptions with 500.
+    /// @param request HTTP request, its body must be already read
+    /// @param response HTTP response, must not be used after successful return
+    /// @param job work producing response
+    /// @throw std::exception when socket could not be detached, response is still usable then
+    void completeAsync(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response, std::move_only_function<AsyncResponse()> job);
+
     /// @brief Gets configuration 
     /// @param request HTTP request
     /// @param response HTTP response
@@ -32,11 +70,62 @@ namespace Endpoints {
     /// @param response HTTP response
     void getPasswords(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept;
 
+    /// @brief Reads passwords changed and removed since given vault version
+    /// @param request HTTP request
+    /// @param response HTTP response
+    void getPasswordChanges(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept;
+
+    /// @brief Searches passwords by name, url and login using blind index
+    /// @param request HTTP request
+    /// @param response HTTP response
+    void searchPasswords(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept;
+
+    /// @brief Finds credentials stored for url, used by browser autofill
+    /// @param request HTTP request
+    /// @param response HTTP response
+    void matchPasswords(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept;
+
+    /// @brief Reports entries sharing same password
+    /// @param request HTTP request
+    /// @param response HTTP response
+    void getReusedPasswords(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept;
+
+    /// @brief Reports entries with weak passwords
+    /// @param request HTTP request
+    /// @param response HTTP response
+    void getWeakPasswords(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept;
+
+    /// @brief Issues single-use ticket opening event stream, so session token does not have to appear in URL
+    /// @param request HTTP request
+    /// @param response HTTP response
+    void issueEventTicket(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept;
+
+    /// @brief Opens Server-Sent Events stream with changes of user vault
+    /// @param request HTTP request
+    /// @param response HTTP response
+    /// @note Socket is detached from HTTP server and served by events::ChangeNotifier
+    void streamPasswordEvents(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept;
+
     /// @brief Adds new password
     /// @param request HTTP request
     /// @param response HTTP response
     void addPassword(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept;
     
+    /// @brief Imports passwords from export of this or other password manager
+    /// @param request HTTP request
+    /// @param response HTTP response
+    void importPasswords(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept;
+
+    /// @brief Streams all passwords of user as encrypted vault archive
+    /// @param request HTTP request
+    /// @param response HTTP response
+    void exportPasswords(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept;
+
+    /// @brief Applies ordered list of add, update and delete operations atomically
+    /// @param request HTTP request
+    /// @param response HTTP response
+    void batchPasswords(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept;
+
     /// @brief Updates password
     /// @param request HTTP request
     /// @param response HTTP response
@@ -56,4 +145,31 @@ namespace Endpoints {
     /// @param request HTTP request
     /// @param response HTTP response
     void registerUser(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept;
+
+    /// @brief Logout from app, wipes cached vault of user
+    /// @param request HTTP request
+    /// @param response HTTP response
+    void logout(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept;
+
+    /// @brief Changes master password of user, or rotates key when new password is omitted, vault is re-encrypted in background
+    /// @param request HTTP request
+    /// @param response HTTP response
+    void changePassword(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept;
+
+    /// @brief Reports progress of re-encryption of vault after password change
+    /// @param request HTTP request
+    /// @param response HTTP response
+    void getKeyRotation(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept;
+
+    /// @brief Requests online backup of all databases, written in background
+    /// @note Answers 404 unless backup endpoints are enabled in configuration, backups are operator's business
+    /// @param request HTTP request
+    /// @param response HTTP response
+    void createBackup(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept;
+
+    /// @brief Reports state of backups
+    /// @note Answers 404 unless backup endpoints are enabled in configuration
+    /// @param request HTTP request
+    /// @param response HTTP response
+    void getBackupStatus(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) noexcept;
 }
\ No newline at end of file
@@ -8,17 +8,33 @@
 #include <utility>
 #include <endpoints.hpp>
 #include <configuration.hpp>
+#include <request-trace.hpp>
 
 std::map<std::pair<std::string, std::string>, MyRequestHandler::RouteHandler> MyRequestHandler::routes = {
     {{"GET",  "/api/configuration/get"}, std::bind(&Endpoints::getConfiguration, std::placeholders::_1, std::placeholders::_2)},
     {{"POST", "/api/configuration/update"}, std::bind(&Endpoints::updateConfiguration, std::placeholders::_1, std::placeholders::_2)},
     {{"POST", "/api/passwords/generate"}, std::bind(&Endpoints::generatePassword, std::placeholders::_1, std::placeholders::_2)},
     {{"GET",  "/api/passwords/get"}, std::bind(&Endpoints::getPasswords, std::placeholders::_1, std::placeholders::_2)},
+    {{"GET",  "/api/passwords/changes"}, std::bind(&Endpoints::getPasswordChanges, std::placeholders::_1, std::placeholders::_2)},
+    {{"GET",  "/api/passwords/search"}, std::bind(&Endpoints::searchPasswords, std::placeholders::_1, std::placeholders::_2)},
+    {{"GET",  "/api/passwords/match"}, std::bind(&Endpoints::matchPasswords, std::placeholders::_1, std::placeholders::_2)},
+    {{"GET",  "/api/passwords/reuse"}, std::bind(&Endpoints::getReusedPasswords, std::placeholders::_1, std::placeholders::_2)},
+    {{"GET",  "/api/passwords/weak"}, std::bind(&Endpoints::getWeakPasswords, std::placeholders::_1, std::placeholders::_2)},
+    {{"GET",  "/api/passwords/events"}, std::bind(&Endpoints::streamPasswordEvents, std::placeholders::_1, std::placeholders::_2)},
+    {{"POST", "/api/passwords/events/ticket"}, std::bind(&Endpoints::issueEventTicket, std::placeholders::_1, std::placeholders::_2)},
     {{"POST", "/api/passwords/add"}, std::bind(&Endpoints::addPassword, std::placeholders::_1, std::placeholders::_2)},
+    {{"POST", "/api/passwords/import"}, std::bind(&Endpoints::importPasswords, std::placeholders::_1, std::placeholders::_2)},
+    {{"GET",  "/api/passwords/export"}, std::bind(&Endpoints::exportPasswords, std::placeholders::_1, std::placeholders::_2)},
+    {{"POST", "/api/passwords/batch"}, std::bind(&Endpoints::batchPasswords, std::placeholders::_1, std::placeholders::_2)},
     {{"POST", "/api/passwords/update"}, std::bind(&Endpoints::updatePassword, std::placeholders::_1, std::placeholders::_2)},
     {{"POST", "/api/passwords/delete"}, std::bind(&Endpoints::removePassword, std::placeholders::_1, std::placeholders::_2)},
     {{"POST", "/api/authentication/login"}, std::bind(&Endpoints::login, std::placeholders::_1, std::placeholders::_2)},
-    {{"POST", "/api/authentication/register"}, std::bind(&Endpoints::registerUser, std::placeholders::_1, std::placeholders::_2)}
+    {{"POST", "/api/authentication/register"}, std::bind(&Endpoints::registerUser, std::placeholders::_1, std::placeholders::_2)},
+    {{"POST", "/api/authentication/logout"}, std::bind(&Endpoints::logout, std::placeholders::_1, std::placeholders::_2)},
+    {{"POST", "/api/authentication/password"}, std::bind(&Endpoints::changePassword, std::placeholders::_1, std::placeholders::_2)},
+    {{"GET",  "/api/authentication/rotation"}, std::bind(&Endpoints::getKeyRotation, std::placeholders::_1, std::placeholders::_2)},
+    {{"POST", "/api/backup/create"}, std::bind(&Endpoints::createBackup, std::placeholders::_1, std::placeholders::_2)},
+    {{"GET",  "/api/backup/status"}, std::bind(&Endpoints::getBackupStatus, std::placeholders::_1, std::placeholders::_2)}
 };
 
 void MyRequestHandler::handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) {
@@ -26,6 +42,9 @@ void MyRequestHandler::handleRequest(Poco::Net::HTTPServerRequest& request, Poco
     std::string path = uri.getPath();
     std::string method = request.getMethod();
 
+    // Stages and log messages of this request are bound to its trace, completed request reports itself when slow
+    auto trace = std::make_shared<timing::RequestTrace>(method, path);
+    timing::RequestTrace::Scope scope(trace);
     setCorsHeaders(response);
 
     if (method == "OPTIONS") {
@@ -36,6 +55,11 @@ void MyRequestHandler::handleRequest(Poco::Net::HTTPServerRequest& request, Poco
     auto route = routes.find({method, path});
     if (route != routes.end()) {
         route->second(request, response);
+
+        // Request completed by executor sets status of its trace itself
+        if (response.sent()) {
+            trace->setStatus(response.getStatus());
+        }
         return;
     }
     handleNotFound(request, response);
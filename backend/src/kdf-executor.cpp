@@ -0,0 +1,110 @@
+#include <kdf-executor.hpp>
+#include <log.hpp>
+#include <algorithm>
+#include <stdexcept>
+
+namespace auth {
+    KdfExecutor& KdfExecutor::getInstance() {
+        static KdfExecutor executor;
+        return executor;
+    }
+
+    KdfExecutor::~KdfExecutor() {
+        stop();
+    }
+
+    void KdfExecutor::start(std::size_t threads) {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!workers.empty()) {
+            return;
+        }
+
+        auto cores = physicalCores();
+        if (threads == 0) {
+            threads = cores.empty() ? std::max(1u, std::thread::hardware_concurrency()) : cores.size();
+        }
+
+        // Threads beyond number of cores are left unpinned
+        for (std::size_t i = 0; i < threads; ++i) {
+            std::uint64_t affinity = i < cores.size() ? cores[i] : 0;
+            workers.emplace_back([this, affinity](std::stop_token stopToken) { run(stopToken, affinity); });
+        }
+        Logger::info("KDF executor started with {} threads on {} physical cores", threads, cores.size());
+    }
+
+    void KdfExecutor::stop() {
+        std::vector<std::jthread> stopping;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping.swap(workers);
+        }
+        for (auto& worker : stopping) {
+            worker.request_stop();
+        }
+        cv.notify_all();
+        stopping.clear();
+    }
+
+    void KdfExecutor::post(std::move_only_function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (workers.empty()) {
+                throw std::runtime_error("KDF executor is not running");
+            }
+            tasks.push_back(std::move(task));
+        }
+        cv.notify_one();
+    }
+
+    std::size_t KdfExecutor::size() {
+        std::lock_guard<std::mutex> lock(mtx);
+        return workers.size();
+    }
+
+    void KdfExecutor::run(std::stop_token stopToken, std::uint64_t affinity) {
+        if (affinity != 0 && SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(affinity)) == 0) {
+            Logger::warn("Could not pin KDF thread to core mask {:#x}", affinity);
+        }
+
+        while (true) {
+            std::move_only_function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv.wait(lock, stopToken, [this]() { return !tasks.empty(); });
+                if (tasks.empty()) {
+                    return;
+                }
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+
+            // Tasks complete their requests themselves, exception here means response was already lost
+            try {
+                task();
+            }
+            catch (const std::exception& e) {
+                Logger::error("KDF task failed: {}", e.what());
+            }
+            catch (...) {
+                Logger::error("KDF task failed with unknown error");
+            }
+        }
+    }
+
+    std::vector<std::uint64_t> KdfExecutor::physicalCores() {
+        DWORD length = 0;
+        GetLogicalProcessorInformation(nullptr, &length);
+        std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> info(length / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+        if (info.empty() || !GetLogicalProcessorInformation(info.data(), &length)) {
+            return {};
+        }
+
+        std::vector<std::uint64_t> cores;
+        for (const auto& entry : info) {
+            if (entry.Relationship == RelationProcessorCore) {
+                cores.push_back(static_cast<std::uint64_t>(entry.ProcessorMask));
+            }
+        }
+        return cores;
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <fix.hpp>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace auth {
+    /// @brief Executor of key derivations running on threads pinned to physical cores, implementing Singleton pattern
+    /// @note HTTP threads hand derivations of login and registration over to it, so HTTP pool stays small and
+    /// busy only with I/O. Pinning one thread per physical core keeps CPU bound derivations off SMT siblings.
+    class KdfExecutor {
+    public:
+        /// @brief Get singleton instance of executor
+        /// @return Reference to executor instance
+        static KdfExecutor& getInstance();
+
+        /// @brief Delete copy, assignment, move, move assignment constructor
+        KdfExecutor(const KdfExecutor&) = delete;
+        KdfExecutor& operator=(const KdfExecutor&) = delete;
+        KdfExecutor(KdfExecutor&&) = delete;
+        KdfExecutor& operator=(KdfExecutor&&) = delete;
+
+        /// @brief Starts worker threads
+        /// @param threads number of threads, 0 for one per physical core
+        void start(std::size_t threads = 0);
+
+        /// @brief Stops worker threads, queued tasks are still run
+        void stop();
+
+        /// @brief Queues task
+        /// @param task task to run on executor thread
+        /// @throw std::runtime_error when executor is not running
+        void post(std::move_only_function<void()> task);
+
+        /// @brief Queues task and returns future of its result
+        /// @param task task to run on executor thread
+        /// @return future of result, carries exception of task
+        /// @throw std::runtime_error when executor is not running
+        template <typename Task>
+        auto submit(Task task) -> std::future<std::invoke_result_t<Task&>> {
+            std::packaged_task<std::invoke_result_t<Task&>()> packaged(std::move(task));
+            auto future = packaged.get_future();
+            post([packaged = std::move(packaged)]() mutable { packaged(); });
+            return future;
+        }
+
+        /// @brief Gets number of worker threads
+        /// @return number of threads, 0 when not running
+        std::size_t size();
+
+    private:
+        /// @brief Private constructor for Singleton pattern
+        KdfExecutor() = default;
+
+        /// @brief Private destructor
+        ~KdfExecutor();
+
+        /// @brief Worker thread loop
+        /// @param stopToken token signalling stop request
+        /// @param affinity affinity mask of thread, 0 leaves thread unpinned
+        void run(std::stop_token stopToken, std::uint64_t affinity);
+
+        /// @brief Gets affinity masks of physical cores of this machine
+        /// @return one mask per physical core, empty when unknown
+        static std::vector<std::uint64_t> physicalCores();
+
+        std::vector<std::jthread> workers;                      // Worker threads
+        std::deque<std::move_only_function<void()>> tasks;      // Queued tasks
+        std::mutex mtx;                                         // Mutex guarding tasks and workers
+        std::condition_variable_any cv;                         // Signals queued task or stop
+    };
+}
@@ -0,0 +1,216 @@
+#include <kdf.hpp>
+#include <request-trace.hpp>
+#include <cryptopp/pwdbased.h>
+#include <cryptopp/sha.h>
+#ifdef PASSWORD_FUCKER_ARGON2
+#include <argon2.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <stdexcept>
+#include <format>
+
+namespace {
+    constexpr std::string_view PBKDF2_NAME = "pbkdf2-sha256";
+    constexpr std::string_view ARGON2ID_NAME = "argon2id";
+
+    // Password and salt used only to measure cost of derivation
+    constexpr std::string_view CALIBRATION_PASSWORD = "calibration-password";
+    constexpr std::uint32_t CALIBRATION_PROBE_ITERATIONS = 10000;
+    constexpr std::chrono::milliseconds CALIBRATION_MIN_PROBE{20};
+
+    void putUInt32(CryptoPP::byte* out, std::uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            out[i] = static_cast<CryptoPP::byte>((value >> (8 * i)) & 0xFF);
+        }
+    }
+
+    std::uint32_t getUInt32(const CryptoPP::byte* in) {
+        std::uint32_t value = 0;
+        for (int i = 0; i < 4; ++i) {
+            value |= static_cast<std::uint32_t>(in[i]) << (8 * i);
+        }
+        return value;
+    }
+
+    std::uint32_t parseValue(std::string_view text) {
+        std::uint32_t value = 0;
+        auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (error != std::errc() || end != text.data() + text.size()) {
+            throw std::invalid_argument(std::format("Invalid KDF parameter value: {}", text));
+        }
+        return value;
+    }
+
+    /// @brief Measures single derivation with given parameters
+    std::chrono::duration<double, std::milli> measure(const KdfParameters& parameters) {
+        std::array<CryptoPP::byte, 16> salt{};
+        std::array<CryptoPP::byte, 32> key{};
+        auto start = std::chrono::steady_clock::now();
+        parameters.derive(CALIBRATION_PASSWORD, salt.data(), salt.size(), key.data(), key.size());
+        return std::chrono::steady_clock::now() - start;
+    }
+}
+
+std::string KdfParameters::toString() const {
+    if (algorithm == Algorithm::Argon2id) {
+        return std::format("{}$m={},t={},p={}", ARGON2ID_NAME, memoryKiB, iterations, lanes);
+    }
+    return std::format("{}$i={}", PBKDF2_NAME, iterations);
+}
+
+KdfParameters KdfParameters::fromString(std::string_view text) {
+    auto separator = text.find('$');
+    if (separator == std::string_view::npos) {
+        throw std::invalid_argument(std::format("Invalid KDF parameters: {}", text));
+    }
+
+    KdfParameters parameters;
+    parameters.algorithm = algorithmFromName(text.substr(0, separator));
+
+    // Comma separated key=value pairs
+    auto rest = text.substr(separator + 1);
+    while (!rest.empty()) {
+        auto end = rest.find(',');
+        auto pair = rest.substr(0, end);
+        rest = end == std::string_view::npos ? std::string_view() : rest.substr(end + 1);
+
+        auto equals = pair.find('=');
+        if (equals == std::string_view::npos) {
+            throw std::invalid_argument(std::format("Invalid KDF parameter: {}", pair));
+        }
+        auto key = pair.substr(0, equals);
+        auto value = parseValue(pair.substr(equals + 1));
+        if (key == "i" || key == "t") {
+            parameters.iterations = value;
+        }
+        else if (key == "m") {
+            parameters.memoryKiB = value;
+        }
+        else if (key == "p") {
+            parameters.lanes = value;
+        }
+        else {
+            throw std::invalid_argument(std::format("Unknown KDF parameter: {}", key));
+        }
+    }
+
+    parameters.validate();
+    return parameters;
+}
+
+KdfParameters::Algorithm KdfParameters::algorithmFromName(std::string_view name) {
+    if (name == PBKDF2_NAME) {
+        return Algorithm::Pbkdf2Sha256;
+    }
+    if (name == ARGON2ID_NAME) {
+        return Algorithm::Argon2id;
+    }
+    throw std::invalid_argument(std::format("Unknown KDF: {}", name));
+}
+
+void KdfParameters::encode(CryptoPP::byte* out) const {
+    out[0] = static_cast<CryptoPP::byte>(algorithm);
+    putUInt32(out + 1, iterations);
+    putUInt32(out + 5, memoryKiB);
+    out[9] = static_cast<CryptoPP::byte>(lanes);
+}
+
+KdfParameters KdfParameters::decode(const CryptoPP::byte* in) {
+    KdfParameters parameters;
+    parameters.algorithm = static_cast<Algorithm>(in[0]);
+    parameters.iterations = getUInt32(in + 1);
+    parameters.memoryKiB = getUInt32(in + 5);
+    parameters.lanes = in[9];
+    parameters.validate();
+    return parameters;
+}
+
+void KdfParameters::validate() const {
+    switch (algorithm) {
+    case Algorithm::Pbkdf2Sha256:
+        if (iterations < LEGACY_ITERATIONS || iterations > MAX_PBKDF2_ITERATIONS) {
+            throw std::invalid_argument(std::format("PBKDF2 iterations out of range: {}", iterations));
+        }
+        return;
+    case Algorithm::Argon2id:
+        if (!argon2Available()) {
+            throw std::invalid_argument("Argon2id is not available in this build");
+        }
+        if (iterations < 1 || iterations > MAX_ARGON2_PASSES) {
+            throw std::invalid_argument(std::format("Argon2 passes out of range: {}", iterations));
+        }
+        if (lanes < 1 || lanes > MAX_ARGON2_LANES) {
+            throw std::invalid_argument(std::format("Argon2 lanes out of range: {}", lanes));
+        }
+        if (memoryKiB < std::max(MIN_ARGON2_MEMORY_KIB, 8 * lanes) || memoryKiB > MAX_ARGON2_MEMORY_KIB) {
+            throw std::invalid_argument(std::format("Argon2 memory out of range: {} KiB", memoryKiB));
+        }
+        return;
+    }
+    throw std::invalid_argument(std::format("Unknown KDF algorithm: {}", static_cast<int>(algorithm)));
+}
+
+void KdfParameters::derive(std::string_view password, const CryptoPP::byte* salt, std::size_t saltSize, CryptoPP::byte* key, std::size_t keySize) const {
+    timing::ScopedStage stage("kdf");
+    if (algorithm == Algorithm::Pbkdf2Sha256) {
+        CryptoPP::PKCS5_PBKDF2_HMAC<CryptoPP::SHA256> pbkdf2;
+        pbkdf2.DeriveKey(
+            key, keySize,
+            0x00, // purpose (not used)
+            reinterpret_cast<const CryptoPP::byte*>(password.data()), password.size(),
+            salt, saltSize,
+            iterations,
+            0.0 // timeInSeconds (not used)
+        );
+        return;
+    }
+
+#ifdef PASSWORD_FUCKER_ARGON2
+    int result = argon2id_hash_raw(iterations, memoryKiB, lanes, password.data(), password.size(), salt, saltSize, key, keySize);
+    if (result != ARGON2_OK) {
+        throw std::runtime_error(std::format("Argon2id derivation failed: {}", argon2_error_message(result)));
+    }
+#else
+    throw std::runtime_error("Argon2id is not available in this build");
+#endif
+}
+
+bool KdfParameters::argon2Available() {
+#ifdef PASSWORD_FUCKER_ARGON2
+    return true;
+#else
+    return false;
+#endif
+}
+
+KdfParameters KdfParameters::calibrate(Algorithm algorithm, std::chrono::milliseconds target, std::uint32_t memoryKiB, std::uint32_t lanes) {
+    KdfParameters parameters;
+    parameters.algorithm = algorithm;
+
+    if (algorithm == Algorithm::Pbkdf2Sha256) {
+        // Cost is linear in iterations, probe is grown until timer resolution does not matter
+        parameters.iterations = CALIBRATION_PROBE_ITERATIONS;
+        auto elapsed = measure(parameters);
+        while (elapsed < CALIBRATION_MIN_PROBE && parameters.iterations < MAX_PBKDF2_ITERATIONS / 2) {
+            parameters.iterations *= 2;
+            elapsed = measure(parameters);
+        }
+        double scaled = static_cast<double>(parameters.iterations) * target.count() / std::max(elapsed.count(), 1e-3);
+        auto iterations = static_cast<std::uint32_t>(std::clamp(scaled, static_cast<double>(LEGACY_ITERATIONS), static_cast<double>(MAX_PBKDF2_ITERATIONS)));
+        parameters.iterations = iterations / 1000 * 1000;
+        return parameters;
+    }
+
+    // Memory and lanes are fixed by configuration, only number of passes is tuned
+    parameters.memoryKiB = memoryKiB;
+    parameters.lanes = lanes;
+    parameters.iterations = 1;
+    parameters.validate();
+    auto elapsed = measure(parameters);
+    double passes = target.count() / std::max(elapsed.count(), 1e-3);
+    parameters.iterations = static_cast<std::uint32_t>(std::clamp(passes, 1.0, static_cast<double>(MAX_ARGON2_PASSES)));
+    return parameters;
+}
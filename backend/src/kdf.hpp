@@ -0,0 +1,86 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cryptopp/config.h>
+
+/// @brief Algorithm and cost of key derivation from user password
+/// @note Parameters are stored per user in users table and in every binary envelope, so data derived with
+/// older parameters stays readable after user is upgraded to new ones.
+struct KdfParameters {
+    /// @brief Key derivation function
+    enum class Algorithm : std::uint8_t {
+        Pbkdf2Sha256 = 1,   // PBKDF2 with HMAC-SHA256
+        Argon2id = 2        // Argon2id, available when built with Argon2
+    };
+
+    Algorithm algorithm = Algorithm::Pbkdf2Sha256;  // Key derivation function
+    std::uint32_t iterations = LEGACY_ITERATIONS;   // PBKDF2 iterations or Argon2 passes
+    std::uint32_t memoryKiB = 0;                    // Argon2 memory cost in KiB
+    std::uint32_t lanes = 1;                        // Argon2 parallelism
+
+    static constexpr std::uint32_t LEGACY_ITERATIONS = 100000;      // PBKDF2 iterations of data without stored parameters
+    static constexpr std::uint32_t MAX_PBKDF2_ITERATIONS = 20000000;
+    static constexpr std::uint32_t MAX_ARGON2_PASSES = 64;
+    static constexpr std::uint32_t MIN_ARGON2_MEMORY_KIB = 8192;
+    static constexpr std::uint32_t MAX_ARGON2_MEMORY_KIB = 4194304; // 4 GiB
+    static constexpr std::uint32_t MAX_ARGON2_LANES = 64;
+    static constexpr std::size_t ENCODED_SIZE = 10;                 // Algorithm, iterations, memory and lanes in envelope
+
+    bool operator==(const KdfParameters&) const = default;
+
+    /// @brief Converts parameters to text stored in database, e.g. "pbkdf2-sha256$i=100000" or "argon2id$m=65536,t=3,p=4"
+    /// @return text form of parameters
+    std::string toString() const;
+
+    /// @brief Parses text form of parameters
+    /// @param text text created by toString()
+    /// @return parsed and validated parameters
+    /// @throw std::invalid_argument on malformed text or parameters out of bounds
+    static KdfParameters fromString(std::string_view text);
+
+    /// @brief Parses name of algorithm
+    /// @param name "pbkdf2-sha256" or "argon2id"
+    /// @return algorithm
+    /// @throw std::invalid_argument on unknown name
+    static Algorithm algorithmFromName(std::string_view name);
+
+    /// @brief Writes parameters in binary form of ENCODED_SIZE bytes
+    /// @param out output buffer
+    void encode(CryptoPP::byte* out) const;
+
+    /// @brief Reads parameters from binary form
+    /// @param in buffer of ENCODED_SIZE bytes
+    /// @return decoded and validated parameters
+    /// @throw std::invalid_argument on parameters out of bounds
+    static KdfParameters decode(const CryptoPP::byte* in);
+
+    /// @brief Checks bounds of parameters, protects decryption from absurd costs read from stored data
+    /// @throw std::invalid_argument on parameters out of bounds or Argon2id not available
+    void validate() const;
+
+    /// @brief Derives key from password
+    /// @param password user password
+    /// @param salt salt
+    /// @param saltSize size of salt
+    /// @param key output buffer
+    /// @param keySize size of key
+    /// @throw std::runtime_error on failure of derivation
+    void derive(std::string_view password, const CryptoPP::byte* salt, std::size_t saltSize, CryptoPP::byte* key, std::size_t keySize) const;
+
+    /// @brief Checks whether backend was built with Argon2
+    /// @return true if Argon2id can be used
+    static bool argon2Available();
+
+    /// @brief Measures key derivation on this host and picks cost reaching target latency
+    /// @param algorithm key derivation function
+    /// @param target target latency of one derivation
+    /// @param memoryKiB Argon2 memory cost, ignored by PBKDF2
+    /// @param lanes Argon2 parallelism, ignored by PBKDF2
+    /// @return parameters, never weaker than LEGACY_ITERATIONS for PBKDF2 and single pass for Argon2id
+    /// @throw std::invalid_argument on invalid memory or lanes
+    static KdfParameters calibrate(Algorithm algorithm, std::chrono::milliseconds target, std::uint32_t memoryKiB, std::uint32_t lanes);
+};
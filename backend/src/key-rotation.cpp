@@ -0,0 +1,372 @@
+#include <key-rotation.hpp>
+#include <auth.hpp>
+#include <crypto.hpp>
+#include <log.hpp>
+#include <passwords.hpp>
+#include <secure-arena.hpp>
+#include <vault-cache.hpp>
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace pass {
+    nlohmann::json KeyRotation::Progress::toJson() const {
+        nlohmann::json json = {
+            { "state", stateToString(state) },
+            { "total", total },
+            { "done", done },
+            { "skipped", skipped }
+        };
+        if (!error.empty()) {
+            json["error"] = error;
+        }
+        return json;
+    }
+
+    std::string KeyRotation::Progress::stateToString(State state) {
+        switch (state) {
+            case State::Idle:
+                return "idle";
+            case State::Queued:
+                return "queued";
+            case State::Running:
+                return "running";
+            case State::Finished:
+                return "finished";
+            case State::Failed:
+                return "failed";
+        }
+        return "unknown";
+    }
+
+    KeyRotation::Pause::Pause() {
+        auto& rotation = getInstance();
+        std::unique_lock<std::mutex> lock(rotation.mtx);
+        ++rotation.pauses;
+        rotation.cv.wait(lock, [&rotation]() { return !rotation.writing && rotation.changing.empty(); });
+    }
+
+    KeyRotation::Pause::~Pause() {
+        auto& rotation = getInstance();
+        {
+            std::lock_guard<std::mutex> lock(rotation.mtx);
+            --rotation.pauses;
+        }
+        rotation.cv.notify_all();
+    }
+
+    KeyRotation& KeyRotation::getInstance() {
+        static KeyRotation rotation;
+        return rotation;
+    }
+
+    KeyRotation::~KeyRotation() {
+        stop();
+    }
+
+    void KeyRotation::configure(const Settings& settings) {
+        if (settings.chunkSize == 0) {
+            throw std::invalid_argument("Chunk size of key rotation must be positive");
+        }
+        std::lock_guard<std::mutex> lock(mtx);
+        this->settings = settings;
+    }
+
+    void KeyRotation::start() {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!worker.joinable()) {
+            worker = std::jthread([this](std::stop_token stopToken) { run(stopToken); });
+        }
+    }
+
+    void KeyRotation::stop() {
+        if (worker.joinable()) {
+            worker.request_stop();
+            cv.notify_all();
+            worker.join();
+        }
+    }
+
+    KeyRotation::ChangeScope::ChangeScope(KeyRotation& rotation, const std::uint32_t userId) : rotation(rotation), userId(userId) {
+        std::lock_guard<std::mutex> lock(rotation.mtx);
+        if (rotation.pauses > 0) {
+            throw KeyRotationConflict("Backup is running, password can be changed after it finishes");
+        }
+        if (!rotation.changing.insert(userId).second) {
+            throw KeyRotationConflict("Password of user is already being changed");
+        }
+    }
+
+    KeyRotation::ChangeScope::~ChangeScope() {
+        {
+            std::lock_guard<std::mutex> lock(rotation.mtx);
+            rotation.changing.erase(userId);
+        }
+        rotation.cv.notify_all();
+    }
+
+    bool KeyRotation::changePassword(const std::uint32_t userId, const std::string& currentPassword, const std::string& newPassword) {
+        // Held from verification until new crypto is registered
+        ChangeScope scope(*this, userId);
+        auto& users = auth::SQLiteUserRepository::getInstance();
+        auto user = users.getById(userId);
+        if (!user) {
+            throw std::invalid_argument(std::format("User with id: {} was not found", userId));
+        }
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (active(userId) || users.getKeyRotation(userId)) {
+                throw std::invalid_argument("Re-encryption after previous password change is not finished");
+            }
+        }
+
+        // Credentials are encrypted with password of user, so they verify current password
+        Crypto current(currentPassword);
+        auth::User plain;
+        try {
+            plain.password = current.decrypt(user->password);
+            if (plain.password != currentPassword) {
+                util::wipe(plain.password);
+                return false;
+            }
+            plain.login = current.decrypt(user->login);
+            plain.name = current.decrypt(user->name);
+            plain.surname = current.decrypt(user->surname);
+        }
+        catch (const std::runtime_error&) {
+            return false;
+        }
+
+        // Credentials and previous password are switched in single statement, entries follow in background
+        auto kdf = Crypto::targetKdf();
+        Crypto next(newPassword, kdf);
+        auth::User encrypted;
+        encrypted.id = userId;
+        encrypted.login = next.encrypt(plain.login);
+        encrypted.password = next.encrypt(newPassword);
+        encrypted.name = next.encrypt(plain.name);
+        encrypted.surname = next.encrypt(plain.surname);
+        encrypted.kdf = kdf;
+        auto swapped = users.startKeyRotation(encrypted, next.encrypt(currentPassword), user->password);
+        for (auto* field : { &plain.login, &plain.password, &plain.name, &plain.surname }) {
+            util::wipe(*field);
+        }
+        if (!swapped) {
+            throw KeyRotationConflict("Credentials of user changed while password change was verified");
+        }
+
+        CryptoManager::registerCrypto(newPassword, userId, kdf);
+        CryptoManager::get(userId)->setPreviousPassword(currentPassword);
+        VaultCache::getInstance().evict(userId);
+        Logger::info("Master password of user {} changed, re-encryption of vault queued", userId);
+
+        std::lock_guard<std::mutex> lock(mtx);
+        enqueue(userId);
+        return true;
+    }
+
+    void KeyRotation::resume(const std::uint32_t userId) {
+        auto state = auth::SQLiteUserRepository::getInstance().getKeyRotation(userId);
+        if (!state) {
+            return;
+        }
+
+        // Crypto registered by login knows only current password
+        auto crypto = CryptoManager::get(userId);
+        auto previous = crypto->decrypt(state->previous);
+        crypto->setPreviousPassword(previous);
+        util::wipe(previous);
+
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!active(userId)) {
+            Logger::info("Resuming re-encryption of vault of user {} after entry {}", userId, state->cursor);
+            enqueue(userId);
+        }
+    }
+
+    KeyRotation::Progress KeyRotation::progress(const std::uint32_t userId) {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto job = jobs.find(userId);
+        return job == jobs.end() ? Progress() : job->second;
+    }
+
+    void KeyRotation::enqueue(const std::uint32_t userId) {
+        if (active(userId)) {
+            return;
+        }
+        jobs[userId] = Progress();
+        jobs[userId].state = State::Queued;
+        queue.push_back(userId);
+        cv.notify_one();
+    }
+
+    bool KeyRotation::active(const std::uint32_t userId) const {
+        auto job = jobs.find(userId);
+        return job != jobs.end() && (job->second.state == State::Queued || job->second.state == State::Running);
+    }
+
+    void KeyRotation::run(std::stop_token stopToken) {
+        while (true) {
+            std::uint32_t userId = 0;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv.wait(lock, stopToken, [this]() { return !queue.empty(); });
+                if (stopToken.stop_requested()) {
+                    return;
+                }
+                userId = queue.front();
+                queue.pop_front();
+                jobs[userId].state = State::Running;
+            }
+
+            // Failed job keeps its stored progress and continues after next login
+            try {
+                process(userId, stopToken);
+            }
+            catch (const std::exception& e) {
+                Logger::error("Re-encryption of vault of user {} failed: {}", userId, e.what());
+                std::lock_guard<std::mutex> lock(mtx);
+                jobs[userId].state = State::Failed;
+                jobs[userId].error = e.what();
+            }
+        }
+    }
+
+    void KeyRotation::process(const std::uint32_t userId, std::stop_token stopToken) {
+        auto& users = auth::SQLiteUserRepository::getInstance();
+        auto state = users.getKeyRotation(userId);
+        if (!state) {
+            std::lock_guard<std::mutex> lock(mtx);
+            jobs[userId].state = State::Finished;
+            return;
+        }
+
+        auto cursor = state->cursor;
+        auto [total, done] = PasswordManager().executeCustomOperation(userId, [userId, cursor](SQLite::Database* db) {
+            SQLite::Statement query(*db, "SELECT COUNT(*), COALESCE(SUM(id <= ?), 0) FROM passwords WHERE userId = ? AND deleted = 0");
+            query.bind(1, static_cast<int64_t>(cursor));
+            query.bind(2, static_cast<int64_t>(userId));
+            query.executeStep();
+            return std::pair<std::size_t, std::size_t>(query.getColumn(0).getInt64(), query.getColumn(1).getInt64());
+        });
+
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            jobs[userId].total = total;
+            jobs[userId].done = done;
+        }
+
+        sweep(userId, cursor, false, stopToken);
+        if (stopToken.stop_requested()) {
+            return;
+        }
+
+        // Entries skipped because they changed meanwhile are not known to be sealed with new password,
+        // previous password is forgotten only when whole vault opens without it
+        for (std::size_t round = 1;; ++round) {
+            auto remaining = sweep(userId, 0, true, stopToken);
+            if (stopToken.stop_requested()) {
+                return;
+            }
+            if (remaining == 0) {
+                break;
+            }
+            if (round == MAX_VERIFY_ROUNDS) {
+                throw std::runtime_error(std::format("{} entries still need previous password", remaining));
+            }
+        }
+
+        users.finishKeyRotation(userId);
+        try {
+            CryptoManager::get(userId)->clearPreviousPassword();
+        }
+        catch (const std::runtime_error&) {
+            // Crypto of user was not registered, nothing to forget
+        }
+
+        std::lock_guard<std::mutex> lock(mtx);
+        jobs[userId].state = State::Finished;
+        Logger::info("Vault of user {} re-encrypted: {} entries, {} written meanwhile", userId, jobs[userId].done, jobs[userId].skipped);
+    }
+
+    std::size_t KeyRotation::sweep(const std::uint32_t userId, std::uint32_t cursor, bool verify, std::stop_token stopToken) {
+        auto& users = auth::SQLiteUserRepository::getInstance();
+        auto& repo = SQLitePasswordRepository::getInstance();
+        Settings limits;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            limits = settings;
+        }
+
+        // Marks chunk as being written until scope ends, also by exception
+        struct Writing {
+            KeyRotation& rotation;
+            ~Writing() {
+                {
+                    std::lock_guard<std::mutex> lock(rotation.mtx);
+                    rotation.writing = false;
+                }
+                rotation.cv.notify_all();
+            }
+        };
+
+        std::size_t conflicts = 0;
+        while (!stopToken.stop_requested()) {
+            {
+                // Chunk is not started while paused, Pause waits for chunk being written
+                std::unique_lock<std::mutex> lock(mtx);
+                cv.wait(lock, stopToken, [this]() { return pauses == 0; });
+                if (stopToken.stop_requested()) {
+                    break;
+                }
+                writing = true;
+            }
+            Writing writingScope{ *this };
+
+            auto started = std::chrono::steady_clock::now();
+            auto page = repo.getPage(userId, cursor, limits.chunkSize);
+            if (page.empty()) {
+                break;
+            }
+            cursor = page.back().id;
+
+            // Entries are decrypted with whichever password sealed them and encrypted with current one on all cores,
+            // verification takes only entries which still open with previous password alone
+            std::vector<Password> chunk;
+            chunk.reserve(page.size());
+            for (const auto& password : page) {
+                if (!verify || PasswordCrypto::needsPreviousPassword(password, userId)) {
+                    chunk.push_back(PasswordCrypto::decrypt(password, userId));
+                }
+            }
+            PasswordCrypto::encryptBatch(chunk, userId);
+            auto replaced = repo.replaceEncrypted(chunk);
+            if (!verify) {
+                users.setKeyRotationCursor(userId, cursor);
+            }
+
+            std::unique_lock<std::mutex> lock(mtx);
+            auto& job = jobs[userId];
+            job.done += replaced;
+            if (verify) {
+                conflicts += chunk.size() - replaced;
+                job.skipped -= std::min(job.skipped, replaced);
+            }
+            else {
+                job.skipped += page.size() - replaced;
+            }
+            writing = false;
+            cv.notify_all();
+
+            // Rate limit leaves database and cores to requests of users
+            if (limits.entriesPerSecond > 0) {
+                auto due = started + std::chrono::microseconds(page.size() * 1'000'000 / limits.entriesPerSecond);
+                cv.wait_until(lock, stopToken, due, []() { return false; });
+            }
+        }
+        return conflicts;
+    }
+}
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <fix.hpp>
+#include <nlohmann/json.hpp>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace pass {
+    /// @brief Exception thrown when password change races with another change of the same user, mapped to 409 response
+    class KeyRotationConflict : public std::runtime_error {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    /// @brief Background re-encryption of vaults after change of master password, implementing Singleton pattern
+    /// @note Credentials of user are switched to new password at once and previous password is kept encrypted with
+    /// the new one, so entries are re-encrypted by single worker thread chunk by chunk at limited rate. Crypto of user
+    /// falls back to previous password for entries not re-encrypted yet, so vault stays readable. Progress is stored
+    /// after every chunk and unfinished job continues after next login of user.
+    class KeyRotation {
+    public:
+        /// @brief Limits of re-encryption
+        class Settings {
+        public:
+            std::size_t chunkSize = 100;            // Entries re-encrypted in single transaction
+            std::uint32_t entriesPerSecond = 500;   // Rate of re-encryption, 0 for unlimited
+        };
+
+        /// @brief State of re-encryption of one vault
+        enum class State {
+            Idle,       ///< No re-encryption since start of server
+            Queued,     ///< Waiting for worker thread
+            Running,    ///< Entries are being re-encrypted
+            Finished,   ///< All entries re-encrypted, previous password forgotten
+            Failed      ///< Stopped by error, continues after next login
+        };
+
+        /// @brief Progress of re-encryption of one vault
+        class Progress {
+        public:
+            State state = State::Idle;          // State of re-encryption
+            std::size_t total = 0;              // Live entries of vault when job was started
+            std::size_t done = 0;               // Entries re-encrypted so far
+            std::size_t skipped = 0;            // Entries written by user meanwhile and found sealed with new password
+            std::string error;                  // Reason of failure
+
+            /// @brief Function to convert Progress object to Json
+            /// @return json object
+            nlohmann::json toJson() const;
+
+            /// @brief Function to convert state to string
+            /// @param state state of re-encryption
+            /// @return name of state
+            static std::string stateToString(State state);
+        };
+
+        /// @brief Pauses re-encryption and password changes of all users for lifetime of object, e.g. during backup
+        /// @note Constructor waits until chunk being written and password changes being verified finish, so
+        /// credentials in main database and entries in shards are not rewritten while files are copied one by one
+        class Pause {
+        public:
+            /// @brief Constructor, pauses key rotation
+            Pause();
+
+            /// @brief Destructor, lets key rotation continue
+            ~Pause();
+
+            Pause(const Pause&) = delete;
+            Pause& operator=(const Pause&) = delete;
+        };
+
+        /// @brief Get singleton instance of key rotation
+        /// @return Reference to key rotation instance
+        static KeyRotation& getInstance();
+
+        /// @brief Delete copy, assignment, move, move assignment constructor
+        KeyRotation(const KeyRotation&) = delete;
+        KeyRotation& operator=(const KeyRotation&) = delete;
+        KeyRotation(KeyRotation&&) = delete;
+        KeyRotation& operator=(KeyRotation&&) = delete;
+
+        /// @brief Sets limits of re-encryption
+        /// @param settings limits
+        /// @throw std::invalid_argument on zero chunk size
+        void configure(const Settings& settings);
+
+        /// @brief Starts worker thread
+        void start();
+
+        /// @brief Stops worker thread after current chunk, unfinished jobs continue after next login
+        void stop();
+
+        /// @brief Changes master password of user and queues re-encryption of vault
+        /// @note With new password equal to current one entries are only moved to fresh key and current KDF (key rotation)
+        /// @param userId ID of logged in user
+        /// @param currentPassword current password of user
+        /// @param newPassword new password of user
+        /// @return false when current password is not valid
+        /// @throw std::invalid_argument when new password is empty or previous re-encryption is not finished
+        /// @throw KeyRotationConflict when another change of the same user runs, changed credentials meanwhile or backup runs
+        bool changePassword(const std::uint32_t userId, const std::string& currentPassword, const std::string& newPassword);
+
+        /// @brief Continues unfinished re-encryption of user, called after login when crypto of user is registered
+        /// @param userId ID of user
+        void resume(const std::uint32_t userId);
+
+        /// @brief Gets progress of re-encryption of user
+        /// @param userId ID of user
+        /// @return progress, Idle when there was no re-encryption
+        Progress progress(const std::uint32_t userId);
+
+    private:
+        /// @brief Marks password change of user as running, so verification, swap of credentials
+        /// and registration of new crypto are not interleaved with another change
+        class ChangeScope {
+        public:
+            /// @brief Constructor
+            /// @param rotation key rotation owning set of running changes
+            /// @param userId ID of user
+            /// @throw KeyRotationConflict when change of user already runs or key rotation is paused
+            ChangeScope(KeyRotation& rotation, const std::uint32_t userId);
+
+            /// @brief Destructor, ends change of user
+            ~ChangeScope();
+
+            ChangeScope(const ChangeScope&) = delete;
+            ChangeScope& operator=(const ChangeScope&) = delete;
+
+        private:
+            KeyRotation& rotation;      // Key rotation owning set of running changes
+            std::uint32_t userId;       // ID of user
+        };
+
+        /// @brief Private constructor for Singleton pattern
+        KeyRotation() = default;
+
+        /// @brief Private destructor
+        ~KeyRotation();
+
+        /// @brief Queues re-encryption of user unless it is already queued or running, must be called with mutex locked
+        /// @param userId ID of user
+        void enqueue(const std::uint32_t userId);
+
+        static constexpr std::size_t MAX_VERIFY_ROUNDS = 3;  // Passes checking vault again before job fails and waits for next login
+
+        /// @brief Worker thread loop
+        /// @param stopToken token signalling stop request
+        void run(std::stop_token stopToken);
+
+        /// @brief Re-encrypts vault of user chunk by chunk
+        /// @note Entries changed meanwhile are skipped by the first pass. Whole vault is then checked again until
+        /// no entry needs previous password, only after that previous password is forgotten.
+        /// @param userId ID of user
+        /// @param stopToken token signalling stop request
+        void process(const std::uint32_t userId, std::stop_token stopToken);
+
+        /// @brief Re-encrypts one pass over vault of user
+        /// @param userId ID of user
+        /// @param cursor ID of last entry already re-encrypted, advanced and stored after every chunk
+        /// @param verify false to re-encrypt every entry, true to re-encrypt only entries needing previous password
+        /// @param stopToken token signalling stop request
+        /// @return number of entries which needed previous password but were changed while being re-encrypted
+        std::size_t sweep(const std::uint32_t userId, std::uint32_t cursor, bool verify, std::stop_token stopToken);
+
+        /// @brief Checks whether re-encryption of user is queued or running, must be called with mutex locked
+        /// @param userId ID of user
+        /// @return true when active
+        bool active(const std::uint32_t userId) const;
+
+        Settings settings;                                  // Limits of re-encryption
+        std::deque<std::uint32_t> queue;                    // Users waiting for worker thread
+        std::unordered_map<std::uint32_t, Progress> jobs;   // Progress by user
+        std::unordered_set<std::uint32_t> changing;         // Users whose password change runs
+        std::size_t pauses = 0;                             // Active Pause objects
+        bool writing = false;                               // Whether worker thread is writing chunk
+        std::mutex mtx;                                     // Mutex guarding settings, queue, jobs, running changes and pauses
+        std::condition_variable_any cv;                     // Signals queued job or stop
+        std::jthread worker;                                // Worker thread
+    };
+}
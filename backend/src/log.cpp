@@ -1,7 +1,29 @@
 #include "log.hpp"
+#include <spdlog/pattern_formatter.h>
+#include <string>
 
 std::shared_ptr<spdlog::logger> Logger::logger;
 std::string Logger::programName;
+thread_local std::uint64_t Logger::requestId = 0;
+
+namespace {
+    /// @brief Formatter of %* flag, ID of request handled by logging thread
+    class RequestIdFlag : public spdlog::custom_flag_formatter {
+    public:
+        void format(const spdlog::details::log_msg&, const std::tm&, spdlog::memory_buf_t& dest) override {
+            auto id = Logger::getRequestId();
+            if (id == 0) {
+                return;
+            }
+            std::string text = "[req " + std::to_string(id) + "] ";
+            dest.append(text.data(), text.data() + text.size());
+        }
+
+        std::unique_ptr<spdlog::custom_flag_formatter> clone() const override {
+            return std::make_unique<RequestIdFlag>();
+        }
+    };
+}
 
 void Logger::init(const std::string& file_name, const std::string& program_name, std::size_t max_size, std::size_t max_files) {
     programName = program_name;
@@ -18,8 +40,10 @@ void Logger::init(const std::string& file_name, const std::string& program_name,
     logger = std::make_shared<spdlog::logger>(program_name, begin(sinks), end(sinks));
     spdlog::register_logger(logger);
 
-    // Ustaw format logów
-    logger->set_pattern("[%Y-%m-%d %H:%M:%S] [%n] [%l] %v");
+    // Ustaw format logów, %* to ID obsługiwanego żądania
+    auto formatter = std::make_unique<spdlog::pattern_formatter>();
+    formatter->add_flag<RequestIdFlag>('*').set_pattern("[%Y-%m-%d %H:%M:%S] [%n] [%l] %*%v");
+    logger->set_formatter(std::move(formatter));
 
     logger->set_level(spdlog::level::trace);
     logger->flush_on(spdlog::level::trace);
@@ -28,3 +52,11 @@ void Logger::init(const std::string& file_name, const std::string& program_name,
 std::shared_ptr<spdlog::logger>& Logger::getLogger() {
     return logger;
 }
+
+void Logger::setRequestId(std::uint64_t id) noexcept {
+    requestId = id;
+}
+
+std::uint64_t Logger::getRequestId() noexcept {
+    return requestId;
+}
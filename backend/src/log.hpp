@@ -4,6 +4,7 @@
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/sinks/rotating_file_sink.h>
+#include <cstdint>
 #include <memory>
 
 /// @brief Class responsible for handling logger actions
@@ -20,6 +21,14 @@ public:
     /// @return Shared pointer to the logger instance
     static std::shared_ptr<spdlog::logger>& getLogger();
 
+    /// @brief Sets ID of request handled by current thread, its messages are prefixed with it
+    /// @param id ID of request, 0 outside of request
+    static void setRequestId(std::uint64_t id) noexcept;
+
+    /// @brief Gets ID of request handled by current thread
+    /// @return ID of request, 0 outside of request
+    static std::uint64_t getRequestId() noexcept;
+
     /// @brief Logs a trace message
     /// @tparam Args Types of the format arguments
     /// @param fmt Format string
@@ -80,4 +89,7 @@ private:
 
     /// @brief Name of the program for logging context
     static std::string programName;
+
+    /// @brief ID of request handled by current thread
+    static thread_local std::uint64_t requestId;
 };
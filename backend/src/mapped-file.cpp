@@ -0,0 +1,80 @@
+#include <mapped-file.hpp>
+#include <format>
+#include <stdexcept>
+#include <utility>
+
+namespace util {
+    MappedFile::MappedFile(const std::filesystem::path& path) {
+        file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error(std::format("Unable to open file: {} (error {})", path.string(), GetLastError()));
+        }
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size)) {
+            close();
+            throw std::runtime_error(std::format("Unable to read size of file: {}", path.string()));
+        }
+        length = static_cast<std::size_t>(size.QuadPart);
+        if (length == 0) {
+            return;     // Empty file cannot be mapped, it is simply empty view
+        }
+
+        mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr) {
+            close();
+            throw std::runtime_error(std::format("Unable to create mapping of file: {} (error {})", path.string(), GetLastError()));
+        }
+
+        view = static_cast<const std::byte*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (view == nullptr) {
+            close();
+            throw std::runtime_error(std::format("Unable to map file: {} (error {})", path.string(), GetLastError()));
+        }
+    }
+
+    MappedFile::~MappedFile() {
+        close();
+    }
+
+    MappedFile::MappedFile(MappedFile&& other) noexcept
+        : file(std::exchange(other.file, INVALID_HANDLE_VALUE)),
+          mapping(std::exchange(other.mapping, nullptr)),
+          view(std::exchange(other.view, nullptr)),
+          length(std::exchange(other.length, 0)) {}
+
+    MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            close();
+            file = std::exchange(other.file, INVALID_HANDLE_VALUE);
+            mapping = std::exchange(other.mapping, nullptr);
+            view = std::exchange(other.view, nullptr);
+            length = std::exchange(other.length, 0);
+        }
+        return *this;
+    }
+
+    std::span<const std::byte> MappedFile::bytes() const {
+        return view == nullptr ? std::span<const std::byte>() : std::span<const std::byte>(view, length);
+    }
+
+    bool MappedFile::isOpen() const {
+        return file != INVALID_HANDLE_VALUE;
+    }
+
+    void MappedFile::close() {
+        if (view != nullptr) {
+            UnmapViewOfFile(view);
+            view = nullptr;
+        }
+        if (mapping != nullptr) {
+            CloseHandle(mapping);
+            mapping = nullptr;
+        }
+        if (file != INVALID_HANDLE_VALUE) {
+            CloseHandle(file);
+            file = INVALID_HANDLE_VALUE;
+        }
+        length = 0;
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <fix.hpp>
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+namespace util {
+    /// @brief Read-only memory mapping of whole file
+    /// @note Pages are loaded by operating system on first access and shared between processes,
+    /// so large read-only data sets (breach corpus, wordlists) cost no startup parsing.
+    class MappedFile {
+    public:
+        /// @brief Constructor of empty mapping
+        MappedFile() = default;
+
+        /// @brief Maps file into memory
+        /// @param path path to file
+        /// @throws std::runtime_error if file cannot be opened or mapped
+        explicit MappedFile(const std::filesystem::path& path);
+
+        /// @brief Destructor, unmaps file
+        ~MappedFile();
+
+        /// @brief Delete copy constructor and assignment operator
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        /// @brief Move constructor and assignment operator
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+
+        /// @brief Gets mapped bytes
+        /// @return view of whole file, empty if nothing is mapped
+        std::span<const std::byte> bytes() const;
+
+        /// @brief Checks if file is mapped
+        /// @return true if file is mapped
+        bool isOpen() const;
+
+    private:
+        HANDLE file = INVALID_HANDLE_VALUE;     // Handle of mapped file
+        HANDLE mapping = nullptr;               // Handle of file mapping object
+        const std::byte* view = nullptr;        // Start of mapped view
+        std::size_t length = 0;                 // Size of mapped view
+
+        /// @brief Unmaps view and closes handles
+        void close();
+    };
+}
@@ -0,0 +1,275 @@
+#include <password-import.hpp>
+#include <vault-archive.hpp>
+#include <crypto.hpp>
+#include <breach-corpus.hpp>
+#include <log.hpp>
+#include <algorithm>
+#include <cctype>
+#include <optional>
+#include <stdexcept>
+#include <format>
+
+namespace pass {
+    nlohmann::json PasswordImporter::Result::toJson() const {
+        return {
+            { "imported", imported },
+            { "skipped", skipped },
+            { "breached", breached }
+        };
+    }
+
+    PasswordImporter::PasswordImporter(const std::uint32_t userId) : userId(userId) {
+        pending.reserve(CHUNK_SIZE);
+    }
+
+    PasswordImporter::Format PasswordImporter::formatFromString(const std::string& name) {
+        std::string lowered(name);
+        std::transform(lowered.begin(), lowered.end(), lowered.begin(), [](unsigned char c) { return std::tolower(c); });
+        if (lowered.empty() || lowered == "json" || lowered == "bitwarden") {
+            return Format::Json;
+        }
+        if (lowered == "csv") {
+            return Format::Csv;
+        }
+        if (lowered == "archive") {
+            return Format::Archive;
+        }
+        throw std::invalid_argument(std::format("Unknown import format: {}", name));
+    }
+
+    PasswordImporter::Result PasswordImporter::import(std::istream& input, Format format) {
+        result = Result();
+        pending.clear();
+
+        switch (format) {
+            case Format::Json:
+                importJson(input);
+                break;
+            case Format::Csv:
+                importCsv(input);
+                break;
+            case Format::Archive: {
+                // Archive holds JSON array, chunks are verified before their entries are parsed
+                auto crypto = CryptoManager::get(userId);
+                VaultArchiveReader reader(input, *crypto);
+                std::istream decrypted(&reader);
+                decrypted.exceptions(std::ios::badbit);
+                importJson(decrypted);
+                break;
+            }
+        }
+        flush();
+
+        Logger::info("Imported {} passwords for user {}, skipped {}", result.imported, userId, result.skipped);
+        return result;
+    }
+
+    void PasswordImporter::importJson(std::istream& input) {
+        // Entries are handled as soon as they are parsed and then dropped from the document,
+        // root array holds entries at depth 1, Bitwarden export keeps them in "items" array at depth 2
+        bool rootIsArray = false;
+        std::string rootKey;
+        auto callback = [&](int depth, nlohmann::json::parse_event_t event, nlohmann::json& parsed) -> bool {
+            if (depth == 0 && event == nlohmann::json::parse_event_t::array_start) {
+                rootIsArray = true;
+            }
+            else if (depth == 1 && event == nlohmann::json::parse_event_t::key) {
+                rootKey = parsed.get<std::string>();
+            }
+            else if (event == nlohmann::json::parse_event_t::object_end || event == nlohmann::json::parse_event_t::value) {
+                bool isEntry = (rootIsArray && depth == 1) || (!rootIsArray && depth == 2 && rootKey == "items");
+                if (isEntry) {
+                    queueJsonEntry(parsed);
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        try {
+            // Only document skeleton without entries is kept
+            nlohmann::json skeleton = nlohmann::json::parse(input, callback);
+        }
+        catch (const nlohmann::json::exception& e) {
+            throw std::runtime_error(std::format("Failed to parse imported JSON: {}", e.what()));
+        }
+    }
+
+    void PasswordImporter::queueJsonEntry(const nlohmann::json& entry) {
+        if (!entry.is_object()) {
+            ++result.skipped;
+            return;
+        }
+
+        try {
+            Password password;
+            password.userId = userId;
+            password.id = 0;
+
+            // Exports often carry nulls instead of empty strings
+            auto text = [](const nlohmann::json& object, const char* key) -> std::string {
+                auto it = object.find(key);
+                return it != object.end() && it->is_string() ? it->get<std::string>() : "";
+            };
+
+            if (entry.contains("login") && entry.at("login").is_object()) {
+                // Bitwarden item, only login items carry passwords
+                const auto& login = entry.at("login");
+                password.name = text(entry, "name");
+                password.notes = text(entry, "notes");
+                password.login = text(login, "username");
+                password.password = text(login, "password");
+                if (login.contains("uris") && login.at("uris").is_array() && !login.at("uris").empty()) {
+                    password.url = text(login.at("uris").front(), "uri");
+                }
+                password.options = Password::Options::fromJson(nlohmann::json::object());
+            }
+            else if (entry.contains("type")) {
+                // Bitwarden card, identity or secure note
+                ++result.skipped;
+                return;
+            }
+            else {
+                password.login = text(entry, "login");
+                password.password = text(entry, "password");
+                password.name = text(entry, "name");
+                password.url = text(entry, "url");
+                password.notes = text(entry, "notes");
+                password.options = Password::Options::fromJson(entry.value("options", nlohmann::json::object()));
+            }
+            queue(std::move(password));
+        }
+        catch (const nlohmann::json::exception& e) {
+            Logger::warn("Skipping malformed imported entry: {}", e.what());
+            ++result.skipped;
+        }
+    }
+
+    void PasswordImporter::importCsv(std::istream& input) {
+        std::vector<std::string> fields;
+        if (!readCsvRecord(input, fields)) {
+            return;
+        }
+
+        // Skip UTF-8 byte order mark written by some exporters
+        if (!fields.empty() && fields.front().starts_with("\xEF\xBB\xBF")) {
+            fields.front().erase(0, 3);
+        }
+
+        // Map header names used by popular password managers to Password fields
+        auto findColumn = [&fields](std::initializer_list<std::string_view> names) -> std::optional<std::size_t> {
+            for (std::size_t i = 0; i < fields.size(); ++i) {
+                std::string header(fields[i]);
+                std::transform(header.begin(), header.end(), header.begin(), [](unsigned char c) { return std::tolower(c); });
+                if (std::find(names.begin(), names.end(), header) != names.end()) {
+                    return i;
+                }
+            }
+            return std::nullopt;
+        };
+        auto nameColumn = findColumn({ "name", "title", "account" });
+        auto urlColumn = findColumn({ "url", "login_uri", "web site", "website", "uri" });
+        auto loginColumn = findColumn({ "username", "login_username", "login name", "login", "user name" });
+        auto passwordColumn = findColumn({ "password", "login_password" });
+        auto notesColumn = findColumn({ "notes", "note", "extra", "comments", "comment" });
+
+        if (!passwordColumn.has_value()) {
+            throw std::runtime_error("Imported CSV has no password column");
+        }
+
+        auto field = [&fields](const std::optional<std::size_t>& column) -> std::string {
+            if (!column.has_value() || column.value() >= fields.size()) {
+                return "";
+            }
+            return std::move(fields[column.value()]);
+        };
+
+        auto defaultOptions = Password::Options::fromJson(nlohmann::json::object());
+        while (readCsvRecord(input, fields)) {
+            if (fields.size() == 1 && fields.front().empty()) {
+                continue;
+            }
+
+            Password password;
+            password.id = 0;
+            password.userId = userId;
+            password.options = defaultOptions;
+            password.name = field(nameColumn);
+            password.url = field(urlColumn);
+            password.login = field(loginColumn);
+            password.password = field(passwordColumn);
+            password.notes = field(notesColumn);
+
+            if (password.password.empty() && password.login.empty()) {
+                ++result.skipped;
+                continue;
+            }
+            if (password.name.empty()) {
+                password.name = password.url;
+            }
+            queue(std::move(password));
+        }
+    }
+
+    bool PasswordImporter::readCsvRecord(std::istream& input, std::vector<std::string>& fields) {
+        fields.clear();
+        if (input.peek() == std::char_traits<char>::eof()) {
+            return false;
+        }
+
+        std::string current;
+        bool quoted = false;
+        char c;
+        while (input.get(c)) {
+            if (quoted) {
+                if (c == '"') {
+                    if (input.peek() == '"') {
+                        current += '"';
+                        input.get();
+                    }
+                    else {
+                        quoted = false;
+                    }
+                }
+                else {
+                    current += c;
+                }
+            }
+            else if (c == '"') {
+                quoted = true;
+            }
+            else if (c == ',') {
+                fields.push_back(std::move(current));
+                current.clear();
+            }
+            else if (c == '\n') {
+                break;
+            }
+            else if (c != '\r') {
+                current += c;
+            }
+        }
+        fields.push_back(std::move(current));
+        return true;
+    }
+
+    void PasswordImporter::queue(Password&& password) {
+        if (BreachChecker::getInstance().isBreached(password.password)) {
+            ++result.breached;
+        }
+        pending.push_back(std::move(password));
+        if (pending.size() >= CHUNK_SIZE) {
+            flush();
+        }
+    }
+
+    void PasswordImporter::flush() {
+        if (pending.empty()) {
+            return;
+        }
+        PasswordCrypto::encryptBatch(pending, userId);
+        manager.addPasswords(pending);
+        result.imported += pending.size();
+        pending.clear();
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <istream>
+#include <nlohmann/json.hpp>
+#include <passwords.hpp>
+
+/// @brief Namespace of password related stuff
+namespace pass {
+    /// @brief Class importing passwords from exports of this and other password managers
+    /// @note Input is consumed as a stream, entries are encrypted in parallel and inserted in batches,
+    /// so memory usage does not depend on size of imported vault. Unlike add and update, entries with breached
+    /// passwords are imported, as they are existing credentials which would be lost otherwise, and only counted.
+    class PasswordImporter {
+    public:
+        /// @brief Supported input formats
+        enum class Format {
+            Json,       ///< JSON array of Password objects or Bitwarden JSON export
+            Csv,        ///< CSV with header row (Chrome, Firefox, LastPass, KeePass, 1Password, Bitwarden)
+            Archive     ///< Encrypted vault archive produced by export
+        };
+
+        /// @brief Summary of import
+        class Result {
+        public:
+            std::size_t imported = 0;   // Number of imported entries
+            std::size_t skipped = 0;    // Number of entries which could not be imported
+            std::size_t breached = 0;   // Number of imported entries whose password appears in known data breach
+
+            /// @brief Function to convert Result object to Json
+            /// @return json object
+            nlohmann::json toJson() const;
+        };
+
+        /// @brief Constructor
+        /// @param userId ID of user owning imported passwords
+        explicit PasswordImporter(const std::uint32_t userId);
+
+        /// @brief Parses format name
+        /// @param name format name ("json", "csv" or "archive")
+        /// @return Format value
+        /// @throws std::invalid_argument on unknown format
+        static Format formatFromString(const std::string& name);
+
+        /// @brief Imports passwords from stream
+        /// @param input stream with exported passwords
+        /// @param format format of input data
+        /// @return summary of import
+        /// @throws std::runtime_error on malformed input, entries flushed before error stay imported
+        Result import(std::istream& input, Format format);
+
+        /// @brief Number of entries encrypted and inserted together, one insert transaction per chunk
+        static constexpr std::size_t CHUNK_SIZE = SQLitePasswordRepository::BATCH_SIZE;
+
+    private:
+        std::uint32_t userId;               // ID of user owning imported passwords
+        std::vector<Password> pending;      // Entries waiting for encryption and insert
+        PasswordManager manager;            // Manager used to store passwords
+        Result result;                      // Summary of current import
+
+        /// @brief Imports JSON array or Bitwarden export
+        /// @param input stream with JSON
+        void importJson(std::istream& input);
+
+        /// @brief Imports CSV with header row
+        /// @param input stream with CSV
+        void importCsv(std::istream& input);
+
+        /// @brief Converts single JSON entry and queues it
+        /// @param entry Password object or Bitwarden item
+        void queueJsonEntry(const nlohmann::json& entry);
+
+        /// @brief Queues password for insertion, flushes when chunk is full
+        /// @param password password with plain secrets
+        void queue(Password&& password);
+
+        /// @brief Encrypts and inserts queued passwords
+        void flush();
+
+        /// @brief Reads single CSV record, supports quoted fields with separators, quotes and new lines
+        /// @param input stream with CSV
+        /// @param fields output fields
+        /// @return false when end of stream was reached
+        static bool readCsvRecord(std::istream& input, std::vector<std::string>& fields);
+    };
+}
@@ -0,0 +1,442 @@
+#include <password-strength.hpp>
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <optional>
+#include <string>
+
+namespace pass {
+    namespace {
+        constexpr double BRUTEFORCE_CARDINALITY = 10;                   // Guesses per character of brute force segment
+        constexpr double MIN_GUESSES_SINGLE_CHAR = 10;                  // Lower bound of guesses of single character match
+        constexpr double MIN_GUESSES_MULTI_CHAR = 50;                   // Lower bound of guesses of longer match
+        constexpr double MIN_GUESSES_BEFORE_GROWING_SEQUENCE = 10000;   // Penalty of every additional match in sequence
+        constexpr double MIN_YEAR_SPACE = 20;                           // Years around reference year treated as equally likely
+        constexpr double KEYBOARD_STARTING_POSITIONS = 47;              // Keys of QWERTY keyboard
+        constexpr double KEYBOARD_AVERAGE_DEGREE = 4.6;                 // Average number of neighbours of key
+
+        /// @brief Key position on QWERTY keyboard, x is shifted by stagger of row
+        struct Key {
+            int row;
+            double x;
+            bool shifted;
+        };
+
+        constexpr std::array<std::string_view, 4> KEYBOARD_ROWS = { "`1234567890-=", "qwertyuiop[]\\", "asdfghjkl;'", "zxcvbnm,./" };
+        constexpr std::array<std::string_view, 4> SHIFTED_ROWS = { "~!@#$%^&*()_+", "QWERTYUIOP{}|", "ASDFGHJKL:\"", "ZXCVBNM<>?" };
+        constexpr std::array<double, 4> ROW_STAGGER = { 0.0, 0.5, 0.75, 1.25 };
+
+        std::optional<Key> keyOf(char c) {
+            for (int row = 0; row < 4; ++row) {
+                if (auto col = KEYBOARD_ROWS[row].find(c); col != std::string_view::npos) {
+                    return Key{ row, static_cast<double>(col) + ROW_STAGGER[row], false };
+                }
+                if (auto col = SHIFTED_ROWS[row].find(c); col != std::string_view::npos) {
+                    return Key{ row, static_cast<double>(col) + ROW_STAGGER[row], true };
+                }
+            }
+            return std::nullopt;
+        }
+
+        bool adjacent(const Key& a, const Key& b) {
+            auto dx = std::abs(a.x - b.x);
+            auto dy = std::abs(a.row - b.row);
+            return (dy == 0 && dx == 1.0) || (dy == 1 && dx <= 0.75);
+        }
+
+        char lower(char c) {
+            return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+
+        /// @brief Reverts common l33t substitution, e.g. '4' -> 'a'
+        char unleet(char c) {
+            switch (c) {
+                case '4': case '@': return 'a';
+                case '3': return 'e';
+                case '1': case '!': return 'i';
+                case '0': return 'o';
+                case '5': case '$': return 's';
+                case '7': case '+': return 't';
+                default: return lower(c);
+            }
+        }
+
+        int referenceYear() {
+            static const int year = static_cast<int>(std::chrono::year_month_day(
+                std::chrono::floor<std::chrono::days>(std::chrono::system_clock::now())).year());
+            return year;
+        }
+
+        double yearGuesses(int year) {
+            return std::max(static_cast<double>(std::abs(year - referenceYear())), MIN_YEAR_SPACE);
+        }
+
+        /// @brief Finds node reached from given node by label
+        /// @return index of node or nullopt if there is no such edge
+        std::optional<std::uint32_t> step(const dictionary::Dictionary& dict, std::uint32_t node, char label) {
+            const auto& n = dict.nodes[node];
+            auto begin = dict.edges.begin() + n.firstEdge;
+            auto end = begin + n.edgeCount;
+            std::uint32_t key = static_cast<std::uint32_t>(static_cast<unsigned char>(label)) << 24;
+            auto it = std::lower_bound(begin, end, key);
+            if (it == end || (*it >> 24) != (key >> 24)) {
+                return std::nullopt;
+            }
+            return *it & 0xFFFFFF;
+        }
+    }
+
+    PasswordStrength::Result PasswordStrength::estimate(std::string_view password) {
+        password = password.substr(0, MAX_LENGTH);
+
+        std::vector<Match> matches;
+        matchDictionaries(password, matches);
+        matchKeyboardWalks(password, matches);
+        matchRepeats(password, matches);
+        matchDates(password, matches);
+
+        Result result;
+        result.guesses = mostGuessableSequence(password, matches);
+        static constexpr double DELTA = 5;
+        result.score = result.guesses < 1e3 + DELTA ? 0
+            : result.guesses < 1e6 + DELTA ? 1
+            : result.guesses < 1e8 + DELTA ? 2
+            : result.guesses < 1e10 + DELTA ? 3
+            : 4;
+        return result;
+    }
+
+    void PasswordStrength::matchDictionaries(std::string_view password, std::vector<Match>& matches) {
+        const std::size_t n = password.size();
+        std::string lowered(n, '\0');
+        std::string unleeted(n, '\0');
+        for (std::size_t i = 0; i < n; ++i) {
+            lowered[i] = lower(password[i]);
+            unleeted[i] = unleet(password[i]);
+        }
+        std::string reversed(lowered.rbegin(), lowered.rend());
+
+        for (const auto& dict : dictionary::DICTIONARIES) {
+            if (dict.nodes.empty()) {
+                continue;
+            }
+
+            // Plain and reversed words
+            for (int variant = 0; variant < 2; ++variant) {
+                const std::string& text = variant == 0 ? lowered : reversed;
+                for (std::size_t i = 0; i < n; ++i) {
+                    std::uint32_t node = 0;
+                    for (std::size_t j = i; j < n; ++j) {
+                        auto next = step(dict, node, text[j]);
+                        if (!next) {
+                            break;
+                        }
+                        node = *next;
+                        if (auto rank = dict.nodes[node].rank; rank != 0) {
+                            std::size_t begin = variant == 0 ? i : n - 1 - j;
+                            std::size_t end = variant == 0 ? j + 1 : n - i;
+                            double guesses = rank * uppercaseVariations(password.substr(begin, end - begin)) * (variant == 0 ? 1 : 2);
+                            matches.push_back({ begin, end, guesses });
+                        }
+                    }
+                }
+            }
+
+            // Words with l33t substitutions, only those which really contain substitution
+            for (std::size_t i = 0; i < n; ++i) {
+                std::uint32_t node = 0;
+                std::size_t substitutions = 0;
+                for (std::size_t j = i; j < n; ++j) {
+                    auto next = step(dict, node, unleeted[j]);
+                    if (!next) {
+                        break;
+                    }
+                    node = *next;
+                    substitutions += unleeted[j] != lowered[j];
+                    if (auto rank = dict.nodes[node].rank; rank != 0 && substitutions > 0) {
+                        // Every substituted character may or may not be substituted
+                        std::size_t letters = 0;
+                        for (std::size_t k = i; k <= j; ++k) {
+                            letters += unleeted[k] != lowered[k] || std::string_view("aeiost").find(lowered[k]) != std::string_view::npos;
+                        }
+                        double leet = 0;
+                        for (std::size_t k = 1; k <= std::min(substitutions, letters - substitutions); ++k) {
+                            leet += binomial(letters, k);
+                        }
+                        leet = std::max(leet, 2.0);
+                        matches.push_back({ i, j + 1, rank * uppercaseVariations(password.substr(i, j + 1 - i)) * leet });
+                    }
+                }
+            }
+        }
+    }
+
+    void PasswordStrength::matchKeyboardWalks(std::string_view password, std::vector<Match>& matches) {
+        const std::size_t n = password.size();
+        std::size_t i = 0;
+        while (i + 2 < n) {
+            auto previous = keyOf(password[i]);
+            std::size_t j = i + 1;
+            std::size_t turns = 0;
+            std::size_t shifted = previous && previous->shifted;
+            std::optional<std::pair<int, bool>> direction;
+            while (previous && j < n) {
+                auto key = keyOf(password[j]);
+                if (!key || !adjacent(*previous, *key)) {
+                    break;
+                }
+                std::pair<int, bool> current{ key->row - previous->row, key->x > previous->x };
+                turns += !direction || *direction != current;
+                direction = current;
+                shifted += key->shifted;
+                previous = key;
+                ++j;
+            }
+
+            std::size_t length = j - i;
+            if (length >= 3) {
+                double guesses = 0;
+                for (std::size_t l = 2; l <= length; ++l) {
+                    for (std::size_t t = 1; t <= std::min(turns, l - 1); ++t) {
+                        guesses += binomial(l - 1, t - 1) * KEYBOARD_STARTING_POSITIONS * std::pow(KEYBOARD_AVERAGE_DEGREE, static_cast<double>(t));
+                    }
+                }
+                std::size_t unshifted = length - shifted;
+                if (shifted > 0 && unshifted == 0) {
+                    guesses *= 2;
+                }
+                else if (shifted > 0) {
+                    double variations = 0;
+                    for (std::size_t k = 1; k <= std::min(shifted, unshifted); ++k) {
+                        variations += binomial(length, k);
+                    }
+                    guesses *= variations;
+                }
+                matches.push_back({ i, j, guesses });
+                i = j - 1;
+            }
+            else {
+                ++i;
+            }
+        }
+    }
+
+    void PasswordStrength::matchRepeats(std::string_view password, std::vector<Match>& matches) {
+        const std::size_t n = password.size();
+        std::size_t i = 0;
+        while (i < n) {
+            std::size_t bestUnit = 0;
+            std::size_t bestCount = 0;
+            for (std::size_t unit = 1; i + 2 * unit <= n; ++unit) {
+                std::size_t count = 1;
+                while (i + (count + 1) * unit <= n && password.substr(i + count * unit, unit) == password.substr(i, unit)) {
+                    ++count;
+                }
+                bool repeated = count >= 2 && (unit > 1 || count >= 3);
+                if (repeated && unit * count > bestUnit * bestCount) {
+                    bestUnit = unit;
+                    bestCount = count;
+                }
+            }
+
+            if (bestCount == 0) {
+                ++i;
+                continue;
+            }
+            double base = estimate(password.substr(i, bestUnit)).guesses;
+            matches.push_back({ i, i + bestUnit * bestCount, base * static_cast<double>(bestCount) });
+            i += bestUnit * bestCount;
+        }
+    }
+
+    void PasswordStrength::matchDates(std::string_view password, std::vector<Match>& matches) {
+        const std::size_t n = password.size();
+        auto validDate = [](int day, int month, int year) {
+            return month >= 1 && month <= 12 && day >= 1 && day <= 31 && year >= 1000 && year <= 2050;
+        };
+        auto fullYear = [](int year, std::size_t digits) {
+            return digits == 2 ? (year > 50 ? 1900 + year : 2000 + year) : year;
+        };
+
+        for (std::size_t i = 0; i < n; ++i) {
+            for (std::size_t length = 4; length <= 10 && i + length <= n; ++length) {
+                auto text = password.substr(i, length);
+
+                // Split into three numeric parts, separators have to be same
+                std::vector<std::string_view> parts;
+                char separator = 0;
+                bool valid = true;
+                std::size_t partBegin = 0;
+                for (std::size_t k = 0; k <= length && valid; ++k) {
+                    if (k < length && std::isdigit(static_cast<unsigned char>(text[k]))) {
+                        continue;
+                    }
+                    if (k < length) {
+                        valid = std::string_view("/-._ ").find(text[k]) != std::string_view::npos && (separator == 0 || separator == text[k]);
+                        separator = text[k];
+                    }
+                    parts.push_back(text.substr(partBegin, k - partBegin));
+                    valid = valid && !parts.back().empty();
+                    partBegin = k + 1;
+                }
+                if (!valid) {
+                    continue;
+                }
+
+                // Year alone
+                if (parts.size() == 1 && length == 4) {
+                    int year = std::stoi(std::string(text));
+                    if (year >= 1900 && year <= 2049) {
+                        matches.push_back({ i, i + length, yearGuesses(year) });
+                    }
+                }
+
+                // Candidate splits of digits without separators
+                std::vector<std::array<std::string_view, 3>> splits;
+                if (parts.size() == 3) {
+                    splits.push_back({ parts[0], parts[1], parts[2] });
+                }
+                else if (parts.size() == 1 && length <= 8) {
+                    for (std::size_t a = 1; a < length - 1; ++a) {
+                        for (std::size_t b = a + 1; b < length; ++b) {
+                            splits.push_back({ text.substr(0, a), text.substr(a, b - a), text.substr(b) });
+                        }
+                    }
+                }
+
+                std::optional<int> best;
+                for (const auto& split : splits) {
+                    if (split[0].size() > 4 || split[1].size() > 2 || split[2].size() > 4) {
+                        continue;
+                    }
+                    int first = std::stoi(std::string(split[0]));
+                    int second = std::stoi(std::string(split[1]));
+                    int third = std::stoi(std::string(split[2]));
+                    std::optional<int> year;
+                    if ((split[0].size() == 2 || split[0].size() == 4) && split[2].size() <= 2) {
+                        int y = fullYear(first, split[0].size());
+                        if (validDate(third, second, y) || validDate(second, third, y)) {
+                            year = y;
+                        }
+                    }
+                    if ((split[2].size() == 2 || split[2].size() == 4) && split[0].size() <= 2) {
+                        int y = fullYear(third, split[2].size());
+                        if (validDate(first, second, y) || validDate(second, first, y)) {
+                            year = year ? *year : y;
+                        }
+                    }
+                    if (year && (!best || std::abs(*year - referenceYear()) < std::abs(*best - referenceYear()))) {
+                        best = year;
+                    }
+                }
+                if (best) {
+                    matches.push_back({ i, i + length, 365 * yearGuesses(*best) * (separator != 0 ? 4 : 1) });
+                }
+            }
+        }
+    }
+
+    double PasswordStrength::mostGuessableSequence(std::string_view password, const std::vector<Match>& matches) {
+        const std::size_t n = std::min(password.size(), MAX_LENGTH);
+        if (n == 0) {
+            return 1;
+        }
+
+        // product[e * stride + l] is product of guesses of best sequence of l matches covering first e characters
+        constexpr double INF = std::numeric_limits<double>::infinity();
+        const std::size_t stride = n + 1;
+        std::vector<double> product(stride * stride, INF);
+        std::vector<double> total(stride * stride, INF);
+        std::vector<std::vector<Match>> byEnd(n + 1);
+        for (const auto& match : matches) {
+            if (match.end > n) {
+                continue;
+            }
+            double minimum = match.end - match.begin == 1 ? MIN_GUESSES_SINGLE_CHAR : MIN_GUESSES_MULTI_CHAR;
+            byEnd[match.end].push_back({ match.begin, match.end, std::max(match.guesses, minimum) });
+        }
+
+        // Powers used by formulas, computed once instead of in inner loop
+        std::vector<double> bruteforce(n + 1, 1);
+        std::vector<double> factorials(n + 1, 1);
+        std::vector<double> penalties(n + 1, 1);
+        for (std::size_t l = 1; l <= n; ++l) {
+            bruteforce[l] = bruteforce[l - 1] * BRUTEFORCE_CARDINALITY;
+            factorials[l] = factorials[l - 1] * static_cast<double>(l);
+            penalties[l] = penalties[l - 1] * MIN_GUESSES_BEFORE_GROWING_SEQUENCE;
+        }
+
+        for (std::size_t begin = 0; begin < n; ++begin) {
+            for (std::size_t end = begin + 1; end <= n; ++end) {
+                double minimum = end - begin == 1 ? MIN_GUESSES_SINGLE_CHAR + 1 : MIN_GUESSES_MULTI_CHAR + 1;
+                byEnd[end].push_back({ begin, end, std::max(bruteforce[end - begin], minimum) });
+            }
+        }
+
+        // Longest sequence ending at each position, shorter ones are only checked
+        std::vector<std::size_t> longest(n + 1, 0);
+
+        for (std::size_t end = 1; end <= n; ++end) {
+            for (const auto& match : byEnd[end]) {
+                if (match.begin == 0) {
+                    if (match.guesses + 1 < total[end * stride + 1]) {
+                        product[end * stride + 1] = match.guesses;
+                        total[end * stride + 1] = match.guesses + 1;
+                        longest[end] = std::max<std::size_t>(longest[end], 1);
+                    }
+                    continue;
+                }
+                for (std::size_t l = 1; l <= longest[match.begin]; ++l) {
+                    if (product[match.begin * stride + l] == INF) {
+                        continue;
+                    }
+                    double p = product[match.begin * stride + l] * match.guesses;
+                    double g = factorials[l + 1] * p + penalties[l];
+                    if (g < total[end * stride + l + 1]) {
+                        product[end * stride + l + 1] = p;
+                        total[end * stride + l + 1] = g;
+                        longest[end] = std::max(longest[end], l + 1);
+                    }
+                }
+            }
+        }
+        return *std::min_element(total.begin() + n * stride, total.end());
+    }
+
+    double PasswordStrength::uppercaseVariations(std::string_view word) {
+        std::size_t upper = 0;
+        std::size_t lowerCount = 0;
+        for (char c : word) {
+            upper += std::isupper(static_cast<unsigned char>(c)) != 0;
+            lowerCount += std::islower(static_cast<unsigned char>(c)) != 0;
+        }
+        if (upper == 0) {
+            return 1;
+        }
+        // Common capitalizations: first letter, last letter, all letters
+        bool firstOnly = upper == 1 && std::isupper(static_cast<unsigned char>(word.front()));
+        bool lastOnly = upper == 1 && std::isupper(static_cast<unsigned char>(word.back()));
+        if (firstOnly || lastOnly || lowerCount == 0) {
+            return 2;
+        }
+        double variations = 0;
+        for (std::size_t k = 1; k <= std::min(upper, lowerCount); ++k) {
+            variations += binomial(upper + lowerCount, k);
+        }
+        return variations;
+    }
+
+    double PasswordStrength::binomial(std::size_t n, std::size_t k) {
+        if (k > n) {
+            return 0;
+        }
+        double result = 1;
+        for (std::size_t i = 1; i <= k; ++i) {
+            result = result * static_cast<double>(n - k + i) / static_cast<double>(i);
+        }
+        return result;
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+/// @brief Namespace of password related stuff
+namespace pass {
+    /// @brief Dictionaries compiled into binary by dictionary-compiler
+    namespace dictionary {
+        /// @brief Node of trie, edges of node are contiguous and sorted by label
+        struct TrieNode {
+            std::uint32_t firstEdge;    // Index of first edge
+            std::uint32_t rank;         // Frequency rank of word ending at node, 0 if no word ends here
+            std::uint32_t edgeCount;    // Number of edges
+        };
+
+        /// @brief Compiled wordlist
+        struct Dictionary {
+            std::string_view name;                  // Name of wordlist
+            std::span<const TrieNode> nodes;        // Nodes, root is first
+            std::span<const std::uint32_t> edges;   // Edges, label in highest 8 bits and target node in lowest 24 bits
+        };
+
+        /// @brief All compiled wordlists, defined in generated source
+        extern const std::span<const Dictionary> DICTIONARIES;
+    }
+
+    /// @brief Password strength estimator in style of zxcvbn
+    /// @note Password is covered by dictionary words (also reversed and with l33t substitutions), keyboard walks,
+    /// repeats, dates and brute force segments. Sequence with fewest guesses gives final estimate.
+    class PasswordStrength {
+    public:
+        /// @brief Result of estimation
+        struct Result {
+            double guesses;     // Estimated number of guesses needed by attacker
+            int score;          // Score from 0 (too guessable) to 4 (very unguessable)
+        };
+
+        /// @brief Estimates strength of password
+        /// @param password plaintext password
+        /// @return estimate
+        static Result estimate(std::string_view password);
+
+        static constexpr std::size_t MAX_LENGTH = 64;      // Longer passwords are scored by their beginning, bounds O(n^3) search of best sequence
+
+    private:
+        /// @brief Part of password matched by single pattern
+        struct Match {
+            std::size_t begin;  // Index of first character
+            std::size_t end;    // Index after last character
+            double guesses;     // Guesses needed for this part
+        };
+
+        /// @brief Finds words of compiled dictionaries
+        static void matchDictionaries(std::string_view password, std::vector<Match>& matches);
+
+        /// @brief Finds walks on QWERTY keyboard
+        static void matchKeyboardWalks(std::string_view password, std::vector<Match>& matches);
+
+        /// @brief Finds repeated characters and substrings
+        static void matchRepeats(std::string_view password, std::vector<Match>& matches);
+
+        /// @brief Finds dates and years
+        static void matchDates(std::string_view password, std::vector<Match>& matches);
+
+        /// @brief Finds sequence of matches with fewest guesses
+        /// @note Brute force segments are O(n^2) and search over them O(n^3), so at most MAX_LENGTH characters are used
+        /// @param password password
+        /// @param matches matches found in password
+        /// @return guesses of best sequence
+        static double mostGuessableSequence(std::string_view password, const std::vector<Match>& matches);
+
+        /// @brief Number of ways to capitalize word as in password
+        static double uppercaseVariations(std::string_view word);
+
+        /// @brief Binomial coefficient
+        static double binomial(std::size_t n, std::size_t k);
+    };
+}
@@ -1,15 +1,34 @@
 // src/passwords.hpp
 
 #include <passwords.hpp>
+#include <vault-cache.hpp>
+#include <write-queue.hpp>
 #include <utilities.hpp>
 #include <database-manager.hpp>
+#include <change-events.hpp>
 #include <tuple>
-#include <random>
+#include <thread>
+#include <map>
+#include <atomic>
+#include <exception>
+#include <format>
+#include <algorithm>
 #include "crypto.hpp"
+#include <blind-index.hpp>
+#include <breach-corpus.hpp>
+#include <password-strength.hpp>
+#include <wordlist.hpp>
+#include <secure-arena.hpp>
+#include <request-trace.hpp>
+#include <encryption-pool.hpp>
+#include <cctype>
+#include <cmath>
+#include <cryptopp/osrng.h>
 
 namespace pass {
     nlohmann::json Password::Options::toJson() const {
         return {
+            { "mode", mode == Mode::Passphrase ? "passphrase" : "characters" },
             { "minimalLength", minimalLength },
             { "includeUppercase", includeUppercase },
             { "includeLowercase", includeLowercase },
@@ -19,7 +38,11 @@ namespace pass {
             { "lowercaseMinimalNumber", lowercaseMinimalNumber },
             { "digitsMinimalNumber", digitsMinimalNumber },
             { "specialCharactersMinimalNumber", specialCharactersMinimalNumber },
-            { "forbiddenCharacters", forbiddenCharacters }
+            { "forbiddenCharacters", forbiddenCharacters },
+            { "wordCount", wordCount },
+            { "wordSeparator", wordSeparator },
+            { "capitalizeWords", capitalizeWords },
+            { "includeNumber", includeNumber }
         };
     }
 
@@ -35,6 +58,18 @@ namespace pass {
         opt.digitsMinimalNumber = options.value("digitsMinimalNumber", 1);
         opt.specialCharactersMinimalNumber = options.value("specialCharactersMinimalNumber", 1);
         opt.forbiddenCharacters = options.value("forbiddenCharacters", "");
+
+        auto mode = options.value("mode", "characters");
+        if (mode == "passphrase") {
+            opt.mode = Mode::Passphrase;
+        }
+        else if (mode != "characters") {
+            throw std::invalid_argument(std::format("Unknown password generation mode: {}", mode));
+        }
+        opt.wordCount = options.value("wordCount", 6);
+        opt.wordSeparator = options.value("wordSeparator", "-");
+        opt.capitalizeWords = options.value("capitalizeWords", false);
+        opt.includeNumber = options.value("includeNumber", false);
         return opt;
     }
 
@@ -49,7 +84,9 @@ namespace pass {
             { "notes", notes },
             { "options", options.toJson() },
             { "createdAt", util::time::toString(createdAt) },
-            { "updatedAt", util::time::toString(updatedAt) }
+            { "updatedAt", util::time::toString(updatedAt) },
+            { "version", version },
+            { "strength", strength }
         };
     }
   
@@ -63,6 +100,7 @@ namespace pass {
         pass.url = password.at("url").get<std::string>();
         pass.notes = password.at("notes").get<std::string>();
         pass.options = Password::Options::fromJson(password.at("options"));
+        pass.version = password.value("version", 0);
         try {
             pass.createdAt = util::time::fromString(password.at("createdAt").get<std::string>());
         }
@@ -78,20 +116,130 @@ namespace pass {
         return pass;
     }
 
-    SQLitePasswordRepository::SQLitePasswordRepository() {
+    void PasswordRow::appendJson(util::SecureString& output) const {
+        // Options are parsed so rows stored before new options were added get their defaults,
+        // entries of a vault mostly share options, so last stored text is parsed only once
+        thread_local std::string storedOptions;
+        thread_local std::string normalizedOptions;
+        if (normalizedOptions.empty() || storedOptions != options) {
+            normalizedOptions = Password::Options::fromJson(nlohmann::json::parse(options)).toJson().dump();
+            storedOptions = options;
+        }
+
+        auto field = [&output](std::string_view key, std::string_view text) {
+            output += ",\"";
+            output += key;
+            output += "\":";
+            util::appendJsonString(output, text);
+        };
+        output += "{\"id\":";
+        output += std::to_string(id);
+        output += ",\"userId\":";
+        output += std::to_string(userId);
+        field("login", login);
+        field("password", password);
+        field("name", name);
+        field("url", url);
+        field("notes", notes);
+        output += ",\"options\":";
+        output += normalizedOptions;
+        field("createdAt", createdAt);
+        field("updatedAt", updatedAt);
+        output += ",\"version\":";
+        output += std::to_string(version);
+        output += ",\"strength\":";
+        output += std::to_string(strength);
+        output += '}';
+    }
+
+    void PasswordRow::appendJson(const PasswordBatch& rows, util::SecureString& output) {
+        std::size_t bytes = 2;
+        for (const auto& row : rows) {
+            bytes += row.login.size() + row.password.size() + row.name.size() + row.url.size() + row.notes.size() + 512;
+        }
+        output.reserve(output.size() + bytes);
+
+        output += '[';
+        for (std::size_t i = 0; i < rows.size(); ++i) {
+            if (i > 0) {
+                output += ',';
+            }
+            rows[i].appendJson(output);
+        }
+        output += ']';
+    }
+
+    Password::~Password() {
+        wipeSecrets();
+    }
+
+    void Password::wipeSecrets() {
+        util::wipe(login);
+        util::wipe(password);
+        util::wipe(name);
+        util::wipe(url);
+        util::wipe(notes);
+    }
+
+    PasswordMutation PasswordMutation::fromJson(const nlohmann::json& mutation) {
         try {
-            // Open or create database
-            db = DatabaseManager::getInstance().getDatabase();
+            PasswordMutation m;
+            auto op = mutation.at("op").get<std::string>();
+            if (op == "add") {
+                m.type = Type::Add;
+                m.password = Password::fromJson(mutation.at("password"));
+            }
+            else if (op == "update") {
+                m.type = Type::Update;
+                m.password = Password::fromJson(mutation.at("password"));
+            }
+            else if (op == "delete") {
+                m.type = Type::Remove;
+                m.password.id = mutation.contains("id") ? mutation.at("id").get<std::uint32_t>() 
+                                                        : mutation.at("password").at("id").get<std::uint32_t>();
+            }
+            else {
+                throw std::invalid_argument("Unknown operation: " + op);
+            }
+            return m;
+        }
+        catch (const nlohmann::json::exception& e) {
+            throw std::invalid_argument("Invalid operation: " + std::string(e.what()));
+        }
+    }
+
+    std::string PasswordMutation::typeToString(Type type) {
+        switch (type) {
+            case Type::Add:
+                return "add";
+            case Type::Update:
+                return "update";
+            case Type::Remove:
+                return "delete";
+        }
+        return "unknown";
+    }
+
+    nlohmann::json PasswordMutationResult::toJson() const {
+        return {
+            { "op", PasswordMutation::typeToString(type) },
+            { "id", id },
+            { "applied", applied }
+        };
+    }
 
-            initializeDatabase();
+    SQLitePasswordRepository::SQLitePasswordRepository() {
+        try {
+            // Per-user tables live in shards, in None mode the only shard is main database
+            DatabaseManager::getInstance().setShardInitializer(&SQLitePasswordRepository::initializeDatabase);
         }
         catch (const SQLite::Exception& e) {
             throw std::runtime_error("Failed to open database: " + std::string(e.what()));
         }
     }
 
-    void SQLitePasswordRepository::initializeDatabase() {
-        db->exec(R"(
+    void SQLitePasswordRepository::initializeDatabase(SQLite::Database& db) {
+        db.exec(R"(
             CREATE TABLE IF NOT EXISTS passwords (
                 id INTEGER PRIMARY KEY AUTOINCREMENT,
                 userId INTEGER NOT NULL,
@@ -101,10 +249,129 @@ namespace pass {
                 url TEXT,
                 notes TEXT,
                 options TEXT,
+                fingerprint TEXT,
+                strength INTEGER,
                 createdAt TEXT NOT NULL,
-                updatedAt TEXT NOT NULL
+                updatedAt TEXT NOT NULL,
+                version INTEGER NOT NULL DEFAULT 0,
+                deleted INTEGER NOT NULL DEFAULT 0
+            )
+        )");
+        addColumnIfMissing(db, "passwords", "version", "INTEGER NOT NULL DEFAULT 0");
+        addColumnIfMissing(db, "passwords", "deleted", "INTEGER NOT NULL DEFAULT 0");
+        addColumnIfMissing(db, "passwords", "fingerprint", "TEXT");
+        addColumnIfMissing(db, "passwords", "strength", "INTEGER");
+        addColumnIfMissing(db, "passwords", "record", "BLOB");
+        db.exec("CREATE INDEX IF NOT EXISTS passwords_user_version ON passwords (userId, version)");
+        db.exec("CREATE INDEX IF NOT EXISTS passwords_user_fingerprint ON passwords (userId, fingerprint)");
+        db.exec("CREATE INDEX IF NOT EXISTS passwords_user_strength ON passwords (userId, strength)");
+
+        db.exec(R"(
+            CREATE TABLE IF NOT EXISTS vault_versions (
+                userId INTEGER PRIMARY KEY,
+                version INTEGER NOT NULL,
+                purgedVersion INTEGER NOT NULL DEFAULT 0
             )
         )");
+        addColumnIfMissing(db, "vault_versions", "purgedVersion", "INTEGER NOT NULL DEFAULT 0");
+
+        db.exec(R"(
+            CREATE TABLE IF NOT EXISTS password_tokens (
+                passwordId INTEGER NOT NULL,
+                userId INTEGER NOT NULL,
+                token INTEGER NOT NULL
+            )
+        )");
+        db.exec("CREATE INDEX IF NOT EXISTS password_tokens_user_token ON password_tokens (userId, token)");
+        db.exec("CREATE INDEX IF NOT EXISTS password_tokens_password ON password_tokens (passwordId)");
+    }
+
+    void SQLitePasswordRepository::addColumnIfMissing(SQLite::Database& db, const std::string& table, const std::string& column, const std::string& definition) {
+        SQLite::Statement query(db, "SELECT COUNT(*) FROM pragma_table_info(?) WHERE name = ?");
+        query.bind(1, table);
+        query.bind(2, column);
+        if (query.executeStep() && query.getColumn(0).getInt() == 0) {
+            db.exec("ALTER TABLE " + table + " ADD COLUMN " + column + " " + definition);
+        }
+    }
+
+    std::size_t SQLitePasswordRepository::migrateToShards() {
+        auto& manager = DatabaseManager::getInstance();
+        if (manager.getShardSettings().mode == DatabaseManager::ShardMode::None) {
+            return 0;
+        }
+
+        // Users of main database are read first, rows are then moved by shard connection with main database attached
+        std::vector<std::uint32_t> users;
+        std::string columns;
+        std::string versionColumns;
+        std::string path;
+        {
+            std::lock_guard<std::mutex> lock(manager.getMutex());
+            auto db = manager.getDatabase();
+            if (!db->tableExists("passwords")) {
+                return 0;
+            }
+            SQLite::Statement query(*db, "SELECT DISTINCT userId FROM passwords");
+            while (query.executeStep()) {
+                users.push_back(query.getColumn(0).getUInt());
+            }
+            SQLite::Statement names(*db, "SELECT name FROM pragma_table_info('passwords')");
+            while (names.executeStep()) {
+                columns += (columns.empty() ? "" : ", ") + names.getColumn(0).getString();
+            }
+
+            // Main database of older version may not know purged versions yet
+            SQLite::Statement versionNames(*db, "SELECT name FROM pragma_table_info('vault_versions')");
+            while (versionNames.executeStep()) {
+                versionColumns += (versionColumns.empty() ? "" : ", ") + versionNames.getColumn(0).getString();
+            }
+            path = db->getFilename();
+        }
+
+        for (auto userId : users) {
+            auto lease = manager.shard(userId);
+            auto& db = lease.database();
+            SQLite::Statement attach(db, "ATTACH DATABASE ? AS main_database");
+            attach.bind(1, path);
+            attach.exec();
+            try {
+                SQLite::Transaction transaction(db);
+                for (const auto& sql : {
+                    "INSERT INTO passwords (" + columns + ") SELECT " + columns + " FROM main_database.passwords WHERE userId = ?",
+                    std::string("INSERT INTO password_tokens (passwordId, userId, token) SELECT passwordId, userId, token FROM main_database.password_tokens WHERE userId = ?"),
+                    "INSERT OR REPLACE INTO vault_versions (" + versionColumns + ") SELECT " + versionColumns + " FROM main_database.vault_versions WHERE userId = ?",
+                    std::string("DELETE FROM main_database.password_tokens WHERE userId = ?"),
+                    std::string("DELETE FROM main_database.passwords WHERE userId = ?"),
+                    std::string("DELETE FROM main_database.vault_versions WHERE userId = ?") }) {
+                    SQLite::Statement query(db, sql);
+                    query.bind(1, static_cast<int64_t>(userId));
+                    query.exec();
+                }
+                transaction.commit();
+            }
+            catch (...) {
+                db.exec("DETACH DATABASE main_database");
+                throw;
+            }
+            db.exec("DETACH DATABASE main_database");
+        }
+        return users.size();
+    }
+
+    std::int64_t SQLitePasswordRepository::nextVersion(DatabaseManager::Lease& lease, const std::uint32_t userId) {
+        auto& increment = lease.statement(
+            "INSERT INTO vault_versions (userId, version) VALUES (?, 1) "
+            "ON CONFLICT (userId) DO UPDATE SET version = version + 1");
+        increment.bind(1, static_cast<int64_t>(userId));
+        increment.exec();
+
+        auto& query = lease.statement(VERSION_QUERY);
+        query.bind(1, static_cast<int64_t>(userId));
+        query.executeStep();
+        auto version = query.getColumn(0).getInt64();
+        query.reset();
+        return version;
     }
 
     SQLitePasswordRepository& SQLitePasswordRepository::getInstance() {
@@ -112,135 +379,811 @@ namespace pass {
         return instance;
     }
 
-    std::list<Password> SQLitePasswordRepository::getAll() {
-        std::lock_guard<std::mutex> lock(DatabaseManager::getInstance().getMutex());
-        std::list<Password> passwords;
+    Password SQLitePasswordRepository::readRow(const SQLite::Statement& query) {
+        Password p;
+        p.id = query.getColumn("id").getUInt();
+        p.userId = query.getColumn("userId").getUInt();
+        p.login = query.getColumn("login").getString();
+        p.password = query.getColumn("password").getString();
+        p.name = query.getColumn("name").getString();
+        p.url = query.getColumn("url").getString();
+        p.notes = query.getColumn("notes").getString();
+        p.options = Password::Options::fromJson(nlohmann::json::parse(query.getColumn("options").getString()));
+        p.createdAt = util::time::fromString(query.getColumn("createdAt").getString());
+        p.updatedAt = util::time::fromString(query.getColumn("updatedAt").getString());
+        p.version = query.getColumn("version").getInt64();
+        p.fingerprint = query.getColumn("fingerprint").getString();
+        p.record = query.getColumn("record").getString();
+        p.strength = query.getColumn("strength").isNull() ? -1 : query.getColumn("strength").getInt();
+        return p;
+    }
+
+    void SQLitePasswordRepository::readRow(const SQLite::Statement& query, PasswordBatch& batch) {
+        auto text = [&query, &batch](const char* column) {
+            auto value = query.getColumn(column);
+            auto data = static_cast<const char*>(value.getBlob());
+            return batch.store(std::string_view(data, static_cast<std::size_t>(value.getBytes())));
+        };
+
+        PasswordRow row;
+        row.id = query.getColumn("id").getUInt();
+        row.userId = query.getColumn("userId").getUInt();
+        row.login = text("login");
+        row.password = text("password");
+        row.name = text("name");
+        row.url = text("url");
+        row.notes = text("notes");
+        row.record = text("record");
+        row.options = text("options");
+        row.createdAt = text("createdAt");
+        row.updatedAt = text("updatedAt");
+        row.version = query.getColumn("version").getInt64();
+        row.strength = query.getColumn("strength").isNull() ? -1 : query.getColumn("strength").getInt();
+        batch.add() = row;
+    }
+
+    void SQLitePasswordRepository::bindColumns(SQLite::Statement& query, const Password& password) {
+        // Encrypted fields are binary envelopes, stored as BLOB
+        auto bindBlob = [&query](const char* name, const std::string& value) {
+            query.bind(name, value.data(), static_cast<int>(value.size()));
+        };
+        bindBlob(":login", password.login);
+        query.bind(":userId", password.userId);
+        bindBlob(":password", password.password);
+        bindBlob(":name", password.name);
+        bindBlob(":url", password.url);
+        bindBlob(":notes", password.notes);
+        query.bind(":options", password.options.toJson().dump());
+        if (password.fingerprint.empty()) {
+            query.bind(":fingerprint");
+        }
+        else {
+            query.bind(":fingerprint", password.fingerprint);
+        }
+        if (password.strength < 0) {
+            query.bind(":strength");
+        }
+        else {
+            query.bind(":strength", password.strength);
+        }
+        if (password.record.empty()) {
+            query.bind(":record");
+        }
+        else {
+            bindBlob(":record", password.record);
+        }
+    }
+
+    void SQLitePasswordRepository::writeSearchTokens(SQLite::Statement& removeTokens, SQLite::Statement& insertTokens, const Password& password) {
+        removeTokens.bind(1, static_cast<int64_t>(password.id));
+        removeTokens.exec();
+        removeTokens.reset();
+
+        for (auto token : password.searchTokens) {
+            insertTokens.bind(1, static_cast<int64_t>(password.id));
+            insertTokens.bind(2, static_cast<int64_t>(password.userId));
+            insertTokens.bind(3, token);
+            insertTokens.exec();
+            insertTokens.reset();
+        }
+    }
+
+    PasswordBatch SQLitePasswordRepository::getAll(const std::uint32_t userId) {
+        auto lease = DatabaseManager::getInstance().shard(userId);
+        timing::ScopedStage stage("db.query");
+        PasswordBatch passwords;
         
-        SQLite::Statement query(*db, "SELECT * FROM passwords");
+        auto& query = lease.statement("SELECT * FROM passwords WHERE userId = ? AND deleted = 0");
+        query.bind(1, static_cast<int64_t>(userId));
         while (query.executeStep()) {
-            Password p;
-            p.id = query.getColumn("id").getUInt();
-            p.userId = query.getColumn("userId").getUInt();
-            p.login = query.getColumn("login").getString();
-            p.password = query.getColumn("password").getString();
-            p.name = query.getColumn("name").getString();
-            p.url = query.getColumn("url").getString();
-            p.notes = query.getColumn("notes").getString();
-            p.options = Password::Options::fromJson(nlohmann::json::parse(query.getColumn("options").getString()));
-            p.createdAt = util::time::fromString(query.getColumn("createdAt").getString());
-            p.updatedAt = util::time::fromString(query.getColumn("updatedAt").getString());
-            passwords.push_back(p);
+            readRow(query, passwords);
         }
         
         return passwords;
     }
 
-    std::optional<Password> SQLitePasswordRepository::getById(const std::uint32_t& id) {
-        std::lock_guard<std::mutex> lock(DatabaseManager::getInstance().getMutex());
+    void SQLitePasswordRepository::forEachOfUser(const std::uint32_t userId, const std::function<void(const Password&)>& visitor) {
+        // Keyset pagination, lock is released between pages so visitor may be slow (e.g. network bound)
+        std::vector<Password> page;
+        std::uint32_t lastId = 0;
         
-        SQLite::Statement query(*db, "SELECT * FROM passwords WHERE id = ?");
+        do {
+            page = getPage(userId, lastId, PAGE_SIZE);
+            for (const auto& password : page) {
+                visitor(password);
+                lastId = password.id;
+            }
+        } while (page.size() == PAGE_SIZE);
+    }
+
+    std::vector<Password> SQLitePasswordRepository::getPage(const std::uint32_t userId, const std::uint32_t afterId, const std::size_t limit) {
+        std::vector<Password> page;
+        page.reserve(limit);
+
+        auto lease = DatabaseManager::getInstance().shard(userId);
+        timing::ScopedStage stage("db.query");
+        auto& query = lease.statement("SELECT * FROM passwords WHERE userId = ? AND id > ? AND deleted = 0 ORDER BY id LIMIT ?");
+        query.bind(1, static_cast<int64_t>(userId));
+        query.bind(2, static_cast<int64_t>(afterId));
+        query.bind(3, static_cast<int64_t>(limit));
+        while (query.executeStep()) {
+            page.push_back(readRow(query));
+        }
+        return page;
+    }
+
+    std::optional<Password> SQLitePasswordRepository::getById(const std::uint32_t userId, const std::uint32_t& id) {
+        auto lease = DatabaseManager::getInstance().shard(userId);
+        timing::ScopedStage stage("db.query");
+        
+        auto& query = lease.statement("SELECT * FROM passwords WHERE id = ? AND userId = ? AND deleted = 0");
         query.bind(1, static_cast<int64_t>(id));
+        query.bind(2, static_cast<int64_t>(userId));
         
         if (query.executeStep()) {
-            Password p;
-            p.id = query.getColumn("id").getUInt();
-            p.userId = query.getColumn("userId").getUInt();
-            p.login = query.getColumn("login").getString();
-            p.password = query.getColumn("password").getString();
-            p.name = query.getColumn("name").getString();
-            p.url = query.getColumn("url").getString();
-            p.notes = query.getColumn("notes").getString();
-            p.options = Password::Options::fromJson(nlohmann::json::parse(query.getColumn("options").getString()));
-            p.createdAt = util::time::fromString(query.getColumn("createdAt").getString());
-            p.updatedAt = util::time::fromString(query.getColumn("updatedAt").getString());
-            
-            return p;
+            return readRow(query);
         }
         
         return std::nullopt;
     }
 
     void SQLitePasswordRepository::add(Password& password) {
-        std::lock_guard<std::mutex> lock(DatabaseManager::getInstance().getMutex());
-        
-        SQLite::Statement query(*db, 
-            "INSERT INTO passwords (login, userId, password, name, url, notes, options, createdAt, updatedAt) "
-            "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)");
+        // Queue commits writes of concurrent requests together, it returns false when not running
+        if (WriteQueue::getInstance().add(password)) {
+            return;
+        }
+
+        auto lease = DatabaseManager::getInstance().shard(password.userId);
+        SQLite::Transaction transaction(lease.database());
+        applyAdd(lease, password);
+        transaction.commit();
+        events::ChangeNotifier::getInstance().publish(password.userId, password.version);
+    }
+
+    std::int64_t SQLitePasswordRepository::applyAdd(DatabaseManager::Lease& lease, Password& password) {
+        auto& query = lease.statement(INSERT_QUERY);
         
         auto now = std::chrono::system_clock::now();
         password.createdAt = now;
         password.updatedAt = now;
+        password.version = nextVersion(lease, password.userId);
         
-        query.bind(1, password.login);
-        query.bind(2, password.userId);
-        query.bind(3, password.password);
-        query.bind(4, password.name);
-        query.bind(5, password.url);
-        query.bind(6, password.notes);
-        query.bind(7, password.options.toJson().dump());
-        query.bind(8, util::time::toString(password.createdAt));
-        query.bind(9, util::time::toString(password.updatedAt));
+        bindColumns(query, password);
+        query.bind(":createdAt", util::time::toString(password.createdAt));
+        query.bind(":updatedAt", util::time::toString(password.updatedAt));
+        query.bind(":version", password.version);
         
         query.exec();
-        password.id = static_cast<std::uint32_t>(db->getLastInsertRowid());
+        password.id = static_cast<std::uint32_t>(lease.database().getLastInsertRowid());
+
+        writeSearchTokens(lease.statement(REMOVE_TOKENS_QUERY), lease.statement(INSERT_TOKEN_QUERY), password);
+        return password.version;
     }
 
-    void SQLitePasswordRepository::update(const Password& password) {
-        std::lock_guard<std::mutex> lock(DatabaseManager::getInstance().getMutex());
+    void SQLitePasswordRepository::addBatch(std::vector<Password>& passwords) {
+        // Users may live in different shards, rows of each user are inserted under lease of its shard
+        std::map<std::uint32_t, std::vector<std::size_t>> byUser;
+        for (std::size_t i = 0; i < passwords.size(); ++i) {
+            byUser[passwords[i].userId].push_back(i);
+        }
         
-        SQLite::Statement query(*db,
-            "UPDATE passwords SET login = ?, userId = ?, password = ?, name = ?, "
-            "url = ?, notes = ?, options = ?, updatedAt = ? WHERE id = ?");
+        auto now = std::chrono::system_clock::now();
+        auto timestamp = util::time::toString(now);
+
+        for (const auto& [userId, indices] : byUser) {
+            auto lease = DatabaseManager::getInstance().shard(userId);
+            auto& query = lease.statement(INSERT_QUERY);
+            auto& removeTokens = lease.statement(REMOVE_TOKENS_QUERY);
+            auto& insertTokens = lease.statement(INSERT_TOKEN_QUERY);
+
+            for (std::size_t begin = 0; begin < indices.size(); begin += BATCH_SIZE) {
+                std::size_t end = std::min(begin + BATCH_SIZE, indices.size());
+                SQLite::Transaction transaction(lease.database());
+                
+                // Every transaction is single vault version of user
+                auto version = nextVersion(lease, userId);
+
+                for (std::size_t i = begin; i < end; ++i) {
+                    auto& password = passwords[indices[i]];
+                    password.createdAt = now;
+                    password.updatedAt = now;
+                    password.version = version;
+
+                    bindColumns(query, password);
+                    query.bind(":createdAt", timestamp);
+                    query.bind(":updatedAt", timestamp);
+                    query.bind(":version", password.version);
+
+                    query.exec();
+                    query.reset();
+                    password.id = static_cast<std::uint32_t>(lease.database().getLastInsertRowid());
+                    writeSearchTokens(removeTokens, insertTokens, password);
+                }
+
+                transaction.commit();
+                events::ChangeNotifier::getInstance().publish(userId, version);
+            }
+        }
+    }
+
+    std::int64_t SQLitePasswordRepository::update(const Password& password) {
+        if (auto version = WriteQueue::getInstance().update(password)) {
+            return *version;
+        }
+
+        auto lease = DatabaseManager::getInstance().shard(password.userId);
+        SQLite::Transaction transaction(lease.database());
+        auto version = applyUpdate(lease, password);
+        if (version == 0) {
+            // Nothing updated, version is not bumped
+            return 0;
+        }
+        transaction.commit();
+        events::ChangeNotifier::getInstance().publish(password.userId, version);
+        return version;
+    }
+
+    std::int64_t SQLitePasswordRepository::applyUpdate(DatabaseManager::Lease& lease, const Password& password) {
+        auto& query = lease.statement(UPDATE_QUERY);
         
         auto now = std::chrono::system_clock::now();
         
-        query.bind(1, password.login);
-        query.bind(2, password.userId);
-        query.bind(3, password.password);
-        query.bind(4, password.name);
-        query.bind(5, password.url);
-        query.bind(6, password.notes);
-        query.bind(7, password.options.toJson().dump());
-        query.bind(8, util::time::toString(now));
-        query.bind(9, static_cast<int64_t>(password.id));
+        auto version = nextVersion(lease, password.userId);
+        bindColumns(query, password);
+        query.bind(":updatedAt", util::time::toString(now));
+        query.bind(":version", version);
+        query.bind(":id", static_cast<int64_t>(password.id));
         
-        query.exec();
+        if (query.exec() == 0) {
+            return 0;
+        }
+
+        writeSearchTokens(lease.statement(REMOVE_TOKENS_QUERY), lease.statement(INSERT_TOKEN_QUERY), password);
+        return version;
+    }
+
+    std::int64_t SQLitePasswordRepository::remove(const std::uint32_t userId, const std::uint32_t id) {
+        if (auto version = WriteQueue::getInstance().remove(userId, id)) {
+            return *version;
+        }
+
+        auto lease = DatabaseManager::getInstance().shard(userId);
+        SQLite::Transaction transaction(lease.database());
+        auto version = applyRemove(lease, userId, id);
+        if (version == 0) {
+            // Nothing removed, version is not bumped
+            return 0;
+        }
+        transaction.commit();
+        events::ChangeNotifier::getInstance().publish(userId, version);
+        return version;
+    }
+
+    std::int64_t SQLitePasswordRepository::applyRemove(DatabaseManager::Lease& lease, const std::uint32_t userId, const std::uint32_t id) {
+        auto& query = lease.statement(REMOVE_QUERY);
+        auto version = nextVersion(lease, userId);
+        query.bind(1, util::time::toString(std::chrono::system_clock::now()));
+        query.bind(2, version);
+        query.bind(3, static_cast<int64_t>(id));
+        query.bind(4, static_cast<int64_t>(userId));
+        if (query.exec() == 0) {
+            return 0;
+        }
+
+        auto& removeTokens = lease.statement(REMOVE_TOKENS_QUERY);
+        removeTokens.bind(1, static_cast<int64_t>(id));
+        removeTokens.exec();
+        return version;
     }
 
-    void SQLitePasswordRepository::remove(const std::uint32_t id) {
-        std::lock_guard<std::mutex> lock(DatabaseManager::getInstance().getMutex());
+    std::vector<PasswordMutationResult> SQLitePasswordRepository::applyBatch(std::vector<PasswordMutation>& mutations, const std::uint32_t userId) {
+        auto lease = DatabaseManager::getInstance().shard(userId);
         
-        SQLite::Statement query(*db, "DELETE FROM passwords WHERE id = ?");
-        query.bind(1, static_cast<int64_t>(id));
+        auto& insertQuery = lease.statement(INSERT_QUERY);
+        auto& updateQuery = lease.statement(UPDATE_QUERY);
+        auto& removeQuery = lease.statement(REMOVE_QUERY);
+        auto& removeTokens = lease.statement(REMOVE_TOKENS_QUERY);
+        auto& insertTokens = lease.statement(INSERT_TOKEN_QUERY);
+
+        auto now = std::chrono::system_clock::now();
+        auto timestamp = util::time::toString(now);
+
+        std::vector<PasswordMutationResult> results;
+        results.reserve(mutations.size());
+
+        // Whole batch is visible to clients as single vault version
+        SQLite::Transaction transaction(lease.database());
+        auto version = nextVersion(lease, userId);
+        for (auto& mutation : mutations) {
+            auto& password = mutation.password;
+            PasswordMutationResult result{ mutation.type, password.id, true };
+
+            switch (mutation.type) {
+                case PasswordMutation::Type::Add:
+                    password.userId = userId;
+                    password.createdAt = now;
+                    password.updatedAt = now;
+                    password.version = version;
+                    bindColumns(insertQuery, password);
+                    insertQuery.bind(":createdAt", timestamp);
+                    insertQuery.bind(":updatedAt", timestamp);
+                    insertQuery.bind(":version", version);
+                    insertQuery.exec();
+                    insertQuery.reset();
+                    password.id = static_cast<std::uint32_t>(lease.database().getLastInsertRowid());
+                    result.id = password.id;
+                    writeSearchTokens(removeTokens, insertTokens, password);
+                    break;
+
+                case PasswordMutation::Type::Update:
+                    password.userId = userId;
+                    password.updatedAt = now;
+                    password.version = version;
+                    bindColumns(updateQuery, password);
+                    updateQuery.bind(":updatedAt", timestamp);
+                    updateQuery.bind(":version", version);
+                    updateQuery.bind(":id", static_cast<int64_t>(password.id));
+                    result.applied = updateQuery.exec() > 0;
+                    updateQuery.reset();
+                    if (result.applied) {
+                        writeSearchTokens(removeTokens, insertTokens, password);
+                    }
+                    break;
+
+                case PasswordMutation::Type::Remove:
+                    password.version = version;
+                    removeQuery.bind(1, timestamp);
+                    removeQuery.bind(2, version);
+                    removeQuery.bind(3, static_cast<int64_t>(password.id));
+                    removeQuery.bind(4, static_cast<int64_t>(userId));
+                    result.applied = removeQuery.exec() > 0;
+                    removeQuery.reset();
+                    if (result.applied) {
+                        password.searchTokens.clear();
+                        writeSearchTokens(removeTokens, insertTokens, password);
+                    }
+                    break;
+            }
+            results.push_back(result);
+        }
+        transaction.commit();
+        events::ChangeNotifier::getInstance().publish(userId, version);
+
+        return results;
+    }
+
+    PasswordChanges SQLitePasswordRepository::getChanges(const std::uint32_t userId, const std::int64_t since) {
+        auto lease = DatabaseManager::getInstance().shard(userId);
+        timing::ScopedStage stage("db.query");
+        PasswordChanges changes;
+
+        auto from = since;
+        auto& version = lease.statement(SYNC_VERSIONS_QUERY);
+        version.bind(1, static_cast<int64_t>(userId));
+        if (version.executeStep()) {
+            changes.version = version.getColumn(0).getInt64();
+
+            // Client older than purged tombstones cannot learn about those removals, it gets snapshot instead
+            if (from > 0 && from < version.getColumn(1).getInt64()) {
+                changes.reset = true;
+                from = 0;
+            }
+        }
+
+        // Client without vault gets snapshot of live entries, tombstones are meaningless for it
+        auto& query = lease.statement(from > 0
+            ? "SELECT * FROM passwords WHERE userId = ? AND version > ? ORDER BY version"
+            : "SELECT * FROM passwords WHERE userId = ? AND version >= ? AND deleted = 0 ORDER BY version");
+        query.bind(1, static_cast<int64_t>(userId));
+        query.bind(2, from);
+        while (query.executeStep()) {
+            if (query.getColumn("deleted").getInt() != 0) {
+                changes.removed.push_back(query.getColumn("id").getUInt());
+            }
+            else {
+                readRow(query, changes.changed);
+            }
+        }
+
+        return changes;
+    }
+
+    std::size_t SQLitePasswordRepository::purgeTombstones(const std::chrono::system_clock::time_point before) {
+        auto& manager = DatabaseManager::getInstance();
+        auto keys = manager.getShardSettings().mode == DatabaseManager::ShardMode::None
+            ? std::vector<std::uint32_t>{ 0 }
+            : manager.storedShards();
+        auto cutoff = util::time::toString(before);
+
+        // Shards are opened one by one, so purge does not push active shards out of cache all at once
+        std::size_t purged = 0;
+        for (auto key : keys) {
+            DatabaseManager::Lease lease(manager.pinShard(key));
+            SQLite::Transaction transaction(lease.database());
+
+            // Horizon is raised before tombstones disappear, both in one transaction
+            auto& horizon = lease.statement(
+                "UPDATE vault_versions SET purgedVersion = MAX(purgedVersion, ("
+                "SELECT MAX(version) FROM passwords WHERE passwords.userId = vault_versions.userId AND deleted = 1 AND updatedAt < ?1)) "
+                "WHERE userId IN (SELECT userId FROM passwords WHERE deleted = 1 AND updatedAt < ?1)");
+            horizon.bind(1, cutoff);
+            horizon.exec();
+
+            auto& remove = lease.statement("DELETE FROM passwords WHERE deleted = 1 AND updatedAt < ?");
+            remove.bind(1, cutoff);
+            purged += static_cast<std::size_t>(remove.exec());
+            transaction.commit();
+        }
+        return purged;
+    }
+
+    std::list<Password> SQLitePasswordRepository::search(const std::uint32_t userId, const std::vector<std::int64_t>& tokens) {
+        std::list<Password> passwords;
+        if (tokens.empty()) {
+            return passwords;
+        }
+        auto lease = DatabaseManager::getInstance().shard(userId);
+        timing::ScopedStage stage("db.query");
+
+        // Entry matches when it contains every token of query, text depends on number of tokens so it is not cached
+        std::string placeholders;
+        for (std::size_t i = 0; i < tokens.size(); ++i) {
+            placeholders += i == 0 ? "?" : ", ?";
+        }
+        SQLite::Statement query(lease.database(),
+            "SELECT * FROM passwords WHERE deleted = 0 AND id IN ("
+            "SELECT passwordId FROM password_tokens WHERE userId = ? AND token IN (" + placeholders + ") "
+            "GROUP BY passwordId HAVING COUNT(DISTINCT token) = ?) ORDER BY id");
+        int index = 1;
+        query.bind(index++, static_cast<int64_t>(userId));
+        for (auto token : tokens) {
+            query.bind(index++, token);
+        }
+        query.bind(index, static_cast<int64_t>(tokens.size()));
+
+        while (query.executeStep()) {
+            passwords.push_back(readRow(query));
+        }
+        return passwords;
+    }
+
+    std::list<Password> SQLitePasswordRepository::getUnindexed(const std::uint32_t userId) {
+        auto lease = DatabaseManager::getInstance().shard(userId);
+        std::list<Password> passwords;
+
+        auto& query = lease.statement(
+            "SELECT * FROM passwords p WHERE userId = ? AND deleted = 0 AND NOT EXISTS ("
+            "SELECT 1 FROM password_tokens t WHERE t.passwordId = p.id AND t.token = ?)");
+        query.bind(1, static_cast<int64_t>(userId));
+        query.bind(2, BlindIndex::INDEXED_MARKER);
+        while (query.executeStep()) {
+            passwords.push_back(readRow(query));
+        }
+        return passwords;
+    }
+
+    std::list<std::pair<Password, bool>> SQLitePasswordRepository::matchUrl(const std::uint32_t userId, const std::int64_t originToken, const std::int64_t siteToken) {
+        auto lease = DatabaseManager::getInstance().shard(userId);
+        std::list<std::pair<Password, bool>> passwords;
+
+        auto& query = lease.statement(
+            "SELECT p.*, MAX(t.token = ?) AS exact FROM password_tokens t JOIN passwords p ON p.id = t.passwordId "
+            "WHERE t.userId = ? AND t.token IN (?, ?) AND p.deleted = 0 GROUP BY p.id ORDER BY exact DESC, p.id");
+        query.bind(1, originToken);
+        query.bind(2, static_cast<int64_t>(userId));
+        query.bind(3, originToken);
+        query.bind(4, siteToken);
+        while (query.executeStep()) {
+            passwords.emplace_back(readRow(query), query.getColumn("exact").getInt() != 0);
+        }
+        return passwords;
+    }
+
+    std::vector<std::vector<std::uint32_t>> SQLitePasswordRepository::getReuseGroups(const std::uint32_t userId, const std::string& emptyFingerprint) {
+        auto lease = DatabaseManager::getInstance().shard(userId);
+        std::vector<std::vector<std::uint32_t>> groups;
+
+        auto& query = lease.statement(
+            "SELECT GROUP_CONCAT(id) FROM passwords WHERE userId = ? AND deleted = 0 AND fingerprint IS NOT NULL AND fingerprint <> ? "
+            "GROUP BY fingerprint HAVING COUNT(*) > 1");
+        query.bind(1, static_cast<int64_t>(userId));
+        query.bind(2, emptyFingerprint);
+        while (query.executeStep()) {
+            std::vector<std::uint32_t> group;
+            std::string ids = query.getColumn(0).getString();
+            for (std::size_t begin = 0, end = 0; begin < ids.size(); begin = end + 1) {
+                end = std::min(ids.find(',', begin), ids.size());
+                group.push_back(static_cast<std::uint32_t>(std::stoul(ids.substr(begin, end - begin))));
+            }
+            std::sort(group.begin(), group.end());
+            groups.push_back(std::move(group));
+        }
+        return groups;
+    }
+
+    std::vector<std::pair<std::uint32_t, int>> SQLitePasswordRepository::getWeak(const std::uint32_t userId, const int maxScore) {
+        auto lease = DatabaseManager::getInstance().shard(userId);
+        std::vector<std::pair<std::uint32_t, int>> weak;
+
+        auto& query = lease.statement("SELECT id, strength FROM passwords WHERE userId = ? AND deleted = 0 AND strength <= ? ORDER BY strength, id");
+        query.bind(1, static_cast<int64_t>(userId));
+        query.bind(2, maxScore);
+        while (query.executeStep()) {
+            weak.emplace_back(query.getColumn(0).getUInt(), query.getColumn(1).getInt());
+        }
+        return weak;
+    }
+
+    std::list<Password> SQLitePasswordRepository::getUnanalyzed(const std::uint32_t userId) {
+        auto lease = DatabaseManager::getInstance().shard(userId);
+        std::list<Password> passwords;
+
+        // Entries without password keep NULL fingerprint, every analyzed entry has strength score
+        auto& query = lease.statement("SELECT * FROM passwords WHERE userId = ? AND deleted = 0 AND strength IS NULL");
+        query.bind(1, static_cast<int64_t>(userId));
+        while (query.executeStep()) {
+            passwords.push_back(readRow(query));
+        }
+        return passwords;
+    }
+
+    void SQLitePasswordRepository::setAnalysis(const Password& password) {
+        auto lease = DatabaseManager::getInstance().shard(password.userId);
+
+        auto& query = lease.statement("UPDATE passwords SET fingerprint = ?, strength = ? WHERE id = ? AND userId = ? AND deleted = 0");
+        if (password.fingerprint.empty()) {
+            query.bind(1);
+        }
+        else {
+            query.bind(1, password.fingerprint);
+        }
+        query.bind(2, password.strength);
+        query.bind(3, static_cast<int64_t>(password.id));
+        query.bind(4, static_cast<int64_t>(password.userId));
         query.exec();
     }
 
+    void SQLitePasswordRepository::setSearchTokens(const Password& password) {
+        auto lease = DatabaseManager::getInstance().shard(password.userId);
+
+        SQLite::Transaction transaction(lease.database());
+        writeSearchTokens(lease.statement(REMOVE_TOKENS_QUERY), lease.statement(INSERT_TOKEN_QUERY), password);
+        transaction.commit();
+    }
+
+    std::size_t SQLitePasswordRepository::replaceEncrypted(const std::vector<Password>& passwords) {
+        if (passwords.empty()) {
+            return 0;
+        }
+
+        auto lease = DatabaseManager::getInstance().shard(passwords.front().userId);
+        SQLite::Transaction transaction(lease.database());
+        auto& query = lease.statement(REENCRYPT_QUERY);
+        auto& removeTokens = lease.statement(REMOVE_TOKENS_QUERY);
+        auto& insertTokens = lease.statement(INSERT_TOKEN_QUERY);
+
+        std::size_t replaced = 0;
+        for (const auto& password : passwords) {
+            // Entry written since it was read is left to caller, version alone does not tell which key sealed it
+            bindColumns(query, password);
+            query.bind(":id", static_cast<int64_t>(password.id));
+            query.bind(":version", password.version);
+            auto changed = query.exec();
+            query.reset();
+            if (changed == 0) {
+                continue;
+            }
+
+            // Blind index keys depend on password too
+            writeSearchTokens(removeTokens, insertTokens, password);
+            ++replaced;
+        }
+        transaction.commit();
+        return replaced;
+    }
+
     std::filesystem::path PasswordManager::dbPath;
 
     // PasswordManager implementation
     PasswordManager::PasswordManager() : repo(SQLitePasswordRepository::getInstance()) {}
 
-    std::list<Password> PasswordManager::getAllPasswords() {
-        return repo.getAll();
+    PasswordBatch PasswordManager::getAllPasswords(const std::uint32_t userId) {
+        return repo.getAll(userId);
     }
 
-    std::optional<Password> PasswordManager::getPasswordById(const std::uint32_t& id) {
-        return repo.getById(id);
+    void PasswordManager::forEachPasswordOfUser(const std::uint32_t userId, const std::function<void(const Password&)>& visitor) {
+        repo.forEachOfUser(userId, visitor);
+    }
+
+    std::optional<Password> PasswordManager::getPasswordById(const std::uint32_t userId, const std::uint32_t& id) {
+        return repo.getById(userId, id);
+    }
+
+    util::SecureString PasswordManager::listPasswords(const std::uint32_t userId) {
+        auto& cache = VaultCache::getInstance();
+        if (auto cached = cache.list(userId)) {
+            return std::move(*cached);
+        }
+
+        PasswordBatch decrypted(util::SecureArena::resource());
+        if (cache.enabled()) {
+            // Snapshot carries its vault version, so cache can tell which writes it already contains
+            auto snapshot = repo.getChanges(userId, 0);
+            for (const auto& password : snapshot.changed) {
+                PasswordCrypto::decrypt(password, userId, decrypted);
+            }
+            cache.store(userId, snapshot.version, decrypted);
+            if (auto cached = cache.list(userId)) {
+                return std::move(*cached);
+            }
+        }
+        else {
+            for (const auto& password : repo.getAll(userId)) {
+                PasswordCrypto::decrypt(password, userId, decrypted);
+            }
+        }
+
+        timing::ScopedStage stage("serialize");
+        util::SecureString result(util::SecureArena::resource());
+        PasswordRow::appendJson(decrypted, result);
+        return result;
     }
 
     void PasswordManager::addPassword(Password& password) {
         repo.add(password);
+        writeThrough(password.userId, password.id, password.version);
+    }
+
+    void PasswordManager::addPasswords(std::vector<Password>& passwords) {
+        repo.addBatch(passwords);
+
+        // Bulk changes are not written through, vault is read again on next list
+        for (const auto& password : passwords) {
+            VaultCache::getInstance().commit(password.userId, password.version);
+        }
     }
 
     void PasswordManager::updatePassword(const Password& password) {
-        repo.update(password);
+        writeThrough(password.userId, password.id, repo.update(password));
+    }
+
+    void PasswordManager::removePassword(const std::uint32_t userId, const std::uint32_t id) {
+        auto version = repo.remove(userId, id);
+        if (version > 0) {
+            VaultCache::getInstance().erase(userId, version, id);
+        }
+    }
+
+    std::vector<PasswordMutationResult> PasswordManager::applyMutations(std::vector<PasswordMutation>& mutations, const std::uint32_t userId) {
+        auto results = repo.applyBatch(mutations, userId);
+
+        // Whole batch shares one version, vault is read again on next list
+        std::int64_t version = 0;
+        for (const auto& mutation : mutations) {
+            version = std::max(version, mutation.password.version);
+        }
+        VaultCache::getInstance().commit(userId, version);
+        return results;
+    }
+
+    void PasswordManager::writeThrough(const std::uint32_t userId, const std::uint32_t id, const std::int64_t version) {
+        auto& cache = VaultCache::getInstance();
+        if (version == 0) {
+            return;
+        }
+
+        // Version is recorded also without cached vault, so snapshot being read cannot be stored behind it
+        if (!cache.contains(userId)) {
+            cache.commit(userId, version);
+            return;
+        }
+
+        // Stored row is read back, timestamps are set by repository
+        auto stored = repo.getById(userId, id);
+        if (!stored) {
+            cache.evict(userId);
+            return;
+        }
+        auto plain = PasswordCrypto::decrypt(*stored, userId);
+        cache.put(userId, version, plain);
+        plain.wipeSecrets();
+    }
+
+    PasswordChanges PasswordManager::getChanges(const std::uint32_t userId, const std::int64_t since) {
+        return repo.getChanges(userId, since);
+    }
+
+    std::size_t PasswordManager::purgeTombstones(const std::chrono::hours retention) {
+        return repo.purgeTombstones(std::chrono::system_clock::now() - retention);
+    }
+
+    std::list<Password> PasswordManager::searchPasswords(const std::uint32_t userId, const std::string& query) {
+        auto crypto = CryptoManager::get(userId);
+        BlindIndex index(crypto->contextKey(BlindIndex::searchContext(userId)));
+
+        std::list<Password> result;
+        for (const auto& password : repo.search(userId, index.queryTokens(query))) {
+            auto plain = PasswordCrypto::decrypt(password, userId);
+            if (BlindIndex::matches(plain.name, query) || BlindIndex::matches(plain.url, query) || BlindIndex::matches(plain.login, query)) {
+                result.push_back(std::move(plain));
+            }
+            else {
+                plain.wipeSecrets();
+            }
+        }
+        return result;
     }
 
-    void PasswordManager::removePassword(const std::uint32_t id) {
-        repo.remove(id);
+    std::list<std::pair<Password, bool>> PasswordManager::matchPasswords(const std::uint32_t userId, const std::string& url) {
+        std::list<std::pair<Password, bool>> result;
+        auto keys = BlindIndex::urlKeys(url);
+        if (keys.origin.empty()) {
+            return result;
+        }
+
+        auto crypto = CryptoManager::get(userId);
+        BlindIndex index(crypto->contextKey(BlindIndex::searchContext(userId)));
+
+        auto [originToken, siteToken] = index.urlTokens(keys);
+        for (auto& [password, exact] : repo.matchUrl(userId, originToken, siteToken)) {
+            auto plain = PasswordCrypto::decrypt(password, userId);
+            if (BlindIndex::urlKeys(plain.url).site == keys.site) {
+                result.emplace_back(std::move(plain), exact);
+            }
+            else {
+                plain.wipeSecrets();
+            }
+        }
+        return result;
+    }
+
+    std::vector<std::vector<std::uint32_t>> PasswordManager::getReusedPasswords(const std::uint32_t userId) {
+        analyzeUnanalyzed(userId);
+        return repo.getReuseGroups(userId, PasswordCrypto::emptyFingerprint(userId));
+    }
+
+    std::vector<std::pair<std::uint32_t, int>> PasswordManager::getWeakPasswords(const std::uint32_t userId, const int maxScore) {
+        analyzeUnanalyzed(userId);
+        return repo.getWeak(userId, maxScore);
+    }
+
+    void PasswordManager::analyzeUnanalyzed(const std::uint32_t userId) {
+        // Entries stored before fingerprints and scores existed are analyzed on first report
+        for (auto& password : repo.getUnanalyzed(userId)) {
+            auto plain = PasswordCrypto::decrypt(password, userId).password;
+            password.fingerprint = PasswordCrypto::fingerprint(plain, userId);
+            password.strength = PasswordStrength::estimate(plain).score;
+            util::wipe(plain);
+            repo.setAnalysis(password);
+        }
+    }
+
+    std::size_t PasswordManager::indexUnindexed(const std::uint32_t userId) {
+        // Entries stored before current index format are indexed once after login, lookups only read tokens
+        auto crypto = CryptoManager::get(userId);
+        BlindIndex index(crypto->contextKey(BlindIndex::searchContext(userId)));
+        auto passwords = repo.getUnindexed(userId);
+        for (auto& password : passwords) {
+            auto plain = PasswordCrypto::decrypt(password, userId);
+            password.searchTokens = index.entryTokens(plain.name, plain.url, plain.login);
+            plain.wipeSecrets();
+            repo.setSearchTokens(password);
+        }
+        return passwords.size();
     }
 
     std::string PasswordGenerator::generate(const Password::Options& options) {
+        // Short passwords with few character sets may hit breached ones, they are generated again
+        for (int attempt = 0; attempt < MAX_GENERATION_ATTEMPTS; ++attempt) {
+            auto password = options.mode == Password::Options::Mode::Passphrase ? generatePassphrase(options) : generateCandidate(options);
+            if (!BreachChecker::getInstance().isBreached(password)) {
+                return password;
+            }
+        }
+        throw std::runtime_error("Failed to generate password which does not appear in known data breach.");
+    }
+
+    std::string PasswordGenerator::generateCandidate(const Password::Options& options) {
         // Define character sets
         static constexpr std::string_view uppercase = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
         static constexpr std::string_view lowercase = "abcdefghijklmnopqrstuvwxyz";
@@ -250,8 +1193,11 @@ namespace pass {
         // Validate options
         validateOptions(options);
 
-        thread_local std::random_device rd;
-        thread_local std::mt19937 gen(rd());
+        // Generated passwords are secrets, so characters are drawn from operating system seeded CSPRNG
+        thread_local CryptoPP::AutoSeededRandomPool rng;
+        auto pick = [](const std::size_t size) -> std::size_t {
+            return rng.GenerateWord32(0, static_cast<CryptoPP::word32>(size - 1));
+        };
 
         // Lambda for checing if a character is allowed based on the forbidden characters
         auto checkIfAllowed = [&options](const char c) -> bool {
@@ -290,12 +1236,11 @@ namespace pass {
                 }
                 
                 // Characters which will be included in the password
-                std::uniform_int_distribution<> charDist(0, charSet.size() - 1);
                 for (std::uint8_t i = 0; i < minimalNumber; ++i) {
-                    auto selectedChar = charSet[charDist(gen)];
+                    auto selectedChar = charSet[pick(charSet.size())];
                     std::size_t counter = 0;
                     while (!checkIfAllowed(selectedChar)) {
-                        selectedChar = charSet[charDist(gen)];
+                        selectedChar = charSet[pick(charSet.size())];
                         if (++counter > 100) {
                             throw std::runtime_error("Failed to find an allowed character after 100 attempts.");
                         }
@@ -325,18 +1270,89 @@ namespace pass {
             allAllowedChars += charSet;
         }
 
-        std::uniform_int_distribution<> distrib(0, allAllowedChars.size() - 1);
         while (password.length() < options.minimalLength) {
-            password += allAllowedChars[distrib(gen)];
+            password += allAllowedChars[pick(allAllowedChars.size())];
         }
 
-        // Mieszanie hasła
-        std::shuffle(password.begin(), password.end(), gen);
+        // Mieszanie hasła (Fisher-Yates)
+        for (std::size_t i = password.size(); i > 1; --i) {
+            std::swap(password[i - 1], password[pick(i)]);
+        }
 
         return password;
     }
 
+    std::string PasswordGenerator::generatePassphrase(const Password::Options& options) {
+        validateOptions(options);
+
+        // Entropy of passphrase is only as good as its source, so words are drawn from operating system seeded CSPRNG
+        thread_local CryptoPP::AutoSeededRandomPool rng;
+        auto pick = [](const std::size_t size) -> std::size_t {
+            return rng.GenerateWord32(0, static_cast<CryptoPP::word32>(size - 1));
+        };
+
+        // Words are views into mapped wordlist, only result is allocated
+        const auto& wordlist = Wordlist::getInstance();
+        std::size_t numberPosition = options.includeNumber ? pick(options.wordCount) : options.wordCount;
+
+        std::string passphrase;
+        passphrase.reserve(options.wordCount * (8 + options.wordSeparator.size()));
+        for (std::size_t i = 0; i < options.wordCount; ++i) {
+            if (i > 0) {
+                passphrase += options.wordSeparator;
+            }
+            auto word = wordlist.word(pick(wordlist.size()));
+            if (options.capitalizeWords) {
+                passphrase += static_cast<char>(std::toupper(static_cast<unsigned char>(word.front())));
+                passphrase += word.substr(1);
+            }
+            else {
+                passphrase += word;
+            }
+            if (i == numberPosition) {
+                passphrase += static_cast<char>('0' + pick(10));
+            }
+        }
+        return passphrase;
+    }
+
+    double PasswordGenerator::entropy(const Password::Options& options) {
+        if (options.mode == Password::Options::Mode::Passphrase) {
+            double bits = options.wordCount * std::log2(static_cast<double>(Wordlist::getInstance().size()));
+            if (options.includeNumber) {
+                bits += std::log2(10.0) + std::log2(static_cast<double>(options.wordCount));
+            }
+            return bits;
+        }
+
+        // Upper bound, every character is drawn from all allowed characters of selected sets
+        std::size_t alphabet = 0;
+        auto countAllowed = [&options](std::string_view charSet) {
+            return static_cast<std::size_t>(std::count_if(charSet.begin(), charSet.end(), [&options](char c) {
+                return options.forbiddenCharacters.find(c) == std::string::npos;
+            }));
+        };
+        alphabet += options.includeUppercase ? countAllowed("ABCDEFGHIJKLMNOPQRSTUVWXYZ") : 0;
+        alphabet += options.includeLowercase ? countAllowed("abcdefghijklmnopqrstuvwxyz") : 0;
+        alphabet += options.includeDigits ? countAllowed("0123456789") : 0;
+        alphabet += options.includeSpecialCharacters ? countAllowed("!@#$%^&*()-_=+[]{}|;:,.<>?") : 0;
+        return alphabet > 1 ? options.minimalLength * std::log2(static_cast<double>(alphabet)) : 0.0;
+    }
+
     void PasswordGenerator::validateOptions(const Password::Options& options) {
+        if (options.mode == Password::Options::Mode::Passphrase) {
+            if (Wordlist::getInstance().size() == 0) {
+                throw std::runtime_error("Passphrase wordlist is not loaded");
+            }
+            if (options.wordCount == 0 || options.wordCount > MAX_WORD_COUNT) {
+                throw std::invalid_argument(std::format("Word count must be between 1 and {}", MAX_WORD_COUNT));
+            }
+            if (options.wordSeparator.size() > MAX_SEPARATOR_LENGTH) {
+                throw std::invalid_argument(std::format("Word separator must have at most {} characters", MAX_SEPARATOR_LENGTH));
+            }
+            return;
+        }
+
         // Check if at least one character set is selected
         if (!options.includeUppercase && !options.includeLowercase && 
             !options.includeDigits && !options.includeSpecialCharacters) {
@@ -361,19 +1377,126 @@ namespace pass {
     }
 
     Password PasswordCrypto::encrypt(const Password& password, const std::uint32_t& id) {
+        timing::ScopedStage stage("encrypt");
         auto crypto = CryptoManager::get(id);
         Password pass(password);
-        pass.login = crypto->encrypt(pass.login);
-        pass.password = crypto->encrypt(pass.password);
-        pass.name = crypto->encrypt(pass.name);
-        pass.url = crypto->encrypt(pass.url);
-        pass.notes = crypto->encrypt(pass.notes);
+        pass.searchTokens = BlindIndex(crypto->contextKey(BlindIndex::searchContext(id))).entryTokens(pass.name, pass.url, pass.login);
+        pass.fingerprint = pass.password.empty() ? std::string() : crypto->fingerprint(fingerprintContext(id), pass.password);
+        pass.strength = PasswordStrength::estimate(pass.password).score;
+        seal(*crypto, pass);
         return pass;
     }
 
+    void PasswordCrypto::encryptBatch(std::vector<Password>& passwords, const std::uint32_t& id) {
+        auto crypto = CryptoManager::get(id);
+        BlindIndex index(crypto->contextKey(BlindIndex::searchContext(id)));
+        auto context = fingerprintContext(id);
+        
+        // Threads of shared pool pick next entry from common counter, each entry is encrypted in place
+        EncryptionPool::getInstance().forEach(passwords.size(), [&](std::size_t i) {
+            auto& pass = passwords[i];
+            pass.searchTokens = index.entryTokens(pass.name, pass.url, pass.login);
+            pass.fingerprint = pass.password.empty() ? std::string() : crypto->fingerprint(context, pass.password);
+            pass.strength = PasswordStrength::estimate(pass.password).score;
+            seal(*crypto, pass);
+        });
+    }
+
+    std::string PasswordCrypto::fingerprint(const std::string& password, const std::uint32_t& id) {
+        // Entries without password share nothing worth reporting
+        if (password.empty()) {
+            return {};
+        }
+        return CryptoManager::get(id)->fingerprint(fingerprintContext(id), password);
+    }
+
+    std::string PasswordCrypto::emptyFingerprint(const std::uint32_t& id) {
+        return CryptoManager::get(id)->fingerprint(fingerprintContext(id), "");
+    }
+
+    std::string PasswordCrypto::fingerprintContext(const std::uint32_t id) {
+        return std::format("PasswordFucker/password-fingerprint/{}", id);
+    }
+
+    std::atomic<bool> PasswordCrypto::recordEncryption = false;
+
+    void PasswordCrypto::setRecordEncryption(bool enabled) {
+        recordEncryption = enabled;
+    }
+
+    void PasswordCrypto::seal(Crypto& crypto, Password& password) {
+        if (!recordEncryption) {
+            password.login = crypto.encrypt(password.login);
+            password.password = crypto.encrypt(password.password);
+            password.name = crypto.encrypt(password.name);
+            password.url = crypto.encrypt(password.url);
+            password.notes = crypto.encrypt(password.notes);
+            password.record.clear();
+            return;
+        }
+
+        // Record is version byte followed by fields, each prefixed with 32-bit little endian length
+        std::array<std::string*, 5> fields = { &password.login, &password.password, &password.name, &password.url, &password.notes };
+        std::size_t size = 1;
+        for (const auto* field : fields) {
+            size += 4 + field->size();
+        }
+        std::string record;
+        record.reserve(size);
+        record += static_cast<char>(RECORD_VERSION);
+        for (auto* field : fields) {
+            auto length = static_cast<std::uint32_t>(field->size());
+            for (int shift = 0; shift < 32; shift += 8) {
+                record += static_cast<char>((length >> shift) & 0xFF);
+            }
+            record += *field;
+            util::wipe(*field);
+        }
+        password.record = crypto.encrypt(record);
+        util::wipe(record);
+    }
+
+    std::array<std::string_view, 5> PasswordCrypto::parseRecord(std::string_view record) {
+        if (record.empty() || static_cast<std::uint8_t>(record.front()) != RECORD_VERSION) {
+            throw std::runtime_error("Unsupported password record version");
+        }
+        record.remove_prefix(1);
+
+        std::array<std::string_view, 5> fields;
+        for (auto& field : fields) {
+            if (record.size() < 4) {
+                throw std::runtime_error("Malformed password record");
+            }
+            std::uint32_t length = 0;
+            for (int i = 0; i < 4; ++i) {
+                length |= static_cast<std::uint32_t>(static_cast<std::uint8_t>(record[i])) << (8 * i);
+            }
+            record.remove_prefix(4);
+            if (record.size() < length) {
+                throw std::runtime_error("Malformed password record");
+            }
+            field = record.substr(0, length);
+            record.remove_prefix(length);
+        }
+        return fields;
+    }
+
     Password PasswordCrypto::decrypt(const Password& password, const std::uint32_t& id) {
+        timing::ScopedStage stage("decrypt");
         auto crypto = CryptoManager::get(id);
         Password pass(password);
+        if (!pass.record.empty()) {
+            auto record = crypto->decrypt(pass.record);
+            auto [login, secret, name, url, notes] = parseRecord(record);
+            pass.login = login;
+            pass.password = secret;
+            pass.name = name;
+            pass.url = url;
+            pass.notes = notes;
+            pass.record.clear();
+            util::wipe(record);
+            return pass;
+        }
         pass.login = crypto->decrypt(pass.login);
         pass.password = crypto->decrypt(pass.password);
         pass.name = crypto->decrypt(pass.name);
@@ -381,4 +1504,47 @@ namespace pass {
         pass.notes = crypto->decrypt(pass.notes);
         return pass;
     }
+
+    bool PasswordCrypto::needsPreviousPassword(const Password& password, const std::uint32_t& id) {
+        auto crypto = CryptoManager::get(id);
+        if (!password.record.empty()) {
+            return crypto->needsPreviousPassword(password.record);
+        }
+        for (const auto* field : { &password.login, &password.password, &password.name, &password.url, &password.notes }) {
+            if (crypto->needsPreviousPassword(*field)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void PasswordCrypto::decrypt(const PasswordRow& password, const std::uint32_t& id, PasswordBatch& output) {
+        timing::ScopedStage stage("decrypt");
+        auto crypto = CryptoManager::get(id);
+        PasswordRow row;
+        row.id = password.id;
+        row.userId = password.userId;
+        if (!password.record.empty()) {
+            // Single AEAD operation, fields are views into decrypted record
+            auto fields = parseRecord(crypto->decrypt(password.record, output.resource()));
+            row.login = fields[0];
+            row.password = fields[1];
+            row.name = fields[2];
+            row.url = fields[3];
+            row.notes = fields[4];
+        }
+        else {
+            row.login = crypto->decrypt(password.login, output.resource());
+            row.password = crypto->decrypt(password.password, output.resource());
+            row.name = crypto->decrypt(password.name, output.resource());
+            row.url = crypto->decrypt(password.url, output.resource());
+            row.notes = crypto->decrypt(password.notes, output.resource());
+        }
+        row.options = output.store(password.options);
+        row.createdAt = output.store(password.createdAt);
+        row.updatedAt = output.store(password.updatedAt);
+        row.version = password.version;
+        row.strength = password.strength;
+        output.add() = row;
+    }
 }
\ No newline at end of file
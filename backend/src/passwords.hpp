@@ -3,15 +3,26 @@
 
 #include <string>
 #include <list>
+#include <vector>
 #include <chrono>
 #include <cstddef>
 #include <optional>
+#include <functional>
 #include <mutex>
 #include <memory>
 #include <filesystem>
+#include <utility>
 #include <nlohmann/json.hpp>
 #include <SQLiteCpp/SQLiteCpp.h>
 #include <database-manager.hpp>
+#include <blind-index.hpp>
+#include <row-batch.hpp>
+#include <secure-arena.hpp>
+#include <string_view>
+#include <array>
+#include <atomic>
+
+class Crypto;
 
 /// @brief Namespace of password related stuff
 namespace pass {
@@ -21,6 +32,13 @@ namespace pass {
         /// @brief Options for password generation
         class Options {
         public:
+            /// @brief Kind of generated password
+            enum class Mode {
+                Characters,     ///< Random characters from selected character sets
+                Passphrase      ///< Random words from wordlist
+            };
+
+            Mode mode = Mode::Characters;                   // Kind of generated password
             std::uint8_t minimalLength;                     // Length of generated password
             bool includeUppercase;                          // Include uppercase letters
             bool includeLowercase;                          // Include lowercase letters
@@ -31,6 +49,10 @@ namespace pass {
             std::uint8_t digitsMinimalNumber;               // Minimal number of digits
             std::uint8_t specialCharactersMinimalNumber;    // Minimal number of special characters
             std::string forbiddenCharacters;                // Forbidden characters in generated password
+            std::uint8_t wordCount = 6;                     // Number of words of passphrase
+            std::string wordSeparator = "-";                // Separator between words of passphrase
+            bool capitalizeWords = false;                   // Capitalize first letter of every word of passphrase
+            bool includeNumber = false;                     // Append random digit to random word of passphrase
         
             /// @brief Function to convert Options object to Json
             /// @return json object
@@ -53,6 +75,20 @@ namespace pass {
         Options options;        // Options for password generation
         std::chrono::system_clock::time_point createdAt;    // Timestamp of creation
         std::chrono::system_clock::time_point updatedAt;    // Timestamp of last update
+        std::int64_t version = 0;                           // Vault version in which entry was last changed
+        std::vector<std::int64_t> searchTokens;             // Blind index tokens of name, url and login, set on encryption
+        std::string fingerprint;                            // Keyed fingerprint of password, equal for reused passwords, empty for empty password
+        int strength = -1;                                  // Strength score of password from 0 to 4, -1 if unknown
+        std::string record;                                 // Sealed record of all secret fields, empty if fields are encrypted separately
+
+        Password() = default;
+        Password(const Password&) = default;
+        Password(Password&&) noexcept = default;
+        Password& operator=(const Password&) = default;
+        Password& operator=(Password&&) noexcept = default;
+
+        /// @brief Destructor, wipes fields so decrypted passwords are cleared also when scope is left by exception
+        ~Password();
         
         /// @brief Function to convert Password object to Json
         /// @return json object
@@ -62,6 +98,86 @@ namespace pass {
         /// @param password Json with password
         /// @return Password object
         static Password fromJson(const nlohmann::json& password);
+
+        /// @brief Overwrites plaintext fields with zeros, used when decrypted password is no longer needed
+        void wipeSecrets();
+    };
+
+    /// @brief Class with password row as stored in database, text fields are views into PasswordBatch
+    class PasswordRow {
+    public:
+        std::uint32_t id = 0;               // ID of entry
+        std::uint32_t userId = 0;           // ID of user owning this password
+        std::string_view login;             // Login, encrypted or plaintext depending on batch
+        std::string_view password;          // Password, encrypted or plaintext depending on batch
+        std::string_view name;              // Name, encrypted or plaintext depending on batch
+        std::string_view url;               // URL, encrypted or plaintext depending on batch
+        std::string_view notes;             // Notes, encrypted or plaintext depending on batch
+        std::string_view record;            // Sealed record of secret fields, empty in plaintext batch
+        std::string_view options;           // Options for password generation as stored Json
+        std::string_view createdAt;         // Timestamp of creation as stored text
+        std::string_view updatedAt;         // Timestamp of last update as stored text
+        std::int64_t version = 0;           // Vault version in which entry was last changed
+        int strength = -1;                  // Strength score of password from 0 to 4, -1 if unknown
+
+        /// @brief Serializes row as Json object with the same layout as Password::toJson()
+        /// @note Text is written straight into output, so plaintext is not copied into json tree on default heap
+        /// @param output string to append to
+        void appendJson(util::SecureString& output) const;
+
+        /// @brief Serializes rows as Json array
+        /// @param rows rows to serialize
+        /// @param output string to append to
+        static void appendJson(const util::RowBatch<PasswordRow>& rows, util::SecureString& output);
+    };
+
+    /// @brief Flat batch of password rows
+    using PasswordBatch = util::RowBatch<PasswordRow>;
+
+    /// @brief Class with single operation of batched mutation
+    class PasswordMutation {
+    public:
+        /// @brief Type of operation
+        enum class Type {
+            Add,        ///< Add new password
+            Update,     ///< Update existing password
+            Remove      ///< Remove existing password
+        };
+
+        Type type;              // Type of operation
+        Password password;      // Password to add or update, only id is used for Remove
+
+        /// @brief Function to convert Json to PasswordMutation object
+        /// @param mutation Json with operation, e.g. {"op": "delete", "id": 1} or {"op": "add", "password": {...}}
+        /// @return PasswordMutation object
+        /// @throws std::invalid_argument on unknown operation or missing fields
+        static PasswordMutation fromJson(const nlohmann::json& mutation);
+
+        /// @brief Function to convert operation type to string
+        /// @param type operation type
+        /// @return name of operation
+        static std::string typeToString(Type type);
+    };
+
+    /// @brief Class with result of single operation of batched mutation
+    class PasswordMutationResult {
+    public:
+        PasswordMutation::Type type;    // Type of operation
+        std::uint32_t id;               // ID of affected password, new ID for Add
+        bool applied;                   // False when password to update or remove was not found
+
+        /// @brief Function to convert PasswordMutationResult object to Json
+        /// @return json object
+        nlohmann::json toJson() const;
+    };
+
+    /// @brief Class with changes of user vault since given version
+    class PasswordChanges {
+    public:
+        std::int64_t version = 0;               // Current version of vault
+        PasswordBatch changed;                  // Passwords added or updated since given version
+        std::vector<std::uint32_t> removed;     // IDs of passwords removed since given version
+        bool reset = false;                     // Tombstones newer than given version were purged, changed holds full snapshot to replace local vault
     };
 
     /// @brief Interface for password repository
@@ -70,33 +186,118 @@ namespace pass {
         /// @brief Virtual destructor for password repository
         virtual ~IPasswordRepository() = default;
 
-        /// @brief Virtual getter for passwords
-        /// @return list of passwords
-        virtual std::list<Password> getAll() = 0;
+        /// @brief Virtual getter for passwords of user
+        /// @param userId id of user owning passwords
+        /// @return batch of passwords
+        virtual PasswordBatch getAll(const std::uint32_t userId) = 0;
+
+        /// @brief Virtual function to visit all passwords of user without loading them all at once
+        /// @param userId id of user owning passwords
+        /// @param visitor function called for every password in order of ids
+        virtual void forEachOfUser(const std::uint32_t userId, const std::function<void(const Password&)>& visitor) = 0;
         
+        /// @brief Virtual function to read page of passwords of user in order of ids
+        /// @param userId id of user owning passwords
+        /// @param afterId id of last password of previous page, 0 for first page
+        /// @param limit maximal number of passwords
+        /// @return passwords of page
+        virtual std::vector<Password> getPage(const std::uint32_t userId, const std::uint32_t afterId, const std::size_t limit) = 0;
+
+        /// @brief Virtual function to store passwords encrypted again with other key, without changing vault version
+        /// @param passwords encrypted passwords of one user, with version they were read at
+        /// @return number of stored passwords, passwords changed since they were read are skipped
+        virtual std::size_t replaceEncrypted(const std::vector<Password>& passwords) = 0;
+
         /// @brief Virtual function to read password with given id
+        /// @param userId id of user owning password
         /// @param id id of password to read
         /// @return optional password object
-        virtual std::optional<Password> getById(const std::uint32_t& id) = 0;
+        virtual std::optional<Password> getById(const std::uint32_t userId, const std::uint32_t& id) = 0;
         
         /// @brief Virtual function to add new password to repository
         /// @param password password to add
         virtual void add(Password& password) = 0;
+
+        /// @brief Virtual function to add many passwords to repository at once
+        /// @param passwords passwords to add, ids are filled in on success
+        virtual void addBatch(std::vector<Password>& passwords) = 0;
         
         /// @brief Virtual function to update password in repository
         /// @param password password to update
-        virtual void update(const Password& password) = 0;
+        /// @return new version of vault, 0 when no entry was updated
+        virtual std::int64_t update(const Password& password) = 0;
         
         /// @brief Virtual function to remove password from repository
+        /// @param userId id of user owning password
         /// @param id id of password to remove
-        virtual void remove(const std::uint32_t id) = 0;
+        /// @return new version of vault, 0 when no entry was removed
+        virtual std::int64_t remove(const std::uint32_t userId, const std::uint32_t id) = 0;
+
+        /// @brief Virtual function to apply ordered list of mutations atomically
+        /// @param mutations mutations to apply, ids of added passwords are filled in
+        /// @param userId id of user owning mutated passwords
+        /// @return result of every mutation in the same order
+        virtual std::vector<PasswordMutationResult> applyBatch(std::vector<PasswordMutation>& mutations, const std::uint32_t userId) = 0;
+
+        /// @brief Virtual function to read changes of user vault
+        /// @param userId id of user owning passwords
+        /// @param since version known by client, 0 for full snapshot
+        /// @return changes since given version
+        virtual PasswordChanges getChanges(const std::uint32_t userId, const std::int64_t since) = 0;
+
+        /// @brief Virtual function to delete tombstones of removed passwords
+        /// @param before tombstones of passwords removed before this time are deleted
+        /// @return number of deleted tombstones
+        virtual std::size_t purgeTombstones(const std::chrono::system_clock::time_point before) = 0;
+
+        /// @brief Virtual function to find passwords containing all given blind index tokens
+        /// @param userId id of user owning passwords
+        /// @param tokens tokens of query
+        /// @return matching passwords, may contain false positives
+        virtual std::list<Password> search(const std::uint32_t userId, const std::vector<std::int64_t>& tokens) = 0;
+
+        /// @brief Virtual function to read passwords which were stored before search index existed
+        /// @param userId id of user owning passwords
+        /// @return passwords without search tokens
+        virtual std::list<Password> getUnindexed(const std::uint32_t userId) = 0;
+
+        /// @brief Virtual function to find passwords stored for url
+        /// @param userId id of user owning passwords
+        /// @param originToken token of exact origin
+        /// @param siteToken token of registrable domain
+        /// @return matching passwords with flag set when origin matched exactly, exact matches first
+        virtual std::list<std::pair<Password, bool>> matchUrl(const std::uint32_t userId, const std::int64_t originToken, const std::int64_t siteToken) = 0;
+
+        /// @brief Virtual function to find groups of passwords sharing same password
+        /// @param userId id of user owning passwords
+        /// @param emptyFingerprint fingerprint of empty password, stored by older versions and skipped
+        /// @return ids of passwords grouped by fingerprint, only groups with more than one entry
+        virtual std::vector<std::vector<std::uint32_t>> getReuseGroups(const std::uint32_t userId, const std::string& emptyFingerprint) = 0;
+
+        /// @brief Virtual function to find passwords with strength score not above given one
+        /// @param userId id of user owning passwords
+        /// @param maxScore highest reported score
+        /// @return pairs of id and score, weakest first
+        virtual std::vector<std::pair<std::uint32_t, int>> getWeak(const std::uint32_t userId, const int maxScore) = 0;
+
+        /// @brief Virtual function to read passwords which were stored before fingerprints and strength scores existed
+        /// @param userId id of user owning passwords
+        /// @return passwords without fingerprint or strength score
+        virtual std::list<Password> getUnanalyzed(const std::uint32_t userId) = 0;
+
+        /// @brief Virtual function to set fingerprint and strength score of password
+        /// @param password password with id, fingerprint and strength
+        virtual void setAnalysis(const Password& password) = 0;
+
+        /// @brief Virtual function to replace search tokens of password
+        /// @param password password with computed tokens
+        virtual void setSearchTokens(const Password& password) = 0;
     };
 
     /// @brief Thread-safe SQLite repository for password storing implementing Singleton pattern
+    /// @note Per-user tables are stored in shards of DatabaseManager, every query is routed by id of user
     class SQLitePasswordRepository : public IPasswordRepository {
     private:
-        std::shared_ptr<SQLite::Database> db;   // Pointer to database
-
         /// @brief Private constructor for Singleton pattern
         explicit SQLitePasswordRepository();
         
@@ -109,8 +310,69 @@ namespace pass {
         SQLitePasswordRepository(SQLitePasswordRepository&&) = delete;
         SQLitePasswordRepository& operator=(SQLitePasswordRepository&&) = delete;
 
-        /// @brief Initialize database schema
-        void initializeDatabase();
+        /// @brief Initialize schema of per-user tables, run on every shard when it is opened
+        /// @param db database of shard
+        static void initializeDatabase(SQLite::Database& db);
+
+        /// @brief Reads password from current row of query
+        /// @param query query positioned at row
+        /// @return Password object
+        static Password readRow(const SQLite::Statement& query);
+
+        /// @brief Appends current row of query to batch without per-field allocations
+        /// @param query query positioned at row
+        /// @param batch batch to append to
+        static void readRow(const SQLite::Statement& query, PasswordBatch& batch);
+
+        /// @brief Adds column to existing table created by older version
+        /// @param db database of shard
+        /// @param table name of table
+        /// @param column name of column
+        /// @param definition type and constraints of column
+        static void addColumnIfMissing(SQLite::Database& db, const std::string& table, const std::string& column, const std::string& definition);
+
+        /// @brief Binds named parameters of columns shared by INSERT, UPDATE and REENCRYPT statements (:login to :record)
+        /// @param query INSERT, UPDATE or REENCRYPT statement
+        /// @param password password to bind
+        static void bindColumns(SQLite::Statement& query, const Password& password);
+
+        /// @brief Replaces blind index tokens of password
+        /// @param removeTokens prepared REMOVE_TOKENS_QUERY
+        /// @param insertTokens prepared INSERT_TOKEN_QUERY
+        /// @param password password with id and search tokens
+        static void writeSearchTokens(SQLite::Statement& removeTokens, SQLite::Statement& insertTokens, const Password& password);
+
+        /// @brief Increments vault version of user, must be called inside transaction
+        /// @param lease lease of shard holding vault
+        /// @param userId ID of user owning vault
+        /// @return new version
+        static std::int64_t nextVersion(DatabaseManager::Lease& lease, const std::uint32_t userId);
+
+        static constexpr const char* VERSION_QUERY = "SELECT version FROM vault_versions WHERE userId = ?";
+        static constexpr const char* SYNC_VERSIONS_QUERY = "SELECT version, purgedVersion FROM vault_versions WHERE userId = ?";
+
+        /// @brief Statements writing whole entry use named parameters, so columns can be added without renumbering binds
+        static constexpr const char* INSERT_QUERY =
+            "INSERT INTO passwords (login, userId, password, name, url, notes, options, fingerprint, strength, record, createdAt, updatedAt, version) "
+            "VALUES (:login, :userId, :password, :name, :url, :notes, :options, :fingerprint, :strength, :record, :createdAt, :updatedAt, :version)";
+
+        static constexpr const char* UPDATE_QUERY =
+            "UPDATE passwords SET login = :login, userId = :userId, password = :password, name = :name, url = :url, notes = :notes, "
+            "options = :options, fingerprint = :fingerprint, strength = :strength, record = :record, updatedAt = :updatedAt, version = :version "
+            "WHERE id = :id AND userId = :userId AND deleted = 0";
+
+        static constexpr const char* REENCRYPT_QUERY =
+            "UPDATE passwords SET login = :login, userId = :userId, password = :password, name = :name, url = :url, notes = :notes, "
+            "options = :options, fingerprint = :fingerprint, strength = :strength, record = :record "
+            "WHERE id = :id AND userId = :userId AND version = :version AND deleted = 0";
+
+        static constexpr const char* REMOVE_TOKENS_QUERY = "DELETE FROM password_tokens WHERE passwordId = ?";
+        static constexpr const char* INSERT_TOKEN_QUERY = "INSERT INTO password_tokens (passwordId, userId, token) VALUES (?, ?, ?)";
+
+        /// @brief Removed entries are kept as tombstones without secrets, so clients can sync deletions
+        static constexpr const char* REMOVE_QUERY =
+            "UPDATE passwords SET login = '', password = '', name = '', url = '', notes = '', fingerprint = NULL, strength = NULL, record = NULL, deleted = 1, "
+            "updatedAt = ?, version = ? WHERE id = ? AND userId = ? AND deleted = 0";
 
     public:
         /// @brief Get singleton instance of repository
@@ -118,35 +380,158 @@ namespace pass {
         /// @return Reference to repository instance
         static SQLitePasswordRepository& getInstance();
 
-        /// @brief Get all passwords from repository
-        /// @return List of all passwords
-        std::list<Password> getAll() override;
+        /// @brief Get all passwords of user from repository
+        /// @param userId ID of user owning passwords
+        /// @return Batch of passwords
+        PasswordBatch getAll(const std::uint32_t userId) override;
+
+        /// @brief Visit all passwords of user page by page
+        /// @param userId ID of user owning passwords
+        /// @param visitor Function called for every password, database is not locked during the call
+        /// @note At most PAGE_SIZE rows are held in memory at once
+        void forEachOfUser(const std::uint32_t userId, const std::function<void(const Password&)>& visitor) override;
+
+        /// @brief Number of rows read under single lock by forEachOfUser
+        static constexpr std::size_t PAGE_SIZE = 256;
+
+        /// @brief Read page of live passwords of user using keyset pagination
+        /// @param userId ID of user owning passwords
+        /// @param afterId ID of last password of previous page, 0 for first page
+        /// @param limit Maximal number of passwords
+        /// @return Passwords of page in order of ids
+        std::vector<Password> getPage(const std::uint32_t userId, const std::uint32_t afterId, const std::size_t limit) override;
+
+        /// @brief Store passwords encrypted again with other key in single transaction, used by key rotation
+        /// @param passwords Encrypted passwords of one user, with version they were read at
+        /// @return Number of stored passwords, passwords changed since they were read are skipped
+        /// and have to be checked again by caller, see PasswordCrypto::needsPreviousPassword()
+        /// @note Plaintext does not change, so vault version and updatedAt are kept and no change event is published
+        std::size_t replaceEncrypted(const std::vector<Password>& passwords) override;
 
         /// @brief Get password by its id
+        /// @param userId ID of user owning password
         /// @param id ID of password to retrieve
         /// @return Optional containing password if found
-        std::optional<Password> getById(const std::uint32_t& id) override;
+        std::optional<Password> getById(const std::uint32_t userId, const std::uint32_t& id) override;
 
         /// @brief Add new password to repository
         /// @param password Password to add
         void add(Password& password) override;
 
+        /// @brief Add many passwords using one prepared statement per shard
+        /// @param passwords Passwords to add, ids are filled in on success
+        /// @note Rows of each user are committed in transactions of BATCH_SIZE, so a failure keeps already committed batches
+        void addBatch(std::vector<Password>& passwords) override;
+
+        /// @brief Number of rows inserted in single transaction by addBatch
+        static constexpr std::size_t BATCH_SIZE = 1000;
+
         /// @brief Update existing password in repository
         /// @param password Password to update
-        void update(const Password& password) override;
+        /// @return New version of vault, 0 when no entry was updated
+        std::int64_t update(const Password& password) override;
 
         /// @brief Remove password from repository
+        /// @param userId ID of user owning password, other users entries are never touched
         /// @param id ID of password to remove
-        void remove(const std::uint32_t id) override;
+        /// @return New version of vault, 0 when no entry was removed
+        std::int64_t remove(const std::uint32_t userId, const std::uint32_t id) override;
+
+        /// @brief Insert password inside transaction of lease, used by add and WriteQueue
+        /// @param lease lease of shard of user owning password
+        /// @param password Password to add, id, timestamps and version are filled in
+        /// @return New version of vault
+        static std::int64_t applyAdd(DatabaseManager::Lease& lease, Password& password);
+
+        /// @brief Update password inside transaction of lease, used by update and WriteQueue
+        /// @param lease lease of shard of user owning password
+        /// @param password Password to update
+        /// @return New version of vault, 0 when no entry was updated and transaction must be rolled back
+        static std::int64_t applyUpdate(DatabaseManager::Lease& lease, const Password& password);
+
+        /// @brief Remove password inside transaction of lease, used by remove and WriteQueue
+        /// @param lease lease of shard of user owning password
+        /// @param userId ID of user owning password
+        /// @param id ID of password to remove
+        /// @return New version of vault, 0 when no entry was removed and transaction must be rolled back
+        static std::int64_t applyRemove(DatabaseManager::Lease& lease, const std::uint32_t userId, const std::uint32_t id);
+
+        /// @brief Apply ordered list of mutations in single transaction
+        /// @param mutations Mutations to apply, ids of added passwords are filled in
+        /// @param userId ID of user owning mutated passwords, other users entries are never touched
+        /// @return Result of every mutation in the same order
+        /// @note Either all mutations are committed or, when any of them throws, none
+        std::vector<PasswordMutationResult> applyBatch(std::vector<PasswordMutation>& mutations, const std::uint32_t userId) override;
+
+        /// @brief Read changes of user vault
+        /// @param userId ID of user owning passwords
+        /// @param since Version known by client, 0 for full snapshot without tombstones
+        /// @return Changes since given version, full snapshot with reset flag when tombstones after given version were purged
+        PasswordChanges getChanges(const std::uint32_t userId, const std::int64_t since) override;
+
+        /// @brief Delete tombstones of removed passwords in every shard
+        /// @note Highest purged version of every vault is stored, so clients syncing from before it get full snapshot
+        /// @param before tombstones of passwords removed before this time are deleted
+        /// @return Number of deleted tombstones
+        std::size_t purgeTombstones(const std::chrono::system_clock::time_point before) override;
+
+        /// @brief Find passwords containing all given blind index tokens using index on (userId, token)
+        /// @param userId ID of user owning passwords
+        /// @param tokens Tokens of query
+        /// @return Matching passwords, may contain false positives
+        std::list<Password> search(const std::uint32_t userId, const std::vector<std::int64_t>& tokens) override;
+
+        /// @brief Read passwords without search tokens
+        /// @param userId ID of user owning passwords
+        /// @return Passwords stored before search index existed
+        std::list<Password> getUnindexed(const std::uint32_t userId) override;
 
-        /// @brief Execute custom database operation with automatic locking
+        /// @brief Find passwords stored for url with single lookup in index on (userId, token)
+        /// @param userId ID of user owning passwords
+        /// @param originToken Token of exact origin
+        /// @param siteToken Token of registrable domain
+        /// @return Matching passwords with flag set when origin matched exactly, exact matches first
+        std::list<std::pair<Password, bool>> matchUrl(const std::uint32_t userId, const std::int64_t originToken, const std::int64_t siteToken) override;
+
+        /// @brief Find groups of passwords sharing same password with single GROUP BY over fingerprints
+        /// @param userId ID of user owning passwords
+        /// @param emptyFingerprint Fingerprint of empty password, stored by older versions and skipped
+        /// @return Ids of passwords grouped by fingerprint, only groups with more than one entry
+        std::vector<std::vector<std::uint32_t>> getReuseGroups(const std::uint32_t userId, const std::string& emptyFingerprint) override;
+
+        /// @brief Find passwords with stored strength score not above given one
+        /// @param userId ID of user owning passwords
+        /// @param maxScore Highest reported score
+        /// @return Pairs of id and score, weakest first
+        std::vector<std::pair<std::uint32_t, int>> getWeak(const std::uint32_t userId, const int maxScore) override;
+
+        /// @brief Read passwords without fingerprint or strength score
+        /// @param userId ID of user owning passwords
+        /// @return Passwords stored before fingerprints and strength scores existed
+        std::list<Password> getUnanalyzed(const std::uint32_t userId) override;
+
+        /// @brief Set fingerprint and strength score of password
+        /// @param password Password with id, fingerprint and strength
+        void setAnalysis(const Password& password) override;
+
+        /// @brief Replace search tokens of password
+        /// @param password Password with computed tokens
+        void setSearchTokens(const Password& password) override;
+
+        /// @brief Moves per-user tables left in main database into shards, run at startup after sharding is configured
+        /// @return number of moved users
+        /// @note Rows keep their ids, moved rows are deleted from main database in the same transaction
+        std::size_t migrateToShards();
+
+        /// @brief Execute custom database operation on shard of user with automatic locking
         /// @tparam Func Type of lambda function
+        /// @param userId ID of user whose shard is used
         /// @param operation Lambda function with database operation
         /// @return Result of operation
         template<typename Func>
-        auto executeOperation(Func operation) {
-            std::lock_guard<std::mutex> lock(DatabaseManager::getInstance().getMutex());
-            return operation(db.get());
+        auto executeOperation(const std::uint32_t userId, Func operation) {
+            auto lease = DatabaseManager::getInstance().shard(userId);
+            return operation(&lease.database());
         }
     };
 
@@ -155,39 +540,112 @@ namespace pass {
     private:
         SQLitePasswordRepository& repo;    // Reference to repository singleton
         static std::filesystem::path dbPath;
+
+        /// @brief Computes fingerprints and strength scores of passwords stored before they existed
+        /// @param userId ID of user owning passwords
+        void analyzeUnanalyzed(const std::uint32_t userId);
+
+        /// @brief Writes stored entry through to VaultCache when vault of user is cached
+        /// @param userId ID of user owning password
+        /// @param id ID of written password
+        /// @param version version of vault created by the write, 0 when nothing was written
+        void writeThrough(const std::uint32_t userId, const std::uint32_t id, const std::int64_t version);
         
     public:
         /// @brief Constructor
         explicit PasswordManager();
 
-        /// @brief Get all passwords
-        /// @return List of all passwords
-        std::list<Password> getAllPasswords();
+        /// @brief Get all passwords of user
+        /// @param userId ID of user owning passwords
+        /// @return Batch of passwords
+        PasswordBatch getAllPasswords(const std::uint32_t userId);
+
+        /// @brief Get all passwords of user decrypted and serialized as JSON array, served from VaultCache when enabled
+        /// @param userId ID of user owning passwords
+        /// @return Array allocated from arena of calling thread
+        util::SecureString listPasswords(const std::uint32_t userId);
+
+        /// @brief Visit all passwords of user without loading them all at once
+        /// @param userId ID of user owning passwords
+        /// @param visitor Function called for every password
+        void forEachPasswordOfUser(const std::uint32_t userId, const std::function<void(const Password&)>& visitor);
 
         /// @brief Get password by id
+        /// @param userId ID of user owning password
         /// @param id ID of password to retrieve
         /// @return Optional containing password if found
-        std::optional<Password> getPasswordById(const std::uint32_t& id);
+        std::optional<Password> getPasswordById(const std::uint32_t userId, const std::uint32_t& id);
 
         /// @brief Add new password
         /// @param password Password to add
         void addPassword(Password& password);
 
+        /// @brief Add many passwords at once
+        /// @param passwords Passwords to add
+        void addPasswords(std::vector<Password>& passwords);
+
         /// @brief Update existing password
         /// @param password Password to update
         void updatePassword(const Password& password);
 
         /// @brief Remove password
+        /// @param userId ID of user owning password
         /// @param id ID of password to remove
-        void removePassword(const std::uint32_t id);
+        void removePassword(const std::uint32_t userId, const std::uint32_t id);
+
+        /// @brief Apply many mutations atomically
+        /// @param mutations Mutations to apply
+        /// @param userId ID of user owning mutated passwords
+        /// @return Result of every mutation
+        std::vector<PasswordMutationResult> applyMutations(std::vector<PasswordMutation>& mutations, const std::uint32_t userId);
+
+        /// @brief Get changes of user vault
+        /// @param userId ID of user owning passwords
+        /// @param since Version known by client, 0 for full snapshot
+        /// @return Changes since given version
+        PasswordChanges getChanges(const std::uint32_t userId, const std::int64_t since);
 
-        /// @brief Execute custom database operation
+        /// @brief Delete tombstones of passwords removed longer than retention ago
+        /// @param retention time tombstones are kept for syncing clients
+        /// @return Number of deleted tombstones
+        std::size_t purgeTombstones(const std::chrono::hours retention);
+
+        /// @brief Search passwords of user by name, url and login without decrypting whole vault
+        /// @param userId ID of user owning passwords
+        /// @param query Plaintext query
+        /// @return Decrypted passwords matching query
+        std::list<Password> searchPasswords(const std::uint32_t userId, const std::string& query);
+
+        /// @brief Find credentials for url, used by autofill
+        /// @param userId ID of user owning passwords
+        /// @param url Url of page
+        /// @return Decrypted passwords of same site with flag set when origin matched exactly, exact matches first
+        std::list<std::pair<Password, bool>> matchPasswords(const std::uint32_t userId, const std::string& url);
+
+        /// @brief Indexes passwords of user stored before current search index format, run by SearchBackfill
+        /// @param userId ID of user owning passwords
+        /// @return Number of indexed passwords
+        std::size_t indexUnindexed(const std::uint32_t userId);
+
+        /// @brief Find passwords used by more than one entry, without decrypting vault
+        /// @param userId ID of user owning passwords
+        /// @return Ids of entries grouped by shared password
+        std::vector<std::vector<std::uint32_t>> getReusedPasswords(const std::uint32_t userId);
+
+        /// @brief Find weak passwords using stored strength scores, without decrypting vault
+        /// @param userId ID of user owning passwords
+        /// @param maxScore Highest reported score
+        /// @return Pairs of entry id and score, weakest first
+        std::vector<std::pair<std::uint32_t, int>> getWeakPasswords(const std::uint32_t userId, const int maxScore);
+
+        /// @brief Execute custom database operation on shard of user
         /// @tparam Func Type of lambda function
+        /// @param userId ID of user whose shard is used
         /// @param operation Lambda function with database operation
         /// @return Result of operation
         template<typename Func>
-        auto executeCustomOperation(Func operation) {
-            return repo.executeOperation(operation);
+        auto executeCustomOperation(const std::uint32_t userId, Func operation) {
+            return repo.executeOperation(userId, operation);
         }
     };
 
@@ -197,10 +655,30 @@ namespace pass {
         /// @brief Generate password based on given options
         /// @param options Options for password generation
         /// @return Generated password as string
+        /// @throws std::runtime_error if no password outside breach corpus was generated
         static std::string generate(const Password::Options& options);
 
+        /// @brief Estimate entropy of passwords generated with given options
+        /// @param options Options for password generation
+        /// @return entropy in bits, assuming attacker knows options and wordlist
+        static double entropy(const Password::Options& options);
+
+        static constexpr int MAX_GENERATION_ATTEMPTS = 16;     // Attempts to generate password outside breach corpus
+        static constexpr std::uint8_t MAX_WORD_COUNT = 32;     // Limit of words of passphrase
+        static constexpr std::size_t MAX_SEPARATOR_LENGTH = 4; // Limit of length of passphrase word separator
+
     private:
         static void validateOptions(const Password::Options& options);
+
+        /// @brief Generate single passphrase candidate from words of wordlist
+        /// @param options Options for password generation
+        /// @return Generated passphrase as string
+        static std::string generatePassphrase(const Password::Options& options);
+
+        /// @brief Generate single password candidate
+        /// @param options Options for password generation
+        /// @return Generated password as string
+        static std::string generateCandidate(const Password::Options& options);
     };
 
     /// @brief Class for managing password encryption
@@ -211,11 +689,65 @@ namespace pass {
         /// @param id user id for encryption
         /// @return encrypted password object
         static Password encrypt(const Password& password, const std::uint32_t& id);
+
+        /// @brief Function to encrypt many password objects in place using all available cores of EncryptionPool
+        /// @param passwords password objects to encrypt
+        /// @param id user id for encryption
+        static void encryptBatch(std::vector<Password>& passwords, const std::uint32_t& id);
         
         /// @brief Function to decrypt secrets in password object
         /// @param password password object
         /// @param id user id for decryption
         /// @return decrypted password
         static Password decrypt(const Password& password, const std::uint32_t& id);
+
+        /// @brief Function to check whether stored password is still sealed with previous password of user
+        /// @param password encrypted password object
+        /// @param id user id
+        /// @return true when any envelope opens only with previous password, see Crypto::setPreviousPassword()
+        static bool needsPreviousPassword(const Password& password, const std::uint32_t& id);
+
+        /// @brief Function to decrypt password row into batch, plaintext is written directly into buffer of batch
+        /// @param password encrypted password row
+        /// @param id user id for decryption
+        /// @param output batch receiving decrypted row, e.g. allocated from SecureArena::resource()
+        static void decrypt(const PasswordRow& password, const std::uint32_t& id, PasswordBatch& output);
+
+        /// @brief Function to compute keyed fingerprint of password, used to detect reuse without decryption
+        /// @param password plaintext password
+        /// @param id user id
+        /// @return fingerprint in Base64 format, empty for empty password
+        static std::string fingerprint(const std::string& password, const std::uint32_t& id);
+
+        /// @brief Function to compute fingerprint which older versions stored for empty passwords
+        /// @param id user id
+        /// @return fingerprint in Base64 format
+        static std::string emptyFingerprint(const std::uint32_t& id);
+
+        /// @brief Function to choose storage format of newly encrypted passwords
+        /// @param enabled true to seal all secret fields into one record with single AEAD operation,
+        /// false to encrypt every field separately; both formats are always readable
+        static void setRecordEncryption(bool enabled);
+
+        static constexpr std::uint8_t RECORD_VERSION = 1;     // First byte of serialized record
+
+    private:
+        static std::atomic<bool> recordEncryption;     // Storage format of newly encrypted passwords
+
+        /// @brief Context of fingerprint key of user
+        /// @param id user id
+        /// @return context for Crypto::contextKey
+        static std::string fingerprintContext(const std::uint32_t id);
+
+        /// @brief Encrypts secret fields of password in place using current storage format
+        /// @param crypto crypto of user
+        /// @param password password with plaintext secrets
+        static void seal(Crypto& crypto, Password& password);
+
+        /// @brief Splits decrypted record into secret fields
+        /// @param record decrypted record
+        /// @return login, password, name, url and notes as views into record
+        /// @throws std::runtime_error if record is malformed
+        static std::array<std::string_view, 5> parseRecord(std::string_view record);
     };
 }
\ No newline at end of file
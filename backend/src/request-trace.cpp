@@ -0,0 +1,144 @@
+#include <request-trace.hpp>
+#include <log.hpp>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+namespace timing {
+    namespace {
+        /// @brief Measures ticks of clock per microsecond
+        double measureFrequency() {
+#ifdef PASSWORD_FUCKER_TSC
+            // Error of a few percent does not matter for breakdown of stages
+            auto wallStart = std::chrono::steady_clock::now();
+            auto ticksStart = Clock::now();
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            auto ticks = Clock::now() - ticksStart;
+            auto wall = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - wallStart).count();
+            return wall > 0 ? static_cast<double>(ticks) / wall : 1.0;
+#else
+            using Period = std::chrono::steady_clock::period;
+            return static_cast<double>(Period::den) / (static_cast<double>(Period::num) * 1'000'000.0);
+#endif
+        }
+
+        /// @brief Gets ticks of clock per microsecond, measured on first use
+        double frequency() {
+            static const double ticksPerMicrosecond = measureFrequency();
+            return ticksPerMicrosecond;
+        }
+
+        thread_local std::shared_ptr<RequestTrace> activeTrace;     // Trace of request handled by current thread
+    }
+
+    void Clock::calibrate() {
+        Logger::info("Clock of request timings runs at {:.0f} ticks per microsecond", frequency());
+    }
+
+    double Clock::toMicroseconds(std::uint64_t ticks) noexcept {
+        return static_cast<double>(ticks) / frequency();
+    }
+
+    std::uint64_t Clock::toTicks(std::chrono::microseconds duration) noexcept {
+        return static_cast<std::uint64_t>(static_cast<double>(duration.count()) * frequency());
+    }
+
+    std::atomic<std::uint64_t> RequestTrace::nextId{1};
+    std::atomic<std::uint64_t> RequestTrace::slowTicks{0};
+
+    RequestTrace::Scope::Scope(std::shared_ptr<RequestTrace> trace) : previous(std::exchange(activeTrace, std::move(trace))) {
+        Logger::setRequestId(activeTrace ? activeTrace->id() : 0);
+    }
+
+    RequestTrace::Scope::~Scope() {
+        activeTrace = std::move(previous);
+        Logger::setRequestId(activeTrace ? activeTrace->id() : 0);
+    }
+
+    RequestTrace::RequestTrace(std::string method, std::string path)
+        : requestId(nextId.fetch_add(1, std::memory_order_relaxed)), method(std::move(method)), path(std::move(path)), started(Clock::now()) {
+        stages.reserve(8);
+    }
+
+    RequestTrace::~RequestTrace() {
+        auto threshold = slowTicks.load(std::memory_order_relaxed);
+        if (threshold == 0 || Clock::now() - started < threshold) {
+            return;
+        }
+
+        // Destructor must not throw, report is lost rather than request
+        try {
+            Logger::warn("Slow request: {}", toJson().dump());
+        }
+        catch (...) {
+        }
+    }
+
+    std::uint64_t RequestTrace::id() const noexcept {
+        return requestId;
+    }
+
+    void RequestTrace::add(const char* name, std::uint64_t ticks) {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (auto& stage : stages) {
+            if (stage.name == name || std::string_view(stage.name) == name) {
+                stage.ticks += ticks;
+                ++stage.count;
+                return;
+            }
+        }
+        stages.push_back(Stage{ name, ticks, 1 });
+    }
+
+    void RequestTrace::setStatus(int status) {
+        std::lock_guard<std::mutex> lock(mtx);
+        this->status = status;
+    }
+
+    nlohmann::json RequestTrace::toJson() {
+        auto total = Clock::now() - started;
+        std::lock_guard<std::mutex> lock(mtx);
+        nlohmann::json breakdown = nlohmann::json::array();
+        for (const auto& stage : stages) {
+            breakdown.push_back({
+                { "stage", stage.name },
+                { "microseconds", static_cast<std::uint64_t>(Clock::toMicroseconds(stage.ticks)) },
+                { "count", stage.count }
+            });
+        }
+        return {
+            { "requestId", requestId },
+            { "method", method },
+            { "path", path },
+            { "status", status },
+            { "microseconds", static_cast<std::uint64_t>(Clock::toMicroseconds(total)) },
+            { "stages", std::move(breakdown) }
+        };
+    }
+
+    const std::shared_ptr<RequestTrace>& RequestTrace::current() noexcept {
+        return activeTrace;
+    }
+
+    void RequestTrace::setSlowThreshold(std::chrono::milliseconds threshold) {
+        slowTicks.store(Clock::toTicks(threshold), std::memory_order_relaxed);
+    }
+
+    ScopedStage::ScopedStage(const char* name) noexcept : trace(activeTrace.get()), name(name) {
+        if (trace) {
+            started = Clock::now();
+        }
+    }
+
+    ScopedStage::~ScopedStage() {
+        if (!trace) {
+            return;
+        }
+        try {
+            trace->add(name, Clock::now() - started);
+        }
+        catch (...) {
+            // Lost timing is not worth failing request
+        }
+    }
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <fix.hpp>
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define PASSWORD_FUCKER_TSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PASSWORD_FUCKER_TSC
+#endif
+
+/// @brief Namespace for timing of requests
+namespace timing {
+    /// @brief Monotonic clock reading time stamp counter of CPU, a few cycles per reading
+    /// @note Without TSC (other architectures) ticks of steady_clock are used
+    class Clock {
+    public:
+        /// @brief Reads clock
+        /// @return ticks since unspecified point
+        static std::uint64_t now() noexcept {
+#ifdef PASSWORD_FUCKER_TSC
+            return __rdtsc();
+#else
+            return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+        }
+
+        /// @brief Measures frequency of clock against steady_clock, done at startup so first report does not wait for it
+        static void calibrate();
+
+        /// @brief Converts ticks to microseconds
+        /// @param ticks ticks of clock
+        /// @return microseconds
+        static double toMicroseconds(std::uint64_t ticks) noexcept;
+
+        /// @brief Converts duration to ticks
+        /// @param duration duration to convert
+        /// @return ticks of clock
+        static std::uint64_t toTicks(std::chrono::microseconds duration) noexcept;
+    };
+
+    /// @brief Timings of stages of one request, reported as slow request when threshold is exceeded
+    /// @note Trace is shared by HTTP thread and executor completing the request, the last one releasing it reports.
+    /// Stages of the same name are summed, so e.g. all decryptions of a vault show as one stage with a count.
+    /// Stages may nest, so they do not have to add up to total time.
+    class RequestTrace {
+    public:
+        /// @brief Summed time of one stage
+        class Stage {
+        public:
+            const char* name = nullptr;         // Name of stage, string literal
+            std::uint64_t ticks = 0;            // Summed ticks of stage
+            std::uint32_t count = 0;            // Times stage was entered
+        };
+
+        /// @brief Makes trace of request active on current thread, so stages and log messages are bound to it
+        class Scope {
+        public:
+            /// @brief Constructor, activates trace
+            /// @param trace trace of request, nullptr deactivates tracing
+            explicit Scope(std::shared_ptr<RequestTrace> trace);
+
+            /// @brief Destructor, restores previously active trace
+            ~Scope();
+
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+
+        private:
+            std::shared_ptr<RequestTrace> previous;     // Trace active before
+        };
+
+        /// @brief Constructor, starts clock of request and assigns next request ID
+        /// @param method HTTP method
+        /// @param path path of request
+        RequestTrace(std::string method, std::string path);
+
+        /// @brief Destructor, logs slow request with breakdown of stages
+        ~RequestTrace();
+
+        RequestTrace(const RequestTrace&) = delete;
+        RequestTrace& operator=(const RequestTrace&) = delete;
+
+        /// @brief Gets ID of request
+        /// @return ID, unique since start of server
+        std::uint64_t id() const noexcept;
+
+        /// @brief Adds time to stage
+        /// @param name name of stage, string literal
+        /// @param ticks ticks of clock spent in stage
+        void add(const char* name, std::uint64_t ticks);
+
+        /// @brief Sets HTTP status of response
+        /// @param status HTTP status
+        void setStatus(int status);
+
+        /// @brief Function to convert RequestTrace object to Json
+        /// @return json object
+        nlohmann::json toJson();
+
+        /// @brief Gets trace active on current thread
+        /// @return trace, nullptr outside of request
+        static const std::shared_ptr<RequestTrace>& current() noexcept;
+
+        /// @brief Sets time after which request is logged as slow
+        /// @param threshold threshold, 0 disables slow request log
+        static void setSlowThreshold(std::chrono::milliseconds threshold);
+
+    private:
+        const std::uint64_t requestId;          // ID of request
+        const std::string method;               // HTTP method
+        const std::string path;                 // Path of request
+        const std::uint64_t started;            // Ticks when request was received
+        int status = 0;                         // HTTP status of response, 0 when not known
+        std::vector<Stage> stages;              // Stages in order of first entry
+        std::mutex mtx;                         // Mutex guarding status and stages
+
+        static std::atomic<std::uint64_t> nextId;           // ID of next request
+        static std::atomic<std::uint64_t> slowTicks;        // Threshold of slow request in ticks, 0 when disabled
+    };
+
+    /// @brief Measures enclosing scope as stage of request active on current thread
+    /// @note Outside of request only a thread local pointer is read
+    class ScopedStage {
+    public:
+        /// @brief Constructor, starts stage
+        /// @param name name of stage, string literal
+        explicit ScopedStage(const char* name) noexcept;
+
+        /// @brief Destructor, adds time of stage to request
+        ~ScopedStage();
+
+        ScopedStage(const ScopedStage&) = delete;
+        ScopedStage& operator=(const ScopedStage&) = delete;
+
+    private:
+        RequestTrace* trace;                    // Trace of request, kept alive by its Scope
+        const char* name;                       // Name of stage
+        std::uint64_t started = 0;              // Ticks when stage started
+    };
+}
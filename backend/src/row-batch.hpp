@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+namespace util {
+    /// @brief Flat batch of rows read from database
+    /// @note Rows are fixed-size records stored in one vector and their text fields are views into
+    /// one monotonic buffer owned by batch, so reading N rows costs a few allocations instead of
+    /// N list nodes and several strings per row. Views stay valid as long as batch lives, also after move.
+    /// @tparam Row record type with std::string_view text fields
+    template <typename Row>
+    class RowBatch {
+    public:
+        using const_iterator = typename std::vector<Row>::const_iterator;
+
+        /// @brief Constructor
+        /// @param upstream resource from which text buffer is allocated, e.g. SecureArena::resource() for plaintext
+        explicit RowBatch(std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+            : buffer(std::make_unique<std::pmr::monotonic_buffer_resource>(INITIAL_BUFFER_SIZE, upstream)) {}
+
+        /// @brief Delete copy constructor and assignment operator
+        RowBatch(const RowBatch&) = delete;
+        RowBatch& operator=(const RowBatch&) = delete;
+
+        /// @brief Move constructor and assignment operator, views of rows remain valid
+        RowBatch(RowBatch&&) noexcept = default;
+        RowBatch& operator=(RowBatch&&) noexcept = default;
+
+        /// @brief Appends default constructed row
+        /// @return reference to new row, valid until next add()
+        Row& add() {
+            return rows.emplace_back();
+        }
+
+        /// @brief Copies text into buffer of batch
+        /// @param text text to copy
+        /// @return view of copy, valid as long as batch
+        std::string_view store(std::string_view text) {
+            if (text.empty()) {
+                return {};
+            }
+            auto data = static_cast<char*>(buffer->allocate(text.size(), 1));
+            std::memcpy(data, text.data(), text.size());
+            return std::string_view(data, text.size());
+        }
+
+        /// @brief Gets memory resource of text buffer, lets producers write text in place
+        /// @return memory resource released together with batch
+        std::pmr::memory_resource& resource() {
+            return *buffer;
+        }
+
+        /// @brief Reserves space for rows
+        /// @param count expected number of rows
+        void reserve(std::size_t count) {
+            rows.reserve(count);
+        }
+
+        std::size_t size() const { return rows.size(); }
+        bool empty() const { return rows.empty(); }
+        const Row& operator[](std::size_t index) const { return rows[index]; }
+        const_iterator begin() const { return rows.begin(); }
+        const_iterator end() const { return rows.end(); }
+
+        static constexpr std::size_t INITIAL_BUFFER_SIZE = 16 * 1024;     // First block of text buffer, grows geometrically
+
+    private:
+        std::unique_ptr<std::pmr::monotonic_buffer_resource> buffer;    // Text of all rows
+        std::vector<Row> rows;                                          // Fixed-size records
+    };
+}
@@ -0,0 +1,68 @@
+#include <search-backfill.hpp>
+#include <passwords.hpp>
+#include <log.hpp>
+
+namespace pass {
+    SearchBackfill& SearchBackfill::getInstance() {
+        static SearchBackfill backfill;
+        return backfill;
+    }
+
+    SearchBackfill::~SearchBackfill() {
+        stop();
+    }
+
+    void SearchBackfill::start() {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!worker.joinable()) {
+            worker = std::jthread([this](std::stop_token stopToken) { run(stopToken); });
+        }
+    }
+
+    void SearchBackfill::stop() {
+        if (worker.joinable()) {
+            worker.request_stop();
+            cv.notify_all();
+            worker.join();
+        }
+    }
+
+    void SearchBackfill::schedule(const std::uint32_t userId) {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (!scheduled.insert(userId).second) {
+                return;
+            }
+            queue.push_back(userId);
+        }
+        cv.notify_all();
+    }
+
+    void SearchBackfill::run(std::stop_token stopToken) {
+        while (true) {
+            std::uint32_t userId = 0;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv.wait(lock, stopToken, [this]() { return !queue.empty(); });
+                if (stopToken.stop_requested()) {
+                    return;
+                }
+                userId = queue.front();
+                queue.pop_front();
+            }
+
+            // Failed user (e.g. logged out meanwhile) is indexed again after next login
+            try {
+                auto indexed = PasswordManager().indexUnindexed(userId);
+                if (indexed > 0) {
+                    Logger::info("Indexed {} passwords of user {} for search", indexed, userId);
+                }
+            }
+            catch (const std::exception& e) {
+                Logger::warn("Could not index passwords of user {} for search: {}", userId, e.what());
+                std::lock_guard<std::mutex> lock(mtx);
+                scheduled.erase(userId);
+            }
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <fix.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+
+namespace pass {
+    /// @brief Background indexing of passwords stored before current search index format, implementing Singleton pattern
+    /// @note Every write indexes its entry, so only entries older than the index need it. They are indexed once per user
+    /// after login, so search and url lookup stay plain token lookups. Until backfill of user finishes, such entries
+    /// are not found by them.
+    class SearchBackfill {
+    public:
+        /// @brief Get singleton instance of backfill
+        /// @return Reference to backfill instance
+        static SearchBackfill& getInstance();
+
+        /// @brief Delete copy, assignment, move, move assignment constructor
+        SearchBackfill(const SearchBackfill&) = delete;
+        SearchBackfill& operator=(const SearchBackfill&) = delete;
+        SearchBackfill(SearchBackfill&&) = delete;
+        SearchBackfill& operator=(SearchBackfill&&) = delete;
+
+        /// @brief Starts worker thread
+        void start();
+
+        /// @brief Stops worker thread, queued users are indexed after their next login
+        void stop();
+
+        /// @brief Queues indexing of user unless it already ran since start of server, called after login
+        /// @param userId ID of user whose crypto is registered
+        void schedule(const std::uint32_t userId);
+
+    private:
+        /// @brief Private constructor for Singleton pattern
+        SearchBackfill() = default;
+
+        /// @brief Private destructor
+        ~SearchBackfill();
+
+        /// @brief Worker thread loop
+        /// @param stopToken token signalling stop request
+        void run(std::stop_token stopToken);
+
+        std::deque<std::uint32_t> queue;                // Users waiting for worker thread
+        std::unordered_set<std::uint32_t> scheduled;    // Users queued or already indexed
+        std::mutex mtx;                                 // Mutex guarding queue and scheduled
+        std::condition_variable_any cv;                 // Signals queued user or stop
+        std::jthread worker;                            // Worker thread
+    };
+}
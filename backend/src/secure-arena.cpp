@@ -0,0 +1,219 @@
+#include <secure-arena.hpp>
+#include <algorithm>
+#include <new>
+#include <ostream>
+#include <streambuf>
+
+namespace util {
+    thread_local int SecureArena::scopeDepth = 0;
+
+    namespace {
+        /// @brief Stream buffer appending to secure string, lets nlohmann serialize without temporary std::string
+        class SecureStringBuffer : public std::streambuf {
+        public:
+            explicit SecureStringBuffer(SecureString& output) : output(output) {}
+
+        protected:
+            int_type overflow(int_type c) override {
+                if (!traits_type::eq_int_type(c, traits_type::eof())) {
+                    output.push_back(traits_type::to_char_type(c));
+                }
+                return traits_type::not_eof(c);
+            }
+
+            std::streamsize xsputn(const char* data, std::streamsize count) override {
+                output.append(data, static_cast<std::size_t>(count));
+                return count;
+            }
+
+        private:
+            SecureString& output;
+        };
+
+        /// @brief Gets size of memory page
+        /// @return page size in bytes
+        std::size_t pageSize() {
+            static const std::size_t size = [] {
+                SYSTEM_INFO info;
+                GetSystemInfo(&info);
+                return static_cast<std::size_t>(info.dwPageSize);
+            }();
+            return size;
+        }
+    }
+
+    SecureArena::SecureArena(std::size_t chunkSize) : chunkSize(chunkSize) {}
+
+    SecureArena::~SecureArena() {
+        for (auto& chunk : chunks) {
+            releaseChunk(chunk);
+        }
+    }
+
+    void SecureArena::reset() {
+        if (chunks.empty()) {
+            return;
+        }
+        for (std::size_t i = 1; i < chunks.size(); ++i) {
+            releaseChunk(chunks[i]);
+        }
+        chunks.resize(1);
+        SecureZeroMemory(chunks.front().data, chunks.front().used);
+        chunks.front().used = 0;
+    }
+
+    std::size_t SecureArena::used() const {
+        std::size_t result = 0;
+        for (const auto& chunk : chunks) {
+            result += chunk.used;
+        }
+        return result;
+    }
+
+    std::pmr::memory_resource* SecureArena::resource() {
+        if (scopeDepth == 0) {
+            return std::pmr::new_delete_resource();
+        }
+        return &forThread();
+    }
+
+    SecureArena::Scope::Scope() {
+        ++scopeDepth;
+    }
+
+    SecureArena::Scope::~Scope() {
+        if (--scopeDepth == 0) {
+            forThread().reset();
+        }
+    }
+
+    void* SecureArena::do_allocate(std::size_t bytes, std::size_t alignment) {
+        if (!chunks.empty()) {
+            auto& chunk = chunks.back();
+            std::size_t offset = (chunk.used + alignment - 1) & ~(alignment - 1);
+            if (offset + bytes <= chunk.size) {
+                chunk.used = offset + bytes;
+                return chunk.data + offset;
+            }
+        }
+
+        // Chunks are page aligned, so new chunk satisfies any alignment
+        addChunk(bytes);
+        auto& chunk = chunks.back();
+        chunk.used = bytes;
+        return chunk.data;
+    }
+
+    void SecureArena::do_deallocate(void*, std::size_t, std::size_t) {
+        // Memory is zeroed and recycled by reset()
+    }
+
+    bool SecureArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+        return this == &other;
+    }
+
+    void SecureArena::addChunk(std::size_t size) {
+        const std::size_t page = pageSize();
+        size = (std::max(size, chunkSize) + page - 1) / page * page;
+
+        auto data = static_cast<std::byte*>(VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+        if (data == nullptr) {
+            throw std::bad_alloc();
+        }
+
+        // Locking keeps secrets out of page file, arena still works if working set quota is exceeded
+        bool locked = VirtualLock(data, size) != 0;
+        chunks.push_back({ data, size, 0, locked });
+    }
+
+    void SecureArena::releaseChunk(Chunk& chunk) {
+        SecureZeroMemory(chunk.data, chunk.used);
+        if (chunk.locked) {
+            VirtualUnlock(chunk.data, chunk.size);
+        }
+        VirtualFree(chunk.data, 0, MEM_RELEASE);
+        chunk = { nullptr, 0, 0, false };
+    }
+
+    SecureArena& SecureArena::forThread() {
+        thread_local SecureArena arena;
+        return arena;
+    }
+
+    void* LockedPages::do_allocate(std::size_t bytes, std::size_t) {
+        const std::size_t page = pageSize();
+        std::size_t size = (bytes + page - 1) / page * page;
+        auto data = VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+        if (data == nullptr) {
+            throw std::bad_alloc();
+        }
+
+        // Same as arena, memory stays usable when working set quota does not allow locking
+        VirtualLock(data, size);
+        return data;
+    }
+
+    void LockedPages::do_deallocate(void* pointer, std::size_t bytes, std::size_t) {
+        const std::size_t page = pageSize();
+        std::size_t size = (bytes + page - 1) / page * page;
+        SecureZeroMemory(pointer, size);
+        VirtualUnlock(pointer, size);
+        VirtualFree(pointer, 0, MEM_RELEASE);
+    }
+
+    bool LockedPages::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+        return this == &other;
+    }
+
+    SecureString dumpSecure(const nlohmann::json& json) {
+        SecureString result(SecureArena::resource());
+        SecureStringBuffer buffer(result);
+        std::ostream stream(&buffer);
+        stream << json;
+        return result;
+    }
+
+    void appendJsonString(SecureString& output, std::string_view text) {
+        static constexpr char HEX[] = "0123456789abcdef";
+        output += '"';
+        for (char c : text) {
+            switch (c) {
+                case '"': output += "\\\""; break;
+                case '\\': output += "\\\\"; break;
+                case '\b': output += "\\b"; break;
+                case '\f': output += "\\f"; break;
+                case '\n': output += "\\n"; break;
+                case '\r': output += "\\r"; break;
+                case '\t': output += "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        output += "\\u00";
+                        output += HEX[(c >> 4) & 0x0F];
+                        output += HEX[c & 0x0F];
+                    }
+                    else {
+                        output += c;
+                    }
+            }
+        }
+        output += '"';
+    }
+
+    void wipe(std::string& text) {
+        // Characters past size() (spare capacity or small string buffer) may still hold earlier content
+        text.resize(text.capacity());
+        SecureZeroMemory(text.data(), text.size());
+        text.clear();
+    }
+
+    void wipe(nlohmann::json& json) {
+        if (json.is_string()) {
+            wipe(json.get_ref<std::string&>());
+        }
+        else if (json.is_structured()) {
+            for (auto& item : json) {
+                wipe(item);
+            }
+        }
+    }
+}
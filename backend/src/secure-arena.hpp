@@ -0,0 +1,149 @@
+#pragma once
+
+#include <fix.hpp>
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+namespace util {
+    /// @brief Memory resource for decrypted secrets backed by pages locked in physical memory
+    /// @note Allocation is a pointer bump and deallocation is no-op, whole arena is zeroed and recycled
+    /// by reset(). Every worker thread has its own arena, which is active while SecureArena::Scope lives,
+    /// so memory allocated from resource() must not outlive the scope.
+    class SecureArena : public std::pmr::memory_resource {
+    public:
+        /// @brief Constructor
+        /// @param chunkSize size of locked chunks, rounded up to page size
+        explicit SecureArena(std::size_t chunkSize = DEFAULT_CHUNK_SIZE);
+
+        /// @brief Destructor, zeroes and releases all chunks
+        ~SecureArena() override;
+
+        /// @brief Delete copy, assignment, move, move assignment constructor
+        SecureArena(const SecureArena&) = delete;
+        SecureArena& operator=(const SecureArena&) = delete;
+        SecureArena(SecureArena&&) = delete;
+        SecureArena& operator=(SecureArena&&) = delete;
+
+        /// @brief Zeroes all allocated memory, keeps first chunk for next use and releases others
+        void reset();
+
+        /// @brief Gets number of bytes allocated since last reset
+        /// @return number of bytes
+        std::size_t used() const;
+
+        /// @brief Gets memory resource for secrets of calling thread
+        /// @return arena of thread if scope is active, otherwise default new/delete resource
+        static std::pmr::memory_resource* resource();
+
+        /// @brief RAII scope of arena of calling thread, usually one request
+        /// @note Scopes may be nested, arena is reset when outermost scope ends
+        class Scope {
+        public:
+            /// @brief Activates arena of calling thread
+            Scope();
+
+            /// @brief Resets arena of calling thread if this is outermost scope
+            ~Scope();
+
+            /// @brief Delete copy, assignment, move, move assignment constructor
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+            Scope(Scope&&) = delete;
+            Scope& operator=(Scope&&) = delete;
+        };
+
+        static constexpr std::size_t DEFAULT_CHUNK_SIZE = 64 * 1024;    // Covers response of typical vault
+
+    private:
+        /// @brief Single block of locked pages
+        struct Chunk {
+            std::byte* data;        // Start of chunk
+            std::size_t size;       // Size of chunk
+            std::size_t used;       // Bytes allocated from chunk
+            bool locked;            // False when working set quota did not allow locking
+        };
+
+        std::vector<Chunk> chunks;      // Chunks, last one is used for allocation
+        std::size_t chunkSize;          // Size of regular chunk
+
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+        void do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+        /// @brief Allocates and locks new chunk
+        /// @param size minimal size of chunk
+        /// @throws std::bad_alloc if pages cannot be allocated
+        void addChunk(std::size_t size);
+
+        /// @brief Zeroes, unlocks and frees chunk
+        /// @param chunk chunk to release
+        static void releaseChunk(Chunk& chunk);
+
+        /// @brief Gets arena of calling thread
+        /// @return reference to thread local arena
+        static SecureArena& forThread();
+
+        static thread_local int scopeDepth;     // Number of active scopes of calling thread
+    };
+
+    /// @brief Memory resource for long-lived secrets, every allocation gets its own locked pages
+    /// @note Meant as upstream of pool resource, which asks for large blocks. Blocks are zeroed before they
+    /// are released, strings freed inside the pool must be wiped by their owner.
+    class LockedPages : public std::pmr::memory_resource {
+    private:
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+        void do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+    };
+
+    /// @brief String allocated from memory resource, use SecureArena::resource() for secrets
+    using SecureString = std::pmr::string;
+
+    /// @brief Serializes json into arena of calling thread
+    /// @param json json to serialize
+    /// @return serialized json, valid until end of current SecureArena::Scope
+    SecureString dumpSecure(const nlohmann::json& json);
+
+    /// @brief Appends text as quoted and escaped Json string, lets secrets be serialized without json tree
+    /// @param output string to append to
+    /// @param text UTF-8 text to append
+    void appendJsonString(SecureString& output, std::string_view text);
+
+    /// @brief Overwrites content of string with zeros, including its spare capacity
+    /// @param text string to wipe
+    void wipe(std::string& text);
+
+    /// @brief Overwrites all strings stored in json with zeros
+    /// @param json json to wipe
+    void wipe(nlohmann::json& json);
+
+    /// @brief Wipes strings or json trees when scope ends, also when it is left by exception
+    /// @note Plaintext held in std::string lives on default heap, so it is wiped rather than arena allocated.
+    /// Copies left behind by reallocation while the string grew are not covered.
+    template<typename... Secrets>
+    class WipeGuard {
+    public:
+        /// @brief Constructor
+        /// @param secrets strings or json trees to wipe, must outlive guard
+        explicit WipeGuard(Secrets&... secrets) : secrets(secrets...) {}
+
+        /// @brief Destructor, wipes all secrets
+        ~WipeGuard() {
+            std::apply([](auto&... secret) { (wipe(secret), ...); }, secrets);
+        }
+
+        /// @brief Delete copy, assignment, move, move assignment constructor
+        WipeGuard(const WipeGuard&) = delete;
+        WipeGuard& operator=(const WipeGuard&) = delete;
+        WipeGuard(WipeGuard&&) = delete;
+        WipeGuard& operator=(WipeGuard&&) = delete;
+
+    private:
+        std::tuple<Secrets&...> secrets;    // Secrets wiped by destructor
+    };
+}
@@ -0,0 +1,52 @@
+#include <tombstone-compactor.hpp>
+#include <passwords.hpp>
+#include <log.hpp>
+
+namespace pass {
+    TombstoneCompactor& TombstoneCompactor::getInstance() {
+        static TombstoneCompactor compactor;
+        return compactor;
+    }
+
+    TombstoneCompactor::~TombstoneCompactor() {
+        stop();
+    }
+
+    void TombstoneCompactor::start(const Settings& settings) {
+        std::lock_guard<std::mutex> lock(mtx);
+        this->settings = settings;
+        if (!worker.joinable() && settings.retention.count() > 0) {
+            worker = std::jthread([this](std::stop_token stopToken) { run(stopToken); });
+        }
+    }
+
+    void TombstoneCompactor::stop() {
+        if (worker.joinable()) {
+            worker.request_stop();
+            cv.notify_all();
+            worker.join();
+        }
+    }
+
+    void TombstoneCompactor::run(std::stop_token stopToken) {
+        while (!stopToken.stop_requested()) {
+            Settings limits;
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                limits = settings;
+            }
+
+            // Failed purge is repeated next interval, tombstones only take space meanwhile
+            try {
+                auto purged = PasswordManager().purgeTombstones(limits.retention);
+                Logger::info("Purged {} tombstones older than {} hours", purged, limits.retention.count());
+            }
+            catch (const std::exception& e) {
+                Logger::error("Could not purge tombstones: {}", e.what());
+            }
+
+            std::unique_lock<std::mutex> lock(mtx);
+            cv.wait_for(lock, stopToken, limits.interval, []() { return false; });
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <fix.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace pass {
+    /// @brief Periodic purge of tombstones of removed passwords implementing Singleton pattern
+    /// @note Tombstones are needed only by clients syncing deltas. Those older than retention are deleted and
+    /// highest purged version of every vault is kept, so client syncing from before it gets full snapshot instead.
+    class TombstoneCompactor {
+    public:
+        /// @brief Settings of purge
+        class Settings {
+        public:
+            std::chrono::hours retention{24 * 90};      // Tombstones are kept for this long, 0 disables purge
+            std::chrono::hours interval{24};            // Time between purges
+        };
+
+        /// @brief Get singleton instance of compactor
+        /// @return Reference to compactor instance
+        static TombstoneCompactor& getInstance();
+
+        /// @brief Delete copy, assignment, move, move assignment constructor
+        TombstoneCompactor(const TombstoneCompactor&) = delete;
+        TombstoneCompactor& operator=(const TombstoneCompactor&) = delete;
+        TombstoneCompactor(TombstoneCompactor&&) = delete;
+        TombstoneCompactor& operator=(TombstoneCompactor&&) = delete;
+
+        /// @brief Starts purge thread, first purge runs right away
+        /// @param settings settings of purge
+        void start(const Settings& settings);
+
+        /// @brief Stops purge thread
+        void stop();
+
+    private:
+        /// @brief Private constructor for Singleton pattern
+        TombstoneCompactor() = default;
+
+        /// @brief Private destructor
+        ~TombstoneCompactor();
+
+        /// @brief Purge thread loop
+        /// @param stopToken token signalling stop request
+        void run(std::stop_token stopToken);
+
+        Settings settings;                              // Settings of purge
+        std::mutex mtx;                                 // Mutex guarding settings and thread
+        std::condition_variable_any cv;                 // Signals stop
+        std::jthread worker;                            // Purge thread
+    };
+}
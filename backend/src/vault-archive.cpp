@@ -0,0 +1,197 @@
+#include <vault-archive.hpp>
+#include <cryptopp/aes.h>
+#include <cryptopp/gcm.h>
+#include <cryptopp/osrng.h>
+#include <cryptopp/misc.h>
+#include <algorithm>
+#include <stdexcept>
+#include <format>
+
+namespace pass {
+    namespace {
+        // Top bit of chunk length marks last chunk, it is authenticated as part of nonce
+        constexpr std::uint32_t LAST_CHUNK_FLAG = 0x80000000u;
+
+        void putUInt32(std::string& out, std::uint32_t value) {
+            for (int i = 0; i < 4; ++i) {
+                out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+            }
+        }
+
+        std::uint32_t getUInt32(const char* data) {
+            std::uint32_t value = 0;
+            for (int i = 0; i < 4; ++i) {
+                value |= static_cast<std::uint32_t>(static_cast<unsigned char>(data[i])) << (8 * i);
+            }
+            return value;
+        }
+
+        void setNonceCounter(std::array<CryptoPP::byte, Crypto::IV_SIZE>& nonce, std::uint32_t counter, bool last) {
+            nonce[archive::NONCE_PREFIX_SIZE + 0] = static_cast<CryptoPP::byte>(counter >> 24);
+            nonce[archive::NONCE_PREFIX_SIZE + 1] = static_cast<CryptoPP::byte>(counter >> 16);
+            nonce[archive::NONCE_PREFIX_SIZE + 2] = static_cast<CryptoPP::byte>(counter >> 8);
+            nonce[archive::NONCE_PREFIX_SIZE + 3] = static_cast<CryptoPP::byte>(counter);
+            nonce[archive::NONCE_PREFIX_SIZE + 4] = last ? 1 : 0;
+        }
+    }
+
+    VaultArchiveWriter::VaultArchiveWriter(std::ostream& out, Crypto& crypto, std::uint32_t chunkSize)
+        : out(out), nonce{}, chunkSize(std::clamp<std::uint32_t>(chunkSize, 1, archive::MAX_CHUNK_SIZE)) {
+        CryptoPP::AutoSeededRandomPool rng;
+        CryptoPP::SecByteBlock salt(Crypto::SALT_SIZE);
+        rng.GenerateBlock(salt, salt.size());
+        rng.GenerateBlock(nonce.data(), archive::NONCE_PREFIX_SIZE);
+        key = crypto.deriveKey(salt);
+
+        header.reserve(archive::HEADER_SIZE);
+        header.append(archive::MAGIC);
+        header.push_back(static_cast<char>(archive::VERSION));
+        header.append(reinterpret_cast<const char*>(salt.data()), salt.size());
+        header.append(reinterpret_cast<const char*>(nonce.data()), archive::NONCE_PREFIX_SIZE);
+        putUInt32(header, this->chunkSize);
+        out.write(header.data(), header.size());
+
+        buffer.reserve(this->chunkSize);
+    }
+
+    VaultArchiveWriter::~VaultArchiveWriter() {
+        CryptoPP::SecureWipeArray(buffer.data(), buffer.size());
+    }
+
+    void VaultArchiveWriter::write(std::string_view data) {
+        if (finished) {
+            throw std::logic_error("Vault archive is already finished");
+        }
+        while (!data.empty()) {
+            std::size_t size = std::min<std::size_t>(chunkSize - buffer.size(), data.size());
+            buffer.append(data.substr(0, size));
+            data.remove_prefix(size);
+            if (buffer.size() == chunkSize) {
+                sealChunk(false);
+            }
+        }
+    }
+
+    void VaultArchiveWriter::finish() {
+        if (!finished) {
+            sealChunk(true);
+            finished = true;
+            out.flush();
+        }
+    }
+
+    void VaultArchiveWriter::sealChunk(bool last) {
+        if (counter == UINT32_MAX) {
+            throw std::runtime_error("Vault archive is too large");
+        }
+        setNonceCounter(nonce, counter++, last);
+
+        std::string chunk;
+        chunk.reserve(4 + buffer.size() + Crypto::TAG_SIZE);
+        putUInt32(chunk, static_cast<std::uint32_t>(buffer.size()) | (last ? LAST_CHUNK_FLAG : 0));
+        chunk.resize(4 + buffer.size() + Crypto::TAG_SIZE);
+
+        auto* ciphertext = reinterpret_cast<CryptoPP::byte*>(chunk.data() + 4);
+        CryptoPP::GCM<CryptoPP::AES>::Encryption enc;
+        enc.SetKeyWithIV(key, key.size(), nonce.data(), nonce.size());
+        enc.EncryptAndAuthenticate(
+            ciphertext, ciphertext + buffer.size(), Crypto::TAG_SIZE,
+            nonce.data(), static_cast<int>(nonce.size()),
+            reinterpret_cast<const CryptoPP::byte*>(header.data()), header.size(),
+            reinterpret_cast<const CryptoPP::byte*>(buffer.data()), buffer.size()
+        );
+
+        out.write(chunk.data(), chunk.size());
+        if (!out) {
+            throw std::runtime_error("Failed to write vault archive");
+        }
+        CryptoPP::SecureWipeArray(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+
+    VaultArchiveReader::VaultArchiveReader(std::istream& in, Crypto& crypto) : in(in), nonce{} {
+        header.resize(archive::HEADER_SIZE);
+        readExactly(header.data(), header.size());
+
+        if (std::string_view(header).substr(0, archive::MAGIC.size()) != archive::MAGIC) {
+            throw std::runtime_error("Not a vault archive");
+        }
+        std::size_t offset = archive::MAGIC.size();
+        if (static_cast<std::uint8_t>(header[offset]) != archive::VERSION) {
+            throw std::runtime_error(std::format("Unsupported vault archive version: {}", static_cast<int>(header[offset])));
+        }
+        offset += 1;
+
+        CryptoPP::SecByteBlock salt(reinterpret_cast<const CryptoPP::byte*>(header.data() + offset), Crypto::SALT_SIZE);
+        offset += Crypto::SALT_SIZE;
+        std::copy_n(reinterpret_cast<const CryptoPP::byte*>(header.data() + offset), archive::NONCE_PREFIX_SIZE, nonce.begin());
+        offset += archive::NONCE_PREFIX_SIZE;
+        chunkSize = getUInt32(header.data() + offset);
+        if (chunkSize == 0 || chunkSize > archive::MAX_CHUNK_SIZE) {
+            throw std::runtime_error("Invalid vault archive chunk size");
+        }
+
+        key = crypto.deriveKey(salt);
+    }
+
+    VaultArchiveReader::~VaultArchiveReader() {
+        CryptoPP::SecureWipeArray(plaintext.data(), plaintext.size());
+    }
+
+    VaultArchiveReader::int_type VaultArchiveReader::underflow() {
+        if (gptr() < egptr()) {
+            return traits_type::to_int_type(*gptr());
+        }
+        if (finished) {
+            if (in.peek() != traits_type::eof()) {
+                throw std::runtime_error("Unexpected data after end of vault archive");
+            }
+            return traits_type::eof();
+        }
+
+        char lengthBytes[4];
+        readExactly(lengthBytes, sizeof(lengthBytes));
+        std::uint32_t length = getUInt32(lengthBytes);
+        bool last = (length & LAST_CHUNK_FLAG) != 0;
+        length &= ~LAST_CHUNK_FLAG;
+        if (length > chunkSize) {
+            throw std::runtime_error("Invalid vault archive chunk length");
+        }
+
+        ciphertext.resize(length + Crypto::TAG_SIZE);
+        readExactly(ciphertext.data(), ciphertext.size());
+
+        CryptoPP::SecureWipeArray(plaintext.data(), plaintext.size());
+        plaintext.resize(length);
+        setNonceCounter(nonce, counter++, last);
+
+        CryptoPP::GCM<CryptoPP::AES>::Decryption dec;
+        dec.SetKeyWithIV(key, key.size(), nonce.data(), nonce.size());
+        bool valid = dec.DecryptAndVerify(
+            reinterpret_cast<CryptoPP::byte*>(plaintext.data()),
+            reinterpret_cast<const CryptoPP::byte*>(ciphertext.data() + length), Crypto::TAG_SIZE,
+            nonce.data(), static_cast<int>(nonce.size()),
+            reinterpret_cast<const CryptoPP::byte*>(header.data()), header.size(),
+            reinterpret_cast<const CryptoPP::byte*>(ciphertext.data()), length
+        );
+        if (!valid) {
+            CryptoPP::SecureWipeArray(plaintext.data(), plaintext.size());
+            plaintext.clear();
+            throw std::runtime_error("Vault archive authentication failed (tampered archive or wrong password)");
+        }
+
+        finished = last;
+        setg(plaintext.data(), plaintext.data(), plaintext.data() + plaintext.size());
+        if (plaintext.empty()) {
+            return underflow();
+        }
+        return traits_type::to_int_type(*gptr());
+    }
+
+    void VaultArchiveReader::readExactly(char* data, std::size_t size) {
+        in.read(data, static_cast<std::streamsize>(size));
+        if (static_cast<std::size_t>(in.gcount()) != size) {
+            throw std::runtime_error("Vault archive is truncated");
+        }
+    }
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <streambuf>
+#include <cryptopp/secblock.h>
+#include <crypto.hpp>
+
+/// @brief Namespace of password related stuff
+namespace pass {
+    /// @brief Layout of encrypted vault archive
+    /// @note Archive is sealed with AES-256-GCM in STREAM construction: plaintext is split into chunks,
+    /// each chunk is sealed with nonce = prefix || chunk counter || last chunk flag and header as associated data.
+    /// Reordered, dropped, truncated or appended chunks fail authentication.
+    ///
+    /// Header:  magic (8) | version (1) | salt (16) | nonce prefix (7) | chunk size (4, LE)
+    /// Chunk:   plaintext length (4, LE) | ciphertext | tag (16)
+    namespace archive {
+        constexpr std::string_view MAGIC = "PFVAULT\x01";
+        constexpr std::uint8_t VERSION = 1;
+        constexpr std::size_t NONCE_PREFIX_SIZE = 7;
+        constexpr std::size_t HEADER_SIZE = MAGIC.size() + 1 + Crypto::SALT_SIZE + NONCE_PREFIX_SIZE + 4;
+        constexpr std::uint32_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+        constexpr std::uint32_t MAX_CHUNK_SIZE = 16 * 1024 * 1024;
+    }
+
+    /// @brief Writer sealing stream of bytes into encrypted vault archive
+    class VaultArchiveWriter {
+    public:
+        /// @brief Constructor, writes archive header
+        /// @param out output stream for archive
+        /// @param crypto crypto of user, archive key is derived from user password
+        /// @param chunkSize size of plaintext chunk
+        VaultArchiveWriter(std::ostream& out, Crypto& crypto, std::uint32_t chunkSize = archive::DEFAULT_CHUNK_SIZE);
+
+        /// @brief Destructor, wipes buffered plaintext
+        ~VaultArchiveWriter();
+
+        /// @brief Appends data to archive, full chunks are sealed and written immediately
+        /// @param data plaintext data
+        void write(std::string_view data);
+
+        /// @brief Seals last chunk, archive without it is treated as truncated
+        void finish();
+
+    private:
+        std::ostream& out;                                  // Output stream
+        CryptoPP::SecByteBlock key;                         // Archive key
+        std::string header;                                 // Serialized header, associated data of every chunk
+        std::array<CryptoPP::byte, Crypto::IV_SIZE> nonce;  // Nonce prefix followed by counter and last flag
+        std::uint32_t chunkSize;                            // Size of plaintext chunk
+        std::uint32_t counter = 0;                          // Number of written chunks
+        std::string buffer;                                 // Plaintext of current chunk
+        bool finished = false;                              // Whether last chunk was written
+
+        /// @brief Seals and writes buffered chunk
+        /// @param last whether this is last chunk of archive
+        void sealChunk(bool last);
+    };
+
+    /// @brief Stream buffer verifying and decrypting vault archive chunk by chunk
+    /// @note Only authenticated plaintext is ever exposed. Truncated or tampered archive throws std::runtime_error
+    /// while reading, so consumers may already have processed preceding chunks.
+    class VaultArchiveReader : public std::streambuf {
+    public:
+        /// @brief Constructor, reads and validates archive header
+        /// @param in input stream with archive
+        /// @param crypto crypto of user, archive key is derived from user password
+        /// @throws std::runtime_error when header is invalid
+        VaultArchiveReader(std::istream& in, Crypto& crypto);
+
+        /// @brief Destructor, wipes decrypted plaintext
+        ~VaultArchiveReader() override;
+
+    protected:
+        /// @brief Decrypts next chunk when current one is consumed
+        /// @return next character or EOF
+        int_type underflow() override;
+
+    private:
+        std::istream& in;                                   // Input stream
+        CryptoPP::SecByteBlock key;                         // Archive key
+        std::string header;                                 // Serialized header, associated data of every chunk
+        std::array<CryptoPP::byte, Crypto::IV_SIZE> nonce;  // Nonce prefix followed by counter and last flag
+        std::uint32_t chunkSize;                            // Maximal size of plaintext chunk
+        std::uint32_t counter = 0;                          // Number of read chunks
+        std::string ciphertext;                             // Ciphertext of current chunk
+        std::string plaintext;                              // Plaintext of current chunk
+        bool finished = false;                              // Whether last chunk was read
+
+        /// @brief Reads exactly given number of bytes
+        /// @param data output buffer
+        /// @param size number of bytes
+        /// @throws std::runtime_error when stream ends early
+        void readExactly(char* data, std::size_t size);
+    };
+}
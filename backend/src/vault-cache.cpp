@@ -0,0 +1,250 @@
+#include <vault-cache.hpp>
+#include <log.hpp>
+#include <algorithm>
+#include <vector>
+
+namespace pass {
+    VaultCache& VaultCache::getInstance() {
+        static VaultCache cache;
+        return cache;
+    }
+
+    VaultCache::~VaultCache() {
+        stop();
+    }
+
+    void VaultCache::configure(const Settings& settings) {
+        std::lock_guard<std::mutex> lock(mtx);
+        while (!vaults.empty()) {
+            drop(vaults.begin());
+        }
+        this->settings = settings;
+    }
+
+    bool VaultCache::enabled() {
+        std::lock_guard<std::mutex> lock(mtx);
+        return settings.budgetBytes > 0;
+    }
+
+    void VaultCache::start() {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!sweeper.joinable() && settings.budgetBytes > 0) {
+            sweeper = std::jthread([this](std::stop_token stopToken) { run(stopToken); });
+        }
+    }
+
+    void VaultCache::stop() {
+        if (sweeper.joinable()) {
+            sweeper.request_stop();
+            cv.notify_all();
+            sweeper.join();
+        }
+
+        std::lock_guard<std::mutex> lock(mtx);
+        while (!vaults.empty()) {
+            drop(vaults.begin());
+        }
+    }
+
+    bool VaultCache::contains(const std::uint32_t userId) {
+        std::lock_guard<std::mutex> lock(mtx);
+        return vaults.contains(userId);
+    }
+
+    std::optional<util::SecureString> VaultCache::list(const std::uint32_t userId) {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto vault = vaults.find(userId);
+        if (vault == vaults.end()) {
+            return std::nullopt;
+        }
+        vault->second.lastRead = std::chrono::steady_clock::now();
+
+        util::SecureString result(util::SecureArena::resource());
+        result.reserve(vault->second.bytes + 2);
+        result += '[';
+        for (const auto& [id, entry] : vault->second.entries) {
+            if (result.size() > 1) {
+                result += ',';
+            }
+            result += entry;
+        }
+        result += ']';
+        return result;
+    }
+
+    void VaultCache::store(const std::uint32_t userId, const std::int64_t version, const PasswordBatch& passwords) {
+        if (!enabled()) {
+            return;
+        }
+
+        // Entries are serialized before locking, only copy into pool happens under lock
+        util::SecureArena::Scope secrets;
+        std::vector<std::pair<std::uint32_t, util::SecureString>> entries;
+        entries.reserve(passwords.size());
+        std::size_t bytes = 0;
+        for (const auto& password : passwords) {
+            util::SecureString text(util::SecureArena::resource());
+            password.appendJson(text);
+            entries.emplace_back(password.id, std::move(text));
+            bytes += entries.back().second.size() + ENTRY_OVERHEAD;
+        }
+
+        std::lock_guard<std::mutex> lock(mtx);
+
+        // Snapshot read before a write committed while vault was not cached would miss that write
+        auto latest = committed.find(userId);
+        if (latest != committed.end() && latest->second > version) {
+            return;
+        }
+        auto existing = vaults.find(userId);
+        if (existing != vaults.end()) {
+            if (existing->second.version >= version) {
+                return;
+            }
+            drop(existing);
+        }
+        if (bytes > settings.budgetBytes || !makeRoom(bytes, userId)) {
+            Logger::debug("Vault of user {} with {} bytes does not fit into cache", userId, bytes);
+            return;
+        }
+
+        auto& vault = vaults.try_emplace(userId, &pool).first->second;
+        vault.version = version;
+        vault.lastRead = std::chrono::steady_clock::now();
+        for (const auto& [id, text] : entries) {
+            replace(vault, id, text);
+        }
+    }
+
+    void VaultCache::put(const std::uint32_t userId, const std::int64_t version, const Password& password) {
+        if (!enabled()) {
+            return;
+        }
+
+        util::SecureArena::Scope secrets;
+        auto text = serialize(password.toJson());
+
+        std::lock_guard<std::mutex> lock(mtx);
+        advance(userId, version);
+        auto vault = vaults.find(userId);
+        if (vault == vaults.end() || vault->second.version >= version) {
+            return;
+        }
+
+        // Missed version means another write is not reflected yet, vault is read again from database
+        if (vault->second.version + 1 != version) {
+            drop(vault);
+            return;
+        }
+        vault->second.version = version;
+        replace(vault->second, password.id, text);
+        if (!makeRoom(0, userId)) {
+            drop(vault);
+        }
+    }
+
+    void VaultCache::erase(const std::uint32_t userId, const std::int64_t version, const std::uint32_t id) {
+        std::lock_guard<std::mutex> lock(mtx);
+        advance(userId, version);
+        auto vault = vaults.find(userId);
+        if (vault == vaults.end() || vault->second.version >= version) {
+            return;
+        }
+        if (vault->second.version + 1 != version) {
+            drop(vault);
+            return;
+        }
+        vault->second.version = version;
+        replace(vault->second, id, {});
+    }
+
+    void VaultCache::commit(const std::uint32_t userId, const std::int64_t version) {
+        std::lock_guard<std::mutex> lock(mtx);
+        advance(userId, version);
+        auto vault = vaults.find(userId);
+        if (vault != vaults.end() && vault->second.version < version) {
+            drop(vault);
+        }
+    }
+
+    void VaultCache::evict(const std::uint32_t userId) {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto vault = vaults.find(userId);
+        if (vault != vaults.end()) {
+            drop(vault);
+        }
+    }
+
+    std::size_t VaultCache::used() {
+        std::lock_guard<std::mutex> lock(mtx);
+        return usedBytes;
+    }
+
+    void VaultCache::run(std::stop_token stopToken) {
+        while (!stopToken.stop_requested()) {
+            std::unique_lock<std::mutex> lock(mtx);
+            cv.wait_for(lock, stopToken, SWEEP_INTERVAL, []() { return false; });
+            if (stopToken.stop_requested()) {
+                return;
+            }
+
+            auto deadline = std::chrono::steady_clock::now() - settings.idleTimeout;
+            for (auto vault = vaults.begin(); vault != vaults.end();) {
+                auto current = vault++;
+                if (current->second.lastRead < deadline) {
+                    Logger::debug("Evicting idle vault of user {}", current->first);
+                    drop(current);
+                }
+            }
+        }
+    }
+
+    void VaultCache::replace(Vault& vault, const std::uint32_t id, std::string_view text) {
+        auto entry = vault.entries.find(id);
+        if (entry != vault.entries.end()) {
+            SecureZeroMemory(entry->second.data(), entry->second.size());
+            vault.bytes -= entry->second.size() + ENTRY_OVERHEAD;
+            usedBytes -= entry->second.size() + ENTRY_OVERHEAD;
+            vault.entries.erase(entry);
+        }
+        if (!text.empty()) {
+            vault.entries.emplace(id, text);
+            vault.bytes += text.size() + ENTRY_OVERHEAD;
+            usedBytes += text.size() + ENTRY_OVERHEAD;
+        }
+    }
+
+    void VaultCache::drop(Vaults::iterator vault) {
+        for (auto& [id, entry] : vault->second.entries) {
+            SecureZeroMemory(entry.data(), entry.size());
+        }
+        usedBytes -= vault->second.bytes;
+        vaults.erase(vault);
+    }
+
+    void VaultCache::advance(const std::uint32_t userId, const std::int64_t version) {
+        auto& latest = committed[userId];
+        latest = std::max(latest, version);
+    }
+
+    bool VaultCache::makeRoom(const std::size_t bytes, const std::uint32_t keep) {
+        while (usedBytes + bytes > settings.budgetBytes) {
+            auto oldest = vaults.end();
+            for (auto vault = vaults.begin(); vault != vaults.end(); ++vault) {
+                if (vault->first != keep && (oldest == vaults.end() || vault->second.lastRead < oldest->second.lastRead)) {
+                    oldest = vault;
+                }
+            }
+            if (oldest == vaults.end()) {
+                return false;
+            }
+            drop(oldest);
+        }
+        return true;
+    }
+
+    util::SecureString VaultCache::serialize(nlohmann::json json) {
+        util::WipeGuard wipeJson(json);
+        return util::dumpSecure(json);
+    }
+}
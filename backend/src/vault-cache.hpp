@@ -0,0 +1,165 @@
+#pragma once
+
+#include <fix.hpp>
+#include <passwords.hpp>
+#include <secure-arena.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace pass {
+    /// @brief Cache of decrypted vaults of logged in users implementing Singleton pattern
+    /// @note Vault is serialized entry by entry into locked pages on first read, so repeated reads of whole
+    /// vault skip database and decryption. Writes of single entries update cache in place, using vault versions
+    /// to detect writes racing with each other, any gap drops the vault. Latest committed version of every user
+    /// is tracked also when vault is not cached, so snapshot read before a write cannot be stored after it.
+    /// Vaults are wiped on idle timeout, logout or when memory budget is exceeded.
+    class VaultCache {
+    public:
+        /// @brief Limits of cache
+        class Settings {
+        public:
+            std::size_t budgetBytes = 0;                        // Memory of all cached vaults, 0 disables cache
+            std::chrono::seconds idleTimeout{900};              // Vault not read for this long is evicted
+        };
+
+        /// @brief Get singleton instance of cache
+        /// @return Reference to cache instance
+        static VaultCache& getInstance();
+
+        /// @brief Delete copy, assignment, move, move assignment constructor
+        VaultCache(const VaultCache&) = delete;
+        VaultCache& operator=(const VaultCache&) = delete;
+        VaultCache(VaultCache&&) = delete;
+        VaultCache& operator=(VaultCache&&) = delete;
+
+        /// @brief Sets limits and drops all cached vaults
+        /// @param settings limits
+        void configure(const Settings& settings);
+
+        /// @brief Checks whether cache is enabled
+        /// @return true when memory budget is not zero
+        bool enabled();
+
+        /// @brief Starts thread evicting idle vaults
+        void start();
+
+        /// @brief Stops eviction thread and wipes all cached vaults
+        void stop();
+
+        /// @brief Checks whether vault of user is cached
+        /// @param userId ID of user owning vault
+        /// @return true when cached
+        bool contains(const std::uint32_t userId);
+
+        /// @brief Serializes cached vault as JSON array
+        /// @param userId ID of user owning vault
+        /// @return array allocated from arena of calling thread, nullopt when vault is not cached
+        std::optional<util::SecureString> list(const std::uint32_t userId);
+
+        /// @brief Stores decrypted snapshot of vault, ignored when cache is disabled, vault does not fit into budget
+        /// or snapshot is older than latest committed version
+        /// @param userId ID of user owning vault
+        /// @param version version of vault the snapshot was read at
+        /// @param passwords decrypted live entries
+        void store(const std::uint32_t userId, const std::int64_t version, const PasswordBatch& passwords);
+
+        /// @brief Writes added or updated entry through to cached vault
+        /// @param userId ID of user owning vault
+        /// @param version version of vault created by the write
+        /// @param password decrypted entry
+        void put(const std::uint32_t userId, const std::int64_t version, const Password& password);
+
+        /// @brief Writes removal of entry through to cached vault
+        /// @param userId ID of user owning vault
+        /// @param version version of vault created by the removal
+        /// @param id ID of removed entry
+        void erase(const std::uint32_t userId, const std::int64_t version, const std::uint32_t id);
+
+        /// @brief Records write not reflected in cache, e.g. bulk change, cached vault older than it is dropped
+        /// @param userId ID of user owning vault
+        /// @param version version of vault created by the write
+        void commit(const std::uint32_t userId, const std::int64_t version);
+
+        /// @brief Wipes cached vault of user, e.g. on logout
+        /// @param userId ID of user owning vault
+        void evict(const std::uint32_t userId);
+
+        /// @brief Gets memory used by cached vaults
+        /// @return number of bytes counted against budget
+        std::size_t used();
+
+        static constexpr auto SWEEP_INTERVAL = std::chrono::seconds(10);   // Interval of idle vault eviction
+        static constexpr std::size_t ENTRY_OVERHEAD = 64;                   // Bytes counted for map node of entry
+
+    private:
+        /// @brief Cached vault of one user
+        class Vault {
+        public:
+            /// @brief Constructor
+            /// @param resource resource of locked pool
+            explicit Vault(std::pmr::memory_resource* resource) : entries(resource) {}
+
+            std::int64_t version = 0;                                   // Version of vault held in cache
+            std::pmr::map<std::uint32_t, std::pmr::string> entries;     // Serialized entries by id
+            std::size_t bytes = 0;                                      // Memory counted against budget
+            std::chrono::steady_clock::time_point lastRead;             // Time of last read
+        };
+
+        using Vaults = std::unordered_map<std::uint32_t, Vault>;
+
+        /// @brief Private constructor for Singleton pattern
+        VaultCache() = default;
+
+        /// @brief Private destructor
+        ~VaultCache();
+
+        /// @brief Eviction thread loop
+        /// @param stopToken token signalling stop request
+        void run(std::stop_token stopToken);
+
+        /// @brief Replaces entry of vault, must be called with mutex locked
+        /// @param vault vault to modify
+        /// @param id ID of entry
+        /// @param text serialized entry, empty to remove entry
+        void replace(Vault& vault, const std::uint32_t id, std::string_view text);
+
+        /// @brief Wipes and removes vault, must be called with mutex locked
+        /// @param vault iterator of vault
+        void drop(Vaults::iterator vault);
+
+        /// @brief Records latest committed version of vault, must be called with mutex locked
+        /// @param userId ID of user owning vault
+        /// @param version version of vault created by a write
+        void advance(const std::uint32_t userId, const std::int64_t version);
+
+        /// @brief Drops least recently read vaults until given number of bytes fits into budget, must be called with mutex locked
+        /// @param bytes bytes to fit
+        /// @param keep ID of user whose vault is not dropped
+        /// @return true when bytes fit
+        bool makeRoom(const std::size_t bytes, const std::uint32_t keep);
+
+        /// @brief Serializes entry into arena of calling thread
+        /// @param json entry, wiped on return
+        /// @return serialized entry
+        static util::SecureString serialize(nlohmann::json json);
+
+        Settings settings;                                      // Limits
+        util::LockedPages pages;                                // Locked pages backing pool
+        std::pmr::unsynchronized_pool_resource pool{&pages};    // Allocator of cached entries
+        Vaults vaults;                                          // Cached vaults by user
+        std::unordered_map<std::uint32_t, std::int64_t> committed;  // Latest committed version by user, also of vaults not cached
+        std::size_t usedBytes = 0;                              // Memory counted against budget
+        std::mutex mtx;                                         // Mutex guarding vaults and pool
+        std::condition_variable_any cv;                         // Wakes eviction thread on stop
+        std::jthread sweeper;                                   // Eviction thread
+    };
+}
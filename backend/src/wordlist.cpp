@@ -0,0 +1,76 @@
+#include <wordlist.hpp>
+#include <cctype>
+#include <format>
+#include <limits>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace pass {
+    Wordlist& Wordlist::getInstance() {
+        static Wordlist wordlist;
+        return wordlist;
+    }
+
+    void Wordlist::load(const std::filesystem::path& path) {
+        util::MappedFile mapped(path);
+        auto bytes = mapped.bytes();
+        if (bytes.size() > std::numeric_limits<std::uint32_t>::max()) {
+            throw std::runtime_error(std::format("Wordlist is too large: {}", path.string()));
+        }
+
+        const char* begin = reinterpret_cast<const char*>(bytes.data());
+        std::string_view content(begin, bytes.size());
+        std::vector<Entry> words;
+        std::unordered_set<std::string_view> seen;
+
+        std::size_t position = 0;
+        while (position < content.size()) {
+            auto lineEnd = content.find('\n', position);
+            if (lineEnd == std::string_view::npos) {
+                lineEnd = content.size();
+            }
+            auto line = content.substr(position, lineEnd - position);
+            std::size_t lineBegin = position;
+            position = lineEnd + 1;
+
+            // Skip dice roll column of diceware lists and surrounding whitespace
+            std::size_t first = 0;
+            while (first < line.size() && std::isdigit(static_cast<unsigned char>(line[first]))) {
+                ++first;
+            }
+            if (first == line.size() || !std::isspace(static_cast<unsigned char>(line[first]))) {
+                first = 0;
+            }
+            while (first < line.size() && std::isspace(static_cast<unsigned char>(line[first]))) {
+                ++first;
+            }
+            std::size_t last = line.size();
+            while (last > first && std::isspace(static_cast<unsigned char>(line[last - 1]))) {
+                --last;
+            }
+
+            auto word = line.substr(first, last - first);
+            if (word.empty() || word.front() == '#' || !seen.insert(word).second) {
+                continue;
+            }
+            words.push_back({ static_cast<std::uint32_t>(lineBegin + first), static_cast<std::uint32_t>(word.size()) });
+        }
+
+        if (words.size() < MIN_WORDS) {
+            throw std::runtime_error(std::format("Wordlist has only {} unique words: {}", words.size(), path.string()));
+        }
+
+        text = begin;
+        entries = std::move(words);
+        file = std::move(mapped);
+    }
+
+    std::size_t Wordlist::size() const {
+        return entries.size();
+    }
+
+    std::string_view Wordlist::word(std::size_t index) const {
+        const auto& entry = entries[index];
+        return std::string_view(text + entry.offset, entry.length);
+    }
+}
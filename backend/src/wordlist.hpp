@@ -0,0 +1,57 @@
+#pragma once
+
+#include <mapped-file.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+#include <vector>
+
+/// @brief Namespace of password related stuff
+namespace pass {
+    /// @brief Wordlist of passphrase generator implementing Singleton pattern
+    /// @note File is memory-mapped and indexed once by table of offsets, words are views into mapping.
+    /// Accepts plain lists (one word per line) and diceware lists ("11111<TAB>word").
+    class Wordlist {
+    public:
+        /// @brief Get singleton instance of wordlist
+        /// @return Reference to wordlist instance
+        static Wordlist& getInstance();
+
+        /// @brief Delete copy, assignment, move, move assignment constructor
+        Wordlist(const Wordlist&) = delete;
+        Wordlist& operator=(const Wordlist&) = delete;
+        Wordlist(Wordlist&&) = delete;
+        Wordlist& operator=(Wordlist&&) = delete;
+
+        /// @brief Maps and indexes wordlist, must be called before server starts
+        /// @param path path to wordlist
+        /// @throws std::runtime_error if file cannot be mapped or contains less than MIN_WORDS unique words
+        void load(const std::filesystem::path& path);
+
+        /// @brief Gets number of words
+        /// @return number of unique words, 0 if no wordlist is loaded
+        std::size_t size() const;
+
+        /// @brief Gets word
+        /// @param index index lower than size()
+        /// @return view into mapped file
+        std::string_view word(std::size_t index) const;
+
+        static constexpr std::size_t MIN_WORDS = 1024;     // Smaller lists give too little entropy per word
+
+    private:
+        /// @brief Position of word in mapped file
+        struct Entry {
+            std::uint32_t offset;   // Offset of first character
+            std::uint32_t length;   // Length of word
+        };
+
+        /// @brief Private constructor for Singleton pattern
+        Wordlist() = default;
+
+        util::MappedFile file;          // Mapped wordlist
+        const char* text = nullptr;     // Start of mapped text
+        std::vector<Entry> entries;     // Words in file order
+    };
+}
@@ -0,0 +1,188 @@
+#include <write-queue.hpp>
+#include <change-events.hpp>
+#include <log.hpp>
+#include <request-trace.hpp>
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+namespace pass {
+    WriteQueue& WriteQueue::getInstance() {
+        static WriteQueue queue;
+        return queue;
+    }
+
+    WriteQueue::~WriteQueue() {
+        stop();
+    }
+
+    void WriteQueue::start(const Settings& settings) {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (writer.joinable() || settings.maxBatch == 0) {
+            return;
+        }
+
+        this->settings = settings;
+        accepting = true;
+        writer = std::jthread([this](std::stop_token stopToken) { run(stopToken); });
+        Logger::info("Write queue started with batches of up to {} writes and {} us delay", settings.maxBatch, settings.maxDelay.count());
+    }
+
+    void WriteQueue::stop() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            accepting = false;
+        }
+        if (writer.joinable()) {
+            writer.request_stop();
+            cv.notify_all();
+            writer.join();
+        }
+    }
+
+    bool WriteQueue::running() {
+        std::lock_guard<std::mutex> lock(mtx);
+        return accepting;
+    }
+
+    bool WriteQueue::add(Password& password) {
+        Write write;
+        write.type = Type::Add;
+        write.password = &password;
+        write.userId = password.userId;
+        return submit(write).has_value();
+    }
+
+    std::optional<std::int64_t> WriteQueue::update(const Password& password) {
+        // Password is only read while applying update
+        Write write;
+        write.type = Type::Update;
+        write.password = const_cast<Password*>(&password);
+        write.userId = password.userId;
+        return submit(write);
+    }
+
+    std::optional<std::int64_t> WriteQueue::remove(const std::uint32_t userId, const std::uint32_t id) {
+        Write write;
+        write.type = Type::Remove;
+        write.userId = userId;
+        write.id = id;
+        return submit(write);
+    }
+
+    std::optional<std::int64_t> WriteQueue::submit(Write& write) {
+        auto future = write.done.get_future();
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (!accepting) {
+                return std::nullopt;
+            }
+            writes.push_back(&write);
+        }
+        cv.notify_one();
+
+        // Wait covers batching delay and shared commit
+        timing::ScopedStage stage("write.commit");
+        return future.get();
+    }
+
+    void WriteQueue::run(std::stop_token stopToken) {
+        while (true) {
+            std::vector<Write*> batch;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv.wait(lock, stopToken, [this]() { return !writes.empty(); });
+                if (writes.empty()) {
+                    return;
+                }
+
+                // First write waits shortly for others to share its commit, queue is drained without waiting on stop
+                if (writes.size() < settings.maxBatch && !stopToken.stop_requested()) {
+                    cv.wait_for(lock, stopToken, settings.maxDelay, [this]() { return writes.size() >= settings.maxBatch; });
+                }
+
+                auto count = std::min(writes.size(), settings.maxBatch);
+                batch.assign(writes.begin(), writes.begin() + count);
+                writes.erase(writes.begin(), writes.begin() + count);
+            }
+            commit(batch);
+        }
+    }
+
+    void WriteQueue::commit(const std::vector<Write*>& batch) {
+        auto& manager = DatabaseManager::getInstance();
+
+        // Stable order keeps writes of one user in order of queueing
+        std::vector<std::pair<std::uint32_t, Write*>> ordered;
+        ordered.reserve(batch.size());
+        for (auto write : batch) {
+            ordered.emplace_back(manager.shardOf(write->userId), write);
+        }
+        std::stable_sort(ordered.begin(), ordered.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+        std::vector<std::int64_t> versions(ordered.size(), 0);
+        std::vector<std::exception_ptr> errors(ordered.size());
+        for (std::size_t first = 0; first < ordered.size();) {
+            auto last = first;
+            while (last < ordered.size() && ordered[last].first == ordered[first].first) {
+                ++last;
+            }
+
+            try {
+                auto lease = manager.shard(ordered[first].second->userId);
+                auto& db = lease.database();
+                SQLite::Transaction transaction(db);
+                for (auto i = first; i < last; ++i) {
+                    // Savepoint isolates failed or empty write from the rest of batch
+                    db.exec("SAVEPOINT write");
+                    try {
+                        versions[i] = apply(lease, *ordered[i].second);
+                        if (versions[i] == 0) {
+                            db.exec("ROLLBACK TO write");
+                        }
+                    }
+                    catch (...) {
+                        versions[i] = 0;
+                        errors[i] = std::current_exception();
+                        db.exec("ROLLBACK TO write");
+                    }
+                    db.exec("RELEASE write");
+                }
+                transaction.commit();
+            }
+            catch (const std::exception& e) {
+                Logger::error("Failed to commit batch of {} writes: {}", last - first, e.what());
+                auto error = std::current_exception();
+                for (auto i = first; i < last; ++i) {
+                    versions[i] = 0;
+                    errors[i] = error;
+                }
+            }
+
+            for (auto i = first; i < last; ++i) {
+                auto& write = *ordered[i].second;
+                if (errors[i]) {
+                    write.done.set_exception(errors[i]);
+                    continue;
+                }
+                if (versions[i] > 0) {
+                    events::ChangeNotifier::getInstance().publish(write.userId, versions[i]);
+                }
+                write.done.set_value(versions[i]);
+            }
+            first = last;
+        }
+    }
+
+    std::int64_t WriteQueue::apply(DatabaseManager::Lease& lease, Write& write) {
+        switch (write.type) {
+            case Type::Add:
+                return SQLitePasswordRepository::applyAdd(lease, *write.password);
+            case Type::Update:
+                return SQLitePasswordRepository::applyUpdate(lease, *write.password);
+            case Type::Remove:
+                return SQLitePasswordRepository::applyRemove(lease, write.userId, write.id);
+        }
+        return 0;
+    }
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <fix.hpp>
+#include <passwords.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace pass {
+    /// @brief Queue combining single password writes of concurrent requests into shared commits, implementing Singleton pattern
+    /// @note Request threads enqueue writes and wait, one writer thread applies them in batches bounded by count
+    /// or delay, each write inside its own savepoint of one transaction per shard. Every request waits only for
+    /// durable commit of batch holding its own write, failure of one write does not affect others in batch.
+    class WriteQueue {
+    public:
+        /// @brief Limits of batches
+        class Settings {
+        public:
+            std::size_t maxBatch = 64;                          // Writes committed together at most, 0 disables queue
+            std::chrono::microseconds maxDelay{200};            // Time first write of batch waits for others
+        };
+
+        /// @brief Get singleton instance of queue
+        /// @return Reference to queue instance
+        static WriteQueue& getInstance();
+
+        /// @brief Delete copy, assignment, move, move assignment constructor
+        WriteQueue(const WriteQueue&) = delete;
+        WriteQueue& operator=(const WriteQueue&) = delete;
+        WriteQueue(WriteQueue&&) = delete;
+        WriteQueue& operator=(WriteQueue&&) = delete;
+
+        /// @brief Starts writer thread, does nothing when maximal batch is zero
+        /// @param settings limits of batches
+        void start(const Settings& settings);
+
+        /// @brief Stops accepting writes and stops writer thread once queued writes are committed
+        void stop();
+
+        /// @brief Checks whether queue accepts writes
+        /// @return true when writer thread is running
+        bool running();
+
+        /// @brief Adds password in next batch and waits for its commit
+        /// @param password Password to add, id, timestamps and version are filled in
+        /// @return false when queue is not running and caller has to write itself
+        bool add(Password& password);
+
+        /// @brief Updates password in next batch and waits for its commit
+        /// @param password Password to update
+        /// @return New version of vault, 0 when no entry was updated, nullopt when queue is not running
+        std::optional<std::int64_t> update(const Password& password);
+
+        /// @brief Removes password in next batch and waits for its commit
+        /// @param userId ID of user owning password
+        /// @param id ID of password to remove
+        /// @return New version of vault, 0 when no entry was removed, nullopt when queue is not running
+        std::optional<std::int64_t> remove(const std::uint32_t userId, const std::uint32_t id);
+
+    private:
+        /// @brief Kind of queued write
+        enum class Type {
+            Add,
+            Update,
+            Remove
+        };
+
+        /// @brief Write waiting in queue, lives on stack of waiting request thread
+        class Write {
+        public:
+            Type type = Type::Add;                      // Kind of write
+            Password* password = nullptr;               // Password to add or update
+            std::uint32_t userId = 0;                   // ID of user owning password
+            std::uint32_t id = 0;                       // ID of password to remove
+            std::promise<std::int64_t> done;            // Version of vault once committed
+        };
+
+        /// @brief Private constructor for Singleton pattern
+        WriteQueue() = default;
+
+        /// @brief Private destructor
+        ~WriteQueue();
+
+        /// @brief Queues write and waits for commit of its batch
+        /// @param write write to queue
+        /// @return New version of vault, nullopt when queue is not running
+        /// @throw exception thrown while applying or committing write
+        std::optional<std::int64_t> submit(Write& write);
+
+        /// @brief Writer thread loop
+        /// @param stopToken token signalling stop request
+        void run(std::stop_token stopToken);
+
+        /// @brief Applies batch in one transaction per shard and completes its writes
+        /// @param batch writes in order of queueing
+        void commit(const std::vector<Write*>& batch);
+
+        /// @brief Applies single write inside transaction of lease
+        /// @param lease lease of shard of user owning password
+        /// @param write write to apply
+        /// @return New version of vault, 0 when nothing changed
+        static std::int64_t apply(DatabaseManager::Lease& lease, Write& write);
+
+        Settings settings;                                  // Limits of batches
+        std::deque<Write*> writes;                          // Queued writes
+        bool accepting = false;                             // Whether new writes are queued
+        std::mutex mtx;                                     // Mutex guarding writes and accepting flag
+        std::condition_variable_any cv;                     // Signals queued write or stop
+        std::jthread writer;                                // Writer thread
+    };
+}
@@ -0,0 +1,138 @@
+// Blind index: tokens of queries are found among tokens of matching entries, deduplicated and capped.
+
+#include <test-harness.hpp>
+#include <blind-index.hpp>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace {
+    /// @brief Builds index under key filled with given byte
+    pass::BlindIndex makeIndex(CryptoPP::byte fill) {
+        CryptoPP::SecByteBlock key(32);
+        std::fill(key.begin(), key.end(), fill);
+        return pass::BlindIndex(key);
+    }
+
+    /// @brief Checks that every token of query is stored for entry
+    bool contains(const std::vector<std::int64_t>& entry, const std::vector<std::int64_t>& query) {
+        return std::includes(entry.begin(), entry.end(), query.begin(), query.end());
+    }
+}
+
+TEST_CASE(entryTokensSortedWithMarker) {
+    auto index = makeIndex(1);
+    auto tokens = index.entryTokens("GitHub Enterprise", "https://github.com", "alice");
+    CHECK(std::is_sorted(tokens.begin(), tokens.end()));
+    CHECK(std::adjacent_find(tokens.begin(), tokens.end()) == tokens.end());
+    CHECK(std::binary_search(tokens.begin(), tokens.end(), pass::BlindIndex::INDEXED_MARKER));
+}
+
+TEST_CASE(queryMatchesEntry) {
+    auto index = makeIndex(1);
+    auto entry = index.entryTokens("GitHub Enterprise", "https://github.com", "alice");
+
+    // Trigrams of longer words, case is ignored
+    CHECK(contains(entry, index.queryTokens("hub ENT")));
+    // Short words match anywhere in word
+    CHECK(contains(entry, index.queryTokens("li")));
+    CHECK(contains(entry, index.queryTokens("e")));
+    // Words of url are indexed too
+    CHECK(contains(entry, index.queryTokens("github.com")));
+    CHECK(!contains(entry, index.queryTokens("gitlab")));
+}
+
+TEST_CASE(queryTokensDeduplicated) {
+    auto index = makeIndex(1);
+    auto tokens = index.queryTokens("aaaa AAAA aaa");
+    CHECK(tokens.size() == 1);
+    CHECK(tokens == index.queryTokens("aaa"));
+    CHECK(index.queryTokens("").empty());
+    CHECK(index.queryTokens(" .,-").empty());
+}
+
+TEST_CASE(queryTokensCapped) {
+    auto index = makeIndex(1);
+    std::string query;
+    for (char c = 'a'; c <= 'z'; ++c) {
+        query += c;
+    }
+    query += "0123456789";
+    CHECK(query.size() - pass::BlindIndex::NGRAM_SIZE + 1 > pass::BlindIndex::MAX_QUERY_TOKENS);
+
+    auto tokens = index.queryTokens(query);
+    CHECK(tokens.size() == pass::BlindIndex::MAX_QUERY_TOKENS);
+    CHECK(std::is_sorted(tokens.begin(), tokens.end()));
+
+    // Capped query still finds entry, it only needs subset of its tokens
+    CHECK(contains(index.entryTokens(query, "", ""), tokens));
+}
+
+TEST_CASE(tokensDependOnKey) {
+    auto first = makeIndex(1);
+    auto second = makeIndex(2);
+    CHECK(first.queryTokens("example") == first.queryTokens("example"));
+    CHECK(first.queryTokens("example") != second.queryTokens("example"));
+}
+
+TEST_CASE(tokensAvoidMarkers) {
+    auto index = makeIndex(3);
+    for (auto token : index.entryTokens("some name", "https://site.example", "login")) {
+        CHECK(token == pass::BlindIndex::INDEXED_MARKER || token < 0 || token >= 256);
+    }
+}
+
+TEST_CASE(matchesIgnoresCase) {
+    CHECK(pass::BlindIndex::matches("GitHub Enterprise", "hub ent"));
+    CHECK(pass::BlindIndex::matches("GitHub", ""));
+    CHECK(!pass::BlindIndex::matches("GitHub", "gitlab"));
+    CHECK(!pass::BlindIndex::matches("", "a"));
+}
+
+TEST_CASE(urlKeysNormalizeOrigin) {
+    auto keys = pass::BlindIndex::urlKeys(" HTTPS://User@Login.Example.com:443/path?q#f ");
+    CHECK(keys.origin == "https://login.example.com");
+    CHECK(keys.site == "example.com");
+
+    // Url without scheme is treated as https, non-default port is kept, default one and trailing dot are dropped
+    keys = pass::BlindIndex::urlKeys("example.com:8443/login");
+    CHECK(keys.origin == "https://example.com:8443");
+    CHECK(keys.site == "example.com");
+
+    keys = pass::BlindIndex::urlKeys("http://shop.example.org.:80");
+    CHECK(keys.origin == "http://shop.example.org");
+    CHECK(keys.site == "example.org");
+}
+
+TEST_CASE(urlKeysRegistrableDomain) {
+    CHECK(pass::BlindIndex::urlKeys("https://a.b.example.co.uk").site == "example.co.uk");
+    CHECK(pass::BlindIndex::urlKeys("https://bank.com.pl/").site == "bank.com.pl");
+    CHECK(pass::BlindIndex::urlKeys("https://example.com").site == "example.com");
+    CHECK(pass::BlindIndex::urlKeys("https://localhost:3000").site == "localhost");
+
+    // IP addresses have no registrable domain
+    CHECK(pass::BlindIndex::urlKeys("http://192.168.1.10:8080/admin").site == "192.168.1.10");
+    CHECK(pass::BlindIndex::urlKeys("http://[::1]:8080/").origin == "http://[::1]:8080");
+}
+
+TEST_CASE(urlKeysWithoutHost) {
+    CHECK(pass::BlindIndex::urlKeys("").origin.empty());
+    CHECK(pass::BlindIndex::urlKeys("https:///path").origin.empty());
+}
+
+TEST_CASE(entryTokensContainUrlTokens) {
+    auto index = makeIndex(1);
+    auto entry = index.entryTokens("Mail", "https://mail.example.com/inbox", "");
+    auto [origin, site] = index.urlTokens(pass::BlindIndex::urlKeys("mail.example.com"));
+    CHECK(std::binary_search(entry.begin(), entry.end(), origin));
+    CHECK(std::binary_search(entry.begin(), entry.end(), site));
+
+    // Another subdomain shares only site
+    auto [otherOrigin, otherSite] = index.urlTokens(pass::BlindIndex::urlKeys("https://login.example.com"));
+    CHECK(!std::binary_search(entry.begin(), entry.end(), otherOrigin));
+    CHECK(otherSite == site);
+}
+
+int main() {
+    return test::run("blind-index-test");
+}
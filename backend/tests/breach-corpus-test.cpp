@@ -0,0 +1,167 @@
+// Breach corpus: layout written by BreachCorpusWriter, validation of header and lookups through Bloom filter.
+
+#include <test-harness.hpp>
+#include <breach-corpus.hpp>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+    std::filesystem::path directory;    // Directory of corpus files written by tests
+
+    /// @brief Writes corpus of given passwords
+    /// @return path of corpus file
+    std::filesystem::path writeCorpus(const std::string& name, const std::vector<std::string>& passwords) {
+        std::vector<pass::BreachCorpus::Hash> hashes;
+        for (const auto& password : passwords) {
+            hashes.push_back(pass::BreachCorpus::hash(password));
+        }
+        std::sort(hashes.begin(), hashes.end());
+
+        auto path = directory / name;
+        std::ofstream out(path, std::ios::binary);
+        pass::BreachCorpusWriter writer(out, hashes.size());
+        for (const auto& hash : hashes) {
+            writer.add(hash);
+        }
+        writer.finish();
+        return path;
+    }
+
+    std::string readFile(const std::filesystem::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    std::filesystem::path writeFile(const std::string& name, const std::string& content) {
+        auto path = directory / name;
+        std::ofstream out(path, std::ios::binary);
+        out.write(content.data(), static_cast<std::streamsize>(content.size()));
+        return path;
+    }
+
+    std::vector<std::string> numbered(const std::string& prefix, int count) {
+        std::vector<std::string> passwords;
+        for (int i = 0; i < count; ++i) {
+            passwords.push_back(prefix + std::to_string(i));
+        }
+        return passwords;
+    }
+}
+
+TEST_CASE(hashAndParseHex) {
+    pass::BreachCorpus::Hash expected;
+    CHECK(pass::BreachCorpus::parseHex("5BAA61E4C9B93F3F0682250B6CF8331B7EE68FD8:9545824", expected));
+    CHECK(pass::BreachCorpus::hash("password") == expected);
+
+    pass::BreachCorpus::Hash lower;
+    CHECK(pass::BreachCorpus::parseHex("5baa61e4c9b93f3f0682250b6cf8331b7ee68fd8", lower));
+    CHECK(lower == expected);
+
+    pass::BreachCorpus::Hash invalid;
+    CHECK(!pass::BreachCorpus::parseHex("5BAA61E4C9B93F3F0682250B6CF8331B7EE68FD", invalid));
+    CHECK(!pass::BreachCorpus::parseHex("5BAA61E4C9B93F3F0682250B6CF8331B7EE68FDX", invalid));
+}
+
+TEST_CASE(writerRequiresSortedHashes) {
+    auto first = pass::BreachCorpus::hash("first");
+    auto second = pass::BreachCorpus::hash("second");
+    auto [low, high] = std::minmax(first, second);
+
+    std::ofstream out(directory / "unsorted.bin", std::ios::binary);
+    pass::BreachCorpusWriter writer(out, 2);
+    writer.add(high);
+    CHECK_THROWS(std::invalid_argument, writer.add(low));
+
+    // Duplicates are skipped
+    writer.add(high);
+    CHECK(writer.finish() == 1);
+}
+
+TEST_CASE(headerLayout) {
+    auto passwords = numbered("header-", 100);
+    passwords.push_back(passwords.front());
+    auto content = readFile(writeCorpus("header.bin", passwords));
+
+    pass::BreachCorpus::Header header;
+    CHECK(content.size() >= sizeof(header));
+    std::memcpy(&header, content.data(), sizeof(header));
+    CHECK(std::memcmp(header.magic, pass::BreachCorpus::MAGIC, sizeof(header.magic)) == 0);
+    CHECK(header.version == pass::BreachCorpus::VERSION);
+    CHECK(header.hashSize == pass::BreachCorpus::HASH_SIZE);
+    CHECK(header.count == 100);
+
+    // Bloom filter starts at cache line boundary right after hashes and fills rest of file
+    CHECK(header.bloomOffset % pass::BreachCorpus::BLOCK_SIZE == 0);
+    CHECK(header.bloomOffset >= pass::BreachCorpus::HEADER_SIZE + header.count * pass::BreachCorpus::HASH_SIZE);
+    CHECK(header.bloomOffset < pass::BreachCorpus::HEADER_SIZE + header.count * pass::BreachCorpus::HASH_SIZE + pass::BreachCorpus::BLOCK_SIZE);
+    CHECK(header.bloomBlocks == (101 * pass::BreachCorpusWriter::DEFAULT_BITS_PER_KEY + 511) / 512);
+    CHECK(content.size() == header.bloomOffset + header.bloomBlocks * pass::BreachCorpus::BLOCK_SIZE);
+}
+
+TEST_CASE(bloomBitsOfEveryHash) {
+    auto passwords = numbered("bloom-", 50);
+    auto content = readFile(writeCorpus("bloom.bin", passwords));
+    pass::BreachCorpus::Header header;
+    std::memcpy(&header, content.data(), sizeof(header));
+
+    for (const auto& password : passwords) {
+        auto hash = pass::BreachCorpus::hash(password);
+        auto offset = header.bloomOffset + pass::BreachCorpus::blockOf(hash, header.bloomBlocks) * pass::BreachCorpus::BLOCK_SIZE;
+        auto bits = pass::BreachCorpus::bitsOf(hash);
+        for (std::size_t i = 0; i < pass::BreachCorpus::BLOCK_WORDS; ++i) {
+            std::uint64_t word;
+            std::memcpy(&word, content.data() + offset + i * sizeof(word), sizeof(word));
+            CHECK((word >> ((bits >> (6 * i)) & 63) & 1) == 1);
+        }
+    }
+}
+
+TEST_CASE(lookups) {
+    auto passwords = numbered("breached-", 1000);
+    passwords.push_back("password");
+    auto& checker = pass::BreachChecker::getInstance();
+    checker.load(writeCorpus("lookups.bin", passwords));
+
+    for (const auto& password : passwords) {
+        CHECK(checker.isBreached(password));
+    }
+    // Passwords passing Bloom filter by chance are rejected by exact search
+    for (const auto& password : numbered("safe-", 1000)) {
+        CHECK(!checker.isBreached(password));
+    }
+}
+
+TEST_CASE(rejectsMalformedCorpus) {
+    auto& checker = pass::BreachChecker::getInstance();
+    auto content = readFile(writeCorpus("valid.bin", numbered("valid-", 10)));
+
+    auto magic = content;
+    magic[0] = 'X';
+    CHECK_THROWS(std::runtime_error, checker.load(writeFile("magic.bin", magic)));
+
+    auto reserved = content;
+    reserved[pass::BreachCorpus::HEADER_SIZE - 1] = 1;
+    CHECK_THROWS(std::runtime_error, checker.load(writeFile("reserved.bin", reserved)));
+
+    CHECK_THROWS(std::runtime_error, checker.load(writeFile("truncated.bin", content.substr(0, content.size() - 1))));
+    CHECK_THROWS(std::runtime_error, checker.load(writeFile("short.bin", content.substr(0, pass::BreachCorpus::HEADER_SIZE - 1))));
+
+    // Count pointing past end of file
+    auto forged = content;
+    pass::BreachCorpus::Header header;
+    std::memcpy(&header, forged.data(), sizeof(header));
+    header.count = UINT64_MAX / pass::BreachCorpus::HASH_SIZE;
+    std::memcpy(forged.data(), &header, sizeof(header));
+    CHECK_THROWS(std::runtime_error, checker.load(writeFile("forged.bin", forged)));
+}
+
+int main() {
+    return test::run("breach-corpus-test", []() {
+        directory = test::temporaryDirectory("breach-corpus-test");
+    });
+}
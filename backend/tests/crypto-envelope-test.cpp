@@ -0,0 +1,85 @@
+// Binary envelope of Crypto: layout, round trips, legacy Base64 text and rejection of damaged envelopes.
+
+#include <test-harness.hpp>
+#include <crypto.hpp>
+#include <secure-arena.hpp>
+#include <cryptopp/base64.h>
+#include <cryptopp/filters.h>
+#include <memory_resource>
+#include <string>
+
+namespace {
+    const std::string PASSWORD = "envelope-test-password";
+
+    /// @brief Copy of envelope with one byte flipped
+    std::string flipped(std::string envelope, std::size_t offset) {
+        envelope[offset] = static_cast<char>(envelope[offset] ^ 0x01);
+        return envelope;
+    }
+}
+
+TEST_CASE(layout) {
+    Crypto crypto(PASSWORD);
+    auto envelope = crypto.encrypt("hello");
+    CHECK(envelope.size() == Crypto::ENVELOPE_OVERHEAD + 5);
+    CHECK(static_cast<CryptoPP::byte>(envelope[0]) == Crypto::ENVELOPE_VERSION);
+
+    // Random IV, equal plaintexts give different envelopes
+    CHECK(crypto.encrypt("hello") != envelope);
+}
+
+TEST_CASE(roundTrip) {
+    Crypto crypto(PASSWORD);
+    std::string binary("\0\x01\xFF text", 8);
+    CHECK(crypto.decrypt(crypto.encrypt(binary)) == binary);
+    CHECK(crypto.decrypt(crypto.encrypt("")).empty());
+
+    // Another session of the same password derives key from salt of envelope
+    Crypto other(PASSWORD);
+    CHECK(other.decrypt(crypto.encrypt("shared")) == "shared");
+}
+
+TEST_CASE(decryptIntoResource) {
+    Crypto crypto(PASSWORD);
+    std::pmr::monotonic_buffer_resource resource;
+    auto plaintext = crypto.decrypt(crypto.encrypt("arena"), resource);
+    CHECK(plaintext == "arena");
+    CHECK(crypto.decrypt(crypto.encrypt(""), resource).empty());
+}
+
+TEST_CASE(legacyBase64Text) {
+    // Legacy text is the same salt, IV, ciphertext and tag without version byte, encoded in Base64
+    Crypto crypto(PASSWORD);
+    auto envelope = crypto.encrypt("legacy");
+    std::string legacy;
+    CryptoPP::StringSource ss(envelope.substr(1), true, new CryptoPP::Base64Encoder(new CryptoPP::StringSink(legacy), false));
+    CHECK(crypto.decrypt(legacy) == "legacy");
+}
+
+TEST_CASE(rejectsDamagedEnvelope) {
+    Crypto crypto(PASSWORD);
+    auto envelope = crypto.encrypt("secret");
+    std::size_t salt = 1;
+    auto iv = salt + Crypto::SALT_SIZE;
+    auto ciphertext = iv + Crypto::IV_SIZE;
+
+    CHECK_THROWS(std::runtime_error, crypto.decrypt(flipped(envelope, salt)));
+    CHECK_THROWS(std::runtime_error, crypto.decrypt(flipped(envelope, iv)));
+    CHECK_THROWS(std::runtime_error, crypto.decrypt(flipped(envelope, ciphertext)));
+    CHECK_THROWS(std::runtime_error, crypto.decrypt(flipped(envelope, envelope.size() - 1)));
+
+    // Truncated envelopes
+    CHECK_THROWS(std::runtime_error, crypto.decrypt(envelope.substr(0, envelope.size() - 1)));
+    CHECK_THROWS(std::runtime_error, crypto.decrypt(envelope.substr(0, Crypto::ENVELOPE_OVERHEAD - 1)));
+    CHECK_THROWS(std::runtime_error, crypto.decrypt(""));
+}
+
+TEST_CASE(rejectsWrongPassword) {
+    Crypto crypto(PASSWORD);
+    Crypto other("another-password");
+    CHECK_THROWS(std::runtime_error, other.decrypt(crypto.encrypt("secret")));
+}
+
+int main() {
+    return test::run("crypto-envelope-test");
+}
@@ -0,0 +1,132 @@
+// KDF parameters: text and binary forms, bounds checked on stored data and envelopes carrying parameters.
+
+#include <test-harness.hpp>
+#include <kdf.hpp>
+#include <crypto.hpp>
+#include <array>
+#include <string>
+
+namespace {
+    KdfParameters pbkdf2(std::uint32_t iterations) {
+        KdfParameters parameters;
+        parameters.iterations = iterations;
+        return parameters;
+    }
+
+    KdfParameters argon2id(std::uint32_t memoryKiB, std::uint32_t passes, std::uint32_t lanes) {
+        KdfParameters parameters;
+        parameters.algorithm = KdfParameters::Algorithm::Argon2id;
+        parameters.memoryKiB = memoryKiB;
+        parameters.iterations = passes;
+        parameters.lanes = lanes;
+        return parameters;
+    }
+}
+
+TEST_CASE(textForm) {
+    CHECK(KdfParameters().toString() == "pbkdf2-sha256$i=100000");
+    CHECK(KdfParameters::fromString("pbkdf2-sha256$i=250000") == pbkdf2(250000));
+    CHECK(KdfParameters::fromString(pbkdf2(600000).toString()) == pbkdf2(600000));
+    CHECK(argon2id(65536, 3, 4).toString() == "argon2id$m=65536,t=3,p=4");
+    if (KdfParameters::argon2Available()) {
+        CHECK(KdfParameters::fromString("argon2id$m=65536,t=3,p=4") == argon2id(65536, 3, 4));
+    }
+    else {
+        CHECK_THROWS(std::invalid_argument, KdfParameters::fromString("argon2id$m=65536,t=3,p=4"));
+    }
+}
+
+TEST_CASE(textFormRejectsMalformed) {
+    CHECK_THROWS(std::invalid_argument, KdfParameters::fromString(""));
+    CHECK_THROWS(std::invalid_argument, KdfParameters::fromString("pbkdf2-sha256"));
+    CHECK_THROWS(std::invalid_argument, KdfParameters::fromString("scrypt$n=16384"));
+    CHECK_THROWS(std::invalid_argument, KdfParameters::fromString("pbkdf2-sha256$i"));
+    CHECK_THROWS(std::invalid_argument, KdfParameters::fromString("pbkdf2-sha256$x=100000"));
+    CHECK_THROWS(std::invalid_argument, KdfParameters::fromString("pbkdf2-sha256$i=100000x"));
+    CHECK_THROWS(std::invalid_argument, KdfParameters::fromString("pbkdf2-sha256$i=-1"));
+    CHECK_THROWS(std::invalid_argument, KdfParameters::fromString("pbkdf2-sha256$i=99999999999"));
+
+    // Bounds protect decryption from absurd costs
+    CHECK_THROWS(std::invalid_argument, KdfParameters::fromString("pbkdf2-sha256$i=1000"));
+    CHECK_THROWS(std::invalid_argument, KdfParameters::fromString("pbkdf2-sha256$i=20000001"));
+}
+
+TEST_CASE(binaryForm) {
+    std::array<CryptoPP::byte, KdfParameters::ENCODED_SIZE> encoded{};
+    pbkdf2(0x01020304).encode(encoded.data());
+    CHECK(encoded[0] == static_cast<CryptoPP::byte>(KdfParameters::Algorithm::Pbkdf2Sha256));
+    CHECK(encoded[1] == 0x04 && encoded[2] == 0x03 && encoded[3] == 0x02 && encoded[4] == 0x01);
+    CHECK(KdfParameters::decode(encoded.data()) == pbkdf2(0x01020304));
+
+    argon2id(65536, 3, 4).encode(encoded.data());
+    CHECK(encoded[0] == static_cast<CryptoPP::byte>(KdfParameters::Algorithm::Argon2id));
+    CHECK(encoded[9] == 4);
+    if (KdfParameters::argon2Available()) {
+        CHECK(KdfParameters::decode(encoded.data()) == argon2id(65536, 3, 4));
+    }
+    else {
+        CHECK_THROWS(std::invalid_argument, KdfParameters::decode(encoded.data()));
+    }
+}
+
+TEST_CASE(binaryFormRejectsOutOfBounds) {
+    std::array<CryptoPP::byte, KdfParameters::ENCODED_SIZE> encoded{};
+    pbkdf2(KdfParameters::LEGACY_ITERATIONS - 1).encode(encoded.data());
+    CHECK_THROWS(std::invalid_argument, KdfParameters::decode(encoded.data()));
+
+    pbkdf2(KdfParameters::LEGACY_ITERATIONS).encode(encoded.data());
+    encoded[0] = 0x7F;
+    CHECK_THROWS(std::invalid_argument, KdfParameters::decode(encoded.data()));
+}
+
+TEST_CASE(argon2Bounds) {
+    if (!KdfParameters::argon2Available()) {
+        CHECK_THROWS(std::invalid_argument, argon2id(65536, 3, 4).validate());
+        return;
+    }
+    argon2id(KdfParameters::MIN_ARGON2_MEMORY_KIB, 1, 1).validate();
+    CHECK_THROWS(std::invalid_argument, argon2id(KdfParameters::MIN_ARGON2_MEMORY_KIB - 1, 1, 1).validate());
+    CHECK_THROWS(std::invalid_argument, argon2id(65536, 0, 1).validate());
+    CHECK_THROWS(std::invalid_argument, argon2id(65536, KdfParameters::MAX_ARGON2_PASSES + 1, 1).validate());
+    CHECK_THROWS(std::invalid_argument, argon2id(65536, 3, 0).validate());
+    CHECK_THROWS(std::invalid_argument, argon2id(65536, 3, KdfParameters::MAX_ARGON2_LANES + 1).validate());
+}
+
+TEST_CASE(envelopeCarriesParameters) {
+    auto kdf = pbkdf2(150000);
+    Crypto crypto("kdf-test-password", kdf);
+    auto envelope = crypto.encrypt("hello");
+    CHECK(envelope.size() == Crypto::ENVELOPE_KDF_OVERHEAD + 5);
+    CHECK(static_cast<CryptoPP::byte>(envelope[0]) == Crypto::ENVELOPE_KDF_VERSION);
+    CHECK(KdfParameters::decode(reinterpret_cast<const CryptoPP::byte*>(envelope.data() + 1)) == kdf);
+
+    // Decryption follows parameters of envelope, not of crypto
+    Crypto legacy("kdf-test-password");
+    CHECK(legacy.decrypt(envelope) == "hello");
+
+    // Legacy parameters keep version 1 envelope
+    CHECK(static_cast<CryptoPP::byte>(legacy.encrypt("hello")[0]) == Crypto::ENVELOPE_VERSION);
+}
+
+TEST_CASE(envelopeRejectsForgedParameters) {
+    auto kdf = pbkdf2(150000);
+    Crypto crypto("kdf-test-password", kdf);
+    auto envelope = crypto.encrypt("hello");
+
+    // Parameters out of bounds are rejected before any derivation
+    auto weak = envelope;
+    pbkdf2(1).encode(reinterpret_cast<CryptoPP::byte*>(weak.data() + 1));
+    CHECK_THROWS(std::runtime_error, crypto.decrypt(weak));
+
+    // Other valid parameters derive another key
+    auto other = envelope;
+    pbkdf2(150001).encode(reinterpret_cast<CryptoPP::byte*>(other.data() + 1));
+    CHECK_THROWS(std::runtime_error, crypto.decrypt(other));
+
+    // Envelope too short to hold parameters
+    CHECK_THROWS(std::runtime_error, crypto.decrypt(envelope.substr(0, KdfParameters::ENCODED_SIZE)));
+}
+
+int main() {
+    return test::run("kdf-test");
+}
@@ -0,0 +1,275 @@
+// Key rotation: compare-and-swap of credentials, upgrade of KDF at login and background re-encryption
+// of vault including verification rounds for entries still sealed with previous password.
+
+#include <test-harness.hpp>
+#include <key-rotation.hpp>
+#include <auth.hpp>
+#include <crypto.hpp>
+#include <passwords.hpp>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    /// @brief User with credentials encrypted with given password, as stored by registration
+    auth::User sealedUser(std::uint32_t id, const std::string& login, const std::string& password, const KdfParameters& kdf = KdfParameters()) {
+        Crypto crypto(password, kdf);
+        auth::User user{};
+        user.id = id;
+        user.login = crypto.encrypt(login);
+        user.password = crypto.encrypt(password);
+        user.name = crypto.encrypt("Name");
+        user.surname = crypto.encrypt("Surname");
+        user.kdf = kdf;
+        user.loginKey = auth::AuthenticationManager::loginKey(login);
+        return user;
+    }
+
+    std::uint32_t newUser(const std::string& login, const std::string& password, const KdfParameters& kdf = KdfParameters()) {
+        auto user = sealedUser(0, login, password, kdf);
+        auth::SQLiteUserRepository::getInstance().add(user);
+        return user.id;
+    }
+
+    std::string storedPassword(std::uint32_t userId) {
+        return auth::SQLiteUserRepository::getInstance().getById(userId)->password;
+    }
+
+    /// @brief Adds entries sealed with crypto currently registered for user
+    /// @return ids of entries in ascending order
+    std::vector<std::uint32_t> addEntries(std::uint32_t userId, int count) {
+        std::vector<std::uint32_t> ids;
+        for (int i = 0; i < count; ++i) {
+            pass::Password password{};
+            password.userId = userId;
+            password.name = "entry-" + std::to_string(i);
+            password.password = "secret-" + std::to_string(i);
+            auto sealed = pass::PasswordCrypto::encrypt(password, userId);
+            pass::SQLitePasswordRepository::getInstance().add(sealed);
+            ids.push_back(sealed.id);
+        }
+        return ids;
+    }
+
+    /// @brief Counts entries of vault which open with given password alone
+    /// @throw std::runtime_error when some entry needs another password
+    std::size_t openWith(std::uint32_t userId, const std::string& password) {
+        CryptoManager::registerCrypto(password, userId, KdfParameters());
+        std::size_t count = 0;
+        pass::SQLitePasswordRepository::getInstance().forEachOfUser(userId, [&](const pass::Password& sealed) {
+            auto plain = pass::PasswordCrypto::decrypt(sealed, userId);
+            test::check(plain.name == "entry-" + std::to_string(count), "entry opens in order");
+            ++count;
+        });
+        return count;
+    }
+
+    /// @brief Waits until re-encryption of user finishes or fails
+    pass::KeyRotation::Progress waitForRotation(std::uint32_t userId) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+        while (true) {
+            auto progress = pass::KeyRotation::getInstance().progress(userId);
+            if (progress.state == pass::KeyRotation::State::Finished || progress.state == pass::KeyRotation::State::Failed
+                || std::chrono::steady_clock::now() > deadline) {
+                return progress;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+}
+
+TEST_CASE(startKeyRotationIsCompareAndSwap) {
+    auto& users = auth::SQLiteUserRepository::getInstance();
+    auto userId = newUser("cas-start", "old-password");
+    auto stored = storedPassword(userId);
+    auto next = sealedUser(userId, "cas-start", "new-password");
+    auto previous = Crypto("new-password").encrypt("old-password");
+
+    // Change verified against other credentials loses
+    CHECK(!users.startKeyRotation(next, previous, "stale"));
+    CHECK(!users.getKeyRotation(userId));
+    CHECK(storedPassword(userId) == stored);
+
+    CHECK(users.startKeyRotation(next, previous, stored));
+    auto state = users.getKeyRotation(userId);
+    CHECK(state && state->previous == previous && state->cursor == 0);
+    CHECK(storedPassword(userId) == next.password);
+
+    // Second change waits for re-encryption of first one, even when verified against current credentials
+    auto third = sealedUser(userId, "cas-start", "third-password");
+    CHECK(!users.startKeyRotation(third, previous, next.password));
+    users.finishKeyRotation(userId);
+    CHECK(!users.getKeyRotation(userId));
+    CHECK(users.startKeyRotation(third, previous, next.password));
+    users.finishKeyRotation(userId);
+}
+
+TEST_CASE(upgradeCredentialsIsCompareAndSwap) {
+    auto& users = auth::SQLiteUserRepository::getInstance();
+    auto userId = newUser("cas-upgrade", "password");
+    auto stored = storedPassword(userId);
+    KdfParameters kdf;
+    kdf.iterations = 150000;
+    auto upgraded = sealedUser(userId, "cas-upgrade", "password", kdf);
+
+    CHECK(!users.upgradeCredentials(upgraded, "stale"));
+    CHECK(storedPassword(userId) == stored);
+    CHECK(users.getById(userId)->kdf == KdfParameters());
+
+    CHECK(users.upgradeCredentials(upgraded, stored));
+    CHECK(storedPassword(userId) == upgraded.password);
+    CHECK(users.getById(userId)->kdf == kdf);
+
+    // Upgrade must not overwrite credentials swapped by password change
+    auto next = sealedUser(userId, "cas-upgrade", "new-password");
+    CHECK(users.startKeyRotation(next, Crypto("new-password").encrypt("password"), upgraded.password));
+    CHECK(!users.upgradeCredentials(upgraded, upgraded.password));
+    CHECK(!users.upgradeCredentials(sealedUser(userId, "cas-upgrade", "new-password", kdf), next.password));
+    CHECK(storedPassword(userId) == next.password);
+    users.finishKeyRotation(userId);
+}
+
+TEST_CASE(loginUpgradesKdf) {
+    KdfParameters target;
+    target.iterations = 150000;
+    Crypto::setTargetKdf(target);
+    auto userId = newUser("login-upgrade", "password");
+
+    auto user = auth::AuthenticationManager::checkCredentials("login-upgrade", "password");
+    Crypto::setTargetKdf(KdfParameters());
+    CHECK(user && user->id == userId);
+    CHECK(user->kdf == target);
+    CHECK(user->name == "Name");
+
+    // Credentials are stored under new parameters and still open with the same password
+    auto stored = auth::SQLiteUserRepository::getInstance().getById(userId);
+    CHECK(stored->kdf == target);
+    CHECK(Crypto("password").decrypt(stored->password) == "password");
+    CHECK(auth::AuthenticationManager::checkCredentials("login-upgrade", "password"));
+}
+
+TEST_CASE(staleUpgradeWritesNothing) {
+    auto userId = newUser("stale-upgrade", "password");
+    auto stored = storedPassword(userId);
+    auto user = auth::AuthenticationManager::checkCredentials("stale-upgrade", "password");
+    CHECK(user);
+
+    KdfParameters target;
+    target.iterations = 150000;
+    Crypto::setTargetKdf(target);
+    auto upgraded = auth::AuthenticationManager::upgradeKdf(*user, "stale");
+    Crypto::setTargetKdf(KdfParameters());
+    CHECK(!upgraded);
+    CHECK(user->kdf == KdfParameters());
+    CHECK(storedPassword(userId) == stored);
+}
+
+TEST_CASE(loginSkipsUpgradeWhileVaultIsReencrypted) {
+    auto& users = auth::SQLiteUserRepository::getInstance();
+    auto userId = newUser("login-rotation", "password");
+    auto stored = storedPassword(userId);
+    users.executeOperation([userId](SQLite::Database* db) {
+        SQLite::Statement query(*db, "UPDATE users SET rotation = 'pending' WHERE id = ?");
+        query.bind(1, static_cast<int64_t>(userId));
+        return query.exec();
+    });
+
+    KdfParameters target;
+    target.iterations = 150000;
+    Crypto::setTargetKdf(target);
+    auto user = auth::AuthenticationManager::checkCredentials("login-rotation", "password");
+    Crypto::setTargetKdf(KdfParameters());
+
+    // Password is unchanged, so login succeeds and user stays on old KDF
+    CHECK(user && user->id == userId);
+    CHECK(user->kdf == KdfParameters());
+    CHECK(storedPassword(userId) == stored);
+    users.finishKeyRotation(userId);
+}
+
+TEST_CASE(changePasswordVerifiesCurrentPassword) {
+    auto& rotation = pass::KeyRotation::getInstance();
+    auto userId = newUser("change-wrong", "password");
+    auto stored = storedPassword(userId);
+    CHECK(!rotation.changePassword(userId, "wrong-password", "new-password"));
+    CHECK(storedPassword(userId) == stored);
+    CHECK(!auth::SQLiteUserRepository::getInstance().getKeyRotation(userId));
+    CHECK_THROWS(std::invalid_argument, rotation.changePassword(999999, "password", "new-password"));
+}
+
+TEST_CASE(changePasswordConflicts) {
+    auto& rotation = pass::KeyRotation::getInstance();
+    auto& users = auth::SQLiteUserRepository::getInstance();
+
+    // Password cannot be changed while backup pauses key rotation
+    auto userId = newUser("change-paused", "password");
+    {
+        pass::KeyRotation::Pause pause;
+        CHECK_THROWS(pass::KeyRotationConflict, rotation.changePassword(userId, "password", "new-password"));
+    }
+    CHECK(!users.getKeyRotation(userId));
+
+    // Unfinished re-encryption of previous change
+    auto next = sealedUser(userId, "change-paused", "new-password");
+    CHECK(users.startKeyRotation(next, Crypto("new-password").encrypt("password"), storedPassword(userId)));
+    CHECK_THROWS(std::invalid_argument, rotation.changePassword(userId, "new-password", "third-password"));
+    users.finishKeyRotation(userId);
+}
+
+TEST_CASE(changePasswordReencryptsVault) {
+    auto& rotation = pass::KeyRotation::getInstance();
+    rotation.configure({ 2, 0 });
+    rotation.start();
+
+    auto userId = newUser("change-vault", "password");
+    CryptoManager::registerCrypto("password", userId, KdfParameters());
+    auto ids = addEntries(userId, 5);
+
+    CHECK(rotation.changePassword(userId, "password", "new-password"));
+    auto progress = waitForRotation(userId);
+    CHECK(progress.state == pass::KeyRotation::State::Finished);
+    CHECK(progress.total == ids.size());
+    CHECK(progress.done == ids.size());
+    CHECK(progress.skipped == 0);
+
+    CHECK(!auth::SQLiteUserRepository::getInstance().getKeyRotation(userId));
+    CHECK(openWith(userId, "new-password") == ids.size());
+    CHECK(auth::AuthenticationManager::checkCredentials("change-vault", "new-password"));
+}
+
+TEST_CASE(verifyRoundsReencryptEntriesMissedByFirstPass) {
+    auto& rotation = pass::KeyRotation::getInstance();
+    auto& users = auth::SQLiteUserRepository::getInstance();
+    rotation.configure({ 2, 0 });
+    rotation.start();
+
+    auto userId = newUser("verify-rounds", "password");
+    CryptoManager::registerCrypto("password", userId, KdfParameters());
+    auto ids = addEntries(userId, 5);
+
+    // Cursor past every entry, as if entries were written with previous password after first pass read them
+    auto next = sealedUser(userId, "verify-rounds", "new-password");
+    CHECK(users.startKeyRotation(next, Crypto("new-password").encrypt("password"), storedPassword(userId)));
+    users.setKeyRotationCursor(userId, ids.back());
+    CHECK_THROWS(std::runtime_error, openWith(userId, "new-password"));
+
+    // Login registers crypto of current password, resumed job learns previous one from stored state
+    CryptoManager::registerCrypto("new-password", userId, KdfParameters());
+    rotation.resume(userId);
+    auto progress = waitForRotation(userId);
+    CHECK(progress.state == pass::KeyRotation::State::Finished);
+    CHECK(!users.getKeyRotation(userId));
+    CHECK(openWith(userId, "new-password") == ids.size());
+}
+
+int main() {
+    auto code = test::run("key-rotation-test", []() {
+        test::initializeDatabase("key-rotation-test");
+        auth::AuthenticationManager::setPrivateKey("key-rotation-test-secret");
+        auth::SQLiteUserRepository::getInstance();
+        pass::SQLitePasswordRepository::getInstance();
+    });
+    pass::KeyRotation::getInstance().stop();
+    return code;
+}
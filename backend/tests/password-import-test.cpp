@@ -0,0 +1,147 @@
+// Import of CSV and JSON exports: header mapping, quoting rules of CSV, Bitwarden items and skipped entries.
+
+#include <test-harness.hpp>
+#include <password-import.hpp>
+#include <passwords.hpp>
+#include <crypto.hpp>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+    /// @brief Registers crypto of fresh user, every case imports into its own vault
+    std::uint32_t newUser() {
+        static std::uint32_t next = 1;
+        auto userId = next++;
+        CryptoManager::registerCrypto("import-test-password", userId, KdfParameters());
+        return userId;
+    }
+
+    /// @brief Imports text into vault of user
+    pass::PasswordImporter::Result importText(std::uint32_t userId, const std::string& text, pass::PasswordImporter::Format format) {
+        std::istringstream input(text);
+        pass::PasswordImporter importer(userId);
+        return importer.import(input, format);
+    }
+
+    /// @brief Reads decrypted vault of user in order of import
+    std::vector<pass::Password> vault(std::uint32_t userId) {
+        std::vector<pass::Password> passwords;
+        pass::PasswordManager manager;
+        manager.forEachPasswordOfUser(userId, [&](const pass::Password& password) {
+            passwords.push_back(pass::PasswordCrypto::decrypt(password, userId));
+        });
+        return passwords;
+    }
+}
+
+TEST_CASE(formatNames) {
+    using Format = pass::PasswordImporter::Format;
+    CHECK(pass::PasswordImporter::formatFromString("") == Format::Json);
+    CHECK(pass::PasswordImporter::formatFromString("Bitwarden") == Format::Json);
+    CHECK(pass::PasswordImporter::formatFromString("CSV") == Format::Csv);
+    CHECK(pass::PasswordImporter::formatFromString("archive") == Format::Archive);
+    CHECK_THROWS(std::invalid_argument, pass::PasswordImporter::formatFromString("xml"));
+}
+
+TEST_CASE(csvQuotedFields) {
+    auto userId = newUser();
+    std::string csv =
+        "\xEF\xBB\xBFname,url,username,password,note\r\n"
+        "\"Bank, main\",https://bank.example,alice,\"pa\"\"ss\",\"line one\nline two\"\r\n"
+        "\r\n"
+        ",https://mail.example,bob,secret,\n";
+    auto result = importText(userId, csv, pass::PasswordImporter::Format::Csv);
+    CHECK(result.imported == 2);
+    CHECK(result.skipped == 0);
+
+    auto passwords = vault(userId);
+    CHECK(passwords.size() == 2);
+    CHECK(passwords[0].name == "Bank, main");
+    CHECK(passwords[0].url == "https://bank.example");
+    CHECK(passwords[0].login == "alice");
+    CHECK(passwords[0].password == "pa\"ss");
+    CHECK(passwords[0].notes == "line one\nline two");
+
+    // Entry without name is named by its URL
+    CHECK(passwords[1].name == "https://mail.example");
+    CHECK(passwords[1].password == "secret");
+}
+
+TEST_CASE(csvHeaderAliases) {
+    auto userId = newUser();
+    std::string csv =
+        "Title,Login_URI,Login_Username,Login_Password,Extra\n"
+        "Shop,https://shop.example,carol,hunter2,\n"
+        "Empty,https://empty.example,,,\n";
+    auto result = importText(userId, csv, pass::PasswordImporter::Format::Csv);
+    CHECK(result.imported == 1);
+    CHECK(result.skipped == 1);
+
+    auto passwords = vault(userId);
+    CHECK(passwords.size() == 1);
+    CHECK(passwords[0].name == "Shop");
+    CHECK(passwords[0].login == "carol");
+    CHECK(passwords[0].password == "hunter2");
+}
+
+TEST_CASE(csvWithoutPasswordColumn) {
+    auto userId = newUser();
+    CHECK_THROWS(std::runtime_error, importText(userId, "name,url\nShop,https://shop.example\n", pass::PasswordImporter::Format::Csv));
+    CHECK(vault(userId).empty());
+}
+
+TEST_CASE(jsonArray) {
+    auto userId = newUser();
+    std::string json = R"([
+        {"login": "dave", "password": "p1", "name": "Forum", "url": "https://forum.example", "notes": null},
+        42,
+        {"login": "erin", "password": "p2", "name": "Wiki"}
+    ])";
+    auto result = importText(userId, json, pass::PasswordImporter::Format::Json);
+    CHECK(result.imported == 2);
+    CHECK(result.skipped == 1);
+
+    auto passwords = vault(userId);
+    CHECK(passwords.size() == 2);
+    CHECK(passwords[0].login == "dave");
+    CHECK(passwords[0].notes.empty());
+    CHECK(passwords[1].name == "Wiki");
+    CHECK(passwords[1].url.empty());
+}
+
+TEST_CASE(jsonBitwardenExport) {
+    auto userId = newUser();
+    std::string json = R"({
+        "encrypted": false,
+        "folders": [],
+        "items": [
+            {"type": 1, "name": "Git", "notes": "2FA on", "login": {"username": "frank", "password": "p3", "uris": [{"uri": "https://git.example"}]}},
+            {"type": 3, "name": "Card", "card": {"number": "4111"}},
+            {"type": 1, "name": "No uris", "login": {"username": "grace", "password": "p4", "uris": null}}
+        ]
+    })";
+    auto result = importText(userId, json, pass::PasswordImporter::Format::Json);
+    CHECK(result.imported == 2);
+    CHECK(result.skipped == 1);
+
+    auto passwords = vault(userId);
+    CHECK(passwords.size() == 2);
+    CHECK(passwords[0].name == "Git");
+    CHECK(passwords[0].login == "frank");
+    CHECK(passwords[0].url == "https://git.example");
+    CHECK(passwords[0].notes == "2FA on");
+    CHECK(passwords[1].login == "grace");
+    CHECK(passwords[1].url.empty());
+}
+
+TEST_CASE(jsonMalformed) {
+    auto userId = newUser();
+    CHECK_THROWS(std::runtime_error, importText(userId, R"([{"login": "x", "password": )", pass::PasswordImporter::Format::Json));
+}
+
+int main() {
+    return test::run("password-import-test", []() {
+        test::initializeDatabase("password-import-test");
+    });
+}
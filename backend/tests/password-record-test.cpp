@@ -0,0 +1,127 @@
+// Record-level encryption: layout of sealed record, both storage formats and length prefixes of malformed records.
+
+#include <test-harness.hpp>
+#include <passwords.hpp>
+#include <crypto.hpp>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+
+namespace {
+    constexpr std::uint32_t USER_ID = 1;
+
+    pass::Password samplePassword() {
+        pass::Password password;
+        password.id = 1;
+        password.userId = USER_ID;
+        password.login = "alice";
+        password.password = std::string("p\0ss", 4);
+        password.name = "Bank";
+        password.url = "";
+        password.notes = "multi\nline";
+        return password;
+    }
+
+    /// @brief Serializes record with given version and length prefixes
+    std::string record(std::uint8_t version, std::initializer_list<std::pair<std::uint32_t, std::string_view>> fields) {
+        std::string result(1, static_cast<char>(version));
+        for (const auto& [length, content] : fields) {
+            for (int shift = 0; shift < 32; shift += 8) {
+                result += static_cast<char>((length >> shift) & 0xFF);
+            }
+            result += content;
+        }
+        return result;
+    }
+
+    /// @brief Decrypts entry whose sealed record has given plaintext
+    pass::Password openRecord(const std::string& plaintext) {
+        auto password = samplePassword();
+        password.record = CryptoManager::get(USER_ID)->encrypt(plaintext);
+        return pass::PasswordCrypto::decrypt(password, USER_ID);
+    }
+
+    void checkFields(const pass::Password& actual, const pass::Password& expected) {
+        CHECK(actual.login == expected.login);
+        CHECK(actual.password == expected.password);
+        CHECK(actual.name == expected.name);
+        CHECK(actual.url == expected.url);
+        CHECK(actual.notes == expected.notes);
+    }
+}
+
+TEST_CASE(recordRoundTrip) {
+    pass::PasswordCrypto::setRecordEncryption(true);
+    auto plain = samplePassword();
+    auto sealed = pass::PasswordCrypto::encrypt(plain, USER_ID);
+    CHECK(!sealed.record.empty());
+    CHECK(sealed.login.empty() && sealed.password.empty() && sealed.name.empty() && sealed.url.empty() && sealed.notes.empty());
+
+    auto opened = pass::PasswordCrypto::decrypt(sealed, USER_ID);
+    checkFields(opened, plain);
+    CHECK(opened.record.empty());
+}
+
+TEST_CASE(recordLayout) {
+    pass::PasswordCrypto::setRecordEncryption(true);
+    auto plain = samplePassword();
+    auto sealed = pass::PasswordCrypto::encrypt(plain, USER_ID);
+
+    // Version byte followed by login, password, name, url and notes, each with 32-bit little endian length
+    auto content = CryptoManager::get(USER_ID)->decrypt(sealed.record);
+    auto expected = record(pass::PasswordCrypto::RECORD_VERSION, {
+        { 5, plain.login }, { 4, plain.password }, { 4, plain.name }, { 0, plain.url }, { 10, plain.notes }
+    });
+    CHECK(content == expected);
+}
+
+TEST_CASE(fieldFormatStaysReadable) {
+    pass::PasswordCrypto::setRecordEncryption(false);
+    auto plain = samplePassword();
+    auto sealed = pass::PasswordCrypto::encrypt(plain, USER_ID);
+    CHECK(sealed.record.empty());
+    CHECK(!sealed.password.empty());
+
+    pass::PasswordCrypto::setRecordEncryption(true);
+    checkFields(pass::PasswordCrypto::decrypt(sealed, USER_ID), plain);
+}
+
+TEST_CASE(handBuiltRecord) {
+    auto opened = openRecord(record(pass::PasswordCrypto::RECORD_VERSION, {
+        { 1, "l" }, { 2, "pw" }, { 0, "" }, { 3, "url" }, { 0, "" }
+    }));
+    CHECK(opened.login == "l");
+    CHECK(opened.password == "pw");
+    CHECK(opened.name.empty());
+    CHECK(opened.url == "url");
+    CHECK(opened.notes.empty());
+}
+
+TEST_CASE(rejectsMalformedRecord) {
+    // Unknown version and empty record
+    CHECK_THROWS(std::runtime_error, openRecord(record(pass::PasswordCrypto::RECORD_VERSION + 1, {
+        { 0, "" }, { 0, "" }, { 0, "" }, { 0, "" }, { 0, "" }
+    })));
+    CHECK_THROWS(std::runtime_error, openRecord(""));
+
+    // Length of field past end of record
+    CHECK_THROWS(std::runtime_error, openRecord(record(pass::PasswordCrypto::RECORD_VERSION, {
+        { 1, "l" }, { 100, "pw" }, { 0, "" }, { 0, "" }, { 0, "" }
+    })));
+    CHECK_THROWS(std::runtime_error, openRecord(record(pass::PasswordCrypto::RECORD_VERSION, {
+        { 0, "" }, { 0, "" }, { 0, "" }, { 0, "" }, { 0xFFFFFFFFu, "" }
+    })));
+
+    // Missing fields and length prefix cut short
+    CHECK_THROWS(std::runtime_error, openRecord(record(pass::PasswordCrypto::RECORD_VERSION, {
+        { 1, "l" }, { 2, "pw" }, { 0, "" }, { 0, "" }
+    })));
+    auto cut = record(pass::PasswordCrypto::RECORD_VERSION, { { 0, "" }, { 0, "" }, { 0, "" }, { 0, "" }, { 0, "" } });
+    CHECK_THROWS(std::runtime_error, openRecord(cut.substr(0, cut.size() - 1)));
+}
+
+int main() {
+    return test::run("password-record-test", []() {
+        CryptoManager::registerCrypto("record-test-password", USER_ID, KdfParameters());
+    });
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+// Minimal test harness without external dependencies. Every *-test.cpp is separate executable, its cases
+// are registered by TEST_CASE and run by test::run() from main(). Failed CHECK stops only its own case.
+
+#include <log.hpp>
+#include <database-manager.hpp>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <source_location>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace test {
+    /// @brief Failed expectation, stops current test case
+    class Failure : public std::runtime_error {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    /// @brief Registered test case
+    class Case {
+    public:
+        const char* name;               // Name of case
+        std::function<void()> body;     // Body of case
+    };
+
+    /// @brief Gets cases registered by executable
+    /// @return cases in order of registration
+    inline std::vector<Case>& cases() {
+        static std::vector<Case> registered;
+        return registered;
+    }
+
+    /// @brief Registers test case during static initialization
+    class Registrar {
+    public:
+        /// @brief Constructor
+        /// @param name name of case
+        /// @param body body of case
+        Registrar(const char* name, std::function<void()> body) {
+            cases().push_back({ name, std::move(body) });
+        }
+    };
+
+    /// @brief Checks condition
+    /// @param condition checked condition
+    /// @param expression text of condition
+    /// @param location place of check
+    /// @throw Failure when condition is false
+    inline void check(bool condition, const char* expression, std::source_location location = std::source_location::current()) {
+        if (!condition) {
+            throw Failure(std::format("{}:{}: CHECK({}) failed", location.file_name(), location.line(), expression));
+        }
+    }
+
+    /// @brief Checks that function throws exception of given type
+    /// @param function checked function
+    /// @param expression text of checked expression
+    /// @param location place of check
+    /// @throw Failure when nothing or exception of another type is thrown
+    template<typename Exception, typename Function>
+    void checkThrows(Function&& function, const char* expression, std::source_location location = std::source_location::current()) {
+        try {
+            function();
+        }
+        catch (const Exception&) {
+            return;
+        }
+        catch (const std::exception& e) {
+            throw Failure(std::format("{}:{}: {} threw unexpected exception: {}", location.file_name(), location.line(), expression, e.what()));
+        }
+        throw Failure(std::format("{}:{}: {} did not throw", location.file_name(), location.line(), expression));
+    }
+
+    /// @brief Creates empty directory for files of test, removed by caller or left for inspection
+    /// @param name name of test executable
+    /// @return path of directory
+    inline std::filesystem::path temporaryDirectory(const std::string& name) {
+        std::random_device random;
+        auto directory = std::filesystem::temp_directory_path() / std::format("{}-{:08x}", name, random());
+        std::filesystem::create_directories(directory);
+        return directory;
+    }
+
+    /// @brief Opens fresh main database in temporary directory, singletons can be initialized only once per process
+    /// @param name name of test executable
+    /// @return directory holding database
+    inline std::filesystem::path initializeDatabase(const std::string& name) {
+        auto directory = temporaryDirectory(name);
+        DatabaseManager::getInstance().initialize(directory / "test.db");
+        return directory;
+    }
+
+    /// @brief Runs all registered cases
+    /// @param name name of test executable, used for log file
+    /// @param setup initialization shared by all cases, run after logger is initialized
+    /// @return exit code, 0 when all cases passed
+    inline int run(const std::string& name, const std::function<void()>& setup = {}) {
+        Logger::init((temporaryDirectory(name) / (name + ".log")).string(), name);
+        if (setup) {
+            try {
+                setup();
+            }
+            catch (const std::exception& e) {
+                std::cout << "[FAIL] setup: " << e.what() << "\n";
+                return 1;
+            }
+        }
+
+        std::size_t failed = 0;
+        for (const auto& testCase : cases()) {
+            try {
+                testCase.body();
+                std::cout << "[ OK ] " << testCase.name << "\n";
+            }
+            catch (const std::exception& e) {
+                ++failed;
+                std::cout << "[FAIL] " << testCase.name << ": " << e.what() << "\n";
+            }
+        }
+        std::cout << cases().size() - failed << "/" << cases().size() << " passed\n";
+        return failed == 0 ? 0 : 1;
+    }
+}
+
+/// @brief Defines and registers test case
+#define TEST_CASE(name) \
+    static void name(); \
+    static test::Registrar name##Registrar(#name, &name); \
+    static void name()
+
+/// @brief Checks condition, failure stops current case
+#define CHECK(expression) test::check(static_cast<bool>(expression), #expression)
+
+/// @brief Checks that expression throws exception of given type
+#define CHECK_THROWS(type, expression) test::checkThrows<type>([&]() { (void)(expression); }, #expression)
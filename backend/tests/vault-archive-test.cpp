@@ -0,0 +1,134 @@
+// Vault archive: round trip over chunk boundaries and rejection of truncated, reordered or tampered archives.
+
+#include <test-harness.hpp>
+#include <vault-archive.hpp>
+#include <crypto.hpp>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+namespace {
+    constexpr std::uint32_t CHUNK_SIZE = 16;                                        // Small chunks, so tests span many of them
+    constexpr std::size_t FULL_CHUNK = 4 + CHUNK_SIZE + Crypto::TAG_SIZE;           // Size of sealed full chunk
+    const std::string PASSWORD = "archive-test-password";
+
+    /// @brief Seals data into archive
+    std::string seal(const std::string& data) {
+        Crypto crypto(PASSWORD);
+        std::ostringstream out;
+        pass::VaultArchiveWriter writer(out, crypto, CHUNK_SIZE);
+        writer.write(data);
+        writer.finish();
+        return out.str();
+    }
+
+    /// @brief Reads whole archive, exceptions of reader are not swallowed by istream
+    std::string unseal(const std::string& archive, const std::string& password = PASSWORD) {
+        Crypto crypto(password);
+        std::istringstream in(archive);
+        pass::VaultArchiveReader reader(in, crypto);
+        return std::string(std::istreambuf_iterator<char>(&reader), std::istreambuf_iterator<char>());
+    }
+}
+
+TEST_CASE(roundTripAcrossChunks) {
+    std::string data(40, '\0');
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<char>(i);
+    }
+    auto archive = seal(data);
+    CHECK(archive.size() == pass::archive::HEADER_SIZE + 2 * FULL_CHUNK + 4 + 8 + Crypto::TAG_SIZE);
+    CHECK(archive.compare(0, pass::archive::MAGIC.size(), pass::archive::MAGIC) == 0);
+    CHECK(unseal(archive) == data);
+}
+
+TEST_CASE(roundTripOfWholeChunks) {
+    // Data filling chunks exactly ends with empty last chunk
+    std::string data(2 * CHUNK_SIZE, 'x');
+    auto archive = seal(data);
+    CHECK(archive.size() == pass::archive::HEADER_SIZE + 2 * FULL_CHUNK + 4 + Crypto::TAG_SIZE);
+    CHECK(unseal(archive) == data);
+}
+
+TEST_CASE(roundTripEmpty) {
+    auto archive = seal("");
+    CHECK(archive.size() == pass::archive::HEADER_SIZE + 4 + Crypto::TAG_SIZE);
+    CHECK(unseal(archive).empty());
+}
+
+TEST_CASE(lastChunkFlag) {
+    auto archive = seal(std::string(20, 'y'));
+    auto lastLength = pass::archive::HEADER_SIZE + FULL_CHUNK;
+    CHECK((static_cast<unsigned char>(archive[lastLength + 3]) & 0x80) != 0);
+    CHECK((static_cast<unsigned char>(archive[pass::archive::HEADER_SIZE + 3]) & 0x80) == 0);
+
+    // Last chunk presented as middle one fails authentication, flag is part of nonce
+    auto cleared = archive;
+    cleared[lastLength + 3] = static_cast<char>(cleared[lastLength + 3] & 0x7F);
+    CHECK_THROWS(std::runtime_error, unseal(cleared));
+
+    // Middle chunk presented as last one fails too
+    auto set = archive;
+    set[pass::archive::HEADER_SIZE + 3] = static_cast<char>(set[pass::archive::HEADER_SIZE + 3] | 0x80);
+    CHECK_THROWS(std::runtime_error, unseal(set));
+}
+
+TEST_CASE(truncatedArchive) {
+    auto archive = seal(std::string(40, 'z'));
+
+    // Archive cut at chunk boundary has no last chunk
+    CHECK_THROWS(std::runtime_error, unseal(archive.substr(0, pass::archive::HEADER_SIZE + FULL_CHUNK)));
+    // Archive cut inside chunk
+    CHECK_THROWS(std::runtime_error, unseal(archive.substr(0, archive.size() - 1)));
+    // Archive cut inside header
+    CHECK_THROWS(std::runtime_error, unseal(archive.substr(0, pass::archive::HEADER_SIZE - 1)));
+}
+
+TEST_CASE(reorderedChunks) {
+    auto archive = seal(std::string(CHUNK_SIZE, 'a') + std::string(CHUNK_SIZE, 'b') + "c");
+    auto swapped = archive.substr(0, pass::archive::HEADER_SIZE)
+        + archive.substr(pass::archive::HEADER_SIZE + FULL_CHUNK, FULL_CHUNK)
+        + archive.substr(pass::archive::HEADER_SIZE, FULL_CHUNK)
+        + archive.substr(pass::archive::HEADER_SIZE + 2 * FULL_CHUNK);
+    CHECK(swapped.size() == archive.size());
+    CHECK_THROWS(std::runtime_error, unseal(swapped));
+}
+
+TEST_CASE(tamperedArchive) {
+    auto archive = seal(std::string(40, 'q'));
+
+    // Ciphertext of chunk
+    auto ciphertext = archive;
+    ciphertext[pass::archive::HEADER_SIZE + 4] ^= 0x01;
+    CHECK_THROWS(std::runtime_error, unseal(ciphertext));
+
+    // Tag of last chunk
+    auto tag = archive;
+    tag.back() ^= 0x01;
+    CHECK_THROWS(std::runtime_error, unseal(tag));
+
+    // Nonce prefix in header is associated data of every chunk
+    auto header = archive;
+    header[pass::archive::MAGIC.size() + 1 + Crypto::SALT_SIZE] ^= 0x01;
+    CHECK_THROWS(std::runtime_error, unseal(header));
+
+    // Magic and version
+    auto magic = archive;
+    magic[0] = 'X';
+    CHECK_THROWS(std::runtime_error, unseal(magic));
+    auto version = archive;
+    version[pass::archive::MAGIC.size()] = 2;
+    CHECK_THROWS(std::runtime_error, unseal(version));
+
+    // Data after last chunk
+    CHECK_THROWS(std::runtime_error, unseal(archive + "x"));
+}
+
+TEST_CASE(wrongPassword) {
+    auto archive = seal("secret vault");
+    CHECK_THROWS(std::runtime_error, unseal(archive, "another-password"));
+}
+
+int main() {
+    return test::run("vault-archive-test");
+}
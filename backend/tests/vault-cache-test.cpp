@@ -0,0 +1,191 @@
+// Vault cache: versioned write-through of entries, stale snapshots, gaps in versions and memory budget.
+
+#include <test-harness.hpp>
+#include <vault-cache.hpp>
+#include <initializer_list>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace {
+    constexpr std::size_t BUDGET = 1024 * 1024;
+
+    pass::VaultCache::Settings withBudget(std::size_t budgetBytes) {
+        pass::VaultCache::Settings settings;
+        settings.budgetBytes = budgetBytes;
+        return settings;
+    }
+
+    /// @brief Decrypted entry with given id
+    pass::Password entry(std::uint32_t userId, std::uint32_t id) {
+        pass::Password password{};
+        password.id = id;
+        password.userId = userId;
+        password.name = "entry-" + std::to_string(id);
+        password.password = "secret-" + std::to_string(id);
+        return password;
+    }
+
+    /// @brief Stores snapshot of vault holding entries with given ids
+    void store(std::uint32_t userId, std::int64_t version, std::initializer_list<std::uint32_t> ids) {
+        auto options = pass::Password::Options{}.toJson().dump();
+        pass::PasswordBatch batch;
+        for (auto id : ids) {
+            auto password = entry(userId, id);
+            auto& row = batch.add();
+            row.id = id;
+            row.userId = userId;
+            row.name = batch.store(password.name);
+            row.password = batch.store(password.password);
+            row.options = batch.store(options);
+            row.version = version;
+        }
+        pass::VaultCache::getInstance().store(userId, version, batch);
+    }
+
+    /// @brief Lists ids of cached entries
+    /// @return ids in order of listing, nullopt when vault is not cached
+    std::optional<std::vector<std::uint32_t>> cachedIds(std::uint32_t userId) {
+        util::SecureArena::Scope secrets;
+        auto list = pass::VaultCache::getInstance().list(userId);
+        if (!list) {
+            return std::nullopt;
+        }
+        std::vector<std::uint32_t> ids;
+        for (const auto& password : nlohmann::json::parse(list->begin(), list->end())) {
+            ids.push_back(password.at("id").get<std::uint32_t>());
+        }
+        return ids;
+    }
+
+    using Ids = std::vector<std::uint32_t>;
+}
+
+TEST_CASE(disabledCacheStoresNothing) {
+    auto& cache = pass::VaultCache::getInstance();
+    cache.configure(withBudget(0));
+    CHECK(!cache.enabled());
+    store(1, 1, { 1 });
+    CHECK(!cache.contains(1));
+    CHECK(!cachedIds(1));
+}
+
+TEST_CASE(storeAndList) {
+    auto& cache = pass::VaultCache::getInstance();
+    cache.configure(withBudget(BUDGET));
+    store(2, 5, { 3, 1, 2 });
+    CHECK(cachedIds(2) == Ids({ 1, 2, 3 }));
+    CHECK(cache.used() > 0);
+
+    // Listed entries keep content of snapshot
+    util::SecureArena::Scope secrets;
+    auto list = cache.list(2);
+    auto json = nlohmann::json::parse(list->begin(), list->end());
+    CHECK(json[0].at("name") == "entry-1");
+    CHECK(json[0].at("password") == "secret-1");
+}
+
+TEST_CASE(writesAdvanceVersion) {
+    auto& cache = pass::VaultCache::getInstance();
+    cache.configure(withBudget(BUDGET));
+    store(3, 5, { 1, 2 });
+
+    cache.put(3, 6, entry(3, 4));
+    CHECK(cachedIds(3) == Ids({ 1, 2, 4 }));
+
+    // Write already reflected in cache is ignored
+    auto replayed = entry(3, 5);
+    cache.put(3, 6, replayed);
+    CHECK(cachedIds(3) == Ids({ 1, 2, 4 }));
+
+    cache.erase(3, 7, 2);
+    CHECK(cachedIds(3) == Ids({ 1, 4 }));
+
+    // Updated entry replaces old one
+    auto updated = entry(3, 1);
+    updated.name = "renamed";
+    cache.put(3, 8, updated);
+    util::SecureArena::Scope secrets;
+    auto list = cache.list(3);
+    CHECK(nlohmann::json::parse(list->begin(), list->end())[0].at("name") == "renamed");
+}
+
+TEST_CASE(missedVersionDropsVault) {
+    auto& cache = pass::VaultCache::getInstance();
+    cache.configure(withBudget(BUDGET));
+    store(4, 5, { 1 });
+    cache.put(4, 7, entry(4, 2));
+    CHECK(!cache.contains(4));
+
+    store(5, 5, { 1 });
+    cache.erase(5, 7, 1);
+    CHECK(!cache.contains(5));
+}
+
+TEST_CASE(commitDropsOlderVault) {
+    auto& cache = pass::VaultCache::getInstance();
+    cache.configure(withBudget(BUDGET));
+    store(6, 5, { 1 });
+    cache.commit(6, 5);
+    CHECK(cache.contains(6));
+    cache.commit(6, 6);
+    CHECK(!cache.contains(6));
+    CHECK(cache.used() == 0);
+}
+
+TEST_CASE(staleSnapshotIsRejected) {
+    auto& cache = pass::VaultCache::getInstance();
+    cache.configure(withBudget(BUDGET));
+
+    // Write committed while vault was not cached, snapshot read before it would miss it
+    cache.commit(7, 10);
+    store(7, 9, { 1 });
+    CHECK(!cache.contains(7));
+    store(7, 10, { 1, 2 });
+    CHECK(cachedIds(7) == Ids({ 1, 2 }));
+
+    // Snapshot older than cached vault is ignored too
+    store(7, 8, { 3 });
+    CHECK(cachedIds(7) == Ids({ 1, 2 }));
+    store(7, 11, { 3 });
+    CHECK(cachedIds(7) == Ids({ 3 }));
+}
+
+TEST_CASE(budgetEvictsLeastRecentlyRead) {
+    auto& cache = pass::VaultCache::getInstance();
+    cache.configure(withBudget(BUDGET));
+    store(8, 1, { 1, 2, 3 });
+    auto vaultBytes = cache.used();
+
+    cache.configure(withBudget(vaultBytes * 2));
+    store(8, 1, { 1, 2, 3 });
+    store(9, 1, { 1, 2, 3 });
+    CHECK(cache.used() == vaultBytes * 2);
+
+    // Vault 8 is read last, so vault 9 makes room for vault 10
+    CHECK(cachedIds(9));
+    CHECK(cachedIds(8));
+    store(10, 1, { 1, 2, 3 });
+    CHECK(cache.contains(8));
+    CHECK(!cache.contains(9));
+    CHECK(cache.contains(10));
+    CHECK(cache.used() == vaultBytes * 2);
+
+    // Vault larger than whole budget is not cached
+    store(11, 1, { 1, 2, 3, 4, 5, 6, 7, 8, 9 });
+    CHECK(!cache.contains(11));
+}
+
+TEST_CASE(evictReleasesBudget) {
+    auto& cache = pass::VaultCache::getInstance();
+    cache.configure(withBudget(BUDGET));
+    store(12, 1, { 1, 2 });
+    CHECK(cache.used() > 0);
+    cache.evict(12);
+    CHECK(!cache.contains(12));
+    CHECK(cache.used() == 0);
+}
+
+int main() {
+    return test::run("vault-cache-test");
+}
@@ -0,0 +1,137 @@
+// Write queue: concurrent writes share commits, empty writes are rolled back to their savepoint and
+// the repository writes by itself while queue is not running.
+
+#include <test-harness.hpp>
+#include <write-queue.hpp>
+#include <passwords.hpp>
+#include <chrono>
+#include <functional>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    constexpr std::size_t WRITERS = 16;
+
+    pass::Password entry(std::uint32_t userId, const std::string& name) {
+        pass::Password password{};
+        password.userId = userId;
+        password.name = name;
+        password.password = "secret";
+        return password;
+    }
+
+    /// @brief Runs functions on separate threads at once, so queue can batch their writes
+    void concurrently(const std::vector<std::function<void()>>& functions) {
+        std::vector<std::jthread> threads;
+        for (const auto& function : functions) {
+            threads.emplace_back(function);
+        }
+    }
+
+    /// @brief Versions from 1 to count
+    std::set<std::int64_t> versionsUpTo(std::int64_t count) {
+        std::set<std::int64_t> versions;
+        for (std::int64_t version = 1; version <= count; ++version) {
+            versions.insert(version);
+        }
+        return versions;
+    }
+}
+
+TEST_CASE(repositoryWritesWhileQueueIsStopped) {
+    auto& queue = pass::WriteQueue::getInstance();
+    CHECK(!queue.running());
+    auto password = entry(1, "direct");
+    CHECK(!queue.add(password));
+    CHECK(!queue.update(password));
+    CHECK(!queue.remove(1, 1));
+
+    auto& repository = pass::SQLitePasswordRepository::getInstance();
+    repository.add(password);
+    CHECK(password.version == 1);
+    CHECK(repository.getById(1, password.id));
+}
+
+TEST_CASE(concurrentAddsShareCommits) {
+    auto& queue = pass::WriteQueue::getInstance();
+    queue.start({ WRITERS, std::chrono::milliseconds(50) });
+    CHECK(queue.running());
+
+    std::vector<pass::Password> passwords;
+    for (std::size_t i = 0; i < WRITERS; ++i) {
+        passwords.push_back(entry(2, "queued-" + std::to_string(i)));
+    }
+    std::vector<std::function<void()>> writes;
+    for (auto& password : passwords) {
+        writes.push_back([&password]() { pass::SQLitePasswordRepository::getInstance().add(password); });
+    }
+    concurrently(writes);
+
+    // Every write gets its own id and version, in whatever order it was applied
+    std::set<std::uint32_t> ids;
+    std::set<std::int64_t> versions;
+    for (const auto& password : passwords) {
+        ids.insert(password.id);
+        versions.insert(password.version);
+        auto stored = pass::SQLitePasswordRepository::getInstance().getById(2, password.id);
+        CHECK(stored && stored->name == password.name);
+    }
+    CHECK(ids.size() == WRITERS);
+    CHECK(versions == versionsUpTo(WRITERS));
+}
+
+TEST_CASE(emptyWritesRollBackToSavepoint) {
+    auto& repository = pass::SQLitePasswordRepository::getInstance();
+    auto kept = entry(3, "kept");
+    auto removed = entry(3, "removed");
+    repository.add(kept);
+    repository.add(removed);
+
+    // Writes changing nothing share batch with real ones, but must not consume versions
+    auto missing = entry(3, "missing");
+    missing.id = 999999;
+    auto added = entry(3, "added");
+    std::int64_t missingUpdate = -1;
+    std::int64_t missingRemove = -1;
+    std::int64_t removal = -1;
+    concurrently({
+        [&]() { missingUpdate = repository.update(missing); },
+        [&]() { missingRemove = repository.remove(3, missing.id); },
+        [&]() { removal = repository.remove(3, removed.id); },
+        [&]() { repository.add(added); }
+    });
+    CHECK(missingUpdate == 0);
+    CHECK(missingRemove == 0);
+    CHECK(std::set<std::int64_t>({ removal, added.version }) == std::set<std::int64_t>({ 3, 4 }));
+
+    CHECK(repository.getById(3, kept.id));
+    CHECK(!repository.getById(3, removed.id));
+    CHECK(repository.getById(3, added.id));
+}
+
+TEST_CASE(sequentialUpdatesBumpVersion) {
+    auto& repository = pass::SQLitePasswordRepository::getInstance();
+    auto password = entry(4, "first");
+    repository.add(password);
+    for (int i = 0; i < 5; ++i) {
+        password.name = "rename-" + std::to_string(i);
+        CHECK(repository.update(password) == password.version + i + 1);
+    }
+    CHECK(repository.getById(4, password.id)->name == "rename-4");
+}
+
+TEST_CASE(stoppedQueueRejectsWrites) {
+    auto& queue = pass::WriteQueue::getInstance();
+    queue.stop();
+    CHECK(!queue.running());
+    CHECK(!queue.remove(2, 1));
+}
+
+int main() {
+    return test::run("write-queue-test", []() {
+        test::initializeDatabase("write-queue-test");
+        pass::SQLitePasswordRepository::getInstance();
+    });
+}
@@ -0,0 +1,65 @@
+// Converts text dump of SHA-1 hashes (e.g. HIBP "ordered by hash" download, lines "HASH:COUNT")
+// into binary breach corpus used by pass::BreachChecker.
+//
+// Usage: breach-corpus-builder <input.txt> <output.bin> [bitsPerKey]
+
+#include <breach-corpus.hpp>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <exception>
+
+int main(int argc, char* argv[]) {
+    if (argc < 3 || argc > 4) {
+        std::cerr << "Usage: " << argv[0] << " <input.txt> <output.bin> [bitsPerKey]\n";
+        return 1;
+    }
+
+    try {
+        std::size_t bitsPerKey = argc == 4 ? std::stoul(argv[3]) : pass::BreachCorpusWriter::DEFAULT_BITS_PER_KEY;
+
+        // First pass only counts lines, so Bloom filter is sized once and hashes are streamed
+        std::ifstream input(argv[1], std::ios::binary);
+        if (!input.is_open()) {
+            std::cerr << "Unable to open input file: " << argv[1] << "\n";
+            return 1;
+        }
+        std::uint64_t lines = 0;
+        std::string line;
+        while (std::getline(input, line)) {
+            ++lines;
+        }
+        input.clear();
+        input.seekg(0);
+
+        std::ofstream output(argv[2], std::ios::binary | std::ios::trunc);
+        if (!output.is_open()) {
+            std::cerr << "Unable to open output file: " << argv[2] << "\n";
+            return 1;
+        }
+
+        pass::BreachCorpusWriter writer(output, lines, bitsPerKey);
+        pass::BreachCorpus::Hash hash;
+        std::uint64_t skipped = 0;
+        while (std::getline(input, line)) {
+            if (pass::BreachCorpus::parseHex(line, hash)) {
+                writer.add(hash);
+            }
+            else {
+                ++skipped;
+            }
+        }
+        auto count = writer.finish();
+
+        std::cout << "Written " << count << " hashes, skipped " << skipped << " malformed lines\n";
+        return 0;
+    }
+    catch (const std::invalid_argument& e) {
+        std::cerr << "Input must be sorted by hash: " << e.what() << "\n";
+        return 1;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,158 @@
+// Compiles wordlists (one word per line, most common first) into tries embedded in backend binary,
+// so password strength estimation needs no parsing at startup. Anything after first whitespace on line
+// is ignored, so frequency lists in "word count" format can be used as they are.
+//
+// Usage: dictionary-compiler <output.cpp> <wordlist.txt>...
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <queue>
+#include <string>
+#include <vector>
+
+namespace {
+    /// @brief Node of trie built in memory
+    struct Node {
+        std::map<unsigned char, std::size_t> children;  // Label -> index of child
+        std::uint32_t rank = 0;                         // Rank of word ending here, 0 if none
+    };
+
+    /// @brief Builds trie of wordlist
+    /// @param path path to wordlist
+    /// @return nodes, root is first
+    std::vector<Node> buildTrie(const std::filesystem::path& path) {
+        std::ifstream input(path, std::ios::binary);
+        if (!input.is_open()) {
+            throw std::runtime_error("Unable to open wordlist: " + path.string());
+        }
+
+        std::vector<Node> nodes(1);
+        std::uint32_t rank = 0;
+        std::string line;
+        while (std::getline(input, line)) {
+            std::string word;
+            for (char c : line) {
+                if (std::isspace(static_cast<unsigned char>(c))) {
+                    if (!word.empty()) {
+                        break;
+                    }
+                    continue;
+                }
+                word += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            }
+            if (word.empty() || word.front() == '#') {
+                continue;
+            }
+            ++rank;
+
+            std::size_t node = 0;
+            for (unsigned char c : word) {
+                auto it = nodes[node].children.find(c);
+                if (it == nodes[node].children.end()) {
+                    nodes.emplace_back();
+                    it = nodes[node].children.emplace(c, nodes.size() - 1).first;
+                }
+                node = it->second;
+            }
+            if (nodes[node].rank == 0) {
+                nodes[node].rank = rank;    // Duplicates keep best rank
+            }
+        }
+        return nodes;
+    }
+
+    /// @brief Writes trie as constant arrays, nodes in BFS order with contiguous sorted edges
+    /// @param out output stream
+    /// @param nodes trie
+    /// @param index index of dictionary
+    void writeTrie(std::ostream& out, const std::vector<Node>& nodes, std::size_t index) {
+        std::vector<std::size_t> order;
+        std::vector<std::uint32_t> position(nodes.size());
+        std::queue<std::size_t> queue;
+        queue.push(0);
+        while (!queue.empty()) {
+            auto node = queue.front();
+            queue.pop();
+            position[node] = static_cast<std::uint32_t>(order.size());
+            order.push_back(node);
+            for (const auto& [label, child] : nodes[node].children) {
+                queue.push(child);
+            }
+        }
+
+        out << "    static constexpr TrieNode NODES_" << index << "[] = {\n";
+        std::uint32_t firstEdge = 0;
+        for (auto node : order) {
+            out << "        { " << firstEdge << ", " << nodes[node].rank << ", " << nodes[node].children.size() << " },\n";
+            firstEdge += static_cast<std::uint32_t>(nodes[node].children.size());
+        }
+        out << "    };\n";
+
+        out << "    static constexpr std::uint32_t EDGES_" << index << "[] = {\n";
+        if (firstEdge == 0) {
+            out << "        0,\n";
+        }
+        for (auto node : order) {
+            for (const auto& [label, child] : nodes[node].children) {
+                out << "        " << ((static_cast<std::uint32_t>(label) << 24) | position[child]) << "u,\n";
+            }
+        }
+        out << "    };\n\n";
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <output.cpp> <wordlist.txt>...\n";
+        return 1;
+    }
+
+    try {
+        std::vector<std::filesystem::path> wordlists(argv + 2, argv + argc);
+        std::sort(wordlists.begin(), wordlists.end());
+
+        std::ofstream out(argv[1], std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            std::cerr << "Unable to open output file: " << argv[1] << "\n";
+            return 1;
+        }
+
+        out << "// Generated by dictionary-compiler, do not edit\n\n";
+        out << "#include <password-strength.hpp>\n\n";
+        out << "namespace pass::dictionary {\n";
+        for (std::size_t i = 0; i < wordlists.size(); ++i) {
+            auto nodes = buildTrie(wordlists[i]);
+            if (nodes.size() >= (1u << 24)) {
+                throw std::runtime_error("Wordlist is too large: " + wordlists[i].string());
+            }
+            writeTrie(out, nodes, i);
+        }
+
+        out << "    static constexpr Dictionary LIST[] = {\n";
+        for (std::size_t i = 0; i < wordlists.size(); ++i) {
+            out << "        { \"" << wordlists[i].stem().string() << "\", NODES_" << i << ", EDGES_" << i << " },\n";
+        }
+        if (wordlists.empty()) {
+            out << "        { \"\", {}, {} },\n";
+        }
+        out << "    };\n\n";
+        out << "    const std::span<const Dictionary> DICTIONARIES(LIST, " << wordlists.size() << ");\n";
+        out << "}\n";
+
+        if (!out) {
+            std::cerr << "Failed to write output file: " << argv[1] << "\n";
+            return 1;
+        }
+        return 0;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+}
@@ -15,6 +15,11 @@ export interface Options {
 	digitsMinimalNumber: number
 	specialCharactersMinimalNumber: number
 	forbiddenCharacters: string
+	mode: 'characters' | 'passphrase'
+	wordCount: number
+	wordSeparator: string
+	capitalizeWords: boolean
+	includeNumber: boolean
 }
 
 export interface Password {
@@ -28,15 +33,29 @@ export interface Password {
 	createdAt: string;
 	updatedAt: string;
 	options: Options;
+	version?: number;
+	strength?: number;
 }
 
-interface GeneratePasswordResponse {
+interface PasswordChangesResponse {
+	version: number;
+	changed: Password[];
+	removed: number[];
+}
+
+export interface GeneratePasswordResponse {
 	password: string;
+	entropy: number;
 }
 
 class PasswordsService {
 	private readonly baseUrl: string;
 
+	// Lokalna kopia sejfu synchronizowana przyrostowo
+	private cache = new Map<number, Password>();
+	private cacheVersion = 0;
+	private cacheToken: string | null = null;
+
 	constructor() {
 		this.baseUrl = 'http://localhost:1234/api/passwords';
 	}
@@ -76,21 +95,26 @@ class PasswordsService {
 			lowercaseMinimalNumber: 4,
 			digitsMinimalNumber: 2,
 			specialCharactersMinimalNumber: 2,
-			forbiddenCharacters: ""
+			forbiddenCharacters: "",
+			mode: 'characters',
+			wordCount: 6,
+			wordSeparator: "-",
+			capitalizeWords: false,
+			includeNumber: false
         };
     }
 
 	// Dodawanie nowego hasła
-	async generatePassword(options: Options): Promise<string> {
+	async generatePassword(options: Options): Promise<GeneratePasswordResponse> {
 		try {
 			const response = await axios.post<GeneratePasswordResponse>(`${this.baseUrl}/generate`, 
 				options, 
 				this.getAuthHeaders()
 			);
-			return response.data.password;
+			return response.data;
 		} catch (error) {
 			this.handleError(error);
-			return '';
+			return { password: '', entropy: 0 };
 		}
 	}
 
@@ -105,6 +129,67 @@ class PasswordsService {
 		}
 	}
 
+	// Synchronizacja lokalnej kopii haseł - pobierane są tylko zmiany od ostatniej wersji
+	async syncPasswords(): Promise<Password[]> {
+		const authStore = useAuthStore();
+		if (this.cacheToken !== authStore.token) {
+			this.resetCache();
+			this.cacheToken = authStore.token;
+		}
+
+		try {
+			const response = await axios.get<PasswordChangesResponse>(`${this.baseUrl}/changes`, {
+				...this.getAuthHeaders(),
+				params: { since: this.cacheVersion }
+			});
+			const { version, changed, removed } = response.data;
+			for (const id of removed) {
+				this.cache.delete(id);
+			}
+			for (const password of changed) {
+				this.cache.set(password.id, password);
+			}
+			this.cacheVersion = version;
+			return Array.from(this.cache.values()).sort((a, b) => a.id - b.id);
+		} catch (error) {
+			this.handleError(error);
+			return [];
+		}
+	}
+
+	// Wyszukiwanie po nazwie, adresie i loginie po stronie serwera - odszyfrowywane są tylko pasujące hasła
+	async searchPasswords(query: string): Promise<Password[]> {
+		try {
+			const response = await axios.get<Password[]>(`${this.baseUrl}/search`, {
+				...this.getAuthHeaders(),
+				params: { q: query }
+			});
+			return response.data;
+		} catch (error) {
+			this.handleError(error);
+			return [];
+		}
+	}
+
+	// Subskrypcja zmian sejfu (Server-Sent Events), EventSource nie obsługuje nagłówków więc w zapytaniu idzie
+	// jednorazowy bilet zamiast tokenu sesji; bilet nie nadaje się do ponownego połączenia, więc przy błędzie pobierany jest nowy
+	async subscribeToChanges(onChange: () => void): Promise<EventSource | null> {
+		try {
+			const response = await axios.post<{ ticket: string }>(`${this.baseUrl}/events/ticket`, {}, this.getAuthHeaders());
+			const source = new EventSource(`${this.baseUrl}/events?ticket=${encodeURIComponent(response.data.ticket)}`);
+			source.addEventListener('changed', () => onChange());
+			return source;
+		} catch (error) {
+			this.handleError(error);
+			return null;
+		}
+	}
+
+	resetCache(): void {
+		this.cache.clear();
+		this.cacheVersion = 0;
+	}
+
 	// Dodawanie nowego hasła
 	async createPassword(passwordData: Password): Promise<void> {
 		try {
@@ -135,6 +220,7 @@ class PasswordsService {
 	private handleError(error: any): void {
 		if (axios.isAxiosError(error)) {
 			if (error.response?.status === 401) {
+				this.resetCache();
 				const authStore = useAuthStore();
 				authStore.logout();
 			}
@@ -113,6 +113,12 @@ export const useAuthStore = defineStore('auth', {
          * Wylogowanie użytkownika
          */
         logout() {
+            // Serwer czyści odszyfrowany sejf z pamięci podręcznej, błąd nie blokuje wylogowania
+            if (this.token) {
+                axios.post('http://localhost:1234/api/authentication/logout', null, {
+                    headers: { Authorization: `Bearer ${this.token}` }
+                }).catch(() => {});
+            }
             this.clearAuth();
         },
 